@@ -0,0 +1,183 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "str_alloc.h"
+
+#ifndef SIZE_MAX
+#define SIZE_MAX ((size_t) -1)
+#endif
+
+/* Alignment of arena_alloc() results, enough for any scalar type */
+#define ARENA_ALIGN 16
+#define ARENA_ALIGN_UP(n) (((n) + (ARENA_ALIGN - 1)) & ~(size_t) (ARENA_ALIGN - 1))
+
+struct st_arena_chunk
+{
+	st_arena_chunk *next;
+	size_t capacity;
+	size_t used;
+};
+
+/* The data of a chunk starts at this offset from the chunk, so that it is aligned. */
+#define ARENA_CHUNK_HEADER ARENA_ALIGN_UP(sizeof (st_arena_chunk))
+
+void arena_init(st_arena *a, size_t chunk_size)
+{
+	memset(a, 0, sizeof *a);
+	a->chunk_size = chunk_size;
+}
+
+void arena_free(st_arena *a)
+{
+	st_arena_chunk *c = a->first;
+
+	while (c != NULL)
+	{
+		st_arena_chunk *next = c->next;
+		str_free(c);
+		c = next;
+	}
+
+	arena_init(a, a->chunk_size);
+}
+
+void arena_reset(st_arena *a)
+{
+	st_arena_chunk *c;
+
+	for (c = a->first; c != NULL; c = c->next)
+		c->used = 0;
+
+	a->current = a->first;
+	memset(a->free_blocks, 0, sizeof a->free_blocks);
+}
+
+/* Allocates `size` bytes at an offset of the current chunk that is aligned if `aligned` is
+   non-zero, or right after the previous allocation otherwise. */
+static void *arena_take(st_arena *a, size_t size, int aligned)
+{
+	st_arena_chunk *c = a->current;
+	size_t capacity;
+
+	if (size > SIZE_MAX - ARENA_CHUNK_HEADER - ARENA_ALIGN)
+		return NULL;
+	if (aligned)
+		size = ARENA_ALIGN_UP(size);
+
+	if (c != NULL)
+	{
+		const size_t offset = (aligned ? ARENA_ALIGN_UP(c->used) : c->used);
+
+		if (c->capacity - offset >= size)
+		{
+			c->used = offset + size;
+			return (char *) c + ARENA_CHUNK_HEADER + offset;
+		}
+	}
+
+	// Move on to the next chunk if it was kept by arena_reset() and is large enough.
+	if (c != NULL && c->next != NULL && c->next->capacity >= size)
+	{
+		c = a->current = c->next;
+		c->used = size;
+		return (char *) c + ARENA_CHUNK_HEADER;
+	}
+
+	capacity = (size > a->chunk_size ? ARENA_ALIGN_UP(size) : ARENA_ALIGN_UP(a->chunk_size));
+	c = (st_arena_chunk *) str_malloc(ARENA_CHUNK_HEADER + capacity);
+	if (c == NULL)
+		return NULL;
+
+	c->capacity = capacity;
+	c->used = size;
+
+	// Insert the new chunk after the current one, so that chunks kept by arena_reset() stay usable.
+	if (a->current == NULL)
+	{
+		c->next = a->first;
+		a->first = c;
+	}
+	else
+	{
+		c->next = a->current->next;
+		a->current->next = c;
+	}
+	a->current = c;
+	a->allocated += capacity;
+
+	return (char *) c + ARENA_CHUNK_HEADER;
+}
+
+void *arena_alloc(st_arena *a, size_t size)
+{
+	return arena_take(a, size, 1);
+}
+
+void *arena_alloc_unaligned(st_arena *a, size_t size)
+{
+	return arena_take(a, size, 0);
+}
+
+/* Returns the size class of blocks of `size` bytes, or ARENA_NUM_CLASSES if there is none. */
+static unsigned arena_block_class(size_t size)
+{
+	unsigned c = 0;
+
+	while (c < ARENA_NUM_CLASSES && ((size_t) ARENA_MIN_BLOCK_SIZE << c) < size)
+		++c;
+
+	return c;
+}
+
+void *arena_alloc_block(st_arena *a, size_t size)
+{
+	const unsigned c = arena_block_class(size);
+	void *block;
+
+	if (c == ARENA_NUM_CLASSES)
+		return NULL;
+
+	block = a->free_blocks[c];
+	if (block != NULL)
+	{
+		memcpy(&a->free_blocks[c], block, sizeof (void *));
+		return block;
+	}
+
+	return arena_alloc(a, (size_t) ARENA_MIN_BLOCK_SIZE << c);
+}
+
+void arena_free_block(st_arena *a, void *block, size_t size)
+{
+	const unsigned c = arena_block_class(size);
+
+	// The first bytes of a free block link it to the next one of its class.
+	memcpy(block, &a->free_blocks[c], sizeof (void *));
+	a->free_blocks[c] = block;
+}
+
+const st_arena_chunk *arena_next_chunk(const st_arena *a, const st_arena_chunk *c, const char **data, size_t *used)
+{
+	c = (c == NULL ? a->first : c->next);
+
+	if (c != NULL)
+	{
+		*data = (const char *) c + ARENA_CHUNK_HEADER;
+		*used = c->used;
+	}
+
+	return c;
+}
+
+size_t arena_allocated(const st_arena *a)
+{
+	return a->allocated;
+}
@@ -0,0 +1,82 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_ARENA_H
+#define LIB_MYSQLUDF_STR_ARENA_H 1
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The number of size classes of blocks that can be returned to an arena: powers of two from
+ * @c ARENA_MIN_BLOCK_SIZE bytes up. */
+#define ARENA_NUM_CLASSES 32
+#define ARENA_MIN_BLOCK_SIZE 16
+
+typedef struct st_arena_chunk st_arena_chunk;
+
+/** A chunked bump allocator. Memory is taken from chunks that are never moved, so pointers into
+ * the arena stay valid until arena_reset() or arena_free(). Individual allocations cannot be
+ * freed, except for blocks from arena_alloc_block(), which can be returned to per-size-class free
+ * lists for reuse. */
+typedef struct st_arena
+{
+	st_arena_chunk *first;   /* the chunks, in allocation order */
+	st_arena_chunk *current; /* the chunk that allocations are taken from */
+	size_t chunk_size;
+	size_t allocated;        /* total size of the chunks */
+	void *free_blocks[ARENA_NUM_CLASSES];
+} st_arena;
+
+/** Initializes the empty arena @p a, whose chunks will hold at least @p chunk_size bytes each.
+ * No memory is allocated until the first allocation. */
+void arena_init(st_arena *a, size_t chunk_size);
+
+/** Frees all memory of @p a. */
+void arena_free(st_arena *a);
+
+/** Invalidates all allocations from @p a, keeping its chunks for reuse. */
+void arena_reset(st_arena *a);
+
+/** Allocates @p size bytes, aligned for any type, from @p a.
+ *
+ * @returns a pointer to the bytes, or NULL if memory could not be allocated. */
+void *arena_alloc(st_arena *a, size_t size);
+
+/** Allocates @p size bytes from @p a right after the previous allocation from the same chunk,
+ * without padding. A series of such allocations is laid out back to back, so that it can be read
+ * again in order with arena_next_chunk().
+ *
+ * @returns a pointer to the bytes, or NULL if memory could not be allocated. */
+void *arena_alloc_unaligned(st_arena *a, size_t size);
+
+/** Allocates a block of at least @p size bytes from the free list of its size class, or from
+ * @p a if that list is empty. The block can be returned with arena_free_block().
+ *
+ * @returns a pointer to the block, or NULL if memory could not be allocated. */
+void *arena_alloc_block(st_arena *a, size_t size);
+
+/** Returns @p block, allocated by arena_alloc_block() with the same @p size, for reuse. */
+void arena_free_block(st_arena *a, void *block, size_t size);
+
+/** Iterates over the chunks of @p a in allocation order: each chunk holds the allocations made
+ * from it since arena_reset() back to back, except for the padding of aligned allocations, in its
+ * first @p *used bytes, which start at @p *data.
+ *
+ * @returns the chunk after @p c, or the first chunk if @p c is NULL, or NULL if there are no more
+ *		chunks. */
+const st_arena_chunk *arena_next_chunk(const st_arena *a, const st_arena_chunk *c, const char **data, size_t *used);
+
+/** @returns the total size of the chunks of @p a. */
+size_t arena_allocated(const st_arena *a);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "big_buffer.h"
+#include "str_alloc.h"
+
+#ifndef SIZE_MAX
+#define SIZE_MAX ((size_t) -1)
+#endif
+
+#define BIG_BUFFER_ALIGN_UP(n) (((n) + (BIG_BUFFER_MAP_ALIGN - 1)) & ~(size_t) (BIG_BUFFER_MAP_ALIGN - 1))
+
+size_t big_buffer_default_threshold(void)
+{
+	const char *s = getenv("LIB_MYSQLUDF_STR_MMAP_THRESHOLD");
+	char *end;
+	unsigned long long n;
+
+	if (s == NULL || *s == '\0')
+		return BIG_BUFFER_DEFAULT_THRESHOLD;
+
+	n = strtoull(s, &end, 10);
+	if (*end != '\0' || n > SIZE_MAX)
+		return BIG_BUFFER_DEFAULT_THRESHOLD;
+
+	return (size_t) n;
+}
+
+void big_buffer_init(st_big_buffer *b)
+{
+	b->data = NULL;
+	b->capacity = 0;
+	b->threshold = big_buffer_default_threshold();
+	b->mapped = 0;
+}
+
+/* Returns a mapping of `size` bytes, a multiple of BIG_BUFFER_MAP_ALIGN, at an address that is a
+   multiple of it too, or NULL. */
+static char *big_buffer_map(size_t size)
+{
+#ifdef _WIN32
+	// Large pages need a privilege that the server does not usually have.
+	return (char *) VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	char *p, *aligned;
+	size_t head;
+
+	// Map one more huge page than needed, and unmap what is before and after the aligned range.
+	if (size > SIZE_MAX - BIG_BUFFER_MAP_ALIGN)
+		return NULL;
+	p = (char *) mmap(NULL, size + BIG_BUFFER_MAP_ALIGN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == (char *) MAP_FAILED)
+		return NULL;
+
+	aligned = (char *) BIG_BUFFER_ALIGN_UP((uintptr_t) p);
+	head = (size_t) (aligned - p);
+	if (head != 0)
+		munmap(p, head);
+	munmap(aligned + size, BIG_BUFFER_MAP_ALIGN - head);
+
+#ifdef MADV_HUGEPAGE
+	// Only a hint: transparent huge pages may be disabled, in which case this fails harmlessly.
+	madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+
+	return aligned;
+#endif
+}
+
+static void big_buffer_unmap(char *p, size_t size)
+{
+#ifdef _WIN32
+	(void) size;
+	VirtualFree(p, 0, MEM_RELEASE);
+#else
+	munmap(p, size);
+#endif
+}
+
+int big_buffer_reserve(st_big_buffer *b, size_t size)
+{
+	if (size <= b->capacity && b->data != NULL)
+		return 0;
+
+	// Grow geometrically, so that rows of increasing lengths do not replace the buffer each time.
+	if (b->capacity != 0 && size < b->capacity * 2 && b->capacity <= SIZE_MAX / 2)
+		size = b->capacity * 2;
+
+	big_buffer_free(b);
+
+	if (b->threshold != 0 && size >= b->threshold)
+	{
+		if (size > SIZE_MAX - BIG_BUFFER_MAP_ALIGN)
+			return 1;
+		size = BIG_BUFFER_ALIGN_UP(size);
+		if (str_memory_charge(size) != 0)
+			return 1;
+		b->data = big_buffer_map(size);
+		if (b->data == NULL)
+			str_memory_discharge(size);
+		b->mapped = 1;
+	}
+	else
+	{
+		b->data = (char *) str_malloc(size != 0 ? size : 1);
+	}
+
+	if (b->data == NULL)
+	{
+		b->mapped = 0;
+		return 1;
+	}
+
+	b->capacity = size;
+	return 0;
+}
+
+void big_buffer_free(st_big_buffer *b)
+{
+	if (b->data != NULL)
+	{
+		if (b->mapped)
+		{
+			big_buffer_unmap(b->data, b->capacity);
+			str_memory_discharge(b->capacity);
+		}
+		else
+			str_free(b->data);
+	}
+
+	b->data = NULL;
+	b->capacity = 0;
+	b->mapped = 0;
+}
@@ -0,0 +1,56 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	Result buffers for values that can be hundreds of megabytes. Small buffers come from malloc().
+	Buffers of at least a threshold are anonymous memory mappings, aligned to and advised for huge
+	pages, so that filling them takes few page faults and does not fragment the heap of the server.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_BIG_BUFFER_H
+#define LIB_MYSQLUDF_STR_BIG_BUFFER_H 1
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The default threshold, in bytes. It can be changed with the environment variable
+ * @c LIB_MYSQLUDF_STR_MMAP_THRESHOLD of the server; 0 disables mappings. */
+#define BIG_BUFFER_DEFAULT_THRESHOLD (8 * 1024 * 1024)
+
+/** The size that mappings are aligned to and rounded up to: that of a huge page of x86-64. */
+#define BIG_BUFFER_MAP_ALIGN (2 * 1024 * 1024)
+
+/** A buffer that grows to the largest size that was reserved. Its contents are not kept when it
+ * grows. */
+typedef struct st_big_buffer
+{
+	char *data;
+	size_t capacity;
+	size_t threshold; /* buffers of at least this size are mapped, unless it is 0 */
+	int mapped;
+} st_big_buffer;
+
+/** @returns the threshold from the environment, or @c BIG_BUFFER_DEFAULT_THRESHOLD. */
+size_t big_buffer_default_threshold(void);
+
+/** Initializes the empty buffer @p b with big_buffer_default_threshold(). */
+void big_buffer_init(st_big_buffer *b);
+
+/** Makes @p b hold at least @p size bytes. The mapping or block is reused if it is large enough.
+ *
+ * @returns 0 if successful, or a non-zero value if memory could not be allocated, in which case
+ *		@p b is empty. */
+int big_buffer_reserve(st_big_buffer *b, size_t size);
+
+/** Frees the memory of @p b, which becomes empty. */
+void big_buffer_free(st_big_buffer *b);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,89 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_BIT_UTILS_H
+#define LIB_MYSQLUDF_STR_BIT_UTILS_H 1
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define STR_INLINE static __inline
+#else
+#define STR_INLINE static inline
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define STR_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/** Returns the number of trailing zero bits of @p x, which must be non-zero. */
+STR_INLINE unsigned bit_ctz64(uint64_t x)
+{
+#if defined(__GNUC__)
+	return (unsigned) __builtin_ctzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long i;
+	_BitScanForward64(&i, x);
+	return (unsigned) i;
+#else
+	unsigned n = 0;
+	while ((x & 1) == 0) {
+		x >>= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+/** Returns the number of leading zero bits of @p x, which must be non-zero. */
+STR_INLINE unsigned bit_clz64(uint64_t x)
+{
+#if defined(__GNUC__)
+	return (unsigned) __builtin_clzll(x);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	unsigned long i;
+	_BitScanReverse64(&i, x);
+	return 63u - (unsigned) i;
+#else
+	unsigned n = 0;
+	while ((x & UINT64_C(0x8000000000000000)) == 0) {
+		x <<= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+/** Returns the number of set bits of @p x. */
+STR_INLINE unsigned bit_popcount64(uint64_t x)
+{
+#if defined(__GNUC__)
+	return (unsigned) __builtin_popcountll(x);
+#else
+	x = x - ((x >> 1) & UINT64_C(0x5555555555555555));
+	x = (x & UINT64_C(0x3333333333333333)) + ((x >> 2) & UINT64_C(0x3333333333333333));
+	x = (x + (x >> 4)) & UINT64_C(0x0F0F0F0F0F0F0F0F);
+	return (unsigned) ((x * UINT64_C(0x0101010101010101)) >> 56);
+#endif
+}
+
+/** Returns the inclusive prefix XOR of @p x: bit @c i of the result is the XOR of bits
+ * <code>0..i</code> of @p x. Applied to a mask of quote characters, this yields the mask
+ * of bytes that are inside a quoted region (opening quote included, closing quote excluded). */
+STR_INLINE uint64_t bit_prefix_xor64(uint64_t x)
+{
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+	return x;
+}
+
+#endif
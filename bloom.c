@@ -0,0 +1,228 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_utils.h"
+#include "bloom.h"
+#include "str_alloc.h"
+#include "str_hash.h"
+
+#define BLOOM_SEED UINT64_C(0x5342463153424631)
+
+static const char bloom_magic[4] = { 'S', 'B', 'F', '1' };
+
+/* Multipliers that derive the bit set in each word of a block from the hash (those of Parquet) */
+static const uint32_t bloom_salt[BLOOM_BLOCK_WORDS] = {
+	0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+	0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+STR_INLINE uint64_t bloom_load64le(const unsigned char *p)
+{
+	return (uint64_t) p[0] | ((uint64_t) p[1] << 8) | ((uint64_t) p[2] << 16) | ((uint64_t) p[3] << 24)
+			| ((uint64_t) p[4] << 32) | ((uint64_t) p[5] << 40) | ((uint64_t) p[6] << 48) | ((uint64_t) p[7] << 56);
+}
+
+STR_INLINE void bloom_store64le(unsigned char *p, uint64_t v)
+{
+	int i;
+	for (i = 0; i < 8; ++i, v >>= 8)
+		p[i] = (unsigned char) (v & 0xFF);
+}
+
+/* The upper half of the hash selects the block, the lower half the bits within it. */
+STR_INLINE uint32_t bloom_block_index(uint64_t h, uint32_t num_blocks)
+{
+	return (uint32_t) (((h >> 32) * (uint64_t) num_blocks) >> 32);
+}
+
+STR_INLINE uint64_t bloom_word_mask(uint64_t h, int i)
+{
+	return UINT64_C(1) << (((uint32_t) h * bloom_salt[i]) >> 26);
+}
+
+uint64_t bloom_hash(const char *key, size_t key_length)
+{
+	return str_hash64(key, key_length, BLOOM_SEED);
+}
+
+/* The false positive probability when keys are spread over the blocks with an average of
+   keys_per_block keys each. The number of keys of a block follows a Poisson distribution; a block
+   with i keys has each bit of a word set with probability 1 - (63/64)^i. */
+static double bloom_fpp(double keys_per_block)
+{
+	const int last = (int) (keys_per_block + 10 * sqrt(keys_per_block) + 20);
+	double p = exp(-keys_per_block); /* Poisson probability of i keys */
+	double q = 1.0; /* (63/64)^i */
+	double sum = 0;
+	int i;
+
+	for (i = 0; i <= last; ++i)
+	{
+		const double bit = 1.0 - q;
+		const double bit2 = bit * bit, bit4 = bit2 * bit2;
+
+		sum += p * bit4 * bit4;
+		p *= keys_per_block / (i + 1);
+		q *= 63.0 / 64.0;
+	}
+
+	return sum;
+}
+
+uint32_t bloom_blocks_for(uint64_t expected_n, double fpp)
+{
+	double lo = 1e-6, hi = 64.0 * BLOOM_BLOCK_WORDS, blocks;
+	int i;
+
+	if (expected_n == 0)
+		return 1;
+
+	/* The largest average number of keys per block that still meets fpp */
+	for (i = 0; i < 60; ++i)
+	{
+		const double mid = (lo + hi) / 2;
+		if (bloom_fpp(mid) <= fpp)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	blocks = ceil((double) expected_n / lo);
+	if (blocks > (double) BLOOM_MAX_BLOCKS)
+		return 0;
+
+	return (blocks < 1 ? 1 : (uint32_t) blocks);
+}
+
+int bloom_filter_init(st_bloom_filter *bf, uint32_t num_blocks)
+{
+	const size_t size = (size_t) num_blocks * BLOOM_BLOCK_SIZE;
+
+	if (num_blocks == 0 || num_blocks > BLOOM_MAX_BLOCKS || size / BLOOM_BLOCK_SIZE != num_blocks)
+		return 1;
+
+	bf->allocation = str_calloc(1, size + BLOOM_BLOCK_SIZE - 1);
+	if (bf->allocation == NULL)
+		return 1;
+
+	bf->blocks = (uint64_t *) (((uintptr_t) bf->allocation + BLOOM_BLOCK_SIZE - 1) & ~(uintptr_t) (BLOOM_BLOCK_SIZE - 1));
+	bf->num_blocks = num_blocks;
+	bf->num_keys = 0;
+	return 0;
+}
+
+void bloom_filter_free(st_bloom_filter *bf)
+{
+	str_free(bf->allocation);
+	bf->allocation = NULL;
+	bf->blocks = NULL;
+	bf->num_blocks = 0;
+	bf->num_keys = 0;
+}
+
+void bloom_filter_clear(st_bloom_filter *bf)
+{
+	memset(bf->blocks, 0, (size_t) bf->num_blocks * BLOOM_BLOCK_SIZE);
+	bf->num_keys = 0;
+}
+
+void bloom_filter_add(st_bloom_filter *bf, uint64_t h)
+{
+	uint64_t *const block = bf->blocks + (size_t) bloom_block_index(h, bf->num_blocks) * BLOOM_BLOCK_WORDS;
+	int i;
+
+	for (i = 0; i < BLOOM_BLOCK_WORDS; ++i)
+		block[i] |= bloom_word_mask(h, i);
+	++bf->num_keys;
+}
+
+int bloom_filter_contains(const st_bloom_filter *bf, uint64_t h)
+{
+	const uint64_t *const block = bf->blocks + (size_t) bloom_block_index(h, bf->num_blocks) * BLOOM_BLOCK_WORDS;
+	uint64_t missing = 0;
+	int i;
+
+	// No early exit: the eight independent word tests compile to straight-line (or vector) code.
+	for (i = 0; i < BLOOM_BLOCK_WORDS; ++i)
+		missing |= bloom_word_mask(h, i) & ~block[i];
+
+	return missing == 0;
+}
+
+size_t bloom_filter_serialized_size(const st_bloom_filter *bf)
+{
+	return BLOOM_HEADER_SIZE + (size_t) bf->num_blocks * BLOOM_BLOCK_SIZE;
+}
+
+void bloom_filter_serialize(const st_bloom_filter *bf, char *dst)
+{
+	unsigned char *p = (unsigned char *) dst;
+	const size_t words = (size_t) bf->num_blocks * BLOOM_BLOCK_WORDS;
+	size_t i;
+
+	memcpy(p, bloom_magic, sizeof bloom_magic);
+	p[4] = (unsigned char) (bf->num_blocks & 0xFF);
+	p[5] = (unsigned char) ((bf->num_blocks >> 8) & 0xFF);
+	p[6] = (unsigned char) ((bf->num_blocks >> 16) & 0xFF);
+	p[7] = (unsigned char) ((bf->num_blocks >> 24) & 0xFF);
+	bloom_store64le(p + 8, bf->num_keys);
+
+	p += BLOOM_HEADER_SIZE;
+	for (i = 0; i < words; ++i, p += 8)
+		bloom_store64le(p, bf->blocks[i]);
+}
+
+uint32_t bloom_serialized_check(const char *src, size_t length)
+{
+	const unsigned char *p = (const unsigned char *) src;
+	uint32_t num_blocks;
+
+	if (length < BLOOM_HEADER_SIZE + BLOOM_BLOCK_SIZE || memcmp(p, bloom_magic, sizeof bloom_magic) != 0)
+		return 0;
+
+	num_blocks = (uint32_t) p[4] | ((uint32_t) p[5] << 8) | ((uint32_t) p[6] << 16) | ((uint32_t) p[7] << 24);
+	if (num_blocks == 0 || num_blocks > BLOOM_MAX_BLOCKS || length != BLOOM_HEADER_SIZE + (size_t) num_blocks * BLOOM_BLOCK_SIZE)
+		return 0;
+
+	return num_blocks;
+}
+
+int bloom_filter_deserialize(st_bloom_filter *bf, const char *src)
+{
+	const unsigned char *p = (const unsigned char *) src;
+	const uint32_t num_blocks = (uint32_t) p[4] | ((uint32_t) p[5] << 8) | ((uint32_t) p[6] << 16) | ((uint32_t) p[7] << 24);
+	size_t words, i;
+
+	if (bloom_filter_init(bf, num_blocks) != 0)
+		return 1;
+
+	bf->num_keys = bloom_load64le(p + 8);
+
+	words = (size_t) num_blocks * BLOOM_BLOCK_WORDS;
+	p += BLOOM_HEADER_SIZE;
+	for (i = 0; i < words; ++i, p += 8)
+		bf->blocks[i] = bloom_load64le(p);
+
+	return 0;
+}
+
+int bloom_serialized_contains(const char *src, uint32_t num_blocks, uint64_t h)
+{
+	const unsigned char *const block = (const unsigned char *) src + BLOOM_HEADER_SIZE
+			+ (size_t) bloom_block_index(h, num_blocks) * BLOOM_BLOCK_SIZE;
+	uint64_t missing = 0;
+	int i;
+
+	for (i = 0; i < BLOOM_BLOCK_WORDS; ++i)
+		missing |= bloom_word_mask(h, i) & ~bloom_load64le(block + 8 * i);
+
+	return missing == 0;
+}
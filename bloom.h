@@ -0,0 +1,98 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The filter is a split block Bloom filter, the layout used by Impala and by Parquet
+	(https://github.com/apache/parquet-format/blob/master/BloomFilter.md), but with blocks of one
+	64-byte cache line: each key selects one block and sets one bit in each of its eight 64-bit
+	words, so a lookup touches a single cache line.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_BLOOM_H
+#define LIB_MYSQLUDF_STR_BLOOM_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The number of 64-bit words of a block. */
+#define BLOOM_BLOCK_WORDS 8
+
+/** The size of a block in bytes. */
+#define BLOOM_BLOCK_SIZE (8 * BLOOM_BLOCK_WORDS)
+
+/** The size of the header of a serialized filter: the magic bytes <code>SBF1</code>, the
+ * number of blocks as a 32-bit little-endian integer, and the number of keys that were added as
+ * a 64-bit little-endian integer. The blocks follow, each word stored little-endian. */
+#define BLOOM_HEADER_SIZE 16
+
+/** The largest number of blocks of a filter, chosen so that the serialized filter fits in a
+ * LONGBLOB. */
+#define BLOOM_MAX_BLOCKS ((0xFFFFFFFFUL - BLOOM_HEADER_SIZE) / BLOOM_BLOCK_SIZE)
+
+typedef struct st_bloom_filter
+{
+	uint64_t *blocks; /* num_blocks * BLOOM_BLOCK_WORDS words, aligned to BLOOM_BLOCK_SIZE */
+	uint32_t num_blocks;
+	uint64_t num_keys;
+	void *allocation; /* what to free() */
+} st_bloom_filter;
+
+/** @returns the hash of a key as expected by the other functions. */
+uint64_t bloom_hash(const char *key, size_t key_length);
+
+/** Computes how many blocks a filter needs so that, holding @p expected_n keys, its false
+ * positive probability does not exceed @p fpp, which must be in <code>(0, 1)</code>.
+ *
+ * @returns the number of blocks (at least 1), or 0 if more than @c BLOOM_MAX_BLOCKS would be
+ *		needed. */
+uint32_t bloom_blocks_for(uint64_t expected_n, double fpp);
+
+/** Allocates an empty filter of @p num_blocks blocks in @p bf.
+ *
+ * @returns 0 if successful, or a non-zero value if memory could not be allocated. */
+int bloom_filter_init(st_bloom_filter *bf, uint32_t num_blocks);
+
+/** Frees the memory of @p bf, which may also be zero-initialized. */
+void bloom_filter_free(st_bloom_filter *bf);
+
+/** Removes all keys from @p bf. */
+void bloom_filter_clear(st_bloom_filter *bf);
+
+/** Adds the key whose bloom_hash() is @p h to @p bf. */
+void bloom_filter_add(st_bloom_filter *bf, uint64_t h);
+
+/** @returns non-zero if the key whose bloom_hash() is @p h may be in @p bf; 0 if it is
+ *		definitely not. */
+int bloom_filter_contains(const st_bloom_filter *bf, uint64_t h);
+
+/** @returns the size of the serialized form of @p bf. */
+size_t bloom_filter_serialized_size(const st_bloom_filter *bf);
+
+/** Writes the serialized form of @p bf to @p dst. */
+void bloom_filter_serialize(const st_bloom_filter *bf, char *dst);
+
+/** Checks that the @p length bytes at @p src are a serialized filter.
+ *
+ * @returns the number of blocks of the filter, or 0 if @p src is not a serialized filter. */
+uint32_t bloom_serialized_check(const char *src, size_t length);
+
+/** Loads the serialized filter at @p src, which must have passed bloom_serialized_check(),
+ * into a new filter @p bf.
+ *
+ * @returns 0 if successful, or a non-zero value if memory could not be allocated. */
+int bloom_filter_deserialize(st_bloom_filter *bf, const char *src);
+
+/** Same as bloom_filter_contains(), but probes the serialized filter at @p src in place. The
+ * filter must have passed bloom_serialized_check(), which returned @p num_blocks. */
+int bloom_serialized_contains(const char *src, uint32_t num_blocks, uint64_t h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
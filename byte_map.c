@@ -0,0 +1,62 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stddef.h>
+
+#include "kernel_isa.h"
+#include "kernel_tuning.h"
+#include "string_utils.h"
+
+void byte_map_fill(unsigned char *table, const char *src, const char *dst, size_t length)
+{
+	size_t i;
+
+	for (i = 0; i < 256; ++i)
+		table[i] = (unsigned char) i;
+
+	for (i = 0; i < length; ++i)
+		table[(unsigned char) src[i]] = (unsigned char) dst[i];
+}
+
+size_t byte_map_unchanged_length(const unsigned char *table, const char *src, size_t length)
+{
+	const unsigned char *s = (const unsigned char *) src;
+	size_t i = 0;
+
+	// Unrolled so that the loads of four chars do not wait on each other's comparisons.
+	for (; i + 4 <= length; i += 4) {
+		if ((table[s[i]] ^ s[i]) | (table[s[i + 1]] ^ s[i + 1]) | (table[s[i + 2]] ^ s[i + 2]) | (table[s[i + 3]] ^ s[i + 3]))
+			break;
+	}
+
+	for (; i < length && table[s[i]] == s[i]; ++i)
+		;
+
+	return i;
+}
+
+void byte_map_scalar(char *__restrict dest, const unsigned char *table, const char *__restrict src, size_t length)
+{
+	const unsigned char *s = (const unsigned char *) src;
+	unsigned char *d = (unsigned char *) dest;
+	size_t i;
+
+	for (i = 0; i < length; ++i)
+		d[i] = table[s[i]];
+}
+
+void byte_map_vector(char *__restrict dest, const unsigned char *table, const char *__restrict src, size_t length)
+{
+	kernel_isa()->transforms[KERNEL_TRANSFORM_translate]((unsigned char *) dest, (const unsigned char *) src, table, length);
+}
+
+void byte_map(char *__restrict dest, const unsigned char *table, const char *__restrict src, size_t length)
+{
+	if (length >= STR_TUNING_TRANSLATE_MIN_LENGTH)
+		byte_map_vector(dest, table, src, length);
+	else
+		byte_map_scalar(dest, table, src, length);
+}
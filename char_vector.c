@@ -10,10 +10,8 @@
 #define SIZE_MAX ((size_t) -1)
 #endif
 
-#undef MAX
-#define MAX(a, b) ((a) > (b) ? (a) : (b))
-
 #include "char_vector.h"
+#include "str_alloc.h"
 
 struct st_char_vector
 {
@@ -24,17 +22,17 @@ struct st_char_vector
 
 st_char_vector *char_vector_alloc()
 {
-	st_char_vector *vec = (st_char_vector *) malloc(sizeof (st_char_vector));
+	st_char_vector *vec = (st_char_vector *) str_malloc(sizeof (st_char_vector));
 
 	if (vec == NULL)
 		return NULL;
 
 	vec->vec_capacity = 255;
 
-	vec->buf = (char *) malloc(vec->vec_capacity);
+	vec->buf = (char *) str_malloc(vec->vec_capacity);
 	if (vec->buf == NULL)
 	{
-		free(vec);
+		str_free(vec);
 		return NULL;
 	}
 
@@ -46,11 +44,11 @@ st_char_vector *char_vector_alloc()
 void char_vector_free(st_char_vector *vec)
 {
 	assert(vec->buf != NULL);
-	free(vec->buf);
+	str_free(vec->buf);
 #ifndef NDEBUG
 	vec->buf = NULL;
 #endif
-	free(vec);
+	str_free(vec);
 }
 
 size_t char_vector_length(const st_char_vector *vec)
@@ -63,27 +61,58 @@ char* char_vector_get_ptr(st_char_vector *vec)
 	return vec->buf;
 }
 
+void char_vector_clear(st_char_vector *vec)
+{
+	vec->vec_length = 0;
+}
+
+int char_vector_reserve(st_char_vector *vec, size_t capacity)
+{
+	char *tmp;
+
+	if (capacity <= vec->vec_capacity)
+	{
+		return 0;
+	}
+
+	tmp = (char *) str_realloc(vec->buf, capacity);
+	if (tmp == NULL)
+	{
+		return ENOMEM;
+	}
+
+	vec->buf = tmp;
+	vec->vec_capacity = capacity;
+
+	return 0;
+}
+
 int char_vector_append(st_char_vector *vec, const char *str, size_t str_length)
 {
-	if (SIZE_MAX - MAX(255, str_length) < vec->vec_capacity)
+	if (SIZE_MAX - vec->vec_length < str_length)
 	{
 		return E2BIG;
 	}
 
 	if (vec->vec_capacity < (vec->vec_length + str_length))
 	{
-		// Need to allocate more space
-		size_t new_capacity = vec->vec_capacity + MAX(255, str_length);
-		char *tmp = (char *) malloc(new_capacity);
-		if (tmp == NULL)
+		// Need to allocate more space. Growing geometrically keeps a series of appends linear.
+		size_t new_capacity = vec->vec_length + str_length;
+		const char *old_buf = vec->buf;
+		int err;
+
+		if (new_capacity < vec->vec_capacity * 2 && vec->vec_capacity <= SIZE_MAX / 2)
+			new_capacity = vec->vec_capacity * 2;
+
+		err = char_vector_reserve(vec, new_capacity);
+		if (err != 0)
 		{
-			return ENOMEM;
+			return err;
 		}
 
-		memcpy(tmp, vec->buf, vec->vec_length);
-
-		vec->buf = tmp;
-		vec->vec_capacity = new_capacity;
+		// str may have been a pointer within the old buffer.
+		if (str >= old_buf && str < old_buf + vec->vec_length)
+			str = vec->buf + (str - old_buf);
 	}
 
 	memmove(vec->buf + vec->vec_length, str, str_length); // Use memmove() because str may be a pointer within [vec->buf, vec->buf + vec->vec_length)
@@ -30,6 +30,18 @@ size_t char_vector_length(const st_char_vector *vec);
  * and they are mutable. */
 char* char_vector_get_ptr(st_char_vector *vec);
 
+/** Empties @p vec, keeping its memory for reuse.
+ *
+ * This function invalidates all iterators. */
+void char_vector_clear(st_char_vector *vec);
+
+/** Makes room in @p vec for a length of at least @p capacity chars, so that appending up to that length does not allocate.
+ *
+ * This function invalidates all iterators.
+ *
+ * @returns 0 if there was no error. Otherwise, a non-zero error code is returned and @p vec is unaffected. */
+int char_vector_reserve(st_char_vector *vec, size_t capacity);
+
 /** Appends the first @p str_length chars of @p str to @p vec.
  *
  * This function invalidates all iterators.
@@ -0,0 +1,173 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bit_utils.h"
+#include "csv_field.h"
+
+/* Returns a mask whose bit i is set iff block[i] == c, for i in [0, 64). */
+static uint64_t csv_match_mask(const unsigned char *block, unsigned char c)
+{
+#ifdef STR_HAVE_SSE2
+	const __m128i v = _mm_set1_epi8((char) c);
+	const uint64_t m0 = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) block), v));
+	const uint64_t m1 = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (block + 16)), v));
+	const uint64_t m2 = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (block + 32)), v));
+	const uint64_t m3 = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (block + 48)), v));
+	return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+#else
+	uint64_t m = 0;
+	int i;
+
+	for (i = 63; i >= 0; --i)
+		m = (m << 1) | (uint64_t) (block[i] == c);
+
+	return m;
+#endif
+}
+
+int csv_field_locate(const char *line, size_t line_length, size_t n, char delim, char quote,
+		size_t *field_begin, size_t *field_end)
+{
+	unsigned char tail[64];
+	uint64_t inside_carry = 0; /* all ones if the previous block ended inside a quoted region */
+	size_t pos;
+	size_t seen = 0; /* number of unquoted delimiters seen so far */
+	size_t begin = 0;
+
+	if (n == 0)
+		return 0;
+
+	for (pos = 0; pos < line_length; pos += 64)
+	{
+		const unsigned char *block = (const unsigned char *) line + pos;
+		const size_t avail = line_length - pos;
+		uint64_t quotes, delims, inside;
+
+		if (avail < 64)
+		{
+			memcpy(tail, block, avail);
+			memset(tail + avail, 0, 64 - avail);
+			block = tail;
+		}
+
+		quotes = csv_match_mask(block, (unsigned char) quote);
+		delims = csv_match_mask(block, (unsigned char) delim);
+
+		if (avail < 64)
+		{
+			const uint64_t valid = (UINT64_C(1) << avail) - 1;
+			quotes &= valid;
+			delims &= valid;
+		}
+
+		inside = bit_prefix_xor64(quotes) ^ inside_carry;
+		inside_carry = 0 - (inside >> 63);
+		delims &= ~inside;
+
+		// Skip the whole block if neither end of the field is in it.
+		if (seen + bit_popcount64(delims) < n - 1)
+		{
+			seen += bit_popcount64(delims);
+			continue;
+		}
+
+		while (delims != 0)
+		{
+			const size_t at = pos + bit_ctz64(delims);
+			delims &= delims - 1;
+
+			if (++seen == n)
+			{
+				*field_begin = begin;
+				*field_end = at;
+				return 1;
+			}
+			else if (seen == n - 1)
+			{
+				begin = at + 1;
+			}
+		}
+	}
+
+	if (seen == n - 1)
+	{
+		*field_begin = begin;
+		*field_end = line_length;
+		return 1;
+	}
+
+	return 0;
+}
+
+int csv_field_locate_scalar(const char *line, size_t line_length, size_t n, char delim, char quote,
+		size_t *field_begin, size_t *field_end)
+{
+	size_t i;
+	size_t field = 1;
+	size_t begin = 0;
+	int in_quotes = 0;
+
+	if (n == 0)
+		return 0;
+
+	for (i = 0; i < line_length; ++i)
+	{
+		if (line[i] == quote)
+		{
+			in_quotes = !in_quotes;
+		}
+		else if (line[i] == delim && !in_quotes)
+		{
+			if (field == n)
+			{
+				*field_begin = begin;
+				*field_end = i;
+				return 1;
+			}
+
+			++field;
+			begin = i + 1;
+		}
+	}
+
+	if (field == n)
+	{
+		*field_begin = begin;
+		*field_end = line_length;
+		return 1;
+	}
+
+	return 0;
+}
+
+size_t csv_field_unquote(char *dest, const char *field, size_t field_length, char quote)
+{
+	char *d = dest;
+	size_t i;
+	int in_quotes = 0;
+
+	for (i = 0; i < field_length; ++i)
+	{
+		if (field[i] != quote)
+		{
+			*d++ = field[i];
+		}
+		else if (in_quotes && i + 1 < field_length && field[i + 1] == quote)
+		{
+			*d++ = quote;
+			++i;
+		}
+		else
+		{
+			in_quotes = !in_quotes;
+		}
+	}
+
+	return (size_t) (d - dest);
+}
@@ -0,0 +1,48 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_CSV_FIELD_H
+#define LIB_MYSQLUDF_STR_CSV_FIELD_H 1
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Locates field number @p n (1-based) of the CSV record @p line, which is @p line_length bytes long.
+ *
+ * Fields are separated by @p delim. A @p delim that appears between @p quote characters does not
+ * separate fields. @p delim and @p quote must differ.
+ *
+ * The record is scanned 64 bytes at a time: a bitmask of quote characters is turned into a
+ * mask of quoted regions with a prefix XOR, which then masks out the quoted delimiters.
+ *
+ * @returns 1 if the record has at least @p n fields, in which case the raw field (quotes included)
+ *		is <code>[line + *field_begin, line + *field_end)</code>. Otherwise, 0 is returned. */
+int csv_field_locate(const char *line, size_t line_length, size_t n, char delim, char quote,
+		size_t *field_begin, size_t *field_end);
+
+/** Equivalent to csv_field_locate(), but implemented as a byte-at-a-time state machine.
+ *
+ * This is the reference implementation that csv_field_locate() is benchmarked and tested against. */
+int csv_field_locate_scalar(const char *line, size_t line_length, size_t n, char delim, char quote,
+		size_t *field_begin, size_t *field_end);
+
+/** Copies the raw field @p field of @p field_length bytes to @p dest, removing the @p quote
+ * characters that open and close quoted regions and replacing each doubled @p quote within a
+ * quoted region by a single one.
+ *
+ * @p dest must have space for @p field_length bytes.
+ *
+ * @returns the number of bytes written to @p dest. */
+size_t csv_field_unquote(char *dest, const char *field, size_t field_length, char quote);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
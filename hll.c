@@ -0,0 +1,485 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bit_utils.h"
+#include "hll.h"
+#include "str_alloc.h"
+#include "str_hash.h"
+
+#define HLL_SEED UINT64_C(0x484C4C31484C4C31)
+#define HLL_ENCODING_SPARSE 0
+#define HLL_ENCODING_DENSE 1
+
+static const char hll_magic[4] = { 'H', 'L', 'L', '1' };
+
+#define HLL_ENTRY(index, value) (((uint32_t) (index) << 6) | (uint32_t) (value))
+#define HLL_ENTRY_INDEX(e) ((e) >> 6)
+#define HLL_ENTRY_VALUE(e) ((e) & 0x3F)
+
+STR_INLINE uint32_t hll_load32le(const unsigned char *p)
+{
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+STR_INLINE void hll_store32le(unsigned char *p, uint32_t v)
+{
+	p[0] = (unsigned char) (v & 0xFF);
+	p[1] = (unsigned char) ((v >> 8) & 0xFF);
+	p[2] = (unsigned char) ((v >> 16) & 0xFF);
+	p[3] = (unsigned char) ((v >> 24) & 0xFF);
+}
+
+/* The largest register value at a precision: one more than the number of hash bits left after
+   the index. */
+#define HLL_MAX_VALUE(precision) (65 - (precision))
+
+/* The first `precision` bits of the hash select the register; the value is the position of the
+   first 1 bit among the rest. */
+STR_INLINE uint32_t hll_entry_of(uint64_t h, unsigned precision)
+{
+	const uint64_t w = h << precision;
+	return HLL_ENTRY(h >> (64 - precision), w == 0 ? HLL_MAX_VALUE(precision) : bit_clz64(w) + 1);
+}
+
+/* Converts an entry of precision `from` to the lower precision `to`. The index bits that are
+   dropped become the leading bits of the rest of the hash. */
+STR_INLINE uint32_t hll_fold_entry(uint32_t e, unsigned from, unsigned to)
+{
+	const unsigned d = from - to;
+	const uint32_t index = HLL_ENTRY_INDEX(e);
+	const uint32_t dropped = index & ((UINT32_C(1) << d) - 1);
+
+	if (d == 0)
+		return e;
+	if (dropped != 0)
+		return HLL_ENTRY(index >> d, d - (63 - bit_clz64(dropped)));
+	return HLL_ENTRY(index >> d, d + HLL_ENTRY_VALUE(e));
+}
+
+uint64_t hll_hash(const char *key, size_t key_length)
+{
+	return str_hash64(key, key_length, HLL_SEED);
+}
+
+void hll_init(st_hll *hll, unsigned precision)
+{
+	memset(hll, 0, sizeof *hll);
+	hll->precision = precision;
+	// The sparse form is used while it is smaller than the dense one.
+	hll->sparse_limit = ((size_t) 1 << precision) / sizeof (uint32_t);
+}
+
+void hll_free(st_hll *hll)
+{
+	str_free(hll->registers);
+	str_free(hll->sparse);
+	str_free(hll->scratch);
+	hll->registers = NULL;
+	hll->sparse = hll->scratch = NULL;
+	hll->sparse_count = hll->sparse_capacity = hll->pending_count = 0;
+}
+
+void hll_reset(st_hll *hll, unsigned precision)
+{
+	if (precision != hll->precision)
+	{
+		hll_free(hll);
+		hll_init(hll, precision);
+		return;
+	}
+
+	// Each group starts sparse again, so that small groups stay cheap.
+	str_free(hll->registers);
+	hll->registers = NULL;
+	hll->sparse_count = 0;
+	hll->pending_count = 0;
+}
+
+/* Switches hll to the dense representation. */
+static int hll_to_dense(st_hll *hll)
+{
+	size_t i;
+
+	hll->registers = (uint8_t *) str_calloc((size_t) 1 << hll->precision, 1);
+	if (hll->registers == NULL)
+		return 1;
+
+	for (i = 0; i < hll->sparse_count; ++i)
+		hll->registers[HLL_ENTRY_INDEX(hll->sparse[i])] = (uint8_t) HLL_ENTRY_VALUE(hll->sparse[i]);
+	for (i = 0; i < hll->pending_count; ++i)
+	{
+		uint8_t *const r = hll->registers + HLL_ENTRY_INDEX(hll->pending[i]);
+		if (*r < HLL_ENTRY_VALUE(hll->pending[i]))
+			*r = (uint8_t) HLL_ENTRY_VALUE(hll->pending[i]);
+	}
+
+	hll->sparse_count = 0;
+	hll->pending_count = 0;
+	return 0;
+}
+
+static int hll_compare_entries(const void *a, const void *b)
+{
+	const uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+	return (x > y) - (x < y);
+}
+
+/* Sorts the pending entries into the sparse list, keeping the largest value per register, or
+   switches to the dense representation if the list would grow too long. */
+static int hll_flush(st_hll *hll)
+{
+	const size_t needed = hll->sparse_count + hll->pending_count;
+	size_t i = 0, j = 0, n = 0;
+	uint32_t *tmp;
+
+	if (needed > hll->sparse_limit)
+		return hll_to_dense(hll);
+
+	if (needed > hll->sparse_capacity)
+	{
+		size_t capacity = (hll->sparse_capacity == 0 ? 2 * HLL_PENDING_SIZE : 2 * hll->sparse_capacity);
+		if (capacity < needed)
+			capacity = needed;
+		if (capacity > hll->sparse_limit)
+			capacity = hll->sparse_limit;
+
+		tmp = (uint32_t *) str_realloc(hll->sparse, capacity * sizeof (uint32_t));
+		if (tmp == NULL)
+			return 1;
+		hll->sparse = tmp;
+
+		tmp = (uint32_t *) str_realloc(hll->scratch, capacity * sizeof (uint32_t));
+		if (tmp == NULL)
+			return 1;
+		hll->scratch = tmp;
+
+		hll->sparse_capacity = capacity;
+	}
+
+	// Entries sort by index, then by value, so the last entry of each index has the largest value.
+	qsort(hll->pending, hll->pending_count, sizeof (uint32_t), hll_compare_entries);
+
+	while (i < hll->sparse_count || j < hll->pending_count)
+	{
+		uint32_t e;
+
+		if (j == hll->pending_count || (i < hll->sparse_count && hll->sparse[i] < hll->pending[j]))
+			e = hll->sparse[i++];
+		else
+			e = hll->pending[j++];
+
+		if (n > 0 && HLL_ENTRY_INDEX(hll->scratch[n - 1]) == HLL_ENTRY_INDEX(e))
+			hll->scratch[n - 1] = e; /* merged in ascending order, so e is not smaller */
+		else
+			hll->scratch[n++] = e;
+	}
+
+	tmp = hll->sparse;
+	hll->sparse = hll->scratch;
+	hll->scratch = tmp;
+	hll->sparse_count = n;
+	hll->pending_count = 0;
+	return 0;
+}
+
+static int hll_add_entry(st_hll *hll, uint32_t e)
+{
+	if (hll->registers == NULL && hll->pending_count == HLL_PENDING_SIZE && hll_flush(hll) != 0)
+		return 1;
+
+	if (hll->registers != NULL)
+	{
+		uint8_t *const r = hll->registers + HLL_ENTRY_INDEX(e);
+		if (*r < HLL_ENTRY_VALUE(e))
+			*r = (uint8_t) HLL_ENTRY_VALUE(e);
+		return 0;
+	}
+
+	hll->pending[hll->pending_count++] = e;
+	return 0;
+}
+
+int hll_add(st_hll *hll, uint64_t h)
+{
+	return hll_add_entry(hll, hll_entry_of(h, hll->precision));
+}
+
+/* Lowers the precision of hll to `precision`. */
+static int hll_reduce(st_hll *hll, unsigned precision)
+{
+	st_hll reduced;
+	size_t i;
+
+	hll_init(&reduced, precision);
+
+	if (hll->registers != NULL)
+	{
+		const size_t m = (size_t) 1 << hll->precision;
+		for (i = 0; i < m; ++i)
+		{
+			if (hll->registers[i] != 0 && hll_add_entry(&reduced, hll_fold_entry(HLL_ENTRY(i, hll->registers[i]), hll->precision, precision)) != 0)
+				goto fail;
+		}
+	}
+	else
+	{
+		for (i = 0; i < hll->sparse_count; ++i)
+		{
+			if (hll_add_entry(&reduced, hll_fold_entry(hll->sparse[i], hll->precision, precision)) != 0)
+				goto fail;
+		}
+		for (i = 0; i < hll->pending_count; ++i)
+		{
+			if (hll_add_entry(&reduced, hll_fold_entry(hll->pending[i], hll->precision, precision)) != 0)
+				goto fail;
+		}
+	}
+
+	hll_free(hll);
+	*hll = reduced;
+	return 0;
+
+fail:
+	hll_free(&reduced);
+	return 1;
+}
+
+/* dst[i] = max(dst[i], src[i]) for the n bytes, n being a multiple of 16 */
+static void hll_max_registers(uint8_t *dst, const uint8_t *src, size_t n)
+{
+	size_t i;
+
+#ifdef STR_HAVE_SSE2
+	for (i = 0; i < n; i += 16)
+	{
+		const __m128i a = _mm_loadu_si128((const __m128i *) (dst + i));
+		const __m128i b = _mm_loadu_si128((const __m128i *) (src + i));
+		_mm_storeu_si128((__m128i *) (dst + i), _mm_max_epu8(a, b));
+	}
+#else
+	for (i = 0; i < n; ++i)
+	{
+		if (dst[i] < src[i])
+			dst[i] = src[i];
+	}
+#endif
+}
+
+unsigned hll_serialized_check(const char *src, size_t length)
+{
+	const unsigned char *p = (const unsigned char *) src;
+	unsigned precision, max_value;
+	size_t m, i;
+
+	if (length < HLL_HEADER_SIZE || memcmp(p, hll_magic, sizeof hll_magic) != 0 || p[6] != 0 || p[7] != 0)
+		return 0;
+
+	precision = p[4];
+	if (precision < HLL_MIN_PRECISION || precision > HLL_MAX_PRECISION)
+		return 0;
+	m = (size_t) 1 << precision;
+	max_value = HLL_MAX_VALUE(precision);
+
+	if (p[5] == HLL_ENCODING_DENSE)
+	{
+		if (length != HLL_HEADER_SIZE + m)
+			return 0;
+		for (i = 0; i < m; ++i)
+		{
+			if (p[HLL_HEADER_SIZE + i] > max_value)
+				return 0;
+		}
+	}
+	else if (p[5] == HLL_ENCODING_SPARSE)
+	{
+		size_t count;
+		uint32_t previous = 0;
+
+		if (length < HLL_HEADER_SIZE + 4)
+			return 0;
+		count = hll_load32le(p + HLL_HEADER_SIZE);
+		if (count > m || length != HLL_HEADER_SIZE + 4 + 4 * count)
+			return 0;
+
+		for (i = 0; i < count; ++i)
+		{
+			const uint32_t e = hll_load32le(p + HLL_HEADER_SIZE + 4 + 4 * i);
+			if (HLL_ENTRY_INDEX(e) >= m || HLL_ENTRY_VALUE(e) == 0 || HLL_ENTRY_VALUE(e) > max_value
+					|| (i > 0 && HLL_ENTRY_INDEX(e) <= HLL_ENTRY_INDEX(previous)))
+				return 0;
+			previous = e;
+		}
+	}
+	else
+	{
+		return 0;
+	}
+
+	return precision;
+}
+
+int hll_merge_serialized(st_hll *hll, const char *src, size_t length)
+{
+	const unsigned char *p = (const unsigned char *) src;
+	const unsigned precision = p[4];
+	size_t i;
+
+	if (precision < hll->precision && hll_reduce(hll, precision) != 0)
+		return 1;
+
+	if (p[5] == HLL_ENCODING_DENSE)
+	{
+		const uint8_t *const registers = p + HLL_HEADER_SIZE;
+		const size_t m = (size_t) 1 << precision;
+
+		if (precision == hll->precision)
+		{
+			if (hll->registers == NULL && hll_to_dense(hll) != 0)
+				return 1;
+			hll_max_registers(hll->registers, registers, m);
+			return 0;
+		}
+
+		for (i = 0; i < m; ++i)
+		{
+			if (registers[i] != 0 && hll_add_entry(hll, hll_fold_entry(HLL_ENTRY(i, registers[i]), precision, hll->precision)) != 0)
+				return 1;
+		}
+	}
+	else
+	{
+		const size_t count = hll_load32le(p + HLL_HEADER_SIZE);
+
+		for (i = 0; i < count; ++i)
+		{
+			const uint32_t e = hll_load32le(p + HLL_HEADER_SIZE + 4 + 4 * i);
+			if (hll_add_entry(hll, hll_fold_entry(e, precision, hll->precision)) != 0)
+				return 1;
+		}
+	}
+
+	(void) length;
+	return 0;
+}
+
+size_t hll_serialized_size(st_hll *hll)
+{
+	if (hll->registers == NULL && hll->pending_count > 0 && hll_flush(hll) != 0)
+		return 0;
+
+	if (hll->registers != NULL)
+		return HLL_HEADER_SIZE + ((size_t) 1 << hll->precision);
+	return HLL_HEADER_SIZE + 4 + 4 * hll->sparse_count;
+}
+
+void hll_serialize(const st_hll *hll, char *dst)
+{
+	unsigned char *p = (unsigned char *) dst;
+	size_t i;
+
+	memcpy(p, hll_magic, sizeof hll_magic);
+	p[4] = (unsigned char) hll->precision;
+	p[5] = (hll->registers != NULL ? HLL_ENCODING_DENSE : HLL_ENCODING_SPARSE);
+	p[6] = p[7] = 0;
+	p += HLL_HEADER_SIZE;
+
+	if (hll->registers != NULL)
+	{
+		memcpy(p, hll->registers, (size_t) 1 << hll->precision);
+		return;
+	}
+
+	hll_store32le(p, (uint32_t) hll->sparse_count);
+	p += 4;
+	for (i = 0; i < hll->sparse_count; ++i, p += 4)
+		hll_store32le(p, hll->sparse[i]);
+}
+
+/* sigma() and tau() of Ertl's estimator; both series converge in a few dozen steps. */
+static double hll_sigma(double x)
+{
+	double y = 1, z = x, previous;
+
+	if (x == 1)
+		return HUGE_VAL;
+
+	do
+	{
+		x *= x;
+		previous = z;
+		z += x * y;
+		y += y;
+	} while (z != previous);
+
+	return z;
+}
+
+static double hll_tau(double x)
+{
+	double y = 1, z, previous;
+
+	if (x == 0 || x == 1)
+		return 0;
+
+	z = 1 - x;
+	do
+	{
+		x = sqrt(x);
+		previous = z;
+		y *= 0.5;
+		z -= (1 - x) * (1 - x) * y;
+	} while (z != previous);
+
+	return z / 3;
+}
+
+/* Estimates the cardinality from the histogram c[0..q + 1] of register values. */
+static double hll_estimate_histogram(const uint32_t *c, unsigned precision)
+{
+	const unsigned q = 64 - precision;
+	const double m = (double) ((size_t) 1 << precision);
+	double z = m * hll_tau(1 - c[q + 1] / m);
+	unsigned k;
+
+	for (k = q; k >= 1; --k)
+		z = 0.5 * (z + c[k]);
+	z += m * hll_sigma(c[0] / m);
+
+	return (m * m) / (2 * log(2.0) * z);
+}
+
+double hll_serialized_estimate(const char *src, size_t length)
+{
+	const unsigned char *p = (const unsigned char *) src;
+	const unsigned precision = p[4];
+	const size_t m = (size_t) 1 << precision;
+	uint32_t c[HLL_MAX_VALUE(HLL_MIN_PRECISION) + 1];
+	size_t i;
+
+	memset(c, 0, sizeof c);
+
+	if (p[5] == HLL_ENCODING_DENSE)
+	{
+		for (i = 0; i < m; ++i)
+			++c[p[HLL_HEADER_SIZE + i]];
+	}
+	else
+	{
+		const size_t count = hll_load32le(p + HLL_HEADER_SIZE);
+
+		c[0] = (uint32_t) (m - count);
+		for (i = 0; i < count; ++i)
+			++c[HLL_ENTRY_VALUE(hll_load32le(p + HLL_HEADER_SIZE + 4 + 4 * i))];
+	}
+
+	(void) length;
+	return hll_estimate_histogram(c, precision);
+}
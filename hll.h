@@ -0,0 +1,109 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	HyperLogLog sketches with a sparse representation for small cardinalities, as in HLL++
+	(Heule, Nunkesser and Hall, 2013), and the improved raw estimator of Ertl ("New cardinality
+	estimation algorithms for HyperLogLog sketches", 2017), which needs neither bias correction
+	tables nor a separate small-range estimator.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_HLL_H
+#define LIB_MYSQLUDF_STR_HLL_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HLL_MIN_PRECISION 4
+#define HLL_MAX_PRECISION 18
+#define HLL_DEFAULT_PRECISION 14
+
+/** The size of the header of a serialized sketch: the magic bytes <code>HLL1</code>, the
+ * precision, the encoding (0 for sparse, 1 for dense) and two zero bytes.
+ *
+ * A dense sketch continues with one byte per register. A sparse sketch continues with the number
+ * of entries as a 32-bit little-endian integer, then the entries as 32-bit little-endian
+ * integers <code>index << 6 | value</code>, sorted by register index. Registers without an entry
+ * are 0. */
+#define HLL_HEADER_SIZE 8
+
+/** Number of sparse entries that are buffered unsorted before they are merged into the sorted
+ * list. */
+#define HLL_PENDING_SIZE 64
+
+typedef struct st_hll
+{
+	unsigned precision;
+
+	/* If non-NULL, the 2^precision registers; the sketch is dense. */
+	uint8_t *registers;
+
+	/* Otherwise, the sparse entries: sparse_count sorted ones, then pending_count unsorted ones
+	   in pending. The sketch becomes dense when the sorted list grows beyond sparse_limit. */
+	uint32_t *sparse;
+	size_t sparse_count;
+	size_t sparse_capacity;
+	size_t sparse_limit;
+	uint32_t pending[HLL_PENDING_SIZE];
+	size_t pending_count;
+
+	/* Scratch space of sparse_capacity entries for merging sorted lists */
+	uint32_t *scratch;
+} st_hll;
+
+/** @returns the hash of a key as expected by hll_add(). */
+uint64_t hll_hash(const char *key, size_t key_length);
+
+/** Initializes @p hll as an empty sparse sketch of @p precision, which must be in
+ * <code>[HLL_MIN_PRECISION, HLL_MAX_PRECISION]</code>. No memory is allocated until keys are
+ * added. */
+void hll_init(st_hll *hll, unsigned precision);
+
+/** Frees the memory of @p hll. */
+void hll_free(st_hll *hll);
+
+/** Empties @p hll and changes its precision to @p precision, keeping allocated memory of the
+ * same precision for reuse. */
+void hll_reset(st_hll *hll, unsigned precision);
+
+/** Adds the key whose hll_hash() is @p h to @p hll.
+ *
+ * @returns 0 if successful, or a non-zero value if memory could not be allocated. */
+int hll_add(st_hll *hll, uint64_t h);
+
+/** Checks that the @p length bytes at @p src are a serialized sketch.
+ *
+ * @returns the precision of the sketch, or 0 if @p src is not a serialized sketch. */
+unsigned hll_serialized_check(const char *src, size_t length);
+
+/** Merges the serialized sketch at @p src, which must have passed hll_serialized_check(), into
+ * @p hll. If the precisions differ, the result has the lower one.
+ *
+ * Dense sketches are merged with vector byte-wise maximum instructions where available.
+ *
+ * @returns 0 if successful, or a non-zero value if memory could not be allocated. */
+int hll_merge_serialized(st_hll *hll, const char *src, size_t length);
+
+/** @returns the size of the serialized form of @p hll. Buffered entries are sorted into place
+ *		first, which may switch @p hll to the dense representation; 0 is returned if that needed
+ *		memory which could not be allocated. */
+size_t hll_serialized_size(st_hll *hll);
+
+/** Writes the serialized form of @p hll, whose size was just returned by hll_serialized_size(),
+ * to @p dst. */
+void hll_serialize(const st_hll *hll, char *dst);
+
+/** @returns the estimated number of distinct keys of the serialized sketch at @p src, which
+ *		must have passed hll_serialized_check(). */
+double hll_serialized_estimate(const char *src, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 use mysql;
 
 drop function if exists lib_mysqludf_str_info;
+drop function if exists lib_mysqludf_str_stats;
 drop function if exists str_numtowords;
 drop function if exists str_rot13;
 drop function if exists str_shuffle;
@@ -9,8 +10,24 @@ drop function if exists str_ucfirst;
 drop function if exists str_ucwords;
 drop function if exists str_xor;
 drop function if exists str_srand;
+drop function if exists str_csv_field;
+drop function if exists str_kv_get;
+drop function if exists str_lz4_compress;
+drop function if exists str_lz4_decompress;
+drop function if exists str_simhash;
+drop function if exists str_hamming;
+drop function if exists str_bloom_build;
+drop function if exists str_bloom_contains;
+drop function if exists str_hll_build;
+drop function if exists str_hll_merge;
+drop function if exists str_hll_count;
+drop function if exists str_topk;
+drop function if exists str_agg;
+drop function if exists str_pipeline;
+drop function if exists str_set_memory_limit;
 
 create function lib_mysqludf_str_info returns string soname 'lib_mysqludf_str.so';
+create function lib_mysqludf_str_stats returns string soname 'lib_mysqludf_str.so';
 create function str_numtowords returns string soname 'lib_mysqludf_str.so';
 create function str_rot13 returns string soname 'lib_mysqludf_str.so';
 create function str_shuffle returns string soname 'lib_mysqludf_str.so';
@@ -19,3 +36,18 @@ create function str_ucfirst returns string soname 'lib_mysqludf_str.so';
 create function str_ucwords returns string soname 'lib_mysqludf_str.so';
 create function str_xor returns string soname 'lib_mysqludf_str.so';
 create function str_srand returns string soname 'lib_mysqludf_str.so';
+create function str_csv_field returns string soname 'lib_mysqludf_str.so';
+create function str_kv_get returns string soname 'lib_mysqludf_str.so';
+create function str_lz4_compress returns string soname 'lib_mysqludf_str.so';
+create function str_lz4_decompress returns string soname 'lib_mysqludf_str.so';
+create function str_simhash returns string soname 'lib_mysqludf_str.so';
+create function str_hamming returns integer soname 'lib_mysqludf_str.so';
+create aggregate function str_bloom_build returns string soname 'lib_mysqludf_str.so';
+create function str_bloom_contains returns integer soname 'lib_mysqludf_str.so';
+create aggregate function str_hll_build returns string soname 'lib_mysqludf_str.so';
+create aggregate function str_hll_merge returns string soname 'lib_mysqludf_str.so';
+create function str_hll_count returns integer soname 'lib_mysqludf_str.so';
+create aggregate function str_topk returns string soname 'lib_mysqludf_str.so';
+create aggregate function str_agg returns string soname 'lib_mysqludf_str.so';
+create function str_pipeline returns string soname 'lib_mysqludf_str.so';
+create function str_set_memory_limit returns integer soname 'lib_mysqludf_str.so';
@@ -0,0 +1,65 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include "string_utils.h"
+
+/* The escape of c if it has a short one, or 'u' if it needs \u00XX; 0 if c needs no escape */
+static char json_escape_char(unsigned char c)
+{
+	switch (c) {
+	case '"': return '"';
+	case '\\': return '\\';
+	case '\b': return 'b';
+	case '\f': return 'f';
+	case '\n': return 'n';
+	case '\r': return 'r';
+	case '\t': return 't';
+	default: return (c < 0x20 ? 'u' : 0);
+	}
+}
+
+size_t json_escaped_length(const char *src, size_t length)
+{
+	size_t n = length, i;
+
+	for (i = 0; i < length; ++i) {
+		const char e = json_escape_char((unsigned char) src[i]);
+		if (e == 'u') {
+			n += 5;
+		} else if (e != 0) {
+			n += 1;
+		}
+	}
+
+	return n;
+}
+
+char *json_escape(char *dest, const char *src, size_t length)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t i;
+
+	for (i = 0; i < length; ++i) {
+		const unsigned char c = (unsigned char) src[i];
+		const char e = json_escape_char(c);
+
+		if (e == 0) {
+			*dest++ = (char) c;
+		} else if (e != 'u') {
+			*dest++ = '\\';
+			*dest++ = e;
+		} else {
+			*dest++ = '\\';
+			*dest++ = 'u';
+			*dest++ = '0';
+			*dest++ = '0';
+			*dest++ = hex[c >> 4];
+			*dest++ = hex[c & 0xF];
+		}
+	}
+
+	return dest;
+}
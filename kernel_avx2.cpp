@@ -0,0 +1,35 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The transforms of kernel_template.h with AVX2, the instruction set of kernel_avx2.h: 32 bytes at
+	a time. The tails that are shorter than a vector are transformed with SSE2.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "kernel_isa.h"
+
+#ifdef STR_KERNEL_X86
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include "kernel_avx2.h"
+
+STR_KERNEL_DEFINE_ISA(kernel_isa_avx2, kernel_avx2_isa)
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,46 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The instruction set AVX2 of kernel_template.h, whose vectors are 32 bytes. It is included by
+	kernel_avx2.cpp and kernel_avx512.cpp, as kernel_sse2.h is.
+*/
+
+#ifndef LIB_MYSQLUDF_STR_KERNEL_AVX2_H
+#define LIB_MYSQLUDF_STR_KERNEL_AVX2_H 1
+#include <immintrin.h>
+
+#include "kernel_sse2.h"
+
+namespace {
+
+struct kernel_avx2_isa
+{
+	typedef __m256i vec;
+	typedef kernel_sse2_isa half;
+	static const size_t width = 32;
+	static constexpr const char *name = "avx2";
+	static const unsigned features = KERNEL_CPU_AVX2;
+
+	static vec load(const unsigned char *p) { return _mm256_loadu_si256((const __m256i *) p); }
+	static void store(unsigned char *p, vec v) { _mm256_storeu_si256((__m256i *) p, v); }
+	static vec set1(unsigned char c) { return _mm256_set1_epi8((char) c); }
+	static vec add(vec a, vec b) { return _mm256_add_epi8(a, b); }
+	static vec sub(vec a, vec b) { return _mm256_sub_epi8(a, b); }
+	static vec and_(vec a, vec b) { return _mm256_and_si256(a, b); }
+	static vec or_(vec a, vec b) { return _mm256_or_si256(a, b); }
+	static vec xor_(vec a, vec b) { return _mm256_xor_si256(a, b); }
+	static vec andnot(vec a, vec b) { return _mm256_andnot_si256(a, b); }
+	static vec eq(vec a, vec b) { return _mm256_cmpeq_epi8(a, b); }
+
+	// v - lo is at most hi - lo, as unsigned bytes, only if v is in the range
+	static vec in_range(vec v, unsigned char lo, unsigned char hi)
+	{
+		return eq(_mm256_subs_epu8(sub(v, set1(lo)), set1((unsigned char) (hi - lo))), _mm256_setzero_si256());
+	}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,70 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The transforms of kernel_template.h with AVX-512BW: 64 bytes at a time. Comparisons give masks,
+	which are expanded to vectors of bytes, as kernel_template.h expects. The tails that are shorter
+	than a vector are transformed with AVX2, then SSE2.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "kernel_isa.h"
+
+#ifdef STR_KERNEL_AVX512
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx512f,avx512bw"))), apply_to = function)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx512f,avx512bw")
+#endif
+
+#include <immintrin.h>
+
+#include "kernel_avx2.h"
+
+namespace {
+
+struct kernel_avx512_isa
+{
+	typedef __m512i vec;
+	typedef kernel_avx2_isa half;
+	static const size_t width = 64;
+	static constexpr const char *name = "avx512";
+	static const unsigned features = KERNEL_CPU_AVX512BW;
+
+	static vec load(const unsigned char *p) { return _mm512_loadu_si512((const void *) p); }
+	static void store(unsigned char *p, vec v) { _mm512_storeu_si512((void *) p, v); }
+	static vec set1(unsigned char c) { return _mm512_set1_epi8((char) c); }
+	static vec add(vec a, vec b) { return _mm512_add_epi8(a, b); }
+	static vec sub(vec a, vec b) { return _mm512_sub_epi8(a, b); }
+	static vec and_(vec a, vec b) { return _mm512_and_si512(a, b); }
+	static vec or_(vec a, vec b) { return _mm512_or_si512(a, b); }
+	static vec xor_(vec a, vec b) { return _mm512_xor_si512(a, b); }
+
+	// 0x0C is the truth table of ~a & b; _mm512_andnot_si512() makes GCC 12 warn in its own header
+	static vec andnot(vec a, vec b) { return _mm512_ternarylogic_epi32(a, b, b, 0x0C); }
+
+	static vec eq(vec a, vec b) { return _mm512_movm_epi8(_mm512_cmpeq_epi8_mask(a, b)); }
+
+	static vec in_range(vec v, unsigned char lo, unsigned char hi)
+	{
+		return _mm512_movm_epi8(_mm512_cmple_epu8_mask(sub(v, set1(lo)), set1((unsigned char) (hi - lo))));
+	}
+};
+
+} // namespace
+
+STR_KERNEL_DEFINE_ISA(kernel_isa_avx512, kernel_avx512_isa)
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#endif
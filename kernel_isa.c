@@ -0,0 +1,138 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernel_isa.h"
+
+#if defined(_MSC_VER) && defined(STR_KERNEL_X86)
+#include <intrin.h>
+#endif
+
+/* The instruction sets that are compiled in, from the widest */
+static const st_kernel_isa *(*const kernel_isa_list[])(void) = {
+#ifdef STR_KERNEL_X86
+#ifdef STR_KERNEL_AVX512
+	kernel_isa_avx512,
+#endif
+	kernel_isa_avx2,
+	kernel_isa_sse2,
+#endif
+	kernel_isa_scalar
+};
+
+#define KERNEL_ISA_COUNT (sizeof (kernel_isa_list) / sizeof (kernel_isa_list[0]))
+
+/* Returns the KERNEL_CPU_ features of the CPU, including the support of the operating system for
+   the registers of AVX and AVX-512. */
+static unsigned kernel_cpu_features(void)
+{
+	unsigned features = 0;
+
+#if defined(STR_KERNEL_X86) && defined(_MSC_VER)
+	int r[4];
+
+	__cpuid(r, 1);
+	if (r[3] & (1 << 26))
+		features |= KERNEL_CPU_SSE2;
+
+	// OSXSAVE, and the AVX state, then the opmask and ZMM states, enabled in XCR0
+	if ((r[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6)
+	{
+		const unsigned long long xcr0 = _xgetbv(0);
+
+		__cpuidex(r, 7, 0);
+		if (r[1] & (1 << 5))
+			features |= KERNEL_CPU_AVX2;
+		if ((r[1] & (1 << 16)) && (r[1] & (1 << 30)) && (xcr0 & 0xE6) == 0xE6)
+			features |= KERNEL_CPU_AVX512BW;
+	}
+#elif defined(STR_KERNEL_X86)
+	// these check that the operating system saves the registers, too
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		features |= KERNEL_CPU_SSE2;
+	if (__builtin_cpu_supports("avx2"))
+		features |= KERNEL_CPU_AVX2;
+#ifdef STR_KERNEL_AVX512
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		features |= KERNEL_CPU_AVX512BW;
+#endif
+#endif
+
+	return features;
+}
+
+int kernel_isa_supported(const st_kernel_isa *isa)
+{
+	return (isa->features & ~kernel_cpu_features()) == 0;
+}
+
+unsigned kernel_isa_count(void)
+{
+	return (unsigned) KERNEL_ISA_COUNT;
+}
+
+const st_kernel_isa *kernel_isa_at(unsigned i)
+{
+	return kernel_isa_list[i]();
+}
+
+/* Returns the instruction set that kernel_isa() uses. */
+static const st_kernel_isa *kernel_isa_choose(void)
+{
+	const char *name = getenv("LIB_MYSQLUDF_STR_ISA");
+	unsigned i;
+
+	if (name != NULL)
+	{
+		for (i = 0; i < KERNEL_ISA_COUNT; ++i)
+		{
+			const st_kernel_isa *isa = kernel_isa_list[i]();
+
+			if (strcmp(isa->name, name) == 0 && kernel_isa_supported(isa))
+				return isa;
+		}
+	}
+
+	for (i = 0; i < KERNEL_ISA_COUNT; ++i)
+	{
+		const st_kernel_isa *isa = kernel_isa_list[i]();
+
+		if (kernel_isa_supported(isa))
+			return isa;
+	}
+
+	return kernel_isa_scalar();
+}
+
+/* The choice is made by the first call; threads that make it at the same time make the same one. */
+static const st_kernel_isa *kernel_isa_chosen;
+
+const st_kernel_isa *kernel_isa(void)
+{
+	const st_kernel_isa *isa;
+
+#ifdef _MSC_VER
+	// aligned pointers are read and written atomically, and volatile ones are not reordered on x86
+	isa = *(const st_kernel_isa *volatile *) &kernel_isa_chosen;
+	if (isa == NULL)
+	{
+		isa = kernel_isa_choose();
+		*(const st_kernel_isa *volatile *) &kernel_isa_chosen = isa;
+	}
+#else
+	isa = __atomic_load_n(&kernel_isa_chosen, __ATOMIC_ACQUIRE);
+	if (isa == NULL)
+	{
+		isa = kernel_isa_choose();
+		__atomic_store_n(&kernel_isa_chosen, isa, __ATOMIC_RELEASE);
+	}
+#endif
+
+	return isa;
+}
@@ -0,0 +1,93 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The byte-wise transforms of the vector variants of the kernels of string_utils.h, compiled for
+	each instruction set. Each transform is written once, in kernel_template.h, as a template over
+	the width of the vectors of an instruction set, and kernel_<isa>.cpp instantiates all of them
+	for one instruction set. The library uses the widest instruction set that the CPU supports.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_KERNEL_ISA_H
+#define LIB_MYSQLUDF_STR_KERNEL_ISA_H 1
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The instruction sets of x86 are compiled in with compilers that can target them per file */
+#if (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)) && (defined(__GNUC__) || defined(_MSC_VER))
+#define STR_KERNEL_X86 1
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5) || (defined(_MSC_VER) && _MSC_VER >= 1910)
+#define STR_KERNEL_AVX512 1
+#endif
+#endif
+
+/** The transforms, each of which is the template <code>NAME_op</code> of kernel_template.h.
+ * Adding one here instantiates it for all of the instruction sets. */
+#define STR_KERNEL_TRANSFORMS(X) \
+	X(rot13) \
+	X(translate) \
+	X(latin1_upper) \
+	X(latin1_lower) \
+	X(xor)
+
+#define STR_KERNEL_TRANSFORM_ID(name) KERNEL_TRANSFORM_##name,
+
+typedef enum kernel_transform
+{
+	STR_KERNEL_TRANSFORMS(STR_KERNEL_TRANSFORM_ID)
+	KERNEL_NUM_TRANSFORMS
+} kernel_transform;
+
+/** A transform of the @p length bytes at @p src to @p dest, which must not overlap. @p arg is the
+ * 256-byte table of translate, the bytes that xor combines with those of @p src, and is unused by
+ * the other transforms. */
+typedef void (*kernel_transform_fn)(unsigned char *dest, const unsigned char *src, const unsigned char *arg, size_t length);
+
+/** The features of the CPU that an instruction set needs. */
+#define KERNEL_CPU_SSE2 1u
+#define KERNEL_CPU_AVX2 2u
+#define KERNEL_CPU_AVX512BW 4u
+
+typedef struct st_kernel_isa
+{
+	const char *name;
+	size_t width;        /* the bytes of a vector; 1 for the portable variants */
+	size_t min_width;    /* those of the narrowest vectors, of the shorter strings and tails */
+	unsigned features;   /* the KERNEL_CPU_ flags that the CPU must have */
+	kernel_transform_fn transforms[KERNEL_NUM_TRANSFORMS];
+} st_kernel_isa;
+
+/** The instruction sets that are compiled in, each defined by its kernel_<isa>.cpp. */
+const st_kernel_isa *kernel_isa_scalar(void);
+#ifdef STR_KERNEL_X86
+const st_kernel_isa *kernel_isa_sse2(void);
+const st_kernel_isa *kernel_isa_avx2(void);
+#ifdef STR_KERNEL_AVX512
+const st_kernel_isa *kernel_isa_avx512(void);
+#endif
+#endif
+
+/** @returns the instruction set that the vector variants use: the widest one that the CPU
+ *		supports, or the one named by the environment variable LIB_MYSQLUDF_STR_ISA if the CPU
+ *		supports it. */
+const st_kernel_isa *kernel_isa(void);
+
+/** @returns the number of instruction sets that are compiled in. */
+unsigned kernel_isa_count(void);
+
+/** @returns instruction set @p i of those compiled in, from the widest. */
+const st_kernel_isa *kernel_isa_at(unsigned i);
+
+/** @returns non-zero if the CPU supports @p isa. */
+int kernel_isa_supported(const st_kernel_isa *isa);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
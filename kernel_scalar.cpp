@@ -0,0 +1,11 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The transforms of kernel_template.h for the CPUs without vector instructions.
+*/
+
+#include "kernel_template.h"
+
+STR_KERNEL_DEFINE_ISA(kernel_isa_scalar, kernel_scalar_isa)
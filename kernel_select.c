@@ -0,0 +1,112 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+
+#include "kernel_isa.h"
+#include "kernel_select.h"
+#include "kernel_tuning.h"
+#include "str_sync.h"
+
+#ifndef SIZE_MAX
+#define SIZE_MAX ((size_t) -1)
+#endif
+
+static const char *const kernel_names[KERNEL_COUNT] = { "rot13", "translate", "xor" };
+
+static str_mutex kernel_stats_lock = STR_MUTEX_INITIALIZER;
+static st_kernel_stats kernel_stats;
+
+size_t kernel_min_vector_length(kernel_id kernel)
+{
+	const st_kernel_isa *isa = kernel_isa();
+
+	// Without vectors, only the lookups of translate gain from being gathered into words.
+	if (isa->width == 1 && kernel != KERNEL_TRANSLATE)
+		return SIZE_MAX;
+
+	// Below the length of its narrowest vectors, the vector variant runs the scalar loop.
+	switch (kernel)
+	{
+	case KERNEL_ROT13:
+		return (STR_TUNING_ROT13_MIN_LENGTH > isa->min_width ? STR_TUNING_ROT13_MIN_LENGTH : isa->min_width);
+	case KERNEL_TRANSLATE:
+		return STR_TUNING_TRANSLATE_MIN_LENGTH;
+	case KERNEL_XOR:
+		return (STR_TUNING_XOR_MIN_LENGTH > isa->min_width ? STR_TUNING_XOR_MIN_LENGTH : isa->min_width);
+	default:
+		return SIZE_MAX;
+	}
+}
+
+const char *kernel_name(kernel_id kernel)
+{
+	return kernel_names[kernel];
+}
+
+const char *kernel_variant_name(kernel_id kernel, kernel_variant variant)
+{
+	if (variant == KERNEL_SCALAR)
+		return "scalar";
+	// translate gathers its lookups into words whatever the instruction set
+	if (kernel == KERNEL_TRANSLATE && kernel_isa()->width == 1)
+		return "word";
+	return kernel_isa()->name;
+}
+
+void kernel_select_init(st_kernel_select *s, kernel_id kernel)
+{
+	s->kernel = kernel;
+	s->min_vector_length = kernel_min_vector_length(kernel);
+	s->rows = 0;
+	s->bytes = 0;
+	s->vector_bytes = 0;
+}
+
+/* Returns the variant that was faster for most of the sampled bytes. */
+static kernel_variant kernel_select_choose(const st_kernel_select *s)
+{
+	return (s->vector_bytes != 0 && 2 * s->vector_bytes >= s->bytes ? KERNEL_VECTOR : KERNEL_SCALAR);
+}
+
+kernel_variant kernel_select_sample(st_kernel_select *s, size_t length)
+{
+	const kernel_variant variant = (length >= s->min_vector_length ? KERNEL_VECTOR : KERNEL_SCALAR);
+
+	s->bytes += length;
+	if (variant == KERNEL_VECTOR)
+		s->vector_bytes += length;
+
+	// Kernels without a vector variant keep the scalar one for all lengths.
+	if (++s->rows == KERNEL_SELECT_SAMPLE_ROWS && s->min_vector_length != SIZE_MAX)
+		s->min_vector_length = (kernel_select_choose(s) == KERNEL_VECTOR ? 0 : KERNEL_SELECT_LONG_LENGTH);
+
+	return variant;
+}
+
+void kernel_select_end(st_kernel_select *s)
+{
+	kernel_variant variant;
+
+	if (s->rows == 0)
+		return;
+
+	if (s->rows < KERNEL_SELECT_SAMPLE_ROWS)
+		variant = kernel_select_choose(s);
+	else
+		variant = (s->min_vector_length == 0 ? KERNEL_VECTOR : KERNEL_SCALAR);
+
+	str_mutex_lock(&kernel_stats_lock);
+	++kernel_stats.statements[s->kernel][variant];
+	str_mutex_unlock(&kernel_stats_lock);
+}
+
+void kernel_get_stats(st_kernel_stats *stats)
+{
+	str_mutex_lock(&kernel_stats_lock);
+	*stats = kernel_stats;
+	str_mutex_unlock(&kernel_stats_lock);
+}
@@ -0,0 +1,103 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The choice, for each statement, between the scalar and the vector variants of a kernel of
+	string_utils.h, from the lengths of its values. The vector variants lose on strings of a few
+	bytes, which most columns hold, and win by far on longer ones. The first rows of a statement
+	use the variant that is faster for their own length, according to kernel_tuning.h, and their
+	lengths are sampled; the statement then keeps the variant that was faster for most of the
+	sampled bytes, except that values of KERNEL_SELECT_LONG_LENGTH bytes or more always use the
+	vector variant.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_KERNEL_SELECT_H
+#define LIB_MYSQLUDF_STR_KERNEL_SELECT_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bit_utils.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The number of rows of a statement whose lengths are sampled. */
+#define KERNEL_SELECT_SAMPLE_ROWS 64
+
+/** The length from which the vector variant is used whatever the statement chose. */
+#define KERNEL_SELECT_LONG_LENGTH 4096
+
+typedef enum kernel_id
+{
+	KERNEL_ROT13,     /* rot13() */
+	KERNEL_TRANSLATE, /* byte_map() */
+	KERNEL_XOR,       /* xor_bytes() */
+	KERNEL_COUNT
+} kernel_id;
+
+typedef enum kernel_variant
+{
+	KERNEL_SCALAR,
+	KERNEL_VECTOR,
+	KERNEL_NUM_VARIANTS
+} kernel_variant;
+
+typedef struct st_kernel_select
+{
+	kernel_id kernel;
+
+	/* Rows of at least this length use the vector variant: the calibrated length while the first
+	   rows are sampled, then 0 or KERNEL_SELECT_LONG_LENGTH */
+	size_t min_vector_length;
+
+	unsigned rows;       /* the number of rows sampled */
+	uint64_t bytes;      /* the bytes of the sampled rows */
+	uint64_t vector_bytes; /* those of the sampled rows that used the vector variant */
+} st_kernel_select;
+
+/** Prepares @p s for the rows of a statement that calls @p kernel. */
+void kernel_select_init(st_kernel_select *s, kernel_id kernel);
+
+/** Samples a row of @p length bytes, and chooses the variant of the statement after the last
+ * sampled row. Called by kernel_select_row().
+ *
+ * @returns the variant to use for the row. */
+kernel_variant kernel_select_sample(st_kernel_select *s, size_t length);
+
+/** @returns the variant to use for a row of @p length bytes. */
+STR_INLINE kernel_variant kernel_select_row(st_kernel_select *s, size_t length)
+{
+	if (s->rows < KERNEL_SELECT_SAMPLE_ROWS)
+		return kernel_select_sample(s, length);
+	return (length >= s->min_vector_length ? KERNEL_VECTOR : KERNEL_SCALAR);
+}
+
+/** Counts the variant that the statement chose in the process-wide counters. Statements with
+ * fewer rows than were to be sampled are counted with the variant of most of their bytes. */
+void kernel_select_end(st_kernel_select *s);
+
+/** @returns the length from which the vector variant of @p kernel is faster on this CPU, or
+ *		SIZE_MAX if it has none. */
+size_t kernel_min_vector_length(kernel_id kernel);
+
+/** @returns the name of @p kernel, or of the variant @p variant of it. */
+const char *kernel_name(kernel_id kernel);
+const char *kernel_variant_name(kernel_id kernel, kernel_variant variant);
+
+typedef struct st_kernel_stats
+{
+	/* The number of statements that chose each variant of each kernel */
+	uint64_t statements[KERNEL_COUNT][KERNEL_NUM_VARIANTS];
+} st_kernel_stats;
+
+/** Stores the process-wide counters in @p stats. */
+void kernel_get_stats(st_kernel_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
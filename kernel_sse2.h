@@ -0,0 +1,48 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The instruction set SSE2 of kernel_template.h, whose vectors are 16 bytes. It is included after
+	kernel_template.h by kernel_sse2.cpp, and by the files of the wider instruction sets, for their
+	tails that are shorter than their own vectors, each with the options that target its own
+	instruction set.
+*/
+
+#ifndef LIB_MYSQLUDF_STR_KERNEL_SSE2_H
+#define LIB_MYSQLUDF_STR_KERNEL_SSE2_H 1
+#include <emmintrin.h>
+
+#include "kernel_template.h"
+
+namespace {
+
+struct kernel_sse2_isa
+{
+	typedef __m128i vec;
+	typedef kernel_scalar_isa half;
+	static const size_t width = 16;
+	static constexpr const char *name = "sse2";
+	static const unsigned features = KERNEL_CPU_SSE2;
+
+	static vec load(const unsigned char *p) { return _mm_loadu_si128((const __m128i *) p); }
+	static void store(unsigned char *p, vec v) { _mm_storeu_si128((__m128i *) p, v); }
+	static vec set1(unsigned char c) { return _mm_set1_epi8((char) c); }
+	static vec add(vec a, vec b) { return _mm_add_epi8(a, b); }
+	static vec sub(vec a, vec b) { return _mm_sub_epi8(a, b); }
+	static vec and_(vec a, vec b) { return _mm_and_si128(a, b); }
+	static vec or_(vec a, vec b) { return _mm_or_si128(a, b); }
+	static vec xor_(vec a, vec b) { return _mm_xor_si128(a, b); }
+	static vec andnot(vec a, vec b) { return _mm_andnot_si128(a, b); }
+	static vec eq(vec a, vec b) { return _mm_cmpeq_epi8(a, b); }
+
+	// v - lo is at most hi - lo, as unsigned bytes, only if v is in the range
+	static vec in_range(vec v, unsigned char lo, unsigned char hi)
+	{
+		return eq(_mm_subs_epu8(sub(v, set1(lo)), set1((unsigned char) (hi - lo))), _mm_setzero_si128());
+	}
+};
+
+} // namespace
+
+#endif
@@ -0,0 +1,304 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The transforms of kernel_isa.h, each written once as a template over an instruction set V,
+	which is a class with:
+
+	 - the type vec of its vectors, and their number of bytes, width;
+	 - load(p) and store(p, v), which need no alignment, and set1(c);
+	 - add(), sub(), and_(), or_(), xor_() and andnot(a, b), which is ~a & b, of bytes;
+	 - eq(a, b) and in_range(v, lo, hi), whose bytes are 0xFF where those of a equal those of b,
+	   or where lo <= v <= hi as unsigned bytes, and 0 elsewhere;
+	 - its name and the KERNEL_CPU_ features that it needs;
+	 - half, the instruction set whose vectors are half as wide, with which the bytes that are
+	   fewer than a vector are transformed, or kernel_scalar_isa for the narrowest.
+
+	A transform is a class NAME_op, listed in STR_KERNEL_TRANSFORMS, with a function
+	run<V>(dest, src, arg, length). Those that map each byte to a byte derive from
+	kernel_map_op, and define the map of a byte as a constexpr function, from which the table of
+	their scalar loop is generated at compile time, and that of a vector of V.
+
+	kernel_<isa>.cpp includes this header after the options that target its instruction set.
+	Everything here is in an unnamed namespace, so that the copies that are compiled for different
+	instruction sets are never merged by the linker.
+*/
+
+#ifndef LIB_MYSQLUDF_STR_KERNEL_TEMPLATE_H
+#define LIB_MYSQLUDF_STR_KERNEL_TEMPLATE_H 1
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "kernel_isa.h"
+
+namespace {
+
+/* The tables of the transforms that map each byte to a byte */
+
+template <unsigned... I> struct kernel_index_list {};
+
+template <unsigned N, unsigned... I> struct kernel_make_index_list : kernel_make_index_list<N - 1, N - 1, I...> {};
+
+template <unsigned... I> struct kernel_make_index_list<0, I...>
+{
+	typedef kernel_index_list<I...> type;
+};
+
+template <class Op, class Indexes = typename kernel_make_index_list<256>::type> struct kernel_byte_table;
+
+template <class Op, unsigned... I> struct kernel_byte_table<Op, kernel_index_list<I...> >
+{
+	static constexpr unsigned char value[256] = { Op::map(I)... };
+};
+
+template <class Op, unsigned... I> constexpr unsigned char kernel_byte_table<Op, kernel_index_list<I...> >::value[256];
+
+/* The loops */
+
+// A transform that maps each byte to a byte with Op::map(), or Op::vector<V>() for a vector.
+// Fewer bytes than a vector are passed on to V::half, and the bytes after the last whole vector
+// are those of the last vector of the string, which overlaps the one before it, since dest and src
+// do not overlap.
+template <class Op> struct kernel_map_op
+{
+	template <class V> static void run(unsigned char *dest, const unsigned char *src, const unsigned char *arg, size_t length)
+	{
+		const unsigned char *const table = kernel_byte_table<Op>::value;
+		size_t i = 0;
+
+		if (V::width > 1)
+		{
+			if (length < V::width)
+			{
+				run<typename V::half>(dest, src, arg, length);
+				return;
+			}
+
+			for (; i + V::width <= length; i += V::width)
+				V::store(dest + i, Op::template vector<V>(V::load(src + i)));
+
+			if (i < length)
+				V::store(dest + length - V::width, Op::template vector<V>(V::load(src + length - V::width)));
+			return;
+		}
+
+		for (; i < length; ++i)
+			dest[i] = table[src[i]];
+	}
+};
+
+// A transform that combines the bytes of src with those of arg, with Op::map() or
+// Op::vector<V>(), as kernel_map_op maps them.
+template <class Op> struct kernel_combine_op
+{
+	template <class V> static void run(unsigned char *dest, const unsigned char *src, const unsigned char *arg, size_t length)
+	{
+		size_t i = 0;
+
+		if (V::width > 1)
+		{
+			if (length < V::width)
+			{
+				run<typename V::half>(dest, src, arg, length);
+				return;
+			}
+
+			for (; i + V::width <= length; i += V::width)
+				V::store(dest + i, Op::template vector<V>(V::load(src + i), V::load(arg + i)));
+
+			if (i < length)
+				V::store(dest + length - V::width, Op::template vector<V>(V::load(src + length - V::width),
+						V::load(arg + length - V::width)));
+			return;
+		}
+
+		for (; i < length; ++i)
+			dest[i] = Op::map(src[i], arg[i]);
+	}
+};
+
+/* The transforms */
+
+// Each ASCII letter is shifted by 13 places in the alphabet; letters are found from their lower
+// case.
+struct rot13_op : kernel_map_op<rot13_op>
+{
+	static constexpr unsigned char map(unsigned c)
+	{
+		return (unsigned char) ((c | 0x20) - 'a' < 13 ? c + 13 : (c | 0x20) - 'n' < 13 ? c - 13 : c);
+	}
+
+	template <class V> static typename V::vec vector(typename V::vec v)
+	{
+		const typename V::vec lower = V::or_(v, V::set1(0x20)), offset = V::set1(13);
+
+		return V::sub(V::add(v, V::and_(V::in_range(lower, 'a', 'm'), offset)),
+				V::and_(V::in_range(lower, 'n', 'z'), offset));
+	}
+};
+
+static_assert(kernel_byte_table<rot13_op>::value['a'] == 'n' && kernel_byte_table<rot13_op>::value['Z'] == 'M'
+		&& kernel_byte_table<rot13_op>::value['@'] == '@' && kernel_byte_table<rot13_op>::value[0xE1] == 0xE1,
+		"rot13 shifts the ASCII letters only");
+
+// The case of latin1, as in str_pipeline_latin1_ctype(): the letters from 0xC0 to 0xDE, but 0xD7, are
+// the upper case of those 0x20 above them.
+struct latin1_upper_op : kernel_map_op<latin1_upper_op>
+{
+	static constexpr unsigned char map(unsigned c)
+	{
+		return (unsigned char) ((c - 'a' < 26 || (c - 0xE0 < 31 && c != 0xF7)) ? c - 0x20 : c);
+	}
+
+	template <class V> static typename V::vec vector(typename V::vec v)
+	{
+		const typename V::vec is_lower = V::or_(V::in_range(v, 'a', 'z'),
+				V::andnot(V::eq(v, V::set1(0xF7)), V::in_range(v, 0xE0, 0xFE)));
+
+		return V::sub(v, V::and_(is_lower, V::set1(0x20)));
+	}
+};
+
+struct latin1_lower_op : kernel_map_op<latin1_lower_op>
+{
+	static constexpr unsigned char map(unsigned c)
+	{
+		return (unsigned char) ((c - 'A' < 26 || (c - 0xC0 < 31 && c != 0xD7)) ? c + 0x20 : c);
+	}
+
+	template <class V> static typename V::vec vector(typename V::vec v)
+	{
+		const typename V::vec is_upper = V::or_(V::in_range(v, 'A', 'Z'),
+				V::andnot(V::eq(v, V::set1(0xD7)), V::in_range(v, 0xC0, 0xDE)));
+
+		return V::add(v, V::and_(is_upper, V::set1(0x20)));
+	}
+};
+
+static_assert(kernel_byte_table<latin1_upper_op>::value[0xE9] == 0xC9 && kernel_byte_table<latin1_upper_op>::value[0xF7] == 0xF7
+		&& kernel_byte_table<latin1_upper_op>::value[0xFF] == 0xFF && kernel_byte_table<latin1_lower_op>::value['Q'] == 'q'
+		&& kernel_byte_table<latin1_lower_op>::value[0xD7] == 0xD7 && kernel_byte_table<latin1_lower_op>::value[0xDF] == 0xDF,
+		"the case of latin1 is that of str_pipeline_latin1_ctype()");
+
+struct xor_op : kernel_combine_op<xor_op>
+{
+	static constexpr unsigned char map(unsigned a, unsigned b)
+	{
+		return (unsigned char) (a ^ b);
+	}
+
+	template <class V> static typename V::vec vector(typename V::vec a, typename V::vec b)
+	{
+		return V::xor_(a, b);
+	}
+};
+
+/* The shift of the byte that is stored at offset k of a word */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define KERNEL_BYTE_SHIFT(k) (56 - 8 * (k))
+#else
+#define KERNEL_BYTE_SHIFT(k) (8 * (k))
+#endif
+
+// Each byte is looked up in the table at arg. No instruction set has a lookup in a table of 256
+// bytes, so the lookups of eight bytes are gathered into a word, which is stored at once, and the
+// loop is unrolled to the width of V. The bytes after the last unrolled block are still gathered
+// into words, but for the last few.
+struct translate_op
+{
+	static void word(unsigned char *dest, const unsigned char *src, const unsigned char *table)
+	{
+		const uint64_t w = (uint64_t) table[src[0]] << KERNEL_BYTE_SHIFT(0)
+				| (uint64_t) table[src[1]] << KERNEL_BYTE_SHIFT(1)
+				| (uint64_t) table[src[2]] << KERNEL_BYTE_SHIFT(2)
+				| (uint64_t) table[src[3]] << KERNEL_BYTE_SHIFT(3)
+				| (uint64_t) table[src[4]] << KERNEL_BYTE_SHIFT(4)
+				| (uint64_t) table[src[5]] << KERNEL_BYTE_SHIFT(5)
+				| (uint64_t) table[src[6]] << KERNEL_BYTE_SHIFT(6)
+				| (uint64_t) table[src[7]] << KERNEL_BYTE_SHIFT(7);
+
+		memcpy(dest, &w, sizeof w);
+	}
+
+	template <class V> static void run(unsigned char *dest, const unsigned char *src, const unsigned char *table, size_t length)
+	{
+		const size_t block = (V::width > 8 ? V::width : 8);
+		size_t i = 0, k;
+
+		for (; i + block <= length; i += block)
+		{
+			for (k = i; k < i + block; k += 8)
+				word(dest + k, src + k, table);
+		}
+
+		for (; i + 8 <= length; i += 8)
+			word(dest + i, src + i, table);
+
+		for (; i < length; ++i)
+			dest[i] = table[src[i]];
+	}
+};
+
+/* The instruction set whose vectors are single bytes, for the CPUs without another one: its
+   variants are the scalar loops of the transforms */
+struct kernel_scalar_isa
+{
+	typedef unsigned char vec;
+	typedef kernel_scalar_isa half;
+	static const size_t width = 1;
+	static constexpr const char *name = "scalar";
+	static const unsigned features = 0;
+
+	static vec load(const unsigned char *p) { return *p; }
+	static void store(unsigned char *p, vec v) { *p = v; }
+	static vec set1(unsigned char c) { return c; }
+	static vec add(vec a, vec b) { return (vec) (a + b); }
+	static vec sub(vec a, vec b) { return (vec) (a - b); }
+	static vec and_(vec a, vec b) { return (vec) (a & b); }
+	static vec or_(vec a, vec b) { return (vec) (a | b); }
+	static vec xor_(vec a, vec b) { return (vec) (a ^ b); }
+	static vec andnot(vec a, vec b) { return (vec) (~a & b); }
+	static vec eq(vec a, vec b) { return (vec) (a == b ? 0xFF : 0); }
+	static vec in_range(vec v, unsigned char lo, unsigned char hi) { return (vec) ((vec) (v - lo) <= hi - lo ? 0xFF : 0); }
+};
+
+/* The registration of the transforms of an instruction set */
+
+// The width of the narrowest vectors with which V transforms the bytes, or 1 for the scalar loops
+template <class V> struct kernel_min_width
+{
+	static const size_t value = (kernel_min_width<typename V::half>::value > 1 ? kernel_min_width<typename V::half>::value : V::width);
+};
+
+template <> struct kernel_min_width<kernel_scalar_isa>
+{
+	static const size_t value = 1;
+};
+
+#define STR_KERNEL_TRANSFORM_RUN(name) &name##_op::run<V>,
+
+template <class V> struct kernel_isa_of
+{
+	static const st_kernel_isa isa;
+};
+
+template <class V> const st_kernel_isa kernel_isa_of<V>::isa = {
+	V::name,
+	V::width,
+	kernel_min_width<V>::value,
+	V::features,
+	{ STR_KERNEL_TRANSFORMS(STR_KERNEL_TRANSFORM_RUN) }
+};
+
+} // namespace
+
+/** Defines the function of kernel_isa.h that returns the transforms of instruction set @p V. */
+#define STR_KERNEL_DEFINE_ISA(function, V) \
+	extern "C" const st_kernel_isa *function(void) \
+	{ \
+		return &kernel_isa_of<V>::isa; \
+	}
+
+#endif
@@ -0,0 +1,38 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The lengths from which the vector variants of the kernels of string_utils.h are faster than
+	their scalar variants. Below them, the setup of the vector loop and the scalar tail cost more
+	than they save. `make calibrate` measures them on the CPU of the build and writes them to
+	str_tuning.h, which is used instead of the defaults below when it exists.
+
+	The defaults were measured with SSE2. Whatever they are, rot13 and xor use their vector variants
+	only from the length of the narrowest vectors of the instruction set (min_width in kernel_isa.h),
+	below which those run the scalar loop.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_KERNEL_TUNING_H
+#define LIB_MYSQLUDF_STR_KERNEL_TUNING_H 1
+
+#if defined(__has_include)
+#if __has_include("str_tuning.h")
+#include "str_tuning.h"
+#endif
+#endif
+
+#ifndef STR_TUNING_ROT13_MIN_LENGTH
+#define STR_TUNING_ROT13_MIN_LENGTH 16
+#endif
+
+#ifndef STR_TUNING_TRANSLATE_MIN_LENGTH
+#define STR_TUNING_TRANSLATE_MIN_LENGTH 16
+#endif
+
+#ifndef STR_TUNING_XOR_MIN_LENGTH
+#define STR_TUNING_XOR_MIN_LENGTH 32
+#endif
+
+#endif
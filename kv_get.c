@@ -0,0 +1,130 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bit_utils.h"
+#include "kv_get.h"
+
+void kv_search_prepare(st_kv_search *ks, const char *key, size_t key_length)
+{
+	ks->key = key;
+	ks->key_length = key_length;
+	ks->first = (unsigned char) key[0];
+	ks->last = (unsigned char) key[key_length - 1];
+}
+
+/* Checks whether the key of ks starts at s + i, given that its first and last bytes match. */
+static int kv_search_check(const st_kv_search *ks, const char *s, size_t s_length, size_t i,
+		char pair_sep, char kv_sep, size_t *value_begin, size_t *value_end)
+{
+	const size_t key_end = i + ks->key_length;
+	const char *value, *sep;
+
+	if (i != 0 && s[i - 1] != pair_sep)
+		return 0;
+
+	if (key_end != s_length && s[key_end] != kv_sep && s[key_end] != pair_sep)
+		return 0;
+
+	if (ks->key_length > 2 && memcmp(s + i + 1, ks->key + 1, ks->key_length - 2) != 0)
+		return 0;
+
+	if (key_end == s_length || s[key_end] == pair_sep)
+	{
+		*value_begin = *value_end = key_end;
+		return 1;
+	}
+
+	value = s + key_end + 1;
+	sep = (const char *) memchr(value, pair_sep, s_length - key_end - 1);
+	*value_begin = key_end + 1;
+	*value_end = (sep != NULL ? (size_t) (sep - s) : s_length);
+	return 1;
+}
+
+int kv_search_find(const st_kv_search *ks, const char *s, size_t s_length, char pair_sep, char kv_sep,
+		size_t *value_begin, size_t *value_end)
+{
+	size_t i = 0;
+
+	if (ks->key_length > s_length)
+		return 0;
+
+#ifdef STR_HAVE_SSE2
+	{
+		const __m128i first = _mm_set1_epi8((char) ks->first);
+		const __m128i last = _mm_set1_epi8((char) ks->last);
+
+		for (; i + ks->key_length + 15 <= s_length; i += 16)
+		{
+			const __m128i block_first = _mm_loadu_si128((const __m128i *) (s + i));
+			const __m128i block_last = _mm_loadu_si128((const __m128i *) (s + i + ks->key_length - 1));
+			unsigned mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+
+			while (mask != 0)
+			{
+				const size_t at = i + bit_ctz64(mask);
+				mask &= mask - 1;
+
+				if (kv_search_check(ks, s, s_length, at, pair_sep, kv_sep, value_begin, value_end))
+					return 1;
+			}
+		}
+	}
+#endif
+
+	for (; i + ks->key_length <= s_length; ++i)
+	{
+		if ((unsigned char) s[i] == ks->first && (unsigned char) s[i + ks->key_length - 1] == ks->last
+				&& kv_search_check(ks, s, s_length, i, pair_sep, kv_sep, value_begin, value_end))
+			return 1;
+	}
+
+	return 0;
+}
+
+int kv_url_needs_decode(const char *src, size_t length)
+{
+	return memchr(src, '%', length) != NULL || memchr(src, '+', length) != NULL;
+}
+
+static int kv_hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	else if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	else if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+size_t kv_url_decode(char *dest, const char *src, size_t length)
+{
+	char *d = dest;
+	size_t i;
+
+	for (i = 0; i < length; ++i)
+	{
+		if (src[i] == '+')
+		{
+			*d++ = ' ';
+		}
+		else if (src[i] == '%' && i + 2 < length && kv_hex_value(src[i + 1]) >= 0 && kv_hex_value(src[i + 2]) >= 0)
+		{
+			*d++ = (char) (kv_hex_value(src[i + 1]) * 16 + kv_hex_value(src[i + 2]));
+			i += 2;
+		}
+		else
+		{
+			*d++ = src[i];
+		}
+	}
+
+	return (size_t) (d - dest);
+}
@@ -0,0 +1,56 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_KV_GET_H
+#define LIB_MYSQLUDF_STR_KV_GET_H 1
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Precomputed state for looking up one key in key/value lists such as
+ * <code>a=1&b=2</code>. The key is not copied; it must outlive the search. */
+typedef struct st_kv_search
+{
+	const char *key;
+	size_t key_length;
+	unsigned char first; /* first byte of the key */
+	unsigned char last;  /* last byte of the key */
+} st_kv_search;
+
+/** Prepares @p ks for looking up the @p key_length bytes at @p key, which must not be empty. */
+void kv_search_prepare(st_kv_search *ks, const char *key, size_t key_length);
+
+/** Looks up the first pair of @p s whose key is that of @p ks. Pairs are separated by
+ * @p pair_sep, and the key of each pair is separated from its value by @p kv_sep. A pair
+ * without @p kv_sep has an empty value.
+ *
+ * Candidate positions are found by comparing 16 bytes at a time against the first and last
+ * bytes of the key; only candidates that match both are checked with @c memcmp().
+ *
+ * @returns 1 if the key was found, in which case the raw value is
+ *		<code>[s + *value_begin, s + *value_end)</code>. Otherwise, 0 is returned. */
+int kv_search_find(const st_kv_search *ks, const char *s, size_t s_length, char pair_sep, char kv_sep,
+		size_t *value_begin, size_t *value_end);
+
+/** @returns non-zero if URL-decoding the @p length bytes at @p src would change them. */
+int kv_url_needs_decode(const char *src, size_t length);
+
+/** URL-decodes the @p length bytes at @p src into @p dest, which must have space for
+ * @p length bytes: each @c + becomes a space and each <code>%XX</code> escape becomes the byte
+ * with hexadecimal value @c XX. A @c % that does not start a valid escape is copied as is.
+ * @p dest may equal @p src.
+ *
+ * @returns the number of bytes written to @p dest. */
+size_t kv_url_decode(char *dest, const char *src, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,18 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include "kernel_isa.h"
+#include "string_utils.h"
+
+void latin1_upper(char *__restrict dest, const char *__restrict src, size_t length)
+{
+	kernel_isa()->transforms[KERNEL_TRANSFORM_latin1_upper]((unsigned char *) dest, (const unsigned char *) src, NULL, length);
+}
+
+void latin1_lower(char *__restrict dest, const char *__restrict src, size_t length)
+{
+	kernel_isa()->transforms[KERNEL_TRANSFORM_latin1_lower]((unsigned char *) dest, (const unsigned char *) src, NULL, length);
+}
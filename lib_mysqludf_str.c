@@ -47,8 +47,24 @@
 #endif
 
 #include "config.h"
+#include "big_buffer.h"
+#include "bloom.h"
 #include "char_vector.h"
+#include "csv_field.h"
+#include "hll.h"
+#include "kernel_select.h"
+#include "kv_get.h"
+#include "lz4_block.h"
+#include "memo.h"
+#include "pattern_cache.h"
+#include "pipeline.h"
+#include "simhash.h"
+#include "str_alloc.h"
+#include "str_probes.h"
+#include "string_list.h"
 #include "string_utils.h"
+#include "topk.h"
+#include "worker_pool.h"
 
 #ifdef __WIN__
 #define DLLEXP __declspec(dllexport)
@@ -83,7 +99,6 @@
 #ifdef HAVE_DLOPEN
 
 #define LIBVERSION ("lib_mysqludf_str version " PACKAGE_VERSION)
-#define ROT_OFFSET 13
 
 #define ARGCOUNTCHECK(typestr)	\
 	if (args->arg_count != 1) { \
@@ -114,8 +129,17 @@ extern "C" {
 #define DECLARE_STRING_UDF(name_id) \
 	DECLARE_UDF_INIT_DEINIT(name_id) \
 	DLLEXP char *name_id(UDF_INIT *, UDF_ARGS *, char *, unsigned long *, char *, char *);
+#define DECLARE_INTEGER_UDF(name_id) \
+	DECLARE_UDF_INIT_DEINIT(name_id) \
+	DLLEXP long long name_id(UDF_INIT *, UDF_ARGS *, char *, char *);
+#define DECLARE_AGGREGATE_STRING_UDF(name_id) \
+	DECLARE_STRING_UDF(name_id) \
+	DLLEXP void name_id ## _clear(UDF_INIT *, char *, char *); \
+	DLLEXP void name_id ## _add(UDF_INIT *, UDF_ARGS *, char *, char *);
 
 DECLARE_STRING_UDF(lib_mysqludf_str_info)
+DECLARE_STRING_UDF(lib_mysqludf_str_stats)
+DECLARE_INTEGER_UDF(str_set_memory_limit)
 DECLARE_STRING_UDF(str_numtowords)
 DECLARE_STRING_UDF(str_rot13)
 DECLARE_STRING_UDF(str_shuffle)
@@ -124,6 +148,20 @@ DECLARE_STRING_UDF(str_ucfirst)
 DECLARE_STRING_UDF(str_ucwords)
 DECLARE_STRING_UDF(str_xor)
 DECLARE_STRING_UDF(str_srand)
+DECLARE_STRING_UDF(str_csv_field)
+DECLARE_STRING_UDF(str_kv_get)
+DECLARE_STRING_UDF(str_lz4_compress)
+DECLARE_STRING_UDF(str_lz4_decompress)
+DECLARE_STRING_UDF(str_simhash)
+DECLARE_STRING_UDF(str_pipeline)
+DECLARE_INTEGER_UDF(str_hamming)
+DECLARE_AGGREGATE_STRING_UDF(str_bloom_build)
+DECLARE_INTEGER_UDF(str_bloom_contains)
+DECLARE_AGGREGATE_STRING_UDF(str_hll_build)
+DECLARE_AGGREGATE_STRING_UDF(str_hll_merge)
+DECLARE_INTEGER_UDF(str_hll_count)
+DECLARE_AGGREGATE_STRING_UDF(str_topk)
+DECLARE_AGGREGATE_STRING_UDF(str_agg)
 
 #ifdef	__cplusplus
 }
@@ -133,6 +171,506 @@ DECLARE_STRING_UDF(str_srand)
 ** function definitions
 ******************************************************************************/
 
+/******************************************************************************
+** memory accounting
+**
+** The memory that a function allocates with the functions of str_alloc.h
+** while it runs is charged to its statement. The exported functions defined
+** below keep an st_udf_statement in initid->ptr, and give the function its
+** own initid->ptr around each call.
+******************************************************************************/
+
+typedef struct st_udf_statement {
+	/* initid->ptr of the function itself */
+	char *inner_ptr;
+
+	st_str_memory_scope memory;
+} st_udf_statement;
+
+/* Writes the error message of an allocation of `size` bytes that failed to `message`. */
+static void udf_alloc_failed(char *message, size_t size)
+{
+	if (str_memory_over_limit())
+		snprintf(message, MYSQL_ERRMSG_SIZE, "allocating %zu bytes of memory would exceed the limit of %zu bytes", size, str_memory_limit());
+	else
+		snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", size);
+}
+
+static st_udf_statement *udf_statement_alloc(UDF_INIT *initid, char *message)
+{
+	st_udf_statement *statement = (st_udf_statement *) str_malloc(sizeof (st_udf_statement));
+
+	if (statement == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_udf_statement));
+		return NULL;
+	}
+
+	statement->inner_ptr = initid->ptr;
+	str_memory_scope_init(&statement->memory);
+	initid->ptr = (char *) statement;
+	return statement;
+}
+
+static void udf_statement_free(UDF_INIT *initid, st_udf_statement *statement)
+{
+	initid->ptr = statement->inner_ptr;
+	str_memory_scope_end(&statement->memory);
+	str_free(statement);
+}
+
+/* Enters the scope of the statement and gives the function its own initid->ptr. Returns the scope
+   to pass to udf_statement_leave(). */
+static st_str_memory_scope *udf_statement_enter(UDF_INIT *initid, st_udf_statement *statement)
+{
+	initid->ptr = statement->inner_ptr;
+	return str_memory_enter(&statement->memory);
+}
+
+static void udf_statement_leave(UDF_INIT *initid, st_udf_statement *statement, st_str_memory_scope *previous)
+{
+	str_memory_leave(previous);
+	statement->inner_ptr = initid->ptr;
+	initid->ptr = (char *) statement;
+}
+
+/******************************************************************************
+** static tracepoints
+**
+** Each exported function is defined by the macros below around the static
+** function that does the work, which it calls within the memory scope of
+** the statement (see above), and fires the probes of str_probes.h on entry
+** and return. The _init, _deinit, main, _clear and _add functions of
+** <name> are <name>_impl_init(), <name>_impl_deinit(), <name>_impl(),
+** <name>_impl_clear() and <name>_impl_add(); DEFINE_TRACED_STRING_UDF(<name>),
+** DEFINE_TRACED_INTEGER_UDF(<name>) or DEFINE_TRACED_AGGREGATE_STRING_UDF(<name>)
+** defines the exported functions, or DEFINE_FOLDABLE_STRING_UDF(<name>) for
+** deterministic functions (see below).
+******************************************************************************/
+
+STR_PROBE_DEFINE_SEMAPHORES;
+
+/* Returns the total length of the arguments that are not NULL. */
+static unsigned long udf_args_length(const UDF_ARGS *args)
+{
+	unsigned long length = 0;
+	unsigned int i;
+
+	for (i = 0; i < args->arg_count; ++i)
+	{
+		if (args->args[i] != NULL)
+			length += args->lengths[i];
+	}
+
+	return length;
+}
+
+/* The input length reported by the row probes, only computed while they are enabled */
+#define UDF_PROBE_INPUT_LENGTH(entry, ret) \
+	((STR_PROBE_ENABLED(entry) || STR_PROBE_ENABLED(ret)) ? udf_args_length(args) : 0)
+
+#define UDF_TRACED_INIT(name_id, call) \
+	my_bool name_id ## _init(UDF_INIT *initid, UDF_ARGS *args, char *message) \
+	{ \
+		st_udf_statement *statement; \
+		st_str_memory_scope *previous; \
+		my_bool failed = 1; \
+		STR_PROBE1(init__entry, #name_id); \
+		statement = udf_statement_alloc(initid, message); \
+		if (statement != NULL) \
+		{ \
+			previous = udf_statement_enter(initid, statement); \
+			failed = call; \
+			udf_statement_leave(initid, statement, previous); \
+			if (failed) \
+				udf_statement_free(initid, statement); \
+		} \
+		STR_PROBE3(init__return, #name_id, (int) failed, message); \
+		return failed; \
+	}
+
+#define UDF_TRACED_DEINIT(name_id, call) \
+	void name_id ## _deinit(UDF_INIT *initid) \
+	{ \
+		st_udf_statement *statement = (st_udf_statement *) initid->ptr; \
+		st_str_memory_scope *previous; \
+		STR_PROBE1(deinit__entry, #name_id); \
+		previous = udf_statement_enter(initid, statement); \
+		call; \
+		udf_statement_leave(initid, statement, previous); \
+		udf_statement_free(initid, statement); \
+		STR_PROBE1(deinit__return, #name_id); \
+	}
+
+#define UDF_TRACED_STRING(name_id, call) \
+	char *name_id(UDF_INIT *initid, UDF_ARGS *args, char *result, unsigned long *res_length, char *null_value, char *error) \
+	{ \
+		const unsigned long input_length = UDF_PROBE_INPUT_LENGTH(row__entry, row__return); \
+		st_udf_statement *statement = (st_udf_statement *) initid->ptr; \
+		st_str_memory_scope *previous; \
+		STR_PROBE2(row__entry, #name_id, input_length); \
+		previous = udf_statement_enter(initid, statement); \
+		result = call; \
+		udf_statement_leave(initid, statement, previous); \
+		if (STR_PROBE_ENABLED(row__return)) \
+			STR_PROBE5(row__return, #name_id, input_length, (*null_value ? 0 : *res_length), (int) *null_value, (int) *error); \
+		return result; \
+	}
+
+#define UDF_TRACED_INTEGER(name_id, call) \
+	long long name_id(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error) \
+	{ \
+		const unsigned long input_length = UDF_PROBE_INPUT_LENGTH(row__entry, row__return); \
+		st_udf_statement *statement = (st_udf_statement *) initid->ptr; \
+		st_str_memory_scope *previous; \
+		long long value; \
+		STR_PROBE2(row__entry, #name_id, input_length); \
+		previous = udf_statement_enter(initid, statement); \
+		value = call; \
+		udf_statement_leave(initid, statement, previous); \
+		if (STR_PROBE_ENABLED(row__return)) \
+			STR_PROBE5(row__return, #name_id, input_length, 0, (int) *is_null, (int) *error); \
+		return value; \
+	}
+
+#define DEFINE_TRACED_STRING_UDF(name_id) \
+	UDF_TRACED_INIT(name_id, name_id ## _impl_init(initid, args, message)) \
+	UDF_TRACED_DEINIT(name_id, name_id ## _impl_deinit(initid)) \
+	UDF_TRACED_STRING(name_id, name_id ## _impl(initid, args, result, res_length, null_value, error))
+
+#define DEFINE_TRACED_INTEGER_UDF(name_id) \
+	UDF_TRACED_INIT(name_id, name_id ## _impl_init(initid, args, message)) \
+	UDF_TRACED_DEINIT(name_id, name_id ## _impl_deinit(initid)) \
+	UDF_TRACED_INTEGER(name_id, name_id ## _impl(initid, args, is_null, error))
+
+/* The _clear function of aggregates has no probes of its own: it runs once per group, before the
+   _add of its first row. */
+#define DEFINE_TRACED_AGGREGATE_STRING_UDF(name_id) \
+	DEFINE_TRACED_STRING_UDF(name_id) \
+	void name_id ## _clear(UDF_INIT *initid, char *is_null, char *error) \
+	{ \
+		st_udf_statement *statement = (st_udf_statement *) initid->ptr; \
+		st_str_memory_scope *previous = udf_statement_enter(initid, statement); \
+		name_id ## _impl_clear(initid, is_null, error); \
+		udf_statement_leave(initid, statement, previous); \
+	} \
+	void name_id ## _add(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error) \
+	{ \
+		const unsigned long input_length = UDF_PROBE_INPUT_LENGTH(add__entry, add__return); \
+		st_udf_statement *statement = (st_udf_statement *) initid->ptr; \
+		st_str_memory_scope *previous; \
+		STR_PROBE2(add__entry, #name_id, input_length); \
+		previous = udf_statement_enter(initid, statement); \
+		name_id ## _impl_add(initid, args, is_null, error); \
+		udf_statement_leave(initid, statement, previous); \
+		if (STR_PROBE_ENABLED(add__return)) \
+			STR_PROBE3(add__return, #name_id, input_length, (int) *error); \
+	}
+
+/******************************************************************************
+** constant folding and memoization of deterministic string functions
+**
+** The _init, _deinit and main functions of a deterministic string function
+** are defined as static <name>_impl_init(), <name>_impl_deinit() and
+** <name>_impl(), and DEFINE_FOLDABLE_STRING_UDF(<name>) defines the
+** exported functions around them. When all arguments are constant, the
+** result is computed once in <name>_init(), the state of the function is
+** freed, and every row returns the stored result. Otherwise, the exported
+** functions pass the calls through. Functions whose results are not
+** determined by their arguments (str_shuffle(), str_srand()) must not be
+** folded and are defined directly.
+**
+** Functions that are expensive compared to hashing their arguments use
+** DEFINE_MEMOIZED_STRING_UDF(<name>) instead, which also keeps the results
+** of recent arguments in a memo table for the statement (see memo.h), until
+** the table finds that the arguments repeat too rarely.
+******************************************************************************/
+
+/* Number of arguments whose types are remembered to detect conversions requested by _init */
+#define UDF_FOLD_MAX_ARGS 8
+
+typedef my_bool (*udf_init_fn)(UDF_INIT *, UDF_ARGS *, char *);
+typedef void (*udf_deinit_fn)(UDF_INIT *);
+typedef char *(*udf_string_fn)(UDF_INIT *, UDF_ARGS *, char *, unsigned long *, char *, char *);
+
+/* The state of a foldable function, in initid->ptr */
+typedef struct st_udf_frame {
+	/* initid->ptr of the function itself while it is not folded */
+	char *inner_ptr;
+
+	/* The results of recent arguments, or NULL if the function is not memoized or the memo table
+	   was bypassed */
+	st_memo *memo;
+
+	/* Non-zero if the result was computed by _init */
+	int folded;
+	char folded_null;
+	char *folded_result;
+	unsigned long folded_length;
+} st_udf_frame;
+
+/* Calls the main function of a frame with its own initid->ptr. */
+static char *udf_frame_call(UDF_INIT *initid, UDF_ARGS *args, char *result, unsigned long *res_length,
+		char *null_value, char *error, udf_string_fn fn)
+{
+	st_udf_frame *frame = (st_udf_frame *) initid->ptr;
+
+	initid->ptr = frame->inner_ptr;
+	result = fn(initid, args, result, res_length, null_value, error);
+	frame->inner_ptr = initid->ptr;
+	initid->ptr = (char *) frame;
+
+	return result;
+}
+
+/* Stores the types, lengths and bytes of the arguments in `key`, which has space for
+   MEMO_SLOT_SIZE bytes. Returns the length of the key, or 0 if it does not fit. */
+static size_t udf_memo_key(const UDF_ARGS *args, char *key)
+{
+	size_t length = 0;
+	unsigned int i;
+
+	for (i = 0; i < args->arg_count; ++i)
+	{
+		uint32_t arg_length;
+
+		if (args->args[i] == NULL)
+		{
+			if (length == MEMO_SLOT_SIZE)
+				return 0;
+			key[length++] = (char) 0xFF;
+			continue;
+		}
+
+		switch (args->arg_type[i])
+		{
+		case INT_RESULT:
+			arg_length = sizeof (long long);
+			break;
+		case REAL_RESULT:
+			arg_length = sizeof (double);
+			break;
+		default:
+			if (args->lengths[i] > MEMO_SLOT_SIZE)
+				return 0;
+			arg_length = (uint32_t) args->lengths[i];
+			break;
+		}
+
+		if (1 + sizeof arg_length + arg_length > MEMO_SLOT_SIZE - length)
+			return 0;
+		key[length++] = (char) args->arg_type[i];
+		memcpy(key + length, &arg_length, sizeof arg_length);
+		memcpy(key + length + sizeof arg_length, args->args[i], arg_length);
+		length += sizeof arg_length + arg_length;
+	}
+
+	return length;
+}
+
+/* Returns the result of the arguments from the memo table of the frame, or calls the main
+   function and stores its result there. */
+static char *udf_memo_call(UDF_INIT *initid, UDF_ARGS *args, char *result, unsigned long *res_length,
+		char *null_value, char *error, udf_string_fn fn)
+{
+	st_udf_frame *frame = (st_udf_frame *) initid->ptr;
+	char key[MEMO_SLOT_SIZE];
+	const char *value;
+	size_t key_length, value_length;
+
+	key_length = udf_memo_key(args, key);
+	if (key_length == 0)
+		return udf_frame_call(initid, args, result, res_length, null_value, error, fn);
+
+	if (memo_lookup(frame->memo, key, key_length, &value, &value_length, null_value))
+	{
+		*res_length = (unsigned long) value_length;
+		return (*null_value ? NULL : (char *) value);
+	}
+
+	result = udf_frame_call(initid, args, result, res_length, null_value, error, fn);
+	if (!*error)
+		memo_store(frame->memo, key, key_length, result, *res_length, *null_value);
+
+	// The arguments repeat too rarely for the table to pay off; free it for the rest of the statement.
+	if (memo_bypassed(frame->memo))
+	{
+		memo_free(frame->memo);
+		frame->memo = NULL;
+	}
+
+	return result;
+}
+
+static my_bool udf_fold_init(UDF_INIT *initid, UDF_ARGS *args, char *message,
+		udf_init_fn init, udf_string_fn fn, udf_deinit_fn deinit, int memoize)
+{
+	enum Item_result arg_types[UDF_FOLD_MAX_ARGS];
+	st_udf_frame *frame;
+	char buf[255], is_null = 0, error = 0;
+	unsigned long length = 0;
+	const char *result;
+	unsigned int i;
+	int foldable = (args->arg_count <= UDF_FOLD_MAX_ARGS);
+
+	frame = (st_udf_frame *) str_calloc(1, sizeof (st_udf_frame));
+	if (frame == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_udf_frame));
+		return 1;
+	}
+
+	for (i = 0; foldable && i < args->arg_count; ++i)
+		arg_types[i] = args->arg_type[i];
+
+	if (init(initid, args, message))
+	{
+		str_free(frame);
+		return 1;
+	}
+
+	frame->inner_ptr = initid->ptr;
+	initid->ptr = (char *) frame;
+
+	// The values of constant arguments were converted before _init, so they are only used if it
+	// kept their types.
+	for (i = 0; foldable && i < args->arg_count; ++i)
+		foldable = (args->args[i] != NULL && args->arg_type[i] == arg_types[i]);
+
+	if (!foldable)
+	{
+		// Without a memo table, the function still works, only without memoization.
+		if (memoize)
+			frame->memo = memo_alloc();
+		return 0;
+	}
+
+	result = udf_frame_call(initid, args, buf, &length, &is_null, &error, fn);
+
+	// Errors are reported by each row, as without folding.
+	if (error)
+		return 0;
+
+	if (!is_null)
+	{
+		frame->folded_result = (char *) str_malloc(length + 1);
+		if (frame->folded_result == NULL)
+			return 0;
+		memcpy(frame->folded_result, result, length);
+	}
+
+	frame->folded = 1;
+	frame->folded_null = is_null;
+	frame->folded_length = length;
+
+	initid->ptr = frame->inner_ptr;
+	deinit(initid);
+	frame->inner_ptr = NULL;
+	initid->ptr = (char *) frame;
+	initid->const_item = 1;
+	return 0;
+}
+
+static void udf_fold_deinit(UDF_INIT *initid, udf_deinit_fn deinit)
+{
+	st_udf_frame *frame = (st_udf_frame *) initid->ptr;
+
+	if (!frame->folded)
+	{
+		initid->ptr = frame->inner_ptr;
+		deinit(initid);
+	}
+
+	if (frame->memo != NULL)
+		memo_free(frame->memo);
+	str_free(frame->folded_result);
+	str_free(frame);
+}
+
+#define DEFINE_FRAMED_STRING_UDF(name_id, memoize) \
+	static char *name_id ## _framed(UDF_INIT *initid, UDF_ARGS *args, char *result, unsigned long *res_length, char *null_value, char *error) \
+	{ \
+		st_udf_frame *frame = (st_udf_frame *) initid->ptr; \
+		if (frame->folded) \
+		{ \
+			*res_length = frame->folded_length; \
+			*null_value = frame->folded_null; \
+			return frame->folded_result; \
+		} \
+		if (frame->memo != NULL) \
+			return udf_memo_call(initid, args, result, res_length, null_value, error, name_id ## _impl); \
+		return udf_frame_call(initid, args, result, res_length, null_value, error, name_id ## _impl); \
+	} \
+	UDF_TRACED_INIT(name_id, udf_fold_init(initid, args, message, name_id ## _impl_init, name_id ## _impl, name_id ## _impl_deinit, memoize)) \
+	UDF_TRACED_DEINIT(name_id, udf_fold_deinit(initid, name_id ## _impl_deinit)) \
+	UDF_TRACED_STRING(name_id, name_id ## _framed(initid, args, result, res_length, null_value, error))
+
+#define DEFINE_FOLDABLE_STRING_UDF(name_id) DEFINE_FRAMED_STRING_UDF(name_id, 0)
+#define DEFINE_MEMOIZED_STRING_UDF(name_id) DEFINE_FRAMED_STRING_UDF(name_id, 1)
+
+/******************************************************************************
+** result buffers of functions whose result is at most as long as their
+** arguments
+**
+** When the result can be longer than the 255 bytes of the buffer provided
+** by MySQL, the function keeps an st_big_buffer (see big_buffer.h). _init
+** allocates it for the longest possible result, unless that is at least the
+** threshold above which buffers are memory mappings: LONGBLOB arguments can
+** be up to 4 GiB long, so the rows map the length of the longest value so
+** far instead, and the following rows reuse the mapping.
+******************************************************************************/
+
+/* Sets *pbuf to the buffer for results of up to res_length bytes, or to NULL if the buffer of
+   MySQL is enough. Returns 1 with a message if memory could not be allocated. */
+static my_bool udf_result_buffer_init(st_big_buffer **pbuf, unsigned long res_length, char *message)
+{
+	st_big_buffer *buf;
+
+	*pbuf = NULL;
+
+	if (res_length <= 255)
+		return 0;
+
+	buf = (st_big_buffer *) str_malloc(sizeof (st_big_buffer));
+	if (buf == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_big_buffer));
+		return 1;
+	}
+	big_buffer_init(buf);
+
+	if ((buf->threshold == 0 || res_length < buf->threshold) && big_buffer_reserve(buf, (size_t) res_length))
+	{
+		udf_alloc_failed(message, (size_t) res_length);
+		str_free(buf);
+		return 1;
+	}
+
+	*pbuf = buf;
+	return 0;
+}
+
+/* Returns the buffer for a result of `length` bytes: `result` if buf is NULL, or NULL if memory
+   could not be allocated. */
+static char *udf_result_buffer(st_big_buffer *buf, char *result, unsigned long length)
+{
+	if (buf == NULL)
+		return result;
+	if (big_buffer_reserve(buf, (size_t) length))
+		return NULL;
+	return buf->data;
+}
+
+static void udf_result_buffer_deinit(st_big_buffer *buf)
+{
+	if (buf != NULL)
+	{
+		big_buffer_free(buf);
+		str_free(buf);
+	}
+}
+
+
 /******************************************************************************
 ** purpose:	called once for each SQL statement which invokes lib_mysqludf_str_info_init();
 **					checks arguments, sets restrictions, allocates memory that
@@ -147,7 +685,7 @@ DECLARE_STRING_UDF(str_srand)
 **					can be stored if necessary
 ** returns:	1 => failure; 0 => successful initialization
 ******************************************************************************/
-my_bool lib_mysqludf_str_info_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+static my_bool lib_mysqludf_str_info_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
 	if (args->arg_count != 0)
 	{
@@ -170,7 +708,7 @@ my_bool lib_mysqludf_str_info_init(UDF_INIT *initid, UDF_ARGS *args, char *messa
 **					lib_mysqludf_str_info_init() and lib_mysqludf_str_info())
 ** returns:	nothing
 ******************************************************************************/
-void lib_mysqludf_str_info_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
+static void lib_mysqludf_str_info_impl_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
 {
 }
 
@@ -185,7 +723,7 @@ void lib_mysqludf_str_info_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
 **					error
 ** returns:	the library version number
 ******************************************************************************/
-char *lib_mysqludf_str_info(UDF_INIT *initid, UDF_ARGS *args,
+static char *lib_mysqludf_str_info_impl(UDF_INIT *initid, UDF_ARGS *args,
 			char *result, unsigned long *res_length,
 			char *null_value, char *error)
 {
@@ -194,210 +732,336 @@ char *lib_mysqludf_str_info(UDF_INIT *initid, UDF_ARGS *args,
 	return result;
 }
 
+DEFINE_TRACED_STRING_UDF(lib_mysqludf_str_info)
+
+
+/* Size of the buffer of the result of lib_mysqludf_str_stats() */
+#define STATS_BUF_SIZE 2048
 
 /******************************************************************************
-** purpose:	called once for each SQL statement which invokes str_numtowords();
+** purpose:	called once for each SQL statement which invokes lib_mysqludf_str_stats();
 **					checks arguments, sets restrictions, allocates memory that
-**					will be used during the main str_numtowords() function
+**					will be used during the main lib_mysqludf_str_stats() function
 ** receives:	pointer to UDF_INIT struct which is to be shared with all
-**					other functions (str_numtowords() and str_numtowords_deinit()) -
+**					other functions (lib_mysqludf_str_stats() and lib_mysqludf_str_stats_deinit()) -
 **					the components of this struct are described in the MySQL manual;
 **					pointer to UDF_ARGS struct which contains information about
 **					the number, size, and type of args the query will be providing
-**					to each invocation of str_numtowords(); pointer to a char
+**					to each invocation of lib_mysqludf_str_stats(); pointer to a char
 **					array of size MYSQL_ERRMSG_SIZE in which an error message
 **					can be stored if necessary
 ** returns:	1 => failure; 0 => successful initialization
 ******************************************************************************/
-my_bool str_numtowords_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+static my_bool lib_mysqludf_str_stats_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
-	static const char funcname[] = "str_numtowords";
-	st_char_vector *vec;
-
-	/* make sure user has provided exactly one integer argument */
-	ARGCOUNTCHECK("integer");
-	INTARGCHECK;
-
-	vec = char_vector_alloc();
-	if (vec == NULL)
+	if (args->arg_count != 0)
 	{
-		x_strlcpy(message, "char_vector_alloc() failed", MYSQL_ERRMSG_SIZE);
+		x_strlcpy(message, "No arguments allowed (udf: lib_mysqludf_str_stats)", MYSQL_ERRMSG_SIZE);
 		return 1;
 	}
 
-	initid->ptr = (char *) vec;
-
-	initid->maybe_null=1;
+	initid->ptr = (char *) str_malloc(STATS_BUF_SIZE);
+	if (initid->ptr == NULL)
+	{
+		udf_alloc_failed(message, (size_t) STATS_BUF_SIZE);
+		return 1;
+	}
 
+	initid->maybe_null = 0;
+	initid->max_length = STATS_BUF_SIZE;
 	return 0;
 }
 
 /******************************************************************************
-** purpose:	deallocate memory allocated by str_numtowords_init(); this func
-**					is called once for each query which invokes str_numtowords(),
-**					it is called after all of the calls to str_numtowords() are done
+** purpose:	deallocate memory allocated by lib_mysqludf_str_stats_init();
+**					this function is called once for each query which invokes
+**					lib_mysqludf_str_stats(), it is called after all of the calls to
+**					lib_mysqludf_str_stats() are done
 ** receives:	pointer to UDF_INIT struct (the same which was used by
-**					str_numtowords_init() and str_numtowords())
+**					lib_mysqludf_str_stats_init() and lib_mysqludf_str_stats())
 ** returns:	nothing
 ******************************************************************************/
-void str_numtowords_deinit(UDF_INIT *initid)
+static void lib_mysqludf_str_stats_impl_deinit(UDF_INIT *initid)
 {
-	st_char_vector *vec = (st_char_vector *) initid->ptr;
-	char_vector_free(vec);
+	str_free(initid->ptr);
 }
 
-#define STR_LENGTH(str) ((sizeof (str)) -1)
-#define STR_COMMA_LENGTH(str_lit) str_lit, STR_LENGTH(str_lit)
-
 /******************************************************************************
-** purpose:	convert numbers written in arabic digits to an english word.
-**					Works for positive and negative numbers up to 9 digits long.
+** purpose:	report the counters of the process-wide caches and of the
+**					memory of lib_mysqludf_str
 ** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
 **					in which work can be done; pointer to UDF_ARGS struct which
 **					contains the functions arguments and data about them; pointer
 **					to mem which can be set to 1 if the result is NULL; pointer
 **					to mem which can be set to 1 if the calculation resulted in an
 **					error
-** returns:	the string spelling the given number in English
+** returns:	a JSON object of the counters
 ******************************************************************************/
-char *str_numtowords(UDF_INIT *initid, UDF_ARGS *args,
+static char *lib_mysqludf_str_stats_impl(UDF_INIT *initid, UDF_ARGS *args,
 			char *result, unsigned long *res_length,
 			char *null_value, char *error)
 {
-	static const char *const powers[] = {"thousand", "million", "billion", "trillion", "quadrillion", "quintillion", "sextillion", "septillion", "octillion", "nonillion", "decillion", "undecillion", "duodecillion"};
-
-	static const char *const ones[] = {"one", "two", "three", "four", "five",
-																"six", "seven", "eight", "nine", "ten",
-																"eleven", "twelve", "thirteen", "fourteen", "fifteen",
-																"sixteen", "seventeen", "eighteen", "nineteen"};
-
-	static const char *const tens[] = {"twenty", "thirty", "forty", "fifty", "sixty", "seventy", "eighty", "ninety"};
-
-	st_char_vector *vec;
-	long long value;
-	int part_stack[14];
-	int *part_ptr;
+	st_pattern_cache_stats pc;
+	st_memo_stats memo;
+	st_worker_pool_stats pool;
+	st_str_memory_stats memory;
+	st_kernel_stats kernels;
+	int n, k;
+
+	pattern_cache_get_stats(&pc);
+	memo_get_stats(&memo);
+	worker_pool_get_stats(&pool);
+	str_memory_get_stats(&memory);
+	kernel_get_stats(&kernels);
+
+	result = initid->ptr;
+	n = snprintf(result, STATS_BUF_SIZE, "{\"pattern_cache\":{\"entries\":%lu,\"bytes\":%lu,\"hits\":%llu,\"misses\":%llu,\"evictions\":%llu},"
+			"\"memo\":{\"hits\":%llu,\"misses\":%llu,\"bypassed\":%llu},"
+			"\"worker_pool\":{\"threads\":%llu,\"jobs\":%llu,\"chunks\":%llu},"
+			"\"memory\":{\"current\":%llu,\"peak\":%llu,\"limit\":%llu,\"refused\":%llu,\"statement_peak\":%llu},\"kernels\":{",
+			(unsigned long) pc.entries, (unsigned long) pc.bytes,
+			(unsigned long long) pc.hits, (unsigned long long) pc.misses, (unsigned long long) pc.evictions,
+			(unsigned long long) memo.hits, (unsigned long long) memo.misses, (unsigned long long) memo.bypassed,
+			(unsigned long long) pool.threads, (unsigned long long) pool.jobs, (unsigned long long) pool.chunks,
+			(unsigned long long) memory.current, (unsigned long long) memory.peak, (unsigned long long) memory.limit,
+			(unsigned long long) memory.refused, (unsigned long long) memory.statement_peak);
+
+	// the variants of each kernel, the length from which the vector variant is used while the rows
+	// of a statement are sampled (-1 if it has none), and the statements that chose each variant
+	for (k = 0; k < KERNEL_COUNT && n < STATS_BUF_SIZE; k++)
+	{
+		const size_t min_length = kernel_min_vector_length((kernel_id) k);
 
-	if (args->args[0] == NULL) {
-		result = NULL;
-		*res_length = 0;
-		*null_value = 1;
-		return result;
+		n += snprintf(result + n, STATS_BUF_SIZE - n, "%s\"%s\":{\"vector\":\"%s\",\"min_vector_length\":%lld,\"scalar_statements\":%llu,\"vector_statements\":%llu}",
+				(k == 0 ? "" : ","), kernel_name((kernel_id) k), kernel_variant_name((kernel_id) k, KERNEL_VECTOR),
+				(min_length == SIZE_MAX ? -1LL : (long long) min_length),
+				(unsigned long long) kernels.statements[k][KERNEL_SCALAR], (unsigned long long) kernels.statements[k][KERNEL_VECTOR]);
 	}
+	if (n < STATS_BUF_SIZE)
+		n += snprintf(result + n, STATS_BUF_SIZE - n, "}}");
 
-	vec = (st_char_vector *) initid->ptr;
-
-	value = *((long long *) args->args[0]);
-
-	part_ptr = part_stack;
+	*res_length = (unsigned long) (n < STATS_BUF_SIZE ? n : STATS_BUF_SIZE - 1);
+	return result;
+}
 
-	assert(char_vector_length(vec) == 0);
+DEFINE_TRACED_STRING_UDF(lib_mysqludf_str_stats)
 
-	// check for negative values or zero
-	if (value < 0)
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes
+**					str_set_memory_limit(); checks arguments
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_set_memory_limit() and
+**					str_set_memory_limit_deinit()) - the components of this struct
+**					are described in the MySQL manual; pointer to UDF_ARGS struct
+**					which contains information about the number, size, and type of
+**					args the query will be providing to each invocation of
+**					str_set_memory_limit(); pointer to a char array of size
+**					MYSQL_ERRMSG_SIZE in which an error message can be stored if
+**					necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_set_memory_limit_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	if (args->arg_count != 1)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: str_set_memory_limit requires one integer argument, got %d arguments", args->arg_count);
+		return 1;
+	}
+	if (args->arg_type[0] != INT_RESULT)
 	{
-		char_vector_append(vec, STR_COMMA_LENGTH("negative "));
-		value = -value;
+		x_strlcpy(message, "wrong argument type: str_set_memory_limit requires one integer argument", MYSQL_ERRMSG_SIZE);
+		return 1;
 	}
-	else if (value == 0)
+	if (args->args[0] != NULL && *((long long *) args->args[0]) < 0)
 	{
-		char *tmp = "zero";
-		*res_length = STR_LENGTH("zero");
-		return tmp;
+		x_strlcpy(message, "str_set_memory_limit requires a number of bytes that is not negative, or 0 for no limit", MYSQL_ERRMSG_SIZE);
+		return 1;
 	}
 
-	// splitting the number into its parts
-	for (; value; value /= 1000)
-		*part_ptr++ = value % 1000;
+	initid->ptr = NULL;
+	initid->maybe_null = 0;
+	return 0;
+}
 
-	while (part_ptr > part_stack)
-	{
-		int p = *--part_ptr;
-		const int pWasNonzero = p != 0;
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_set_memory_limit_init();
+**					this function is called once for each query which invokes
+**					str_set_memory_limit(), it is called after all of the calls
+**					to str_set_memory_limit() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_set_memory_limit_init() and str_set_memory_limit())
+** returns:	nothing
+******************************************************************************/
+static void str_set_memory_limit_impl_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
+{
+}
 
-		if (p >= 100)
-		{
-			char_vector_strcat(vec, ones[p / 100 - 1]);
-			char_vector_append(vec, STR_COMMA_LENGTH(" hundred "));
-			p %= 100;
-		}
+/******************************************************************************
+** purpose:	set the largest number of bytes that the functions of
+**					lib_mysqludf_str may hold at once in the server, over which
+**					they fail instead of allocating more; 0 removes the limit, and
+**					NULL leaves it unchanged.
+** receives:	pointer to UDF_INIT struct; pointer to UDF_ARGS struct which
+**					contains the limit; pointer to mem which can be set to 1 if the
+**					result is NULL; pointer to mem which can be set to 1 if the
+**					calculation resulted in an error
+** returns:	the limit in effect, or 0 for none
+******************************************************************************/
+static long long str_set_memory_limit_impl(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error)
+{
+	if (args->args[0] != NULL)
+	{
+		const long long limit = *((long long *) args->args[0]);
 
-		if (p >= 20)
-		{
-			if (p % 10)
-			{
-				char_vector_strcat(vec, tens[p / 10 - 2]);
-				char_vector_append(vec, STR_COMMA_LENGTH("-"));
-				char_vector_strcat(vec, ones[p % 10 - 1]);
-				char_vector_append(vec, STR_COMMA_LENGTH(" "));
-			}
-			else
-			{
-				char_vector_strcat(vec, tens[p / 10 - 2]);
-				char_vector_append(vec, STR_COMMA_LENGTH(" "));
-			}
-		}
-		else if (p > 0)
+		if (limit < 0)
 		{
-			char_vector_strcat(vec, ones[p - 1]);
-			char_vector_append(vec, STR_COMMA_LENGTH(" "));
+			*error = 1;
+			return 0;
 		}
 
-		if (pWasNonzero && part_ptr > part_stack)
-		{
-			char_vector_strcat(vec, powers[part_ptr - part_stack - 1]);
-			char_vector_append(vec, STR_COMMA_LENGTH(" "));
-		}
+		str_memory_set_limit((unsigned long long) limit < SIZE_MAX ? (size_t) limit : 0);
 	}
 
-	*res_length = char_vector_length(vec) - 1;
-	return char_vector_get_ptr(vec);
+	return (long long) str_memory_limit();
 }
 
+DEFINE_TRACED_INTEGER_UDF(str_set_memory_limit)
+
 
 /******************************************************************************
-** purpose:	called once for each SQL statement which invokes str_rot13();
+** purpose:	called once for each SQL statement which invokes str_numtowords();
 **					checks arguments, sets restrictions, allocates memory that
-**					will be used during the main str_rot13() function
+**					will be used during the main str_numtowords() function
 ** receives:	pointer to UDF_INIT struct which is to be shared with all
-**					other functions (str_rot13() and str_rot13_deinit()) -
+**					other functions (str_numtowords() and str_numtowords_deinit()) -
 **					the components of this struct are described in the MySQL manual;
 **					pointer to UDF_ARGS struct which contains information about
 **					the number, size, and type of args the query will be providing
-**					to each invocation of str_rot13(); pointer to a char
+**					to each invocation of str_numtowords(); pointer to a char
 **					array of size MYSQL_ERRMSG_SIZE in which an error message
 **					can be stored if necessary
 ** returns:	1 => failure; 0 => successful initialization
 ******************************************************************************/
-my_bool str_rot13_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+static my_bool str_numtowords_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
-	static const char funcname[] = "str_rot13";
-	unsigned long res_length;
-
-	/* make sure user has provided exactly one string argument */
-	ARGCOUNTCHECK("string");
-	STRARGCHECK;
+	static const char funcname[] = "str_numtowords";
+	char *buf;
 
-	res_length = args->lengths[0];
+	/* make sure user has provided exactly one integer argument */
+	ARGCOUNTCHECK("integer");
+	INTARGCHECK;
 
-	if (SIZE_MAX < res_length)
+	buf = (char *) str_malloc(NUMTOWORDS_MAX_LENGTH);
+	if (buf == NULL)
 	{
-		snprintf(message, MYSQL_ERRMSG_SIZE, "res_length (%lu) cannot be greater than SIZE_MAX (%zu)", res_length, (size_t) (SIZE_MAX));
+		udf_alloc_failed(message, (size_t) NUMTOWORDS_MAX_LENGTH);
 		return 1;
 	}
 
-	initid->ptr = NULL;
+	initid->ptr = buf;
 
-	if (res_length > 255)
-	{
-		char *tmp = (char *) malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
-		if (tmp == NULL)
-		{
-			snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", (size_t) res_length);
-			return 1;
-		}
-		initid->ptr = tmp;
+	initid->maybe_null=1;
+
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_numtowords_init(); this func
+**					is called once for each query which invokes str_numtowords(),
+**					it is called after all of the calls to str_numtowords() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_numtowords_init() and str_numtowords())
+** returns:	nothing
+******************************************************************************/
+static void str_numtowords_impl_deinit(UDF_INIT *initid)
+{
+	str_free(initid->ptr);
+}
+
+#define STR_LENGTH(str) ((sizeof (str)) -1)
+
+/******************************************************************************
+** purpose:	convert numbers written in arabic digits to an english word.
+**					Works for positive and negative numbers up to 9 digits long.
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the string spelling the given number in English
+******************************************************************************/
+static char *str_numtowords_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	if (args->args[0] == NULL) {
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	*res_length = (unsigned long) numtowords(initid->ptr, *((long long *) args->args[0]));
+	return initid->ptr;
+}
+
+DEFINE_MEMOIZED_STRING_UDF(str_numtowords)
+
+
+typedef struct st_str_rot13_data {
+	/* Buffer for results longer than 255 bytes; otherwise NULL */
+	st_big_buffer *buf;
+
+	/* The choice between the variants of rot13() */
+	st_kernel_select select;
+} st_str_rot13_data;
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_rot13();
+**					checks arguments, sets restrictions, allocates memory that
+**					will be used during the main str_rot13() function
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_rot13() and str_rot13_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_rot13(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_rot13_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_rot13";
+	unsigned long res_length;
+	st_str_rot13_data *p;
+
+	/* make sure user has provided exactly one string argument */
+	ARGCOUNTCHECK("string");
+	STRARGCHECK;
+
+	res_length = args->lengths[0];
+
+	if (SIZE_MAX < res_length)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "res_length (%lu) cannot be greater than SIZE_MAX (%zu)", res_length, (size_t) (SIZE_MAX));
+		return 1;
+	}
+
+	p = (st_str_rot13_data *) str_malloc(sizeof (st_str_rot13_data));
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_rot13_data));
+		return 1;
+	}
+	if (udf_result_buffer_init(&p->buf, res_length, message))
+	{
+		str_free(p);
+		return 1;
 	}
+	kernel_select_init(&p->select, KERNEL_ROT13);
+	initid->ptr = (char *) p;
 
 	initid->maybe_null = 1;
 	initid->max_length = res_length;
@@ -412,10 +1076,28 @@ my_bool str_rot13_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 **					str_rot13_init() and str_rot13())
 ** returns:	nothing
 ******************************************************************************/
-void str_rot13_deinit(UDF_INIT *initid)
+static void str_rot13_impl_deinit(UDF_INIT *initid)
 {
-	if (initid->ptr != NULL)
-		free(initid->ptr);
+	st_str_rot13_data *p = (st_str_rot13_data *) initid->ptr;
+
+	kernel_select_end(&p->select);
+	udf_result_buffer_deinit(p->buf);
+	str_free(p);
+}
+
+/* The argument, the result and the variant of rot13() of str_rot13(), for worker_pool_run() */
+typedef struct st_str_rot13_job {
+	void (*rot13)(char *dst, const char *src, size_t length);
+	const char *s;
+	char *result;
+} st_str_rot13_job;
+
+/* Performs the rot13 transform on the chars [begin, end) of the argument. */
+static void str_rot13_range(void *ctx, size_t begin, size_t end)
+{
+	const st_str_rot13_job *job = (const st_str_rot13_job *) ctx;
+
+	job->rot13(job->result + begin, job->s + begin, end - begin);
 }
 
 /******************************************************************************
@@ -431,12 +1113,12 @@ void str_rot13_deinit(UDF_INIT *initid)
 **					error
 ** returns:	the string transformed by str_rot13
 ******************************************************************************/
-char *str_rot13(UDF_INIT *initid, UDF_ARGS *args,
+static char *str_rot13_impl(UDF_INIT *initid, UDF_ARGS *args,
 			char *result, unsigned long *res_length,
 			char *null_value, char *error)
 {
-	int i, cod_ascii;
-	const char *s;
+	st_str_rot13_data *p = (st_str_rot13_data *) initid->ptr;
+	st_str_rot13_job job;
 
 	if (args->args[0] == NULL) {
 		result = NULL;
@@ -445,42 +1127,27 @@ char *str_rot13(UDF_INIT *initid, UDF_ARGS *args,
 		return result;
 	}
 
-	// s will contain the user-supplied argument
-	s = args->args[0];
-
-	if (initid->ptr != NULL)
+	result = udf_result_buffer(p->buf, result, args->lengths[0]);
+	if (result == NULL)
 	{
-		result = initid->ptr;
+		*res_length = 0;
+		*error = 1;
+		return result;
 	}
 
 	*res_length = args->lengths[0];
 
-	for (i = 0; i < *res_length; i++)
-	{
-		// cod_ascii is an integer containing the ascii code of a single character
-		cod_ascii = s[i];
-
-		if(cod_ascii >= 97 && cod_ascii <= 122)	// lower case character
-		{
-			cod_ascii += ROT_OFFSET;
-
-			if(cod_ascii>122)
-				cod_ascii = 96 + (cod_ascii-122);
-		}
-		else if(cod_ascii >= 65 && cod_ascii <= 90)	// upper case character
-		{
-			cod_ascii += ROT_OFFSET;
-
-			if(cod_ascii>90)
-				cod_ascii = 64 + (cod_ascii-90);
-		}
-
-		result[i] = cod_ascii;
-	}
+	// values of many megabytes are split across the threads of the worker pool
+	job.rot13 = (kernel_select_row(&p->select, *res_length) == KERNEL_VECTOR ? rot13_vector : rot13_scalar);
+	job.s = args->args[0];
+	job.result = result;
+	worker_pool_run(*res_length, str_rot13_range, &job);
 
 	return result;
 }
 
+DEFINE_FOLDABLE_STRING_UDF(str_rot13)
+
 
 /******************************************************************************
 ** purpose:	called once for each SQL statement which invokes str_shuffle();
@@ -497,7 +1164,7 @@ char *str_rot13(UDF_INIT *initid, UDF_ARGS *args,
 ** returns:	1 => failure; 0 => successful initialization
 ******************************************************************************/
 
-my_bool str_shuffle_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+static my_bool str_shuffle_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
 	static const char funcname[] = "str_shuffle";
 	unsigned long res_length;
@@ -518,10 +1185,10 @@ my_bool str_shuffle_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 
 	if (res_length > 255)
 	{
-		char *tmp = (char *) malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
+		char *tmp = (char *) str_malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
 		if (tmp == NULL)
 		{
-			snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", (size_t) res_length);
+			udf_alloc_failed(message, (size_t) res_length);
 			return 1;
 		}
 		initid->ptr = tmp;
@@ -540,10 +1207,10 @@ my_bool str_shuffle_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 **					str_shuffle_init() and str_shuffle())
 ** returns:	nothing
 ******************************************************************************/
-void str_shuffle_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
+static void str_shuffle_impl_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
 {
 	if (initid->ptr != NULL)
-		free(initid->ptr);
+		str_free(initid->ptr);
 }
 
 /******************************************************************************
@@ -556,7 +1223,7 @@ void str_shuffle_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
 **					error
 ** returns:	one of the possible permutations of the original string
 ******************************************************************************/
-char *str_shuffle(UDF_INIT *initid, UDF_ARGS *args,
+static char *str_shuffle_impl(UDF_INIT *initid, UDF_ARGS *args,
 			char *result, unsigned long *res_length,
 			char *null_value, char *error)
 {
@@ -593,11 +1260,41 @@ char *str_shuffle(UDF_INIT *initid, UDF_ARGS *args,
 	return result;
 }
 
+DEFINE_TRACED_STRING_UDF(str_shuffle)
+
+
+/* Number of entries of a translation table, one for each byte value */
+#define TRANSLATE_TABLE_SIZE 256
+
+typedef struct st_str_translate_data {
+	/* The translation table compiled from srcchar and dstchar if they are constant; otherwise NULL */
+	st_pattern_cache_entry *table_entry;
+
+	/* Buffer for results longer than 255 bytes; otherwise NULL */
+	char *buf;
+
+	/* The choice between the variants of byte_map() */
+	st_kernel_select select;
+} st_str_translate_data;
+
+/* Compiles the translation table of srcchar and dstchar, which are concatenated in `key`. */
+static void *str_translate_compile(const char *key, size_t key_length, size_t *size)
+{
+	unsigned char *table = (unsigned char *) str_malloc(TRANSLATE_TABLE_SIZE);
+
+	if (table != NULL)
+		byte_map_fill(table, key, key + key_length / 2, key_length / 2);
+
+	*size = TRANSLATE_TABLE_SIZE;
+	return table;
+}
 
 /******************************************************************************
 ** purpose:	called once for each SQL statement which invokes str_translate();
 **					checks arguments, sets restrictions, allocates memory that
-**					will be used during the main str_translate() function
+**					will be used during the main str_translate() function and, if
+**					srcchar and dstchar are constant, looks up their translation
+**					table in the pattern cache
 ** receives:	pointer to UDF_INIT struct which is to be shared with all
 **					other functions (str_translate() and str_translate_deinit()) -
 **					the components of this struct are described in the MySQL manual;
@@ -609,10 +1306,11 @@ char *str_shuffle(UDF_INIT *initid, UDF_ARGS *args,
 ** returns:	1 => failure; 0 => successful initialization
 ******************************************************************************/
 
-my_bool str_translate_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+static my_bool str_translate_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
 	static const char funcname[] = "str_translate";
 	unsigned long res_length;
+	st_str_translate_data *p;
 
 	/* make sure user has provided exactly three string arguments */
 	if (args->arg_count != 3) {
@@ -637,19 +1335,48 @@ my_bool str_translate_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 		return 1;
 	}
 
-	initid->ptr = NULL;
+	p = (st_str_translate_data *) str_calloc(1, sizeof (st_str_translate_data));
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_translate_data));
+		return 1;
+	}
 
 	if (res_length > 255)
 	{
-		char *tmp = (char *) malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
-		if (tmp == NULL)
+		p->buf = (char *) str_malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
+		if (p->buf == NULL)
 		{
-			snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", (size_t) res_length);
+			str_free(p);
+			udf_alloc_failed(message, (size_t) res_length);
+			return 1;
+		}
+	}
+
+	if (args->args[1] != NULL && args->args[2] != NULL)
+	{
+		const size_t key_length = 2 * (size_t) args->lengths[1];
+		char *key = (char *) str_malloc(key_length + 1);
+
+		if (key != NULL)
+		{
+			memcpy(key, args->args[1], args->lengths[1]);
+			memcpy(key + args->lengths[1], args->args[2], args->lengths[2]);
+			p->table_entry = pattern_cache_acquire(funcname, key, key_length, str_translate_compile, str_free);
+			str_free(key);
+		}
+
+		if (p->table_entry == NULL)
+		{
+			str_free(p->buf);
+			str_free(p);
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s failed to allocate its translation table", funcname);
 			return 1;
 		}
-		initid->ptr = tmp;
 	}
 
+	kernel_select_init(&p->select, KERNEL_TRANSLATE);
+	initid->ptr = (char *) p;
 	initid->maybe_null = 1;
 	initid->max_length = res_length;
 	return 0;
@@ -663,10 +1390,31 @@ my_bool str_translate_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 **					str_translate_init() and str_translate())
 ** returns:	nothing
 ******************************************************************************/
-void str_translate_deinit(UDF_INIT *initid)
+static void str_translate_impl_deinit(UDF_INIT *initid)
 {
-	if (initid->ptr != NULL)
-		free(initid->ptr);
+	st_str_translate_data *p = (st_str_translate_data *) initid->ptr;
+
+	kernel_select_end(&p->select);
+	if (p->table_entry != NULL)
+		pattern_cache_release(p->table_entry);
+	str_free(p->buf);
+	str_free(p);
+}
+
+/* The subject, table, result and variant of byte_map() of str_translate(), for worker_pool_run() */
+typedef struct st_str_translate_job {
+	void (*byte_map)(char *dest, const unsigned char *table, const char *src, size_t length);
+	const unsigned char *table;
+	const char *subject;
+	char *result;
+} st_str_translate_job;
+
+/* Translates the chars [begin, end) of the subject. */
+static void str_translate_range(void *ctx, size_t begin, size_t end)
+{
+	const st_str_translate_job *job = (const st_str_translate_job *) ctx;
+
+	job->byte_map(job->result + begin, job->table, job->subject + begin, end - begin);
 }
 
 /******************************************************************************
@@ -679,17 +1427,18 @@ void str_translate_deinit(UDF_INIT *initid)
 **					to mem which can be set to 1 if the result is NULL; pointer
 **					to mem which can be set to 1 if the calculation resulted in an
 **					error
-** returns:	the string transformed by str_translate
+** returns:	the string transformed by str_translate, which is subject
+**					itself if no char of it is translated to a different char
 ******************************************************************************/
-char *str_translate(UDF_INIT *initid, UDF_ARGS *args,
+static char *str_translate_impl(UDF_INIT *initid, UDF_ARGS *args,
 			char *result, unsigned long *res_length,
 			char *null_value, char *error)
 {
-	int i, j;
-	const char *subject;
-	const char *src;
-	unsigned long src_length;
-	const char *dst;
+	st_str_translate_data *p = (st_str_translate_data *) initid->ptr;
+	unsigned long i;
+	const unsigned char *table;
+	unsigned char row_table[TRANSLATE_TABLE_SIZE];
+	st_str_translate_job job;
 
 	if (args->args[0] == NULL || args->args[1] == NULL || args->args[2] == NULL) {
 		result = NULL;
@@ -698,45 +1447,46 @@ char *str_translate(UDF_INIT *initid, UDF_ARGS *args,
 		return result;
 	}
 
-	// subject will contain the string to be translated
-	subject = args->args[0];
-
-	// src will contain the string to be translated
-	src = args->args[1];
-	src_length = args->lengths[1];
-
-	// dst will contain the string to be translated
-	dst = args->args[2];
-
-	if (initid->ptr != NULL)
+	// the table maps each char of srcchar to the corresponding char of dstchar
+	if (p->table_entry != NULL)
 	{
-		result = initid->ptr;
+		table = (const unsigned char *) pattern_cache_value(p->table_entry);
+	}
+	else
+	{
+		byte_map_fill(row_table, args->args[1], args->args[2], args->lengths[1]);
+		table = row_table;
 	}
 
 	*res_length = args->lengths[0];
 
-	memcpy(result, subject, *res_length);
+	// skip the chars that the table leaves unchanged; if that is all of them, the subject is the result
+	i = byte_map_unchanged_length(table, args->args[0], *res_length);
 
+	if (i == *res_length)
 	{
-		char *__restrict p = result;
+		return args->args[0];
+	}
 
-		for (i = 0; i < *res_length; ++i, ++p)
-		{
-			// for each character of the subject string we check if it is present in src
-			for (j = 0; j < src_length; j++)
-			{
-				if (subject[i] == src[j])
-				{
-					// replace the character with the corresponding one from dst
-					*p = dst[j];
-				}
-			}
-		}
+	if (p->buf != NULL)
+	{
+		result = p->buf;
 	}
 
+	// copy the unchanged prefix, and translate from the first changed char on; values of many
+	// megabytes are split across the threads of the worker pool
+	memcpy(result, args->args[0], i);
+	job.byte_map = (kernel_select_row(&p->select, *res_length - i) == KERNEL_VECTOR ? byte_map_vector : byte_map_scalar);
+	job.table = table;
+	job.subject = args->args[0] + i;
+	job.result = result + i;
+	worker_pool_run(*res_length - i, str_translate_range, &job);
+
 	return result;
 }
 
+DEFINE_FOLDABLE_STRING_UDF(str_translate)
+
 
 /******************************************************************************
 ** purpose:	called once for each SQL statement which invokes str_ucfirst();
@@ -753,7 +1503,7 @@ char *str_translate(UDF_INIT *initid, UDF_ARGS *args,
 ** returns:	1 => failure; 0 => successful initialization
 ******************************************************************************/
 
-my_bool str_ucfirst_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+static my_bool str_ucfirst_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
 	static const char funcname[] = "str_ucfirst";
 	unsigned long res_length;
@@ -774,10 +1524,10 @@ my_bool str_ucfirst_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 
 	if (res_length > 255)
 	{
-		char *tmp = (char *) malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
+		char *tmp = (char *) str_malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
 		if (tmp == NULL)
 		{
-			snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", (size_t) res_length);
+			udf_alloc_failed(message, (size_t) res_length);
 			return 1;
 		}
 		initid->ptr = tmp;
@@ -796,10 +1546,10 @@ my_bool str_ucfirst_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 **					str_ucfirst_init() and str_ucfirst())
 ** returns:	nothing
 ******************************************************************************/
-void str_ucfirst_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
+static void str_ucfirst_impl_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
 {
 	if (initid->ptr != NULL)
-		free(initid->ptr);
+		str_free(initid->ptr);
 }
 
 /******************************************************************************
@@ -810,9 +1560,10 @@ void str_ucfirst_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
 **					to mem which can be set to 1 if the result is NULL; pointer
 **					to mem which can be set to 1 if the calculation resulted in an
 **					error
-** returns:	the original string with the first character capitalized
+** returns:	the original string with the first character capitalized,
+**					which is the argument itself if that is already uppercase
 ******************************************************************************/
-char *str_ucfirst(UDF_INIT *initid, UDF_ARGS *args,
+static char *str_ucfirst_impl(UDF_INIT *initid, UDF_ARGS *args,
 			char *result, unsigned long *res_length,
 			char *null_value, char *error)
 {
@@ -823,22 +1574,28 @@ char *str_ucfirst(UDF_INIT *initid, UDF_ARGS *args,
 		return result;
 	}
 
+	*res_length = args->lengths[0];
+	*null_value = 0;
+	*error = 0;
+
+	// if the first character is already uppercase, the argument string is the result
+	if (args->lengths[0] == 0 || (char) my_toupper(&my_charset_latin1, args->args[0][0]) == args->args[0][0]) {
+		return args->args[0];
+	}
+
 	if (initid->ptr != NULL) {
 		result = initid->ptr;
 	}
 
-	// copy the argument string into result
-	memcpy(result, args->args[0], args->lengths[0]);
-
-	// capitalize the first character of the string
-	*result = my_toupper(&my_charset_latin1, *result);
+	// capitalize the first character of the string, and copy the rest of the argument string
+	*result = my_toupper(&my_charset_latin1, args->args[0][0]);
+	memcpy(result + 1, args->args[0] + 1, args->lengths[0] - 1);
 
-	*res_length = args->lengths[0];
-	*null_value = 0;
-	*error = 0;
 	return result;
 }
 
+DEFINE_FOLDABLE_STRING_UDF(str_ucfirst)
+
 
 /******************************************************************************
 ** purpose:	called once for each SQL statement which invokes str_ucwords();
@@ -855,7 +1612,7 @@ char *str_ucfirst(UDF_INIT *initid, UDF_ARGS *args,
 ** returns:	1 => failure; 0 => successful initialization
 ******************************************************************************/
 
-my_bool str_ucwords_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+static my_bool str_ucwords_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
 	static const char funcname[] = "str_ucwords";
 	unsigned long res_length;
@@ -876,10 +1633,10 @@ my_bool str_ucwords_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 
 	if (res_length > 255)
 	{
-		char *tmp = (char *) malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
+		char *tmp = (char *) str_malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
 		if (tmp == NULL)
 		{
-			snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", (size_t) res_length);
+			udf_alloc_failed(message, (size_t) res_length);
 			return 1;
 		}
 		initid->ptr = tmp;
@@ -898,10 +1655,10 @@ my_bool str_ucwords_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 **					str_ucwords_init() and str_ucwords())
 ** returns:	nothing
 ******************************************************************************/
-void str_ucwords_deinit(UDF_INIT *initid)
+static void str_ucwords_impl_deinit(UDF_INIT *initid)
 {
 	if (initid->ptr != NULL)
-		free(initid->ptr);
+		str_free(initid->ptr);
 }
 
 /******************************************************************************
@@ -914,13 +1671,15 @@ void str_ucwords_deinit(UDF_INIT *initid)
 **					to mem which can be set to 1 if the result is NULL; pointer
 **					to mem which can be set to 1 if the calculation resulted in an
 **					error
-** returns:	the original string with the first character of each word capitalized
+** returns:	the original string with the first character of each word capitalized,
+**					which is the argument itself if those are already uppercase
 ******************************************************************************/
-char *str_ucwords(UDF_INIT *initid, UDF_ARGS *args,
+static char *str_ucwords_impl(UDF_INIT *initid, UDF_ARGS *args,
 			char *result, unsigned long *res_length,
 			char *null_value, char *error)
 {
-	int i;
+	const char *subject;
+	unsigned long i;
 	int new_word = 0;
 
 	if (args->args[0] == NULL) {
@@ -930,24 +1689,52 @@ char *str_ucwords(UDF_INIT *initid, UDF_ARGS *args,
 		return result;
 	}
 
+	subject = args->args[0];
+	*res_length = args->lengths[0];
+
+	// find the first character that has to be capitalized; if there is none, the argument
+	// string is the result
+	for (i = 0; i < *res_length; i++)
+	{
+		if (my_isalpha(&my_charset_latin1, subject[i]))
+		{
+			if (!new_word)
+			{
+				new_word = 1;
+				if ((char) my_toupper(&my_charset_latin1, subject[i]) != subject[i])
+					break;
+			}
+		}
+		else
+		{
+			new_word = 0;
+		}
+	}
+
+	if (i == *res_length)
+	{
+		return args->args[0];
+	}
+
 	if (initid->ptr != NULL) {
 		result = initid->ptr;
 	}
 
-	// copy the argument string into result
-	memcpy(result, args->args[0], args->lengths[0]);
-
-	*res_length = args->lengths[0];
+	// copy the unchanged prefix of the argument string into result
+	memcpy(result, subject, i);
+	result[i] = my_toupper(&my_charset_latin1, subject[i]);
 
-	// capitalize the first character of each word in the string
-	for (i = 0; i < *res_length; i++)
+	// capitalize the first character of each of the remaining words in the string
+	for (i++; i < *res_length; i++)
 	{
-		if (my_isalpha(&my_charset_latin1, result[i]))
+		result[i] = subject[i];
+
+		if (my_isalpha(&my_charset_latin1, subject[i]))
 		{
 			if (!new_word)
 			{
 				new_word = 1;
-				result[i] = my_toupper(&my_charset_latin1, result[i]);
+				result[i] = my_toupper(&my_charset_latin1, subject[i]);
 			}
 		}
 		else
@@ -959,6 +1746,16 @@ char *str_ucwords(UDF_INIT *initid, UDF_ARGS *args,
 	return result;
 }
 
+DEFINE_MEMOIZED_STRING_UDF(str_ucwords)
+
+typedef struct st_str_xor_data {
+	/* Buffer for results longer than 255 bytes; otherwise NULL */
+	st_big_buffer *buf;
+
+	/* The choice between the variants of xor_bytes() */
+	st_kernel_select select;
+} st_str_xor_data;
+
 /******************************************************************************
 ** purpose:	called once for each invocation of str_xor();
 **					checks arguments, sets restrictions
@@ -967,10 +1764,11 @@ char *str_ucwords(UDF_INIT *initid, UDF_ARGS *args,
 **					array of size MYSQL_ERRMSG_SIZE in which an error message can be stored if necessary
 ** returns:	1 => failure; 0 => success
 ******************************************************************************/
-my_bool str_xor_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+static my_bool str_xor_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
 	static const char funcname[] = "str_xor";
 	unsigned long res_length;
+	st_str_xor_data *p;
 
 	if (args->arg_count != 2)
 	{
@@ -994,28 +1792,52 @@ my_bool str_xor_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 		return 1;
 	}
 
-	initid->ptr = NULL;
-
-	if (res_length > 255)
+	p = (st_str_xor_data *) str_malloc(sizeof (st_str_xor_data));
+	if (p == NULL)
 	{
-		char *tmp = (char *) malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
-		if (tmp == NULL)
-		{
-			snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", (size_t) res_length);
-			return 1;
-		}
-		initid->ptr = tmp;
+		udf_alloc_failed(message, sizeof (st_str_xor_data));
+		return 1;
+	}
+	if (udf_result_buffer_init(&p->buf, res_length, message))
+	{
+		str_free(p);
+		return 1;
 	}
+	kernel_select_init(&p->select, KERNEL_XOR);
+	initid->ptr = (char *) p;
 
 	initid->maybe_null = 1;
 	initid->max_length = res_length;
 	return 0;
 }
 
-void str_xor_deinit(UDF_INIT *initid)
+static void str_xor_impl_deinit(UDF_INIT *initid)
 {
-	if (initid->ptr != NULL)
-		free(initid->ptr);
+	st_str_xor_data *p = (st_str_xor_data *) initid->ptr;
+
+	kernel_select_end(&p->select);
+	udf_result_buffer_deinit(p->buf);
+	str_free(p);
+}
+
+/* The arguments, the result and the variant of xor_bytes() of str_xor(), for worker_pool_run() */
+typedef struct st_str_xor_job {
+	void (*xor_bytes)(char *dest, const char *longer, size_t length, const char *shorter, size_t shorter_length);
+	const char *longer;
+	const char *shorter;
+	size_t shorter_length;
+	char *result;
+} st_str_xor_job;
+
+/* XORs the bytes [begin, end) of the arguments, the shorter one being padded with NUL bytes. */
+static void str_xor_range(void *ctx, size_t begin, size_t end)
+{
+	const st_str_xor_job *job = (const st_str_xor_job *) ctx;
+	const size_t shorter_begin = (begin < job->shorter_length ? begin : job->shorter_length);
+
+	// past the end of the shorter argument, its pointer stays at its end rather than beyond it
+	job->xor_bytes(job->result + begin, job->longer + begin, end - begin, job->shorter + shorter_begin,
+			job->shorter_length - shorter_begin);
 }
 
 /******************************************************************************
@@ -1031,9 +1853,12 @@ void str_xor_deinit(UDF_INIT *initid)
 **					error
 ** returns:	the bytewise XOR of the two strings
 ******************************************************************************/
-char *str_xor(UDF_INIT *initid, UDF_ARGS *args, char *result,
+static char *str_xor_impl(UDF_INIT *initid, UDF_ARGS *args, char *result,
 		unsigned long *res_length, char *null_value, char *error)
 {
+	st_str_xor_data *p = (st_str_xor_data *) initid->ptr;
+	st_str_xor_job job;
+
 	assert(args->arg_count == 2);
 	assert(args->arg_type[0] == STRING_RESULT && args->arg_type[1] == STRING_RESULT);
 	//assert(args->args[0] != NULL && args->args[1] != NULL);
@@ -1045,47 +1870,42 @@ char *str_xor(UDF_INIT *initid, UDF_ARGS *args, char *result,
 	}
 
 
-	if (initid->ptr != NULL)
+	result = udf_result_buffer(p->buf, result, args->lengths[0] > args->lengths[1] ? args->lengths[0] : args->lengths[1]);
+	if (result == NULL)
 	{
-		result = initid->ptr;
+		*res_length = 0;
+		*error = 1;
+		return result;
 	}
 
+	// XOR is commutative, so the longer argument can be taken as the first operand
+	if (args->lengths[0] >= args->lengths[1])
 	{
-		char *__restrict p = result,
-				*arg0 = args->args[0],
-				*arg1 = args->args[1];
-		const unsigned long arg0_length = args->lengths[0],
-				arg1_length = args->lengths[1];
-		char *const arg0_end = arg0 + arg0_length;
-		char *const arg1_end = arg1 + arg1_length;
-
-		if (arg0_length <= arg1_length)
-		{
-			for (; arg0 != arg0_end; ++arg0, ++arg1)
-				*p++ = (*arg0) ^ (*arg1);
-			//for (; arg1 != arg1_end; ++arg1)
-			//	*p++ = *arg1 /* '\x00' ^ (*arg1) */;
-			memcpy(p, arg1, (arg1_end - arg1));
-
-			*res_length = arg1_length;
-		}
-		else
-		{
-			for (; arg1 != arg1_end; ++arg0, ++arg1)
-				*p++ = (*arg0) ^ (*arg1);
-			//for (; arg0 != arg0_end; ++arg0)
-			//	*p++ = *arg0 /* (*arg0) ^ '\x00' */;
-			memcpy(p, arg0, (arg0_end - arg0));
-
-			*res_length = arg0_length;
-		}
+		job.longer = args->args[0];
+		job.shorter = args->args[1];
+		job.shorter_length = args->lengths[1];
+		*res_length = args->lengths[0];
+	}
+	else
+	{
+		job.longer = args->args[1];
+		job.shorter = args->args[0];
+		job.shorter_length = args->lengths[0];
+		*res_length = args->lengths[1];
 	}
+	job.xor_bytes = (kernel_select_row(&p->select, *res_length) == KERNEL_VECTOR ? xor_bytes_vector : xor_bytes_scalar);
+	job.result = result;
+
+	// values of many megabytes are split across the threads of the worker pool
+	worker_pool_run(*res_length, str_xor_range, &job);
 
 	*null_value = 0;
 	*error = 0;
 	return result;
 }
 
+DEFINE_FOLDABLE_STRING_UDF(str_xor)
+
 #ifndef __WIN__
 typedef struct st_str_srand_data {
 	/* Readable file descriptor of /dev/urandom */
@@ -1096,7 +1916,7 @@ typedef struct st_str_srand_data {
 } st_str_srand_data;
 #endif
 
-my_bool str_srand_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+static my_bool str_srand_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 {
 	static const char funcname[] = "str_srand_init";
 	long long *arg0;
@@ -1130,10 +1950,10 @@ my_bool str_srand_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 
 	if (*arg0 > 255)
 	{
-		char *tmp = (char *) malloc((size_t) *arg0); /* This is a safe cast because *arg0 <= SIZE_MAX. */
+		char *tmp = (char *) str_malloc((size_t) *arg0); /* This is a safe cast because *arg0 <= SIZE_MAX. */
 		if (tmp == NULL)
 		{
-			snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", (size_t) *arg0);
+			udf_alloc_failed(message, (size_t) *arg0);
 			return 1;
 		}
 		initid->ptr = tmp;
@@ -1142,10 +1962,10 @@ my_bool str_srand_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 	{
 		st_str_srand_data *p;
 
-		p = (st_str_srand_data *) malloc(sizeof (st_str_srand_data));
+		p = (st_str_srand_data *) str_malloc(sizeof (st_str_srand_data));
 		if (p == NULL)
 		{
-			snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", (sizeof (st_str_srand_data)));
+			udf_alloc_failed(message, sizeof (st_str_srand_data));
 			return 1;
 		}
 
@@ -1153,11 +1973,11 @@ my_bool str_srand_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 
 		if (*arg0 > 255)
 		{
-			char *tmp = (char *) malloc((size_t) *arg0); /* This is a safe cast because *arg0 <= SIZE_MAX. */
+			char *tmp = (char *) str_malloc((size_t) *arg0); /* This is a safe cast because *arg0 <= SIZE_MAX. */
 			if (tmp == NULL)
 			{
-				snprintf(message, MYSQL_ERRMSG_SIZE, "malloc() failed to allocate %zu bytes of memory", (size_t) *arg0);
-				free(p);
+				udf_alloc_failed(message, (size_t) *arg0);
+				str_free(p);
 				return 1;
 			}
 			p->buf = tmp;
@@ -1168,8 +1988,8 @@ my_bool str_srand_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 		{
 			snprintf(message, MYSQL_ERRMSG_SIZE, "failed to open /dev/urandom for reading: %s", strerror(errno));
 			if (p->buf != NULL)
-				free(p->buf);
-			free(p);
+				str_free(p->buf);
+			str_free(p);
 			return 1;
 		}
 
@@ -1182,24 +2002,24 @@ my_bool str_srand_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
 	return 0;
 }
 
-void str_srand_deinit(UDF_INIT *initid)
+static void str_srand_impl_deinit(UDF_INIT *initid)
 {
 #ifdef __WIN__
 	if (initid->ptr != NULL)
 	{
-		free(initid->ptr);
+		str_free(initid->ptr);
 	}
 #else
 	st_str_srand_data *p = (st_str_srand_data *) initid->ptr;
 
 	close(p->fd);
 	if (p->buf != NULL)
-		free(p->buf);
-	free(p);
+		str_free(p->buf);
+	str_free(p);
 #endif
 }
 
-char *str_srand(UDF_INIT *initid, UDF_ARGS *args, char *result,
+static char *str_srand_impl(UDF_INIT *initid, UDF_ARGS *args, char *result,
 		unsigned long *res_length, char *null_value, char *error)
 {
 	long long *arg0;
@@ -1260,4 +2080,2270 @@ char *str_srand(UDF_INIT *initid, UDF_ARGS *args, char *result,
 	return result;
 }
 
+DEFINE_TRACED_STRING_UDF(str_srand)
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_csv_field();
+**					checks arguments, sets restrictions, allocates memory that
+**					will be used during the main str_csv_field() function
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_csv_field() and str_csv_field_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_csv_field(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_csv_field_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_csv_field";
+	unsigned long res_length;
+
+	/* make sure user has provided a string, an integer and up to two one-character strings */
+	if (args->arg_count < 2 || args->arg_count > 4)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires two to four arguments (line, n [, delim [, quote]]), got %d argument%s.", funcname, args->arg_count, (args->arg_count == 1 ? "" : "s"));
+		return 1;
+	}
+	else if (args->arg_type[0] != STRING_RESULT
+			|| args->arg_type[1] != INT_RESULT
+			|| (args->arg_count > 2 && args->arg_type[2] != STRING_RESULT)
+			|| (args->arg_count > 3 && args->arg_type[3] != STRING_RESULT))
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument type: %s requires a string, an integer and optionally two string arguments (line, n [, delim [, quote]]).", funcname);
+		return 1;
+	}
+	else if ((args->arg_count > 2 && args->args[2] != NULL && args->lengths[2] != 1)
+			|| (args->arg_count > 3 && args->args[3] != NULL && args->lengths[3] != 1))
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "%s(line, n, delim, quote) requires delim and quote to be single characters", funcname);
+		return 1;
+	}
+	else if (args->arg_count > 3 && args->args[2] != NULL && args->args[3] != NULL && args->args[2][0] == args->args[3][0])
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "%s(line, n, delim, quote) requires delim and quote to differ", funcname);
+		return 1;
+	}
+
+	res_length = args->lengths[0];
+
+	if (SIZE_MAX < res_length)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "res_length (%lu) cannot be greater than SIZE_MAX (%zu)", res_length, (size_t) (SIZE_MAX));
+		return 1;
+	}
+
+	initid->ptr = NULL;
+
+	if (res_length > 255)
+	{
+		char *tmp = (char *) str_malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
+		if (tmp == NULL)
+		{
+			udf_alloc_failed(message, (size_t) res_length);
+			return 1;
+		}
+		initid->ptr = tmp;
+	}
+
+	initid->maybe_null = 1;
+	initid->max_length = res_length;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_csv_field_init(); this func
+**					is called once for each query which invokes str_csv_field(),
+**					it is called after all of the calls to str_csv_field() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_csv_field_init() and str_csv_field())
+** returns:	nothing
+******************************************************************************/
+static void str_csv_field_impl_deinit(UDF_INIT *initid)
+{
+	if (initid->ptr != NULL)
+		str_free(initid->ptr);
+}
+
+/******************************************************************************
+** purpose:	extract the n-th field (1-based) of a CSV record. Delimiters
+**					between quote characters do not separate fields, and the
+**					quotes of the selected field are removed, a doubled quote
+**					within a quoted region standing for a single quote character.
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the unquoted field, or NULL if the record has fewer than n fields
+******************************************************************************/
+static char *str_csv_field_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	const char *line;
+	long long n;
+	char delim = ',', quote = '"';
+	size_t field_begin, field_end;
+
+	if (args->args[0] == NULL || args->args[1] == NULL
+			|| (args->arg_count > 2 && (args->args[2] == NULL || args->lengths[2] != 1))
+			|| (args->arg_count > 3 && (args->args[3] == NULL || args->lengths[3] != 1)))
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	line = args->args[0];
+	n = *((long long *) args->args[1]);
+
+	if (args->arg_count > 2)
+		delim = args->args[2][0];
+	if (args->arg_count > 3)
+		quote = args->args[3][0];
+
+	if (n < 1 || (unsigned long long) n > (unsigned long long) args->lengths[0] + 1 || delim == quote
+			|| ! csv_field_locate(line, args->lengths[0], (size_t) n, delim, quote, &field_begin, &field_end))
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	// an unquoted field is returned in place
+	if (memchr(line + field_begin, quote, field_end - field_begin) == NULL)
+	{
+		*res_length = (unsigned long) (field_end - field_begin);
+		return (char *) line + field_begin;
+	}
+
+	if (initid->ptr != NULL)
+	{
+		result = initid->ptr;
+	}
+
+	*res_length = (unsigned long) csv_field_unquote(result, line + field_begin, field_end - field_begin, quote);
+	return result;
+}
+
+DEFINE_FOLDABLE_STRING_UDF(str_csv_field)
+
+typedef struct st_str_kv_get_data {
+	/* If non-NULL, a buffer where URL-decoded values are stored */
+	char *buf;
+
+	/* Non-zero if the key is constant, in which case search is prepared once by str_kv_get_init() */
+	int key_is_const;
+	st_kv_search search;
+
+	/* A copy of the constant key, which search refers to */
+	char key[1];
+} st_str_kv_get_data;
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_kv_get();
+**					checks arguments, sets restrictions, allocates memory that
+**					will be used during the main str_kv_get() function and, if
+**					the key is constant, prepares the key search
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_kv_get() and str_kv_get_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_kv_get(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_kv_get_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_kv_get";
+	unsigned long res_length;
+	st_str_kv_get_data *p;
+	size_t key_length = 0;
+
+	if (args->arg_count < 2 || args->arg_count > 5)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires two to five arguments (s, key [, pair_sep [, kv_sep [, url_decode]]]), got %d argument%s.", funcname, args->arg_count, (args->arg_count == 1 ? "" : "s"));
+		return 1;
+	}
+	else if (args->arg_type[0] != STRING_RESULT
+			|| args->arg_type[1] != STRING_RESULT
+			|| (args->arg_count > 2 && args->arg_type[2] != STRING_RESULT)
+			|| (args->arg_count > 3 && args->arg_type[3] != STRING_RESULT)
+			|| (args->arg_count > 4 && args->arg_type[4] != INT_RESULT))
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument type: %s requires four string arguments and an integer argument (s, key [, pair_sep [, kv_sep [, url_decode]]]).", funcname);
+		return 1;
+	}
+	else if ((args->arg_count > 2 && args->args[2] != NULL && args->lengths[2] != 1)
+			|| (args->arg_count > 3 && args->args[3] != NULL && args->lengths[3] != 1))
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "%s(s, key, pair_sep, kv_sep) requires pair_sep and kv_sep to be single characters", funcname);
+		return 1;
+	}
+	else if (args->args[1] != NULL && args->lengths[1] == 0)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "%s(s, key) requires a non-empty key", funcname);
+		return 1;
+	}
+
+	res_length = args->lengths[0];
+
+	if (SIZE_MAX < res_length)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "res_length (%lu) cannot be greater than SIZE_MAX (%zu)", res_length, (size_t) (SIZE_MAX));
+		return 1;
+	}
+
+	if (args->args[1] != NULL)
+		key_length = args->lengths[1];
+
+	p = (st_str_kv_get_data *) str_malloc(sizeof (st_str_kv_get_data) + key_length);
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_kv_get_data) + key_length);
+		return 1;
+	}
+
+	p->buf = NULL;
+	p->key_is_const = (args->args[1] != NULL);
+
+	if (p->key_is_const)
+	{
+		memcpy(p->key, args->args[1], key_length);
+		kv_search_prepare(&p->search, p->key, key_length);
+	}
+
+	if (res_length > 255)
+	{
+		char *tmp = (char *) str_malloc((size_t) res_length); /* This is a safe cast because res_length <= SIZE_MAX. */
+		if (tmp == NULL)
+		{
+			udf_alloc_failed(message, (size_t) res_length);
+			str_free(p);
+			return 1;
+		}
+		p->buf = tmp;
+	}
+
+	initid->ptr = (char *) p;
+
+	initid->maybe_null = 1;
+	initid->max_length = res_length;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_kv_get_init(); this func
+**					is called once for each query which invokes str_kv_get(),
+**					it is called after all of the calls to str_kv_get() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_kv_get_init() and str_kv_get())
+** returns:	nothing
+******************************************************************************/
+static void str_kv_get_impl_deinit(UDF_INIT *initid)
+{
+	st_str_kv_get_data *p = (st_str_kv_get_data *) initid->ptr;
+
+	if (p->buf != NULL)
+		str_free(p->buf);
+	str_free(p);
+}
+
+/******************************************************************************
+** purpose:	look up the value of a key in a list of key/value pairs, such
+**					as a query string or a header blob. The value is URL-decoded
+**					unless url_decode is 0.
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the value of the first pair with the given key, or NULL if there
+**					is no such pair
+******************************************************************************/
+static char *str_kv_get_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	st_str_kv_get_data *p = (st_str_kv_get_data *) initid->ptr;
+	st_kv_search search;
+	const st_kv_search *ks = &p->search;
+	char pair_sep = '&', kv_sep = '=';
+	int url_decode = 1;
+	size_t value_begin, value_end;
+	const char *value;
+
+	if (args->args[0] == NULL || args->args[1] == NULL || args->lengths[1] == 0
+			|| (args->arg_count > 2 && (args->args[2] == NULL || args->lengths[2] != 1))
+			|| (args->arg_count > 3 && (args->args[3] == NULL || args->lengths[3] != 1))
+			|| (args->arg_count > 4 && args->args[4] == NULL))
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	if (args->arg_count > 2)
+		pair_sep = args->args[2][0];
+	if (args->arg_count > 3)
+		kv_sep = args->args[3][0];
+	if (args->arg_count > 4)
+		url_decode = (*((long long *) args->args[4]) != 0);
+
+	if (! p->key_is_const)
+	{
+		kv_search_prepare(&search, args->args[1], args->lengths[1]);
+		ks = &search;
+	}
+
+	if (! kv_search_find(ks, args->args[0], args->lengths[0], pair_sep, kv_sep, &value_begin, &value_end))
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	value = args->args[0] + value_begin;
+
+	// a value that needs no decoding is returned in place
+	if (! url_decode || ! kv_url_needs_decode(value, value_end - value_begin))
+	{
+		*res_length = (unsigned long) (value_end - value_begin);
+		return (char *) value;
+	}
+
+	if (p->buf != NULL)
+	{
+		result = p->buf;
+	}
+
+	*res_length = (unsigned long) kv_url_decode(result, value, value_end - value_begin);
+	return result;
+}
+
+DEFINE_FOLDABLE_STRING_UDF(str_kv_get)
+
+/* Size of the header of str_lz4_compress() results: the original length as a 32-bit little-endian integer */
+#define LZ4_FRAME_HEADER_SIZE 4
+
+typedef struct st_str_lz4_compress_data {
+	/* Hash table of the compressor, reused for all rows */
+	uint32_t hash_table[LZ4_BLOCK_HASH_SIZE];
+
+	/* If non-NULL, a buffer of capacity bytes where results longer than 255 bytes are stored */
+	char *buf;
+	size_t capacity;
+} st_str_lz4_compress_data;
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_lz4_compress();
+**					checks arguments, sets restrictions, allocates the hash table
+**					that will be used for all rows
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_lz4_compress() and str_lz4_compress_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_lz4_compress(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_lz4_compress_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_lz4_compress";
+	st_str_lz4_compress_data *p;
+	size_t bound;
+
+	if (args->arg_count < 1 || args->arg_count > 2)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires one string argument and an optional integer argument (s [, accel]), got %d arguments.", funcname, args->arg_count);
+		return 1;
+	}
+	STRARGCHECK;
+	if (args->arg_count > 1 && args->arg_type[1] != INT_RESULT)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument type: %s requires an integer accel argument. Expected type %d, got type %d.", funcname, INT_RESULT, args->arg_type[1]);
+		return 1;
+	}
+
+	if (args->lengths[0] > 0xFFFFFFFFUL)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "%s cannot compress strings longer than 4294967295 bytes", funcname);
+		return 1;
+	}
+
+	bound = lz4_block_compress_bound((size_t) args->lengths[0]);
+	if (bound == 0 || bound > ULONG_MAX - LZ4_FRAME_HEADER_SIZE || bound > SIZE_MAX - LZ4_FRAME_HEADER_SIZE)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "the compressed form of %lu bytes cannot be greater than SIZE_MAX (%zu)", args->lengths[0], (size_t) (SIZE_MAX));
+		return 1;
+	}
+
+	p = (st_str_lz4_compress_data *) str_malloc(sizeof (st_str_lz4_compress_data));
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_lz4_compress_data));
+		return 1;
+	}
+
+	p->buf = NULL;
+	p->capacity = 0;
+	initid->ptr = (char *) p;
+
+	initid->maybe_null = 1;
+	initid->max_length = (unsigned long) (LZ4_FRAME_HEADER_SIZE + bound);
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_lz4_compress_init() and
+**					str_lz4_compress(); this func is called once for each query
+**					which invokes str_lz4_compress(), it is called after all of
+**					the calls to str_lz4_compress() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_lz4_compress_init() and str_lz4_compress())
+** returns:	nothing
+******************************************************************************/
+static void str_lz4_compress_impl_deinit(UDF_INIT *initid)
+{
+	st_str_lz4_compress_data *p = (st_str_lz4_compress_data *) initid->ptr;
+
+	if (p->buf != NULL)
+		str_free(p->buf);
+	str_free(p);
+}
+
+/******************************************************************************
+** purpose:	compress a string into an LZ4 block, preceded by the length of
+**					the string as a 32-bit little-endian integer. The output buffer
+**					is sized from the length of the string, so it is allocated at
+**					most once for each longer argument.
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the compressed string; the empty string if the argument is empty
+******************************************************************************/
+static char *str_lz4_compress_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	st_str_lz4_compress_data *p = (st_str_lz4_compress_data *) initid->ptr;
+	const unsigned long length = args->lengths[0];
+	size_t size;
+	int acceleration = 1;
+
+	if (args->args[0] == NULL) {
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	if (length == 0)
+	{
+		*res_length = 0;
+		return result;
+	}
+
+	if (args->arg_count > 1 && args->args[1] != NULL)
+	{
+		const long long accel = *((long long *) args->args[1]);
+		acceleration = (accel < 1 ? 1 : accel > LZ4_BLOCK_MAX_ACCELERATION ? LZ4_BLOCK_MAX_ACCELERATION : (int) accel);
+	}
+
+	size = lz4_block_compress_bound((size_t) length);
+	if (size == 0 || size > SIZE_MAX - LZ4_FRAME_HEADER_SIZE)
+	{
+		*error = 1;
+		return NULL;
+	}
+	size += LZ4_FRAME_HEADER_SIZE;
+
+	if (size > 255)
+	{
+		if (p->capacity < size)
+		{
+			char *tmp = (char *) str_malloc(size);
+			if (tmp == NULL)
+			{
+				*error = 1;
+				return NULL;
+			}
+			if (p->buf != NULL)
+				str_free(p->buf);
+			p->buf = tmp;
+			p->capacity = size;
+		}
+		result = p->buf;
+	}
+
+	result[0] = (char) (length & 0xFF);
+	result[1] = (char) ((length >> 8) & 0xFF);
+	result[2] = (char) ((length >> 16) & 0xFF);
+	result[3] = (char) ((length >> 24) & 0xFF);
+
+	*res_length = (unsigned long) (LZ4_FRAME_HEADER_SIZE
+			+ lz4_block_compress(args->args[0], (size_t) length, result + LZ4_FRAME_HEADER_SIZE, p->hash_table, acceleration));
+	return result;
+}
+
+DEFINE_FOLDABLE_STRING_UDF(str_lz4_compress)
+
+typedef struct st_str_lz4_decompress_data {
+	/* If non-NULL, a buffer of capacity bytes where results longer than 255 bytes are stored */
+	char *buf;
+	size_t capacity;
+} st_str_lz4_decompress_data;
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_lz4_decompress();
+**					checks arguments, sets restrictions
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_lz4_decompress() and str_lz4_decompress_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_lz4_decompress(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_lz4_decompress_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_lz4_decompress";
+	st_str_lz4_decompress_data *p;
+
+	/* make sure user has provided exactly one string argument */
+	ARGCOUNTCHECK("string");
+	STRARGCHECK;
+
+	p = (st_str_lz4_decompress_data *) str_malloc(sizeof (st_str_lz4_decompress_data));
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_lz4_decompress_data));
+		return 1;
+	}
+
+	p->buf = NULL;
+	p->capacity = 0;
+	initid->ptr = (char *) p;
+
+	initid->maybe_null = 1;
+	initid->max_length = 0xFFFFFFFFUL;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_lz4_decompress_init() and
+**					str_lz4_decompress(); this func is called once for each query
+**					which invokes str_lz4_decompress(), it is called after all of
+**					the calls to str_lz4_decompress() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_lz4_decompress_init() and str_lz4_decompress())
+** returns:	nothing
+******************************************************************************/
+static void str_lz4_decompress_impl_deinit(UDF_INIT *initid)
+{
+	st_str_lz4_decompress_data *p = (st_str_lz4_decompress_data *) initid->ptr;
+
+	if (p->buf != NULL)
+		str_free(p->buf);
+	str_free(p);
+}
+
+/******************************************************************************
+** purpose:	decompress a string produced by str_lz4_compress(). The output
+**					buffer is sized from the length stored in the header, so it is
+**					allocated at most once for each longer result.
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the original string, or NULL if the argument is not valid
+**					str_lz4_compress() output
+******************************************************************************/
+static char *str_lz4_decompress_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	st_str_lz4_decompress_data *p = (st_str_lz4_decompress_data *) initid->ptr;
+	const unsigned char *header = (const unsigned char *) args->args[0];
+	const unsigned long length = args->lengths[0];
+	size_t original_length;
+
+	if (args->args[0] == NULL) {
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	if (length == 0)
+	{
+		*res_length = 0;
+		return result;
+	}
+
+	original_length = (size_t) header[0] | ((size_t) header[1] << 8) | ((size_t) header[2] << 16) | ((size_t) header[3] << 24);
+
+	// LZ4 cannot expand data by more than a factor of 255, so anything longer is a corrupt header.
+	if (length <= LZ4_FRAME_HEADER_SIZE || original_length > (length - LZ4_FRAME_HEADER_SIZE) * (size_t) 255)
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	if (original_length > 255)
+	{
+		if (p->capacity < original_length)
+		{
+			char *tmp = (char *) str_malloc(original_length);
+			if (tmp == NULL)
+			{
+				*error = 1;
+				return NULL;
+			}
+			if (p->buf != NULL)
+				str_free(p->buf);
+			p->buf = tmp;
+			p->capacity = original_length;
+		}
+		result = p->buf;
+	}
+
+	if (lz4_block_decompress(args->args[0] + LZ4_FRAME_HEADER_SIZE, length - LZ4_FRAME_HEADER_SIZE, result, original_length) != 0)
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	*res_length = (unsigned long) original_length;
+	return result;
+}
+
+DEFINE_FOLDABLE_STRING_UDF(str_lz4_decompress)
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_simhash();
+**					checks arguments, sets restrictions
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_simhash() and str_simhash_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_simhash(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_simhash_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_simhash";
+
+	if (args->arg_count < 1 || args->arg_count > 2)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires one string argument and an optional integer argument (s [, shingle_size]), got %d arguments.", funcname, args->arg_count);
+		return 1;
+	}
+	STRARGCHECK;
+	if (args->arg_count > 1)
+	{
+		if (args->arg_type[1] != INT_RESULT)
+		{
+			snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument type: %s requires an integer shingle_size argument. Expected type %d, got type %d.", funcname, INT_RESULT, args->arg_type[1]);
+			return 1;
+		}
+		else if (args->args[1] != NULL && (*((long long *) args->args[1]) < 1 || *((long long *) args->args[1]) > SIMHASH_MAX_SHINGLE_SIZE))
+		{
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s requires shingle_size to be between 1 and %d", funcname, SIMHASH_MAX_SHINGLE_SIZE);
+			return 1;
+		}
+	}
+
+	initid->ptr = NULL;
+	initid->maybe_null = 1;
+	initid->max_length = 8;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_simhash_init(); this func
+**					is called once for each query which invokes str_simhash(),
+**					it is called after all of the calls to str_simhash() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_simhash_init() and str_simhash())
+** returns:	nothing
+******************************************************************************/
+static void str_simhash_impl_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
+{
+}
+
+/******************************************************************************
+** purpose:	compute the 64-bit SimHash fingerprint of a string from its
+**					shingles (runs of shingle_size bytes, 4 by default)
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the fingerprint as an 8-byte big-endian binary string
+******************************************************************************/
+static char *str_simhash_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	long long shingle_size = 4;
+	uint64_t fingerprint;
+	int i;
+
+	if (args->arg_count > 1)
+		shingle_size = (args->args[1] != NULL ? *((long long *) args->args[1]) : 0);
+
+	if (args->args[0] == NULL || shingle_size < 1 || shingle_size > SIMHASH_MAX_SHINGLE_SIZE) {
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	fingerprint = simhash64(args->args[0], args->lengths[0], (size_t) shingle_size);
+
+	for (i = 7; i >= 0; --i, fingerprint >>= 8)
+		result[i] = (char) (fingerprint & 0xFF);
+
+	*res_length = 8;
+	return result;
+}
+
+DEFINE_MEMOIZED_STRING_UDF(str_simhash)
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_hamming();
+**					checks arguments
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_hamming() and str_hamming_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_hamming(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_hamming_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	if (args->arg_count != 2)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: str_hamming requires exactly two string arguments, got %d arguments.", args->arg_count);
+		return 1;
+	}
+	if (args->arg_type[0] != STRING_RESULT
+			|| args->arg_type[1] != STRING_RESULT)
+	{
+		x_strlcpy(message, "wrong argument type: str_hamming requires two string arguments", MYSQL_ERRMSG_SIZE);
+		return 1;
+	}
+
+	initid->ptr = NULL;
+	initid->maybe_null = 1;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_hamming_init(); this func
+**					is called once for each query which invokes str_hamming(),
+**					it is called after all of the calls to str_hamming() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_hamming_init() and str_hamming())
+** returns:	nothing
+******************************************************************************/
+static void str_hamming_impl_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
+{
+}
+
+/******************************************************************************
+** purpose:	count the bits that differ between two binary strings. If one
+**					string argument is longer than the other, the shorter string
+**					is considered to be padded with enough trailing NUL bytes that
+**					the arguments would have the same length.
+** receives:	pointer to UDF_INIT struct; pointer to UDF_ARGS struct which
+**					contains the two string arguments and their lengths; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the Hamming distance of the two strings
+******************************************************************************/
+static long long str_hamming_impl(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error)
+{
+	if (args->args[0] == NULL || args->args[1] == NULL) {
+		*is_null = 1;
+		return 0;
+	}
+
+	return (long long) hamming_distance(args->args[0], args->lengths[0], args->args[1], args->lengths[1]);
+}
+
+DEFINE_TRACED_INTEGER_UDF(str_hamming)
+
+typedef struct st_str_pipeline_data {
+	/* The pipeline compiled from spec, which is spec_length bytes long; spec is NULL if it is the
+	   constant argument of the statement, in which case the pipeline is compiled by _init */
+	st_str_pipeline *pipeline;
+	char *spec;
+	size_t spec_length;
+	int spec_is_const;
+
+	/* Scratch memory of str_pipeline_run(), of scratch_size bytes */
+	char *scratch;
+	size_t scratch_size;
+
+	/* Buffer for results longer than 255 bytes; otherwise NULL */
+	st_big_buffer *buf;
+
+	/* The case and letters of latin1, for the pipelines compiled by the rows */
+	st_str_pipeline_ctype ctype;
+} st_str_pipeline_data;
+
+/* Fills the tables of `ctype` with the case and letters of latin1, like str_ucwords(). */
+static void str_pipeline_fill_ctype(st_str_pipeline_ctype *ctype)
+{
+	unsigned i;
+
+	for (i = 0; i < 256; ++i)
+	{
+		ctype->upper[i] = (unsigned char) my_toupper(&my_charset_latin1, i);
+		ctype->lower[i] = (unsigned char) my_tolower(&my_charset_latin1, i);
+		ctype->alpha[i] = (my_isalpha(&my_charset_latin1, i) ? 1 : 0);
+	}
+}
+
+/* Makes the scratch memory of p at least `size` bytes. Returns 0 on success. */
+static int str_pipeline_reserve_scratch(st_str_pipeline_data *p, size_t size)
+{
+	char *scratch;
+
+	if (size <= p->scratch_size)
+		return 0;
+
+	scratch = (char *) str_realloc(p->scratch, size);
+	if (scratch == NULL)
+		return 1;
+
+	p->scratch = scratch;
+	p->scratch_size = size;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_pipeline();
+**					checks arguments, sets restrictions, allocates memory that
+**					will be used during the main str_pipeline() function and, if
+**					spec is constant, compiles it
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_pipeline() and str_pipeline_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_pipeline(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_pipeline_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_pipeline";
+	unsigned long res_length;
+	st_str_pipeline_data *p;
+
+	/* make sure user has provided exactly two string arguments */
+	if (args->arg_count != 2) {
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires two string arguments (spec, s), got %d argument%s.", funcname, args->arg_count, (args->arg_count == 1 ? "" : "s"));
+		return 1;
+	} else if (args->arg_type[0] != STRING_RESULT || args->arg_type[1] != STRING_RESULT) {
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument type: %s requires two string arguments (spec, s).", funcname);
+		return 1;
+	}
+
+	res_length = args->lengths[1];
+
+	if (SIZE_MAX < res_length)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "res_length (%lu) cannot be greater than SIZE_MAX (%zu)", res_length, (size_t) (SIZE_MAX));
+		return 1;
+	}
+
+	p = (st_str_pipeline_data *) str_calloc(1, sizeof (st_str_pipeline_data));
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_pipeline_data));
+		return 1;
+	}
+	str_pipeline_fill_ctype(&p->ctype);
+
+	if (args->args[0] != NULL)
+	{
+		const char *error;
+		unsigned error_op;
+
+		p->spec_is_const = 1;
+		p->pipeline = str_pipeline_compile(args->args[0], args->lengths[0], &p->ctype, &error, &error_op);
+		if (p->pipeline == NULL)
+		{
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s: %s in transform %u of the spec", funcname, error, error_op);
+			str_free(p);
+			return 1;
+		}
+		if (str_pipeline_reserve_scratch(p, str_pipeline_scratch_size(p->pipeline)))
+		{
+			udf_alloc_failed(message, str_pipeline_scratch_size(p->pipeline));
+			str_pipeline_free(p->pipeline);
+			str_free(p);
+			return 1;
+		}
+	}
+
+	if (udf_result_buffer_init(&p->buf, res_length, message))
+	{
+		str_pipeline_free(p->pipeline);
+		str_free(p->scratch);
+		str_free(p);
+		return 1;
+	}
+
+	initid->ptr = (char *) p;
+	initid->maybe_null = 1;
+	initid->max_length = res_length;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_pipeline_init(); this func
+**					is called once for each query which invokes str_pipeline(),
+**					it is called after all of the calls to str_pipeline() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_pipeline_init() and str_pipeline())
+** returns:	nothing
+******************************************************************************/
+static void str_pipeline_impl_deinit(UDF_INIT *initid)
+{
+	st_str_pipeline_data *p = (st_str_pipeline_data *) initid->ptr;
+
+	str_pipeline_free(p->pipeline);
+	str_free(p->spec);
+	str_free(p->scratch);
+	udf_result_buffer_deinit(p->buf);
+	str_free(p);
+}
+
+/* Compiles the spec of the current row unless it is the spec of the previous one. Returns 0 on
+   success. */
+static int str_pipeline_compile_row(st_str_pipeline_data *p, const char *spec, size_t spec_length)
+{
+	st_str_pipeline *pipeline;
+	char *copy;
+	const char *error;
+	unsigned error_op;
+
+	if (p->pipeline != NULL && p->spec_length == spec_length && memcmp(p->spec, spec, spec_length) == 0)
+		return 0;
+
+	pipeline = str_pipeline_compile(spec, spec_length, &p->ctype, &error, &error_op);
+	if (pipeline == NULL)
+		return 1;
+
+	// The scratch memory is reserved before the pipeline replaces that of the previous spec, which
+	// the next row could otherwise run with too little of it.
+	copy = (char *) str_malloc(spec_length + 1);
+	if (copy == NULL || str_pipeline_reserve_scratch(p, str_pipeline_scratch_size(pipeline)))
+	{
+		str_free(copy);
+		str_pipeline_free(pipeline);
+		return 1;
+	}
+	memcpy(copy, spec, spec_length);
+
+	str_pipeline_free(p->pipeline);
+	str_free(p->spec);
+	p->pipeline = pipeline;
+	p->spec = copy;
+	p->spec_length = spec_length;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	apply the transforms of spec to s in a single pass over s
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the transformed string, or NULL if any argument is NULL or a
+**					spec that is not constant is not valid
+******************************************************************************/
+static char *str_pipeline_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	st_str_pipeline_data *p = (st_str_pipeline_data *) initid->ptr;
+
+	if (args->args[0] == NULL || args->args[1] == NULL) {
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	if (!p->spec_is_const && str_pipeline_compile_row(p, args->args[0], args->lengths[0]) != 0)
+	{
+		*error = 1;
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	result = udf_result_buffer(p->buf, result, args->lengths[1]);
+	if (result == NULL)
+	{
+		*res_length = 0;
+		*error = 1;
+		return result;
+	}
+
+	*res_length = (unsigned long) str_pipeline_run(p->pipeline, args->args[1], args->lengths[1], result, p->scratch);
+	return result;
+}
+
+DEFINE_FOLDABLE_STRING_UDF(str_pipeline)
+
+
+/* Default false positive probability of str_bloom_build() */
+#define BLOOM_DEFAULT_FPP 0.01
+
+typedef struct st_str_bloom_build_data {
+	/* The filter of the current group */
+	st_bloom_filter filter;
+
+	/* Target false positive probability */
+	double fpp;
+
+	/* Non-zero if expected_n was given, in which case the filter has its final size from the
+	   start. Otherwise, the hashes of the keys of the group are collected in hashes, and the
+	   filter is sized from their number at the end of the group. */
+	int sized;
+	uint64_t *hashes;
+	size_t hash_count;
+	size_t hash_capacity;
+
+	/* Buffer of buf_capacity bytes where the serialized filter is stored */
+	char *buf;
+	size_t buf_capacity;
+} st_str_bloom_build_data;
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_bloom_build();
+**					checks arguments, sets restrictions, allocates the filter if
+**					its expected number of keys is known
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_bloom_build_clear(), str_bloom_build_add(),
+**					str_bloom_build() and str_bloom_build_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_bloom_build_add(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_bloom_build_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_bloom_build";
+	st_str_bloom_build_data *p;
+	long long expected_n = -1;
+	double fpp = BLOOM_DEFAULT_FPP;
+
+	if (args->arg_count < 1 || args->arg_count > 3)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires one key argument, an optional integer argument and an optional real argument (key [, expected_n, fpp]), got %d arguments.", funcname, args->arg_count);
+		return 1;
+	}
+
+	if (args->arg_count > 1)
+	{
+		if (args->arg_type[1] != INT_RESULT || args->args[1] == NULL || *((long long *) args->args[1]) < 0)
+		{
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s requires expected_n to be a constant non-negative integer", funcname);
+			return 1;
+		}
+		expected_n = *((long long *) args->args[1]);
+	}
+
+	if (args->arg_count > 2)
+	{
+		if (args->args[2] == NULL)
+		{
+			fpp = 0;
+		}
+		else if (args->arg_type[2] == REAL_RESULT)
+		{
+			fpp = *((double *) args->args[2]);
+		}
+		else if (args->arg_type[2] == DECIMAL_RESULT && args->lengths[2] < 64)
+		{
+			char decimal[64];
+			memcpy(decimal, args->args[2], args->lengths[2]);
+			decimal[args->lengths[2]] = '\0';
+			fpp = strtod(decimal, NULL);
+		}
+		else
+		{
+			fpp = 0;
+		}
+
+		if (! (fpp > 0 && fpp <= 0.5))
+		{
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s requires fpp to be a constant number greater than 0 and at most 0.5", funcname);
+			return 1;
+		}
+	}
+
+	// Keys of any type are hashed as strings, so that 42 and '42' are the same key.
+	args->arg_type[0] = STRING_RESULT;
+
+	p = (st_str_bloom_build_data *) str_calloc(1, sizeof (st_str_bloom_build_data));
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_bloom_build_data));
+		return 1;
+	}
+	p->fpp = fpp;
+
+	if (expected_n >= 0)
+	{
+		const uint32_t num_blocks = bloom_blocks_for((uint64_t) expected_n, fpp);
+
+		if (num_blocks == 0)
+		{
+			str_free(p);
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s cannot build a filter for %lld keys with fpp %g that fits in a LONGBLOB", funcname, expected_n, fpp);
+			return 1;
+		}
+
+		if (bloom_filter_init(&p->filter, num_blocks) != 0)
+		{
+			str_free(p);
+			udf_alloc_failed(message, (size_t) num_blocks * BLOOM_BLOCK_SIZE);
+			return 1;
+		}
+		p->sized = 1;
+	}
+
+	initid->ptr = (char *) p;
+	initid->maybe_null = 1;
+	initid->max_length = 0xFFFFFFFFUL;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_bloom_build_init() and the
+**					other str_bloom_build functions; this func is called once for
+**					each query which invokes str_bloom_build(), it is called after
+**					all groups are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_bloom_build_init() and str_bloom_build())
+** returns:	nothing
+******************************************************************************/
+static void str_bloom_build_impl_deinit(UDF_INIT *initid)
+{
+	st_str_bloom_build_data *p = (st_str_bloom_build_data *) initid->ptr;
+
+	bloom_filter_free(&p->filter);
+	str_free(p->hashes);
+	str_free(p->buf);
+	str_free(p);
+}
+
+/******************************************************************************
+** purpose:	start a new group: remove all keys from the filter
+** receives:	pointer to UDF_INIT struct; pointer to mem which can be set to 1
+**					if the result is NULL; pointer to mem which can be set to 1 if
+**					the calculation resulted in an error
+** returns:	nothing
+******************************************************************************/
+static void str_bloom_build_impl_clear(UDF_INIT *initid, char *is_null, char *error)
+{
+	st_str_bloom_build_data *p = (st_str_bloom_build_data *) initid->ptr;
+
+	if (p->sized)
+		bloom_filter_clear(&p->filter);
+	p->hash_count = 0;
+	*is_null = 0;
+}
+
+/******************************************************************************
+** purpose:	add the key of the current row to the filter of the group;
+**					NULL keys are ignored
+** receives:	pointer to UDF_INIT struct; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	nothing
+******************************************************************************/
+static void str_bloom_build_impl_add(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error)
+{
+	st_str_bloom_build_data *p = (st_str_bloom_build_data *) initid->ptr;
+	uint64_t h;
+
+	if (args->args[0] == NULL || *error)
+		return;
+
+	h = bloom_hash(args->args[0], args->lengths[0]);
+
+	if (p->sized)
+	{
+		bloom_filter_add(&p->filter, h);
+		return;
+	}
+
+	if (p->hash_count == p->hash_capacity)
+	{
+		const size_t new_capacity = (p->hash_capacity == 0 ? 1024 : 2 * p->hash_capacity);
+		uint64_t *tmp;
+
+		if (new_capacity > SIZE_MAX / sizeof (uint64_t)
+				|| (tmp = (uint64_t *) str_realloc(p->hashes, new_capacity * sizeof (uint64_t))) == NULL)
+		{
+			*error = 1;
+			return;
+		}
+
+		p->hashes = tmp;
+		p->hash_capacity = new_capacity;
+	}
+
+	p->hashes[p->hash_count++] = h;
+}
+
+/******************************************************************************
+** purpose:	serialize the filter of the group
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the serialized blocked Bloom filter
+******************************************************************************/
+static char *str_bloom_build_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	st_str_bloom_build_data *p = (st_str_bloom_build_data *) initid->ptr;
+	size_t size;
+
+	if (*error)
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	if (! p->sized)
+	{
+		const uint32_t num_blocks = bloom_blocks_for((uint64_t) p->hash_count, p->fpp);
+		size_t i;
+
+		if (num_blocks == 0 || num_blocks != p->filter.num_blocks)
+		{
+			bloom_filter_free(&p->filter);
+			if (num_blocks == 0 || bloom_filter_init(&p->filter, num_blocks) != 0)
+			{
+				*error = 1;
+				result = NULL;
+				*res_length = 0;
+				*null_value = 1;
+				return result;
+			}
+		}
+		else
+		{
+			bloom_filter_clear(&p->filter);
+		}
+
+		for (i = 0; i < p->hash_count; ++i)
+			bloom_filter_add(&p->filter, p->hashes[i]);
+	}
+
+	size = bloom_filter_serialized_size(&p->filter);
+	if (size > p->buf_capacity)
+	{
+		char *tmp = (char *) str_realloc(p->buf, size);
+		if (tmp == NULL)
+		{
+			*error = 1;
+			result = NULL;
+			*res_length = 0;
+			*null_value = 1;
+			return result;
+		}
+		p->buf = tmp;
+		p->buf_capacity = size;
+	}
+
+	bloom_filter_serialize(&p->filter, p->buf);
+	*res_length = (unsigned long) size;
+	return p->buf;
+}
+
+DEFINE_TRACED_AGGREGATE_STRING_UDF(str_bloom_build)
+
+typedef struct st_str_bloom_contains_data {
+	/* The deserialized filter if it is constant; otherwise NULL */
+	st_pattern_cache_entry *filter_entry;
+	const st_bloom_filter *filter;
+} st_str_bloom_contains_data;
+
+/* Deserializes a filter that was checked with bloom_serialized_check(). */
+static void *str_bloom_contains_compile(const char *key, size_t key_length, size_t *size)
+{
+	st_bloom_filter *filter = (st_bloom_filter *) str_malloc(sizeof (st_bloom_filter));
+
+	*size = sizeof (st_bloom_filter) + key_length;
+	if (filter == NULL)
+		return NULL;
+
+	if (bloom_filter_deserialize(filter, key) != 0)
+	{
+		str_free(filter);
+		return NULL;
+	}
+
+	return filter;
+}
+
+static void str_bloom_contains_destroy(void *value)
+{
+	bloom_filter_free((st_bloom_filter *) value);
+	str_free(value);
+}
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_bloom_contains();
+**					checks arguments, looks up the deserialized filter in the
+**					pattern cache if it is constant
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_bloom_contains() and str_bloom_contains_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_bloom_contains(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_bloom_contains_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_bloom_contains";
+	st_str_bloom_contains_data *p;
+
+	if (args->arg_count != 2)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires two arguments (filter, key), got %d arguments.", funcname, args->arg_count);
+		return 1;
+	}
+	STRARGCHECK;
+
+	// Keys are hashed as strings, like in str_bloom_build().
+	args->arg_type[1] = STRING_RESULT;
+
+	p = (st_str_bloom_contains_data *) str_calloc(1, sizeof (st_str_bloom_contains_data));
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_bloom_contains_data));
+		return 1;
+	}
+
+	if (args->args[0] != NULL)
+	{
+		if (bloom_serialized_check(args->args[0], args->lengths[0]) == 0)
+		{
+			str_free(p);
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s requires a filter built by str_bloom_build", funcname);
+			return 1;
+		}
+
+		p->filter_entry = pattern_cache_acquire(funcname, args->args[0], args->lengths[0],
+				str_bloom_contains_compile, str_bloom_contains_destroy);
+		if (p->filter_entry == NULL)
+		{
+			str_free(p);
+			udf_alloc_failed(message, (size_t) args->lengths[0]);
+			return 1;
+		}
+		p->filter = (const st_bloom_filter *) pattern_cache_value(p->filter_entry);
+	}
+
+	initid->ptr = (char *) p;
+	initid->maybe_null = 1;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_bloom_contains_init(); this func
+**					is called once for each query which invokes str_bloom_contains(),
+**					it is called after all of the calls to str_bloom_contains() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_bloom_contains_init() and str_bloom_contains())
+** returns:	nothing
+******************************************************************************/
+static void str_bloom_contains_impl_deinit(UDF_INIT *initid)
+{
+	st_str_bloom_contains_data *p = (st_str_bloom_contains_data *) initid->ptr;
+
+	if (p->filter_entry != NULL)
+		pattern_cache_release(p->filter_entry);
+	str_free(p);
+}
+
+/******************************************************************************
+** purpose:	test whether a key may have been added to a filter built by
+**					str_bloom_build(); a constant filter is probed in its
+**					deserialized form, any other filter in place
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	1 if the key may be in the filter, 0 if it is definitely not
+******************************************************************************/
+static long long str_bloom_contains_impl(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error)
+{
+	st_str_bloom_contains_data *p = (st_str_bloom_contains_data *) initid->ptr;
+	uint32_t num_blocks;
+
+	if (args->args[0] == NULL || args->args[1] == NULL) {
+		*is_null = 1;
+		return 0;
+	}
+
+	if (p->filter != NULL)
+		return bloom_filter_contains(p->filter, bloom_hash(args->args[1], args->lengths[1]));
+
+	num_blocks = bloom_serialized_check(args->args[0], args->lengths[0]);
+	if (num_blocks == 0) {
+		*is_null = 1;
+		return 0;
+	}
+
+	return bloom_serialized_contains(args->args[0], num_blocks, bloom_hash(args->args[1], args->lengths[1]));
+}
+
+DEFINE_TRACED_INTEGER_UDF(str_bloom_contains)
+
+typedef struct st_str_hll_data {
+	/* The sketch of the current group */
+	st_hll hll;
+
+	/* For str_hll_merge(): non-zero once a non-NULL sketch was merged in the current group */
+	int merged;
+
+	/* Buffer of buf_capacity bytes where the serialized sketch is stored */
+	char *buf;
+	size_t buf_capacity;
+} st_str_hll_data;
+
+/* Allocates the state shared by str_hll_build() and str_hll_merge(). */
+static st_str_hll_data *str_hll_data_alloc(unsigned precision, char *message)
+{
+	st_str_hll_data *p = (st_str_hll_data *) str_malloc(sizeof (st_str_hll_data));
+
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_hll_data));
+		return NULL;
+	}
+
+	hll_init(&p->hll, precision);
+	p->merged = 0;
+	p->buf = NULL;
+	p->buf_capacity = 0;
+	return p;
+}
+
+static void str_hll_data_free(st_str_hll_data *p)
+{
+	hll_free(&p->hll);
+	str_free(p->buf);
+	str_free(p);
+}
+
+/* Serializes the sketch of the group as the result of str_hll_build() or str_hll_merge(). */
+static char *str_hll_data_result(st_str_hll_data *p, unsigned long *res_length, char *null_value, char *error)
+{
+	const size_t size = hll_serialized_size(&p->hll);
+
+	if (size == 0)
+	{
+		*error = 1;
+	}
+	else if (size > p->buf_capacity)
+	{
+		char *tmp = (char *) str_realloc(p->buf, size);
+		if (tmp == NULL)
+		{
+			*error = 1;
+		}
+		else
+		{
+			p->buf = tmp;
+			p->buf_capacity = size;
+		}
+	}
+
+	if (*error)
+	{
+		*res_length = 0;
+		*null_value = 1;
+		return NULL;
+	}
+
+	hll_serialize(&p->hll, p->buf);
+	*res_length = (unsigned long) size;
+	return p->buf;
+}
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_hll_build();
+**					checks arguments, sets restrictions
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_hll_build_clear(), str_hll_build_add(),
+**					str_hll_build() and str_hll_build_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_hll_build_add(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_hll_build_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_hll_build";
+	long long precision = HLL_DEFAULT_PRECISION;
+	st_str_hll_data *p;
+
+	if (args->arg_count < 1 || args->arg_count > 2)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires one argument and an optional integer argument (s [, precision]), got %d arguments.", funcname, args->arg_count);
+		return 1;
+	}
+
+	if (args->arg_count > 1)
+	{
+		if (args->arg_type[1] != INT_RESULT || args->args[1] == NULL
+				|| *((long long *) args->args[1]) < HLL_MIN_PRECISION || *((long long *) args->args[1]) > HLL_MAX_PRECISION)
+		{
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s requires precision to be a constant integer between %d and %d", funcname, HLL_MIN_PRECISION, HLL_MAX_PRECISION);
+			return 1;
+		}
+		precision = *((long long *) args->args[1]);
+	}
+
+	// Values of any type are hashed as strings, like in str_bloom_build().
+	args->arg_type[0] = STRING_RESULT;
+
+	p = str_hll_data_alloc((unsigned) precision, message);
+	if (p == NULL)
+		return 1;
+
+	initid->ptr = (char *) p;
+	initid->maybe_null = 1;
+	initid->max_length = HLL_HEADER_SIZE + (1UL << HLL_MAX_PRECISION);
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_hll_build_init() and the
+**					other str_hll_build functions; this func is called once for
+**					each query which invokes str_hll_build(), it is called after
+**					all groups are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_hll_build_init() and str_hll_build())
+** returns:	nothing
+******************************************************************************/
+static void str_hll_build_impl_deinit(UDF_INIT *initid)
+{
+	str_hll_data_free((st_str_hll_data *) initid->ptr);
+}
+
+/******************************************************************************
+** purpose:	start a new group: empty the sketch
+** receives:	pointer to UDF_INIT struct; pointer to mem which can be set to 1
+**					if the result is NULL; pointer to mem which can be set to 1 if
+**					the calculation resulted in an error
+** returns:	nothing
+******************************************************************************/
+static void str_hll_build_impl_clear(UDF_INIT *initid, char *is_null, char *error)
+{
+	st_str_hll_data *p = (st_str_hll_data *) initid->ptr;
+
+	hll_reset(&p->hll, p->hll.precision);
+	*is_null = 0;
+}
+
+/******************************************************************************
+** purpose:	add the value of the current row to the sketch of the group;
+**					NULL values are ignored
+** receives:	pointer to UDF_INIT struct; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	nothing
+******************************************************************************/
+static void str_hll_build_impl_add(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error)
+{
+	st_str_hll_data *p = (st_str_hll_data *) initid->ptr;
+
+	if (args->args[0] == NULL || *error)
+		return;
+
+	if (hll_add(&p->hll, hll_hash(args->args[0], args->lengths[0])) != 0)
+		*error = 1;
+}
+
+/******************************************************************************
+** purpose:	serialize the sketch of the group
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the serialized HyperLogLog sketch
+******************************************************************************/
+static char *str_hll_build_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	return str_hll_data_result((st_str_hll_data *) initid->ptr, res_length, null_value, error);
+}
+
+DEFINE_TRACED_AGGREGATE_STRING_UDF(str_hll_build)
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_hll_merge();
+**					checks arguments
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_hll_merge_clear(), str_hll_merge_add(),
+**					str_hll_merge() and str_hll_merge_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_hll_merge_add(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_hll_merge_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_hll_merge";
+	st_str_hll_data *p;
+
+	ARGCOUNTCHECK("string");
+	STRARGCHECK;
+
+	p = str_hll_data_alloc(HLL_MAX_PRECISION, message);
+	if (p == NULL)
+		return 1;
+
+	initid->ptr = (char *) p;
+	initid->maybe_null = 1;
+	initid->max_length = HLL_HEADER_SIZE + (1UL << HLL_MAX_PRECISION);
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_hll_merge_init() and the
+**					other str_hll_merge functions; this func is called once for
+**					each query which invokes str_hll_merge(), it is called after
+**					all groups are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_hll_merge_init() and str_hll_merge())
+** returns:	nothing
+******************************************************************************/
+static void str_hll_merge_impl_deinit(UDF_INIT *initid)
+{
+	str_hll_data_free((st_str_hll_data *) initid->ptr);
+}
+
+/******************************************************************************
+** purpose:	start a new group: empty the merged sketch
+** receives:	pointer to UDF_INIT struct; pointer to mem which can be set to 1
+**					if the result is NULL; pointer to mem which can be set to 1 if
+**					the calculation resulted in an error
+** returns:	nothing
+******************************************************************************/
+static void str_hll_merge_impl_clear(UDF_INIT *initid, char *is_null, char *error)
+{
+	st_str_hll_data *p = (st_str_hll_data *) initid->ptr;
+
+	// Start at the highest precision; merging a sketch of lower precision lowers it.
+	hll_reset(&p->hll, HLL_MAX_PRECISION);
+	p->merged = 0;
+	*is_null = 0;
+}
+
+/******************************************************************************
+** purpose:	merge the sketch of the current row into the sketch of the group;
+**					NULL sketches are ignored
+** receives:	pointer to UDF_INIT struct; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	nothing
+******************************************************************************/
+static void str_hll_merge_impl_add(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error)
+{
+	st_str_hll_data *p = (st_str_hll_data *) initid->ptr;
+
+	if (args->args[0] == NULL || *error)
+		return;
+
+	if (hll_serialized_check(args->args[0], args->lengths[0]) == 0
+			|| hll_merge_serialized(&p->hll, args->args[0], args->lengths[0]) != 0)
+	{
+		*error = 1;
+		return;
+	}
+
+	p->merged = 1;
+}
+
+/******************************************************************************
+** purpose:	serialize the merged sketch of the group
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the serialized HyperLogLog sketch; NULL if the group has no
+**					non-NULL sketches or one of them is not a valid sketch
+******************************************************************************/
+static char *str_hll_merge_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	st_str_hll_data *p = (st_str_hll_data *) initid->ptr;
+
+	if (! p->merged && ! *error)
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	return str_hll_data_result(p, res_length, null_value, error);
+}
+
+DEFINE_TRACED_AGGREGATE_STRING_UDF(str_hll_merge)
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_hll_count();
+**					checks arguments
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_hll_count() and str_hll_count_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_hll_count(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_hll_count_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_hll_count";
+
+	ARGCOUNTCHECK("string");
+	STRARGCHECK;
+
+	initid->ptr = NULL;
+	initid->maybe_null = 1;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_hll_count_init(); this func
+**					is called once for each query which invokes str_hll_count(),
+**					it is called after all of the calls to str_hll_count() are done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_hll_count_init() and str_hll_count())
+** returns:	nothing
+******************************************************************************/
+static void str_hll_count_impl_deinit(UDF_INIT *initid ATTRIBUTE_UNUSED)
+{
+}
+
+/******************************************************************************
+** purpose:	estimate the number of distinct values counted by a sketch
+** receives:	pointer to UDF_INIT struct; pointer to UDF_ARGS struct which
+**					contains the sketch; pointer to mem which can be set to 1 if
+**					the result is NULL; pointer to mem which can be set to 1 if
+**					the calculation resulted in an error
+** returns:	the estimated number of distinct values
+******************************************************************************/
+static long long str_hll_count_impl(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error)
+{
+	if (args->args[0] == NULL || hll_serialized_check(args->args[0], args->lengths[0]) == 0) {
+		*is_null = 1;
+		return 0;
+	}
+
+	return (long long) (hll_serialized_estimate(args->args[0], args->lengths[0]) + 0.5);
+}
+
+DEFINE_TRACED_INTEGER_UDF(str_hll_count)
+
+/* Number of counters per requested term that str_topk() uses by default, and their minimum */
+#define TOPK_DEFAULT_CAPACITY_FACTOR 10
+#define TOPK_DEFAULT_MIN_CAPACITY 64
+
+/* Size of an entry of the str_topk() result besides its term: punctuation, a comma, and up to 20
+   digits for each number */
+#define TOPK_JSON_ENTRY_SIZE (sizeof "{\"term\":\"\",\"count\":,\"error\":}," - 1 + 2 * 20)
+
+typedef struct st_str_topk_data {
+	/* The Space-Saving summary of the current group */
+	st_topk *summary;
+
+	/* The k terms with the largest counts */
+	size_t k;
+	st_topk_entry *entries;
+
+	/* Buffer of buf_capacity bytes where the JSON result is stored */
+	char *buf;
+	size_t buf_capacity;
+} st_str_topk_data;
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_topk();
+**					checks arguments, sets restrictions, allocates the summary
+**					that is reused for all groups
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_topk_clear(), str_topk_add(), str_topk()
+**					and str_topk_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_topk_add(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_topk_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_topk";
+	st_str_topk_data *p;
+	long long k, capacity;
+
+	if (args->arg_count < 2 || args->arg_count > 3)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires one argument and one or two integer arguments (s, k [, capacity]), got %d arguments.", funcname, args->arg_count);
+		return 1;
+	}
+
+	if (args->arg_type[1] != INT_RESULT || args->args[1] == NULL
+			|| *((long long *) args->args[1]) < 1 || *((long long *) args->args[1]) > TOPK_MAX_CAPACITY)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "%s requires k to be a constant integer between 1 and %d", funcname, TOPK_MAX_CAPACITY);
+		return 1;
+	}
+	k = *((long long *) args->args[1]);
+
+	if (args->arg_count > 2)
+	{
+		if (args->arg_type[2] != INT_RESULT || args->args[2] == NULL
+				|| *((long long *) args->args[2]) < k || *((long long *) args->args[2]) > TOPK_MAX_CAPACITY)
+		{
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s requires capacity to be a constant integer between k and %d", funcname, TOPK_MAX_CAPACITY);
+			return 1;
+		}
+		capacity = *((long long *) args->args[2]);
+	}
+	else
+	{
+		capacity = k * TOPK_DEFAULT_CAPACITY_FACTOR;
+		if (capacity < TOPK_DEFAULT_MIN_CAPACITY)
+			capacity = TOPK_DEFAULT_MIN_CAPACITY;
+		else if (capacity > TOPK_MAX_CAPACITY)
+			capacity = TOPK_MAX_CAPACITY;
+	}
+
+	// Terms of any type are counted as strings, like in str_bloom_build().
+	args->arg_type[0] = STRING_RESULT;
+
+	p = (st_str_topk_data *) str_calloc(1, sizeof (st_str_topk_data));
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_topk_data));
+		return 1;
+	}
+
+	p->k = (size_t) k;
+	p->summary = topk_alloc((size_t) capacity);
+	p->entries = (st_topk_entry *) str_malloc(p->k * sizeof (st_topk_entry));
+	if (p->summary == NULL || p->entries == NULL)
+	{
+		if (p->summary != NULL)
+			topk_free(p->summary);
+		str_free(p->entries);
+		str_free(p);
+		snprintf(message, MYSQL_ERRMSG_SIZE, "%s failed to allocate a summary of %lld counters", funcname, capacity);
+		return 1;
+	}
+
+	initid->ptr = (char *) p;
+	initid->maybe_null = 1;
+	initid->max_length = 0xFFFFFFFFUL;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_topk_init() and the other
+**					str_topk functions; this func is called once for each query
+**					which invokes str_topk(), it is called after all groups are
+**					done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_topk_init() and str_topk())
+** returns:	nothing
+******************************************************************************/
+static void str_topk_impl_deinit(UDF_INIT *initid)
+{
+	st_str_topk_data *p = (st_str_topk_data *) initid->ptr;
+
+	topk_free(p->summary);
+	str_free(p->entries);
+	str_free(p->buf);
+	str_free(p);
+}
+
+/******************************************************************************
+** purpose:	start a new group: empty the summary
+** receives:	pointer to UDF_INIT struct; pointer to mem which can be set to 1
+**					if the result is NULL; pointer to mem which can be set to 1 if
+**					the calculation resulted in an error
+** returns:	nothing
+******************************************************************************/
+static void str_topk_impl_clear(UDF_INIT *initid, char *is_null, char *error)
+{
+	st_str_topk_data *p = (st_str_topk_data *) initid->ptr;
+
+	topk_clear(p->summary);
+	*is_null = 0;
+}
+
+/******************************************************************************
+** purpose:	count the term of the current row; NULL terms are ignored
+** receives:	pointer to UDF_INIT struct; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	nothing
+******************************************************************************/
+static void str_topk_impl_add(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error)
+{
+	st_str_topk_data *p = (st_str_topk_data *) initid->ptr;
+
+	if (args->args[0] == NULL || *error)
+		return;
+
+	if (topk_add(p->summary, args->args[0], args->lengths[0]) != 0)
+		*error = 1;
+}
+
+/******************************************************************************
+** purpose:	list the most frequent terms of the group as a JSON array of
+**					{"term": ..., "count": ..., "error": ...} objects by decreasing
+**					count
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the JSON array
+******************************************************************************/
+static char *str_topk_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	st_str_topk_data *p = (st_str_topk_data *) initid->ptr;
+	size_t n, size = 2, i; /* size starts with the brackets */
+	char *d;
+
+	if (*error)
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	n = topk_top(p->summary, p->entries, p->k);
+	for (i = 0; i < n; ++i)
+		size += TOPK_JSON_ENTRY_SIZE + json_escaped_length(p->entries[i].term, p->entries[i].term_length);
+
+	if (size > p->buf_capacity)
+	{
+		char *tmp = (char *) str_realloc(p->buf, size);
+		if (tmp == NULL)
+		{
+			*error = 1;
+			result = NULL;
+			*res_length = 0;
+			*null_value = 1;
+			return result;
+		}
+		p->buf = tmp;
+		p->buf_capacity = size;
+	}
+
+	d = p->buf;
+	*d++ = '[';
+	for (i = 0; i < n; ++i)
+	{
+		if (i != 0)
+			*d++ = ',';
+		memcpy(d, "{\"term\":\"", 9);
+		d = json_escape(d + 9, p->entries[i].term, p->entries[i].term_length);
+		d += sprintf(d, "\",\"count\":%llu,\"error\":%llu}", (unsigned long long) p->entries[i].count, (unsigned long long) p->entries[i].error);
+	}
+	*d++ = ']';
+
+	*res_length = (unsigned long) (d - p->buf);
+	return p->buf;
+}
+
+DEFINE_TRACED_AGGREGATE_STRING_UDF(str_topk)
+
+typedef struct st_str_agg_data {
+	/* The values of the current group */
+	st_string_list *list;
+
+	/* A copy of the separator */
+	char *sep;
+	size_t sep_length;
+
+	/* Buffer where the result is joined */
+	st_char_vector *vec;
+} st_str_agg_data;
+
+/******************************************************************************
+** purpose:	called once for each SQL statement which invokes str_agg();
+**					checks arguments, sets restrictions, allocates the list of
+**					values that is reused for all groups
+** receives:	pointer to UDF_INIT struct which is to be shared with all
+**					other functions (str_agg_clear(), str_agg_add(), str_agg()
+**					and str_agg_deinit()) -
+**					the components of this struct are described in the MySQL manual;
+**					pointer to UDF_ARGS struct which contains information about
+**					the number, size, and type of args the query will be providing
+**					to each invocation of str_agg_add(); pointer to a char
+**					array of size MYSQL_ERRMSG_SIZE in which an error message
+**					can be stored if necessary
+** returns:	1 => failure; 0 => successful initialization
+******************************************************************************/
+static my_bool str_agg_impl_init(UDF_INIT *initid, UDF_ARGS *args, char *message)
+{
+	static const char funcname[] = "str_agg";
+	st_str_agg_data *p;
+	int distinct = 0;
+
+	if (args->arg_count < 2 || args->arg_count > 3)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "wrong argument count: %s requires two or three arguments (s, sep [, 'distinct']), got %d arguments.", funcname, args->arg_count);
+		return 1;
+	}
+
+	if (args->arg_type[1] != STRING_RESULT || args->args[1] == NULL)
+	{
+		snprintf(message, MYSQL_ERRMSG_SIZE, "%s requires sep to be a constant string", funcname);
+		return 1;
+	}
+
+	if (args->arg_count > 2)
+	{
+		static const char keyword[] = "distinct";
+		size_t i;
+
+		distinct = (args->arg_type[2] == STRING_RESULT && args->args[2] != NULL && args->lengths[2] == STR_LENGTH(keyword));
+		for (i = 0; distinct && i < STR_LENGTH(keyword); ++i)
+			distinct = (tolower((unsigned char) args->args[2][i]) == keyword[i]);
+
+		if (!distinct)
+		{
+			snprintf(message, MYSQL_ERRMSG_SIZE, "%s requires the third argument to be the constant string 'distinct'", funcname);
+			return 1;
+		}
+	}
+
+	// Values of any type are joined as strings, like in str_bloom_build().
+	args->arg_type[0] = STRING_RESULT;
+
+	p = (st_str_agg_data *) str_calloc(1, sizeof (st_str_agg_data));
+	if (p == NULL)
+	{
+		udf_alloc_failed(message, sizeof (st_str_agg_data));
+		return 1;
+	}
+
+	p->sep_length = args->lengths[1];
+	p->sep = (char *) str_malloc(p->sep_length + 1);
+	p->list = string_list_alloc(distinct);
+	p->vec = char_vector_alloc();
+	if (p->sep == NULL || p->list == NULL || p->vec == NULL)
+	{
+		if (p->list != NULL)
+			string_list_free(p->list);
+		if (p->vec != NULL)
+			char_vector_free(p->vec);
+		str_free(p->sep);
+		str_free(p);
+		snprintf(message, MYSQL_ERRMSG_SIZE, "%s failed to allocate memory", funcname);
+		return 1;
+	}
+	memcpy(p->sep, args->args[1], p->sep_length);
+
+	initid->ptr = (char *) p;
+	initid->maybe_null = 1;
+	initid->max_length = 0xFFFFFFFFUL;
+	return 0;
+}
+
+/******************************************************************************
+** purpose:	deallocate memory allocated by str_agg_init() and the other
+**					str_agg functions; this func is called once for each query
+**					which invokes str_agg(), it is called after all groups are
+**					done
+** receives:	pointer to UDF_INIT struct (the same which was used by
+**					str_agg_init() and str_agg())
+** returns:	nothing
+******************************************************************************/
+static void str_agg_impl_deinit(UDF_INIT *initid)
+{
+	st_str_agg_data *p = (st_str_agg_data *) initid->ptr;
+
+	string_list_free(p->list);
+	char_vector_free(p->vec);
+	str_free(p->sep);
+	str_free(p);
+}
+
+/******************************************************************************
+** purpose:	start a new group: empty the list of values
+** receives:	pointer to UDF_INIT struct; pointer to mem which can be set to 1
+**					if the result is NULL; pointer to mem which can be set to 1 if
+**					the calculation resulted in an error
+** returns:	nothing
+******************************************************************************/
+static void str_agg_impl_clear(UDF_INIT *initid, char *is_null, char *error)
+{
+	st_str_agg_data *p = (st_str_agg_data *) initid->ptr;
+
+	string_list_clear(p->list);
+	*is_null = 0;
+}
+
+/******************************************************************************
+** purpose:	append the value of the current row to the list, unless it is
+**					NULL, or it is already in the list and duplicates are removed
+** receives:	pointer to UDF_INIT struct; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	nothing
+******************************************************************************/
+static void str_agg_impl_add(UDF_INIT *initid, UDF_ARGS *args, char *is_null, char *error)
+{
+	st_str_agg_data *p = (st_str_agg_data *) initid->ptr;
+
+	if (args->args[0] == NULL || *error)
+		return;
+
+	if (string_list_add(p->list, args->args[0], args->lengths[0]) != 0)
+		*error = 1;
+}
+
+/******************************************************************************
+** purpose:	join the values of the group with the separator
+** receives:	pointer to UDF_INIT struct which contains pre-allocated memory
+**					in which work can be done; pointer to UDF_ARGS struct which
+**					contains the functions arguments and data about them; pointer
+**					to mem which can be set to 1 if the result is NULL; pointer
+**					to mem which can be set to 1 if the calculation resulted in an
+**					error
+** returns:	the joined values, or NULL if the group has no non-NULL values
+******************************************************************************/
+static char *str_agg_impl(UDF_INIT *initid, UDF_ARGS *args,
+			char *result, unsigned long *res_length,
+			char *null_value, char *error)
+{
+	st_str_agg_data *p = (st_str_agg_data *) initid->ptr;
+
+	if (*error || string_list_count(p->list) == 0)
+	{
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	if (string_list_join(p->list, p->vec, p->sep, p->sep_length) != 0
+			|| char_vector_length(p->vec) > 0xFFFFFFFFUL)
+	{
+		*error = 1;
+		result = NULL;
+		*res_length = 0;
+		*null_value = 1;
+		return result;
+	}
+
+	*res_length = (unsigned long) char_vector_length(p->vec);
+	return char_vector_get_ptr(p->vec);
+}
+
+DEFINE_TRACED_AGGREGATE_STRING_UDF(str_agg)
+
 #endif /* HAVE_DLOPEN */
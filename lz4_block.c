@@ -0,0 +1,337 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bit_utils.h"
+#include "lz4_block.h"
+
+#ifndef SIZE_MAX
+#define SIZE_MAX ((size_t) -1)
+#endif
+
+/* Constants of the LZ4 block format */
+#define MINMATCH 4
+#define LASTLITERALS 5 /* the last 5 bytes are always literals */
+#define MFLIMIT 12 /* the last match must start at least 12 bytes before the end */
+#define MAX_DISTANCE 65535
+#define ML_BITS 4
+#define ML_MASK ((1U << ML_BITS) - 1)
+#define RUN_MASK ((1U << (8 - ML_BITS)) - 1)
+
+/* How fast the compressor skips ahead when it does not find matches */
+#define SKIP_TRIGGER 6
+
+STR_INLINE uint32_t lz4_read32(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+STR_INLINE uint64_t lz4_read64(const unsigned char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+STR_INLINE uint32_t lz4_hash(const unsigned char *p)
+{
+	return (lz4_read32(p) * 2654435761U) >> (32 - LZ4_BLOCK_HASH_LOG);
+}
+
+/* Returns the number of bytes that p and ref have in common, not looking at or past limit. */
+STR_INLINE size_t lz4_count(const unsigned char *p, const unsigned char *ref, const unsigned char *limit)
+{
+	const unsigned char *const start = p;
+
+	while (p + 8 <= limit)
+	{
+		const uint64_t diff = lz4_read64(p) ^ lz4_read64(ref);
+		if (diff != 0)
+		{
+			/* The first differing byte is the lowest one on little-endian machines. */
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			return (size_t) (p - start) + (bit_clz64(diff) >> 3);
+#else
+			return (size_t) (p - start) + (bit_ctz64(diff) >> 3);
+#endif
+		}
+		p += 8;
+		ref += 8;
+	}
+
+	while (p < limit && *p == *ref)
+	{
+		++p;
+		++ref;
+	}
+
+	return (size_t) (p - start);
+}
+
+/* Writes the extra length bytes of a literal or match length that does not fit in its token nibble. */
+STR_INLINE unsigned char *lz4_write_length(unsigned char *op, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*op++ = 255;
+	*op++ = (unsigned char) length;
+	return op;
+}
+
+size_t lz4_block_compress_bound(size_t src_length)
+{
+	if (src_length > SIZE_MAX - 16 - src_length / 255)
+		return 0;
+	return src_length + src_length / 255 + 16;
+}
+
+size_t lz4_block_compress(const char *src, size_t src_length, char *dst, uint32_t *hash_table, int acceleration)
+{
+	const unsigned char *const base = (const unsigned char *) src;
+	const unsigned char *const iend = base + src_length;
+	const unsigned char *const mflimit = iend - MFLIMIT;
+	const unsigned char *const matchlimit = iend - LASTLITERALS;
+	const unsigned char *ip = base;
+	const unsigned char *anchor = base;
+	unsigned char *op = (unsigned char *) dst;
+
+	if (acceleration < 1)
+		acceleration = 1;
+	else if (acceleration > LZ4_BLOCK_MAX_ACCELERATION)
+		acceleration = LZ4_BLOCK_MAX_ACCELERATION;
+
+	if (src_length < MFLIMIT + 1)
+		goto last_literals;
+
+	/* Entries left over from other inputs would be taken for positions of this one, and the
+	   output would then depend on what was compressed before. */
+	memset(hash_table, 0, LZ4_BLOCK_HASH_SIZE * sizeof (uint32_t));
+	hash_table[lz4_hash(ip)] = 0;
+	++ip;
+
+	for (;;)
+	{
+		const unsigned char *ref;
+		unsigned char *token;
+
+		/* Find a match. Empty entries point at the start of the input, and are checked like any
+		   other candidate. */
+		{
+			const unsigned char *forward_ip = ip;
+			unsigned step = 1;
+			unsigned search_match_nb = (unsigned) acceleration << SKIP_TRIGGER;
+
+			do
+			{
+				const uint32_t h = lz4_hash(forward_ip);
+				ip = forward_ip;
+				forward_ip += step;
+				step = search_match_nb++ >> SKIP_TRIGGER;
+
+				if (forward_ip > mflimit)
+					goto last_literals;
+
+				ref = base + hash_table[h];
+				hash_table[h] = (uint32_t) (ip - base);
+			} while (ref >= ip || ip - ref > MAX_DISTANCE || lz4_read32(ref) != lz4_read32(ip));
+		}
+
+		/* Extend the match backwards */
+		while (ip > anchor && ref > base && ip[-1] == ref[-1])
+		{
+			--ip;
+			--ref;
+		}
+
+		/* Encode the literal run */
+		{
+			const size_t lit_length = (size_t) (ip - anchor);
+			token = op++;
+
+			if (lit_length >= RUN_MASK)
+			{
+				*token = (unsigned char) (RUN_MASK << ML_BITS);
+				op = lz4_write_length(op, lit_length - RUN_MASK);
+			}
+			else
+			{
+				*token = (unsigned char) (lit_length << ML_BITS);
+			}
+
+			memcpy(op, anchor, lit_length);
+			op += lit_length;
+		}
+
+next_match:
+		/* Encode the offset and the match length */
+		{
+			size_t match_length;
+
+			op[0] = (unsigned char) (ip - ref);
+			op[1] = (unsigned char) ((ip - ref) >> 8);
+			op += 2;
+
+			match_length = lz4_count(ip + MINMATCH, ref + MINMATCH, matchlimit);
+			ip += MINMATCH + match_length;
+
+			if (match_length >= ML_MASK)
+			{
+				*token |= (unsigned char) ML_MASK;
+				op = lz4_write_length(op, match_length - ML_MASK);
+			}
+			else
+			{
+				*token |= (unsigned char) match_length;
+			}
+		}
+
+		anchor = ip;
+
+		if (ip > mflimit)
+			break;
+
+		hash_table[lz4_hash(ip - 2)] = (uint32_t) (ip - 2 - base);
+
+		/* Test the next position for an immediate match */
+		{
+			const uint32_t h = lz4_hash(ip);
+			ref = base + hash_table[h];
+			hash_table[h] = (uint32_t) (ip - base);
+
+			if (ref < ip && ip - ref <= MAX_DISTANCE && lz4_read32(ref) == lz4_read32(ip))
+			{
+				token = op++;
+				*token = 0;
+				goto next_match;
+			}
+		}
+
+		++ip;
+	}
+
+last_literals:
+	{
+		const size_t lit_length = (size_t) (iend - anchor);
+
+		if (lit_length >= RUN_MASK)
+		{
+			*op++ = (unsigned char) (RUN_MASK << ML_BITS);
+			op = lz4_write_length(op, lit_length - RUN_MASK);
+		}
+		else
+		{
+			*op++ = (unsigned char) (lit_length << ML_BITS);
+		}
+
+		memcpy(op, anchor, lit_length);
+		op += lit_length;
+	}
+
+	return (size_t) (op - (unsigned char *) dst);
+}
+
+/* Reads the extra length bytes that follow a token nibble of 15. Returns 0 on truncated input. */
+STR_INLINE int lz4_read_length(const unsigned char **ip, const unsigned char *iend, size_t *length)
+{
+	unsigned s;
+
+	do
+	{
+		if (*ip >= iend)
+			return 0;
+		s = *(*ip)++;
+		*length += s;
+	} while (s == 255);
+
+	return 1;
+}
+
+int lz4_block_decompress(const char *src, size_t src_length, char *dst, size_t dst_length)
+{
+	const unsigned char *ip = (const unsigned char *) src;
+	const unsigned char *const iend = ip + src_length;
+	unsigned char *op = (unsigned char *) dst;
+	unsigned char *const ostart = op;
+	unsigned char *const oend = op + dst_length;
+
+	for (;;)
+	{
+		unsigned token;
+		size_t length, offset;
+		const unsigned char *match;
+
+		if (ip >= iend)
+			return 1;
+
+		token = *ip++;
+
+		/* Literals */
+		length = token >> ML_BITS;
+		if (length == RUN_MASK && ! lz4_read_length(&ip, iend, &length))
+			return 1;
+
+		if (length <= 16 && (size_t) (iend - ip) >= 16 && (size_t) (oend - op) >= 16)
+		{
+			/* Short run with room to spare on both sides: copy a fixed 16 bytes. */
+			memcpy(op, ip, 16);
+		}
+		else
+		{
+			if (length > (size_t) (iend - ip) || length > (size_t) (oend - op))
+				return 1;
+			memcpy(op, ip, length);
+		}
+		ip += length;
+		op += length;
+
+		/* The last sequence has no match. */
+		if (ip == iend)
+			break;
+
+		/* Match */
+		if (iend - ip < 2)
+			return 1;
+		offset = (size_t) ip[0] | ((size_t) ip[1] << 8);
+		ip += 2;
+
+		if (offset == 0 || offset > (size_t) (op - ostart))
+			return 1;
+		match = op - offset;
+
+		length = token & ML_MASK;
+		if (length == ML_MASK && ! lz4_read_length(&ip, iend, &length))
+			return 1;
+		length += MINMATCH;
+
+		if (length > (size_t) (oend - op))
+			return 1;
+
+		if (offset >= 16 && (size_t) (oend - op) >= length + 16)
+		{
+			/* Non-overlapping 16-byte chunks; may write up to 15 bytes past the match, which
+			   later sequences overwrite. */
+			unsigned char *const end = op + length;
+			do
+			{
+				memcpy(op, match, 16);
+				op += 16;
+				match += 16;
+			} while (op < end);
+			op = end;
+		}
+		else
+		{
+			unsigned char *const end = op + length;
+			while (op < end)
+				*op++ = *match++;
+		}
+	}
+
+	return (op == oend) ? 0 : 1;
+}
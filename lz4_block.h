@@ -0,0 +1,59 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The block format is that of LZ4 (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md),
+	so the output can be decompressed by any LZ4 implementation. The code is an independent
+	implementation of the format.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_LZ4_BLOCK_H
+#define LIB_MYSQLUDF_STR_LZ4_BLOCK_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LZ4_BLOCK_HASH_LOG 12
+
+/** The number of entries of the hash table that lz4_block_compress() works with. */
+#define LZ4_BLOCK_HASH_SIZE (1 << LZ4_BLOCK_HASH_LOG)
+
+/** The largest acceleration factor accepted by lz4_block_compress(). */
+#define LZ4_BLOCK_MAX_ACCELERATION 65537
+
+/** @returns the largest size that the compressed form of @p src_length bytes can have.
+ *		Returns 0 if that size does not fit in a size_t. */
+size_t lz4_block_compress_bound(size_t src_length);
+
+/** Compresses the @p src_length bytes at @p src into an LZ4 block at @p dst, which must have
+ * space for <code>lz4_block_compress_bound(src_length)</code> bytes.
+ *
+ * @p hash_table must point to @c LZ4_BLOCK_HASH_SIZE entries, which are cleared before use, so
+ * a single table can be reused for all rows of a statement and the output depends only on the
+ * input.
+ *
+ * @p acceleration trades compression ratio for speed. 1 is the default; larger values (up to
+ * @c LZ4_BLOCK_MAX_ACCELERATION) skip ahead faster through incompressible data.
+ *
+ * @returns the size of the compressed block. */
+size_t lz4_block_compress(const char *src, size_t src_length, char *dst, uint32_t *hash_table, int acceleration);
+
+/** Decompresses the LZ4 block of @p src_length bytes at @p src into @p dst, which must have
+ * space for exactly @p dst_length bytes: the size of the original data.
+ *
+ * Malformed input never causes reads or writes outside of the two buffers.
+ *
+ * @returns 0 if the block decompressed to exactly @p dst_length bytes. Otherwise, a non-zero
+ *		value is returned and the contents of @p dst are unspecified. */
+int lz4_block_decompress(const char *src, size_t src_length, char *dst, size_t dst_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
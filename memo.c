@@ -0,0 +1,195 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memo.h"
+#include "str_alloc.h"
+#include "str_hash.h"
+#include "str_sync.h"
+
+#define MEMO_SEED UINT64_C(0x4D454D4F4D454D4F)
+
+/* Size of the hash index of the slots, a power of two; at most half of it is used */
+#define MEMO_INDEX_SIZE (2 * MEMO_NUM_SLOTS)
+
+typedef struct st_memo_slot
+{
+	uint64_t hash;
+	uint16_t key_length;
+	uint16_t value_length;
+	unsigned char used;
+	unsigned char referenced; /* the CLOCK bit: set by hits, cleared when the hand passes */
+	char is_null;
+} st_memo_slot;
+
+struct st_memo
+{
+	uint64_t hits, misses;
+	unsigned window_lookups, window_hits;
+	int bypassed;
+
+	uint64_t last_hash; /* the hash of the key of the last lookup */
+	unsigned hand; /* the next slot that the CLOCK hand visits */
+
+	/* Open addressing hash table with linear probing: 1 + the index of a slot, or 0 */
+	uint16_t index[MEMO_INDEX_SIZE];
+
+	st_memo_slot slots[MEMO_NUM_SLOTS];
+
+	/* The key of each slot, followed by its value */
+	char data[MEMO_NUM_SLOTS][MEMO_SLOT_SIZE];
+};
+
+static str_mutex memo_stats_lock = STR_MUTEX_INITIALIZER;
+static st_memo_stats memo_stats;
+
+st_memo *memo_alloc(void)
+{
+	st_memo *m = (st_memo *) str_malloc(sizeof (st_memo));
+
+	if (m == NULL)
+		return NULL;
+
+	// The data of the slots is only read once they are used.
+	memset(m, 0, offsetof(st_memo, data));
+	return m;
+}
+
+void memo_free(st_memo *m)
+{
+	str_mutex_lock(&memo_stats_lock);
+	memo_stats.hits += m->hits;
+	memo_stats.misses += m->misses;
+	memo_stats.bypassed += (m->bypassed != 0);
+	str_mutex_unlock(&memo_stats_lock);
+
+	str_free(m);
+}
+
+int memo_bypassed(const st_memo *m)
+{
+	return m->bypassed;
+}
+
+/* Returns the index entry of the key, or the empty entry where it would be inserted. */
+static size_t memo_find(const st_memo *m, uint64_t hash, const char *key, size_t key_length)
+{
+	size_t i = (size_t) hash & (MEMO_INDEX_SIZE - 1);
+
+	while (m->index[i] != 0)
+	{
+		const unsigned s = m->index[i] - 1u;
+
+		if (m->slots[s].hash == hash && m->slots[s].key_length == key_length
+				&& memcmp(m->data[s], key, key_length) == 0)
+			break;
+		i = (i + 1) & (MEMO_INDEX_SIZE - 1);
+	}
+
+	return i;
+}
+
+/* Empties index entry i, moving later entries of its cluster back so that lookups still find them. */
+static void memo_index_remove(st_memo *m, size_t i)
+{
+	size_t j = i;
+
+	for (;;)
+	{
+		size_t home;
+
+		j = (j + 1) & (MEMO_INDEX_SIZE - 1);
+		if (m->index[j] == 0)
+			break;
+
+		home = (size_t) m->slots[m->index[j] - 1].hash & (MEMO_INDEX_SIZE - 1);
+		if (((j - home) & (MEMO_INDEX_SIZE - 1)) >= ((j - i) & (MEMO_INDEX_SIZE - 1)))
+		{
+			m->index[i] = m->index[j];
+			i = j;
+		}
+	}
+
+	m->index[i] = 0;
+}
+
+int memo_lookup(st_memo *m, const char *key, size_t key_length, const char **value, size_t *value_length, char *is_null)
+{
+	size_t i;
+	int hit = 0;
+
+	m->last_hash = str_hash64(key, key_length, MEMO_SEED);
+	i = memo_find(m, m->last_hash, key, key_length);
+
+	if (m->index[i] != 0)
+	{
+		st_memo_slot *slot = &m->slots[m->index[i] - 1];
+
+		slot->referenced = 1;
+		*value = m->data[m->index[i] - 1] + slot->key_length;
+		*value_length = slot->value_length;
+		*is_null = slot->is_null;
+		hit = 1;
+	}
+
+	m->hits += hit;
+	m->misses += !hit;
+	m->window_hits += hit;
+	if (++m->window_lookups == MEMO_WINDOW_LOOKUPS)
+	{
+		if (m->window_hits * MEMO_MIN_HIT_RATIO < MEMO_WINDOW_LOOKUPS)
+			m->bypassed = 1;
+		m->window_lookups = m->window_hits = 0;
+	}
+
+	return hit;
+}
+
+void memo_store(st_memo *m, const char *key, size_t key_length, const char *value, size_t value_length, char is_null)
+{
+	st_memo_slot *slot;
+	unsigned s;
+
+	if (key_length > MEMO_SLOT_SIZE || value_length > MEMO_SLOT_SIZE - key_length)
+		return;
+
+	// Advance the hand to a slot that is free or was not referenced since the hand last passed it.
+	for (;;)
+	{
+		s = m->hand;
+		m->hand = (m->hand + 1) % MEMO_NUM_SLOTS;
+
+		slot = &m->slots[s];
+		if (!slot->used || !slot->referenced)
+			break;
+		slot->referenced = 0;
+	}
+
+	if (slot->used)
+		memo_index_remove(m, memo_find(m, slot->hash, m->data[s], slot->key_length));
+
+	slot->hash = m->last_hash;
+	slot->key_length = (uint16_t) key_length;
+	slot->value_length = (uint16_t) value_length;
+	slot->used = 1;
+	slot->referenced = 0;
+	slot->is_null = is_null;
+	memcpy(m->data[s], key, key_length);
+	if (value_length != 0)
+		memcpy(m->data[s] + key_length, value, value_length);
+
+	m->index[memo_find(m, slot->hash, key, key_length)] = (uint16_t) (s + 1);
+}
+
+void memo_get_stats(st_memo_stats *stats)
+{
+	str_mutex_lock(&memo_stats_lock);
+	*stats = memo_stats;
+	str_mutex_unlock(&memo_stats_lock);
+}
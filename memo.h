@@ -0,0 +1,73 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	A small fixed-size table of the results of recent arguments, for functions that are called
+	with few distinct arguments. Entries are replaced with the CLOCK algorithm. The table gives up
+	when too few lookups hit, so that high-cardinality inputs only pay for a short trial.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_MEMO_H
+#define LIB_MYSQLUDF_STR_MEMO_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The number of entries of a table. */
+#define MEMO_NUM_SLOTS 256
+
+/** The largest size of the key and the value of an entry together. */
+#define MEMO_SLOT_SIZE 256
+
+/** The table is bypassed once fewer than 1 in @c MEMO_MIN_HIT_RATIO of the lookups of a window
+ * of @c MEMO_WINDOW_LOOKUPS lookups hit. */
+#define MEMO_WINDOW_LOOKUPS 1024
+#define MEMO_MIN_HIT_RATIO 4
+
+typedef struct st_memo st_memo;
+
+typedef struct st_memo_stats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t bypassed; /* the number of tables that gave up */
+} st_memo_stats;
+
+/** Allocates an empty table, in one block of memory.
+ *
+ * @returns a pointer to the table, or NULL if memory could not be allocated. It must be freed with
+ *		memo_free(). */
+st_memo *memo_alloc(void);
+
+/** Adds the counters of @p m to the process-wide counters, and frees it. */
+void memo_free(st_memo *m);
+
+/** @returns non-zero if @p m gave up because too few lookups hit, in which case it should not be
+ *		used anymore. */
+int memo_bypassed(const st_memo *m);
+
+/** Looks up the value of the @p key_length bytes at @p key. On a hit, the value is
+ * <code>[*value, *value + *value_length)</code>, or NULL if @p *is_null is non-zero. It is valid
+ * until the next call of memo_store().
+ *
+ * @returns 1 on a hit, or 0 on a miss. */
+int memo_lookup(st_memo *m, const char *key, size_t key_length, const char **value, size_t *value_length, char *is_null);
+
+/** Stores the value of the key of the last missed memo_lookup(), replacing an entry that was not
+ * used recently if the table is full. Nothing is stored if the key and the value together are
+ * larger than @c MEMO_SLOT_SIZE bytes. */
+void memo_store(st_memo *m, const char *key, size_t key_length, const char *value, size_t value_length, char is_null);
+
+/** Stores the process-wide counters of the tables that were freed in @p stats. */
+void memo_get_stats(st_memo_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,485 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	mysqludf_str, a command-line tool that runs the functions of the library over each record of
+	a file, such as a dump made with SELECT ... INTO OUTFILE, without a server. Run it without
+	arguments for its usage.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define open _open
+#define close _close
+#define STDIN_FILENO 0
+#define STDOUT_FILENO 1
+#else
+#include <unistd.h>
+#endif
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+#include "pipeline.h"
+#include "record_stream.h"
+#include "simhash.h"
+#include "string_utils.h"
+
+static const char progname[] = "mysqludf_str";
+
+/* The NULL of SELECT ... INTO OUTFILE and LOAD DATA INFILE */
+static const char null_record[] = "\\N";
+
+typedef struct st_cli st_cli;
+
+/* Appends the result of the command for the `length` bytes of a record at `record` to out, using
+   the scratch memory of the batch. Returns 0, or an errno value. */
+typedef int (*cli_record_fn)(const st_cli *cli, const char *record, size_t length, st_record_output *out, char *scratch);
+
+typedef struct st_cli_command
+{
+	const char *name;
+	unsigned num_args;
+	cli_record_fn fn;
+	const char *usage;
+} st_cli_command;
+
+struct st_cli
+{
+	const st_cli_command *command;
+	char delim;
+	unsigned char table[256];   /* translate */
+	const char *key;            /* xor */
+	size_t key_length;
+	st_str_pipeline *pipeline;      /* pipeline */
+	size_t scratch_size;
+};
+
+static int cli_append(st_record_output *out, const char *s, size_t length)
+{
+	char *p = record_output_reserve(out, length);
+
+	if (p == NULL)
+		return ENOMEM;
+	memcpy(p, s, length);
+	out->length += length;
+	return 0;
+}
+
+static int cli_rot13(const st_cli *cli, const char *record, size_t length, st_record_output *out, char *scratch)
+{
+	char *p = record_output_reserve(out, length);
+
+	(void) cli;
+	(void) scratch;
+	if (p == NULL)
+		return ENOMEM;
+	rot13(p, record, length);
+	out->length += length;
+	return 0;
+}
+
+static int cli_translate(const st_cli *cli, const char *record, size_t length, st_record_output *out, char *scratch)
+{
+	char *p = record_output_reserve(out, length);
+
+	(void) scratch;
+	if (p == NULL)
+		return ENOMEM;
+	byte_map(p, cli->table, record, length);
+	out->length += length;
+	return 0;
+}
+
+static int cli_xor(const st_cli *cli, const char *record, size_t length, st_record_output *out, char *scratch)
+{
+	const size_t result_length = (length > cli->key_length ? length : cli->key_length);
+	char *p = record_output_reserve(out, result_length);
+
+	(void) scratch;
+	if (p == NULL)
+		return ENOMEM;
+	if (length >= cli->key_length)
+		xor_bytes(p, record, length, cli->key, cli->key_length);
+	else
+		xor_bytes(p, cli->key, cli->key_length, record, length);
+	out->length += result_length;
+	return 0;
+}
+
+/* Parses the `length` bytes at s as a decimal integer, with an optional sign. Returns 0 if they are
+   not one, or if it does not fit in a long long. */
+static int cli_parse_integer(const char *s, size_t length, long long *value)
+{
+	const int negative = (length != 0 && s[0] == '-');
+	unsigned long long magnitude = 0;
+	const unsigned long long limit = (negative ? 0ULL - (unsigned long long) LLONG_MIN : (unsigned long long) LLONG_MAX);
+	size_t i = (length != 0 && (s[0] == '-' || s[0] == '+') ? 1 : 0);
+
+	if (i == length)
+		return 0;
+
+	for (; i < length; ++i)
+	{
+		const unsigned digit = (unsigned) (s[i] - '0');
+
+		if (digit > 9 || magnitude > (limit - digit) / 10)
+			return 0;
+		magnitude = magnitude * 10 + digit;
+	}
+
+	*value = (negative ? (long long) (0ULL - magnitude) : (long long) magnitude);
+	return 1;
+}
+
+static int cli_numtowords(const st_cli *cli, const char *record, size_t length, st_record_output *out, char *scratch)
+{
+	long long value;
+	char *p;
+
+	(void) cli;
+	(void) scratch;
+	if (!cli_parse_integer(record, length, &value))
+		return cli_append(out, null_record, sizeof null_record - 1);
+
+	p = record_output_reserve(out, NUMTOWORDS_MAX_LENGTH);
+	if (p == NULL)
+		return ENOMEM;
+	out->length += numtowords(p, value);
+	return 0;
+}
+
+static int cli_simhash(const st_cli *cli, const char *record, size_t length, st_record_output *out, char *scratch)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	uint64_t fingerprint = simhash64(record, length, 4);
+	char *p = record_output_reserve(out, 16);
+	int i;
+
+	(void) cli;
+	(void) scratch;
+	if (p == NULL)
+		return ENOMEM;
+	for (i = 15; i >= 0; --i, fingerprint >>= 4)
+		p[i] = hex[fingerprint & 0xF];
+	out->length += 16;
+	return 0;
+}
+
+static int cli_pipeline(const st_cli *cli, const char *record, size_t length, st_record_output *out, char *scratch)
+{
+	char *p = record_output_reserve(out, length);
+
+	if (p == NULL)
+		return ENOMEM;
+	out->length += str_pipeline_run(cli->pipeline, record, length, p, scratch);
+	return 0;
+}
+
+static const st_cli_command cli_commands[] =
+{
+	{ "rot13", 0, cli_rot13, "rot13                like str_rot13(record)" },
+	{ "translate", 2, cli_translate, "translate SRC DST    like str_translate(record, SRC, DST)" },
+	{ "xor", 1, cli_xor, "xor KEY              like str_xor(record, KEY)" },
+	{ "numtowords", 0, cli_numtowords, "numtowords           like str_numtowords(record); records that are not integers give \\N" },
+	{ "simhash", 0, cli_simhash, "simhash              like HEX(str_simhash(record))" },
+	{ "pipeline", 1, cli_pipeline, "pipeline SPEC        like str_pipeline(SPEC, record)" }
+};
+
+#define CLI_NUM_COMMANDS (sizeof cli_commands / sizeof cli_commands[0])
+
+/* Runs the command over each record of a batch. */
+static int cli_process(void *ctx, const char *data, size_t length, st_record_output *out)
+{
+	const st_cli *cli = (const st_cli *) ctx;
+	const char *const end = data + length;
+	char *scratch = NULL;
+	int error = 0;
+
+	if (cli->scratch_size != 0)
+	{
+		scratch = (char *) malloc(cli->scratch_size);
+		if (scratch == NULL)
+			return ENOMEM;
+	}
+
+	while (data != end)
+	{
+		const char *d = (const char *) memchr(data, cli->delim, (size_t) (end - data));
+		const size_t n = (size_t) ((d != NULL ? d : end) - data);
+
+		if (n == sizeof null_record - 1 && memcmp(data, null_record, n) == 0)
+			error = cli_append(out, null_record, n);
+		else
+			error = cli->command->fn(cli, data, n, out, scratch);
+
+		if (error != 0 || d == NULL)
+			break;
+		error = cli_append(out, &cli->delim, 1);
+		if (error != 0)
+			break;
+		data = d + 1;
+	}
+
+	free(scratch);
+	return error;
+}
+
+static double cli_now(void)
+{
+#if defined(CLOCK_MONOTONIC) && !defined(_WIN32)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static unsigned cli_default_threads(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+	const long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n > 0)
+		return (n > RECORD_STREAM_MAX_THREADS ? RECORD_STREAM_MAX_THREADS : (unsigned) n);
+#endif
+	return 0;
+}
+
+/* Parses a size such as 512K or 4M. Returns 0 if s is not a size. */
+static size_t cli_parse_size(const char *s)
+{
+	char *end;
+	const unsigned long long n = strtoull(s, &end, 10);
+	unsigned long long unit = 1;
+
+	if (end == s)
+		return 0;
+	if (*end == 'K' || *end == 'k')
+		unit = 1024, ++end;
+	else if (*end == 'M' || *end == 'm')
+		unit = 1024 * 1024, ++end;
+	else if (*end == 'G' || *end == 'g')
+		unit = 1024 * 1024 * 1024, ++end;
+
+	if (*end != '\0' || n > (unsigned long long) (SIZE_MAX / 2) / unit)
+		return 0;
+	return (size_t) (n * unit);
+}
+
+static void cli_usage(FILE *f)
+{
+	size_t i;
+
+	fprintf(f, "usage: %s [OPTION]... COMMAND [ARG]... [FILE]\n\n", progname);
+	fprintf(f, "Runs a function of lib_mysqludf_str over each record of FILE, or of the standard input\n"
+			"if FILE is missing or -, and writes the results in the same order. A record that is \\N,\n"
+			"the NULL of SELECT ... INTO OUTFILE, gives \\N.\n\nCommands:\n");
+	for (i = 0; i < CLI_NUM_COMMANDS; ++i)
+		fprintf(f, "  %s\n", cli_commands[i].usage);
+	fprintf(f, "\nOptions:\n"
+			"  -d CHAR       records end with CHAR instead of a newline\n"
+			"  -z            records end with a NUL byte\n"
+			"  -t N          use N worker threads; 0 works in a single thread (default: the number\n"
+			"                of processors)\n"
+			"  -b SIZE       process batches of SIZE bytes, with a K, M or G suffix (default: 1M)\n"
+			"  -o FILE       write to FILE instead of the standard output\n"
+			"  --no-mmap     read the input even if it is a regular file that could be mapped\n"
+			"  -s, --stats   print the throughput to the standard error when done\n");
+}
+
+int main(int argc, char **argv)
+{
+	st_cli cli;
+	st_record_stream_options options;
+	st_record_stream_stats stats;
+	const char *output = NULL, *input = NULL, *where;
+	int print_stats = 0;
+	int in_fd = STDIN_FILENO, out_fd = STDOUT_FILENO;
+	int i, error;
+	size_t c;
+	double start, elapsed;
+
+	memset(&cli, 0, sizeof cli);
+	memset(&options, 0, sizeof options);
+	options.delim = '\n';
+	options.threads = cli_default_threads();
+
+	for (i = 1; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; ++i)
+	{
+		const char *opt = argv[i];
+
+		if (strcmp(opt, "--") == 0)
+		{
+			++i;
+			break;
+		}
+		if (strcmp(opt, "-h") == 0 || strcmp(opt, "--help") == 0)
+		{
+			cli_usage(stdout);
+			return EXIT_SUCCESS;
+		}
+		if (strcmp(opt, "-z") == 0)
+			options.delim = '\0';
+		else if (strcmp(opt, "--no-mmap") == 0)
+			options.no_mmap = 1;
+		else if (strcmp(opt, "-s") == 0 || strcmp(opt, "--stats") == 0)
+			print_stats = 1;
+		else if ((strcmp(opt, "-d") == 0 || strcmp(opt, "-t") == 0 || strcmp(opt, "-b") == 0 || strcmp(opt, "-o") == 0) && i + 1 < argc)
+		{
+			const char *value = argv[++i];
+			char *end;
+
+			switch (opt[1])
+			{
+			case 'd':
+				if (strlen(value) != 1)
+				{
+					fprintf(stderr, "%s: the delimiter must be a single byte\n", progname);
+					return 2;
+				}
+				options.delim = (unsigned char) value[0];
+				break;
+			case 't':
+				options.threads = (unsigned) strtoul(value, &end, 10);
+				if (*end != '\0' || end == value)
+				{
+					fprintf(stderr, "%s: invalid number of threads: %s\n", progname, value);
+					return 2;
+				}
+				break;
+			case 'b':
+				options.batch_size = cli_parse_size(value);
+				if (options.batch_size == 0)
+				{
+					fprintf(stderr, "%s: invalid batch size: %s\n", progname, value);
+					return 2;
+				}
+				break;
+			case 'o':
+				output = value;
+				break;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown option %s\n", progname, opt);
+			cli_usage(stderr);
+			return 2;
+		}
+	}
+
+	if (i == argc)
+	{
+		cli_usage(stderr);
+		return 2;
+	}
+
+	for (c = 0; c < CLI_NUM_COMMANDS && strcmp(argv[i], cli_commands[c].name) != 0; ++c)
+		;
+	if (c == CLI_NUM_COMMANDS || argc - i - 1 < (int) cli_commands[c].num_args || argc - i - 1 > (int) cli_commands[c].num_args + 1)
+	{
+		fprintf(stderr, "%s: unknown command or wrong number of arguments: %s\n", progname, argv[i]);
+		cli_usage(stderr);
+		return 2;
+	}
+	cli.command = &cli_commands[c];
+	cli.delim = (char) options.delim;
+	if (argc - i - 1 > (int) cli.command->num_args)
+		input = argv[argc - 1];
+	++i;
+
+	if (cli.command->fn == cli_translate)
+	{
+		if (strlen(argv[i]) != strlen(argv[i + 1]))
+		{
+			fprintf(stderr, "%s: translate requires SRC and DST to have the same length\n", progname);
+			return 2;
+		}
+		byte_map_fill(cli.table, argv[i], argv[i + 1], strlen(argv[i]));
+	}
+	else if (cli.command->fn == cli_xor)
+	{
+		cli.key = argv[i];
+		cli.key_length = strlen(argv[i]);
+	}
+	else if (cli.command->fn == cli_pipeline)
+	{
+		st_str_pipeline_ctype ctype;
+		const char *message;
+		unsigned op;
+
+		str_pipeline_latin1_ctype(&ctype);
+		cli.pipeline = str_pipeline_compile(argv[i], strlen(argv[i]), &ctype, &message, &op);
+		if (cli.pipeline == NULL)
+		{
+			fprintf(stderr, "%s: %s in transform %u of the spec\n", progname, message, op);
+			return 2;
+		}
+		cli.scratch_size = str_pipeline_scratch_size(cli.pipeline);
+	}
+
+	if (input != NULL && strcmp(input, "-") != 0)
+	{
+		in_fd = open(input, O_RDONLY | O_BINARY);
+		if (in_fd < 0)
+		{
+			fprintf(stderr, "%s: %s: %s\n", progname, input, strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+	if (output != NULL)
+	{
+		out_fd = open(output, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0666);
+		if (out_fd < 0)
+		{
+			fprintf(stderr, "%s: %s: %s\n", progname, output, strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+#ifdef _WIN32
+	_setmode(in_fd, O_BINARY);
+	_setmode(out_fd, O_BINARY);
+#endif
+
+	start = cli_now();
+	error = record_stream_run(in_fd, out_fd, &options, cli_process, &cli, &stats, &where);
+	elapsed = cli_now() - start;
+
+	if (output != NULL && close(out_fd) != 0 && error == 0)
+	{
+		error = errno;
+		where = "write";
+	}
+	if (in_fd != STDIN_FILENO)
+		close(in_fd);
+	str_pipeline_free(cli.pipeline);
+
+	if (print_stats)
+	{
+		fprintf(stderr, "%s: %s: %llu bytes in, %llu bytes out, %llu batches, %u threads, %s, %.3f s, %.1f MB/s\n",
+				progname, cli.command->name, (unsigned long long) stats.bytes_in, (unsigned long long) stats.bytes_out,
+				(unsigned long long) stats.batches, stats.threads, (stats.mapped ? "mapped" : "read"), elapsed,
+				(elapsed > 0 ? (double) stats.bytes_in / elapsed / 1e6 : 0.0));
+	}
+
+	if (error != 0)
+	{
+		fprintf(stderr, "%s: %s: %s\n", progname, where, strerror(error));
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <string.h>
+
+#include "string_utils.h"
+
+#define STR_LENGTH(str) ((sizeof (str)) -1)
+#define STR_COMMA_LENGTH(str_lit) str_lit, STR_LENGTH(str_lit)
+
+/* Appends the `length` bytes at `s` to `d`, and returns a pointer past them. */
+static char *numtowords_append(char *d, const char *s, size_t length)
+{
+	memcpy(d, s, length);
+	return d + length;
+}
+
+static char *numtowords_strcat(char *d, const char *s)
+{
+	return numtowords_append(d, s, strlen(s));
+}
+
+size_t numtowords(char *dest, long long value)
+{
+	static const char *const powers[] = {"thousand", "million", "billion", "trillion", "quadrillion", "quintillion", "sextillion", "septillion", "octillion", "nonillion", "decillion", "undecillion", "duodecillion"};
+
+	static const char *const ones[] = {"one", "two", "three", "four", "five",
+																"six", "seven", "eight", "nine", "ten",
+																"eleven", "twelve", "thirteen", "fourteen", "fifteen",
+																"sixteen", "seventeen", "eighteen", "nineteen"};
+
+	static const char *const tens[] = {"twenty", "thirty", "forty", "fifty", "sixty", "seventy", "eighty", "ninety"};
+
+	int part_stack[14];
+	int *part_ptr = part_stack;
+	char *d = dest;
+	unsigned long long magnitude;
+
+	// check for negative values or zero; the magnitude of the smallest value is not a long long
+	if (value < 0)
+	{
+		d = numtowords_append(d, STR_COMMA_LENGTH("negative "));
+		magnitude = 0ULL - (unsigned long long) value;
+	}
+	else if (value == 0)
+	{
+		memcpy(dest, "zero", STR_LENGTH("zero"));
+		return STR_LENGTH("zero");
+	}
+	else
+	{
+		magnitude = (unsigned long long) value;
+	}
+
+	// splitting the number into its parts
+	for (; magnitude; magnitude /= 1000)
+		*part_ptr++ = (int) (magnitude % 1000);
+
+	while (part_ptr > part_stack)
+	{
+		int p = *--part_ptr;
+		const int pWasNonzero = p != 0;
+
+		if (p >= 100)
+		{
+			d = numtowords_strcat(d, ones[p / 100 - 1]);
+			d = numtowords_append(d, STR_COMMA_LENGTH(" hundred "));
+			p %= 100;
+		}
+
+		if (p >= 20)
+		{
+			d = numtowords_strcat(d, tens[p / 10 - 2]);
+			if (p % 10)
+			{
+				d = numtowords_append(d, STR_COMMA_LENGTH("-"));
+				d = numtowords_strcat(d, ones[p % 10 - 1]);
+			}
+			d = numtowords_append(d, STR_COMMA_LENGTH(" "));
+		}
+		else if (p > 0)
+		{
+			d = numtowords_strcat(d, ones[p - 1]);
+			d = numtowords_append(d, STR_COMMA_LENGTH(" "));
+		}
+
+		if (pWasNonzero && part_ptr > part_stack)
+		{
+			d = numtowords_strcat(d, powers[part_ptr - part_stack - 1]);
+			d = numtowords_append(d, STR_COMMA_LENGTH(" "));
+		}
+	}
+
+	// without the trailing space
+	return (size_t) (d - dest) - 1;
+}
@@ -0,0 +1,228 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pattern_cache.h"
+#include "str_alloc.h"
+#include "str_hash.h"
+#include "str_sync.h"
+
+#ifndef SIZE_MAX
+#define SIZE_MAX ((size_t) -1)
+#endif
+
+#define PATTERN_CACHE_SEED UINT64_C(0x5041545443414348)
+
+/* Number of hash chains, a power of two */
+#define PATTERN_CACHE_NUM_CHAINS 1024
+
+struct st_pattern_cache_entry
+{
+	/* The chain of the hash table and the LRU list, most recently used first */
+	st_pattern_cache_entry *chain_next;
+	st_pattern_cache_entry *lru_prev, *lru_next;
+
+	const char *func;
+	uint64_t hash;
+	void *value;
+	pattern_cache_destroy_fn destroy;
+	size_t bytes;
+
+	unsigned refs; /* the number of references returned by pattern_cache_acquire() */
+	int cached; /* zero once the entry is evicted, or if it was never cached */
+
+	size_t key_length;
+	char key[1];
+};
+
+/* All of the state is protected by one lock. It is only taken in the _init and _deinit functions,
+   once per statement, and held for a lookup in a short chain; compiling happens outside of it. */
+static str_mutex cache_lock = STR_MUTEX_INITIALIZER;
+#define PATTERN_CACHE_LOCK() str_mutex_lock(&cache_lock)
+#define PATTERN_CACHE_UNLOCK() str_mutex_unlock(&cache_lock)
+
+static st_pattern_cache_entry *cache_chains[PATTERN_CACHE_NUM_CHAINS];
+static st_pattern_cache_entry *cache_lru_first, *cache_lru_last;
+static st_pattern_cache_stats cache_stats;
+
+static void pattern_cache_destroy(st_pattern_cache_entry *e)
+{
+	e->destroy(e->value);
+	str_free(e);
+}
+
+static void pattern_cache_lru_unlink(st_pattern_cache_entry *e)
+{
+	if (e->lru_prev != NULL)
+		e->lru_prev->lru_next = e->lru_next;
+	else
+		cache_lru_first = e->lru_next;
+	if (e->lru_next != NULL)
+		e->lru_next->lru_prev = e->lru_prev;
+	else
+		cache_lru_last = e->lru_prev;
+}
+
+static void pattern_cache_lru_push(st_pattern_cache_entry *e)
+{
+	e->lru_prev = NULL;
+	e->lru_next = cache_lru_first;
+	if (cache_lru_first != NULL)
+		cache_lru_first->lru_prev = e;
+	else
+		cache_lru_last = e;
+	cache_lru_first = e;
+}
+
+/* Removes e from the cache. It is destroyed once it has no references. */
+static void pattern_cache_evict(st_pattern_cache_entry *e)
+{
+	st_pattern_cache_entry **link = &cache_chains[e->hash & (PATTERN_CACHE_NUM_CHAINS - 1)];
+
+	while (*link != e)
+		link = &(*link)->chain_next;
+	*link = e->chain_next;
+
+	pattern_cache_lru_unlink(e);
+	e->cached = 0;
+	--cache_stats.entries;
+	cache_stats.bytes -= e->bytes;
+	++cache_stats.evictions;
+
+	if (e->refs == 0)
+		pattern_cache_destroy(e);
+}
+
+static st_pattern_cache_entry *pattern_cache_find(const char *func, uint64_t hash, const char *key, size_t key_length)
+{
+	st_pattern_cache_entry *e;
+
+	for (e = cache_chains[hash & (PATTERN_CACHE_NUM_CHAINS - 1)]; e != NULL; e = e->chain_next)
+	{
+		if (e->hash == hash && e->key_length == key_length && strcmp(e->func, func) == 0
+				&& memcmp(e->key, key, key_length) == 0)
+			return e;
+	}
+
+	return NULL;
+}
+
+st_pattern_cache_entry *pattern_cache_acquire(const char *func, const char *key, size_t key_length,
+		pattern_cache_compile_fn compile, pattern_cache_destroy_fn destroy)
+{
+	const uint64_t hash = str_hash64(key, key_length, str_hash64(func, strlen(func), PATTERN_CACHE_SEED));
+	st_pattern_cache_entry *e, *found;
+	st_str_memory_scope *scope;
+	size_t value_size;
+
+	PATTERN_CACHE_LOCK();
+	e = pattern_cache_find(func, hash, key, key_length);
+	if (e != NULL)
+	{
+		++e->refs;
+		++cache_stats.hits;
+		pattern_cache_lru_unlink(e);
+		pattern_cache_lru_push(e);
+		PATTERN_CACHE_UNLOCK();
+		return e;
+	}
+	++cache_stats.misses;
+	PATTERN_CACHE_UNLOCK();
+
+	if (key_length > SIZE_MAX - sizeof (st_pattern_cache_entry))
+		return NULL;
+
+	// Entries outlive the statement that compiles them, so they are not charged to it.
+	scope = str_memory_enter(NULL);
+	e = (st_pattern_cache_entry *) str_malloc(sizeof (st_pattern_cache_entry) + key_length);
+	if (e != NULL)
+	{
+		e->value = compile(key, key_length, &value_size);
+		if (e->value == NULL)
+		{
+			str_free(e);
+			e = NULL;
+		}
+	}
+	str_memory_leave(scope);
+	if (e == NULL)
+		return NULL;
+
+	e->func = func;
+	e->hash = hash;
+	e->destroy = destroy;
+	e->bytes = sizeof (st_pattern_cache_entry) + key_length + value_size;
+	e->refs = 1;
+	e->cached = 0;
+	e->key_length = key_length;
+	memcpy(e->key, key, key_length);
+
+	if (e->bytes > PATTERN_CACHE_MAX_ENTRY_BYTES)
+		return e;
+
+	PATTERN_CACHE_LOCK();
+	// Another statement may have compiled the same key in the meantime.
+	found = pattern_cache_find(func, hash, key, key_length);
+	if (found != NULL)
+	{
+		++found->refs;
+		PATTERN_CACHE_UNLOCK();
+		pattern_cache_destroy(e);
+		return found;
+	}
+
+	while (cache_lru_last != NULL && (cache_stats.entries >= PATTERN_CACHE_MAX_ENTRIES
+				|| cache_stats.bytes + e->bytes > PATTERN_CACHE_MAX_BYTES))
+		pattern_cache_evict(cache_lru_last);
+
+	e->chain_next = cache_chains[hash & (PATTERN_CACHE_NUM_CHAINS - 1)];
+	cache_chains[hash & (PATTERN_CACHE_NUM_CHAINS - 1)] = e;
+	pattern_cache_lru_push(e);
+	e->cached = 1;
+	++cache_stats.entries;
+	cache_stats.bytes += e->bytes;
+	PATTERN_CACHE_UNLOCK();
+
+	return e;
+}
+
+const void *pattern_cache_value(const st_pattern_cache_entry *entry)
+{
+	return entry->value;
+}
+
+void pattern_cache_release(st_pattern_cache_entry *entry)
+{
+	int destroy;
+
+	PATTERN_CACHE_LOCK();
+	destroy = (--entry->refs == 0 && !entry->cached);
+	PATTERN_CACHE_UNLOCK();
+
+	if (destroy)
+		pattern_cache_destroy(entry);
+}
+
+void pattern_cache_get_stats(st_pattern_cache_stats *stats)
+{
+	PATTERN_CACHE_LOCK();
+	*stats = cache_stats;
+	PATTERN_CACHE_UNLOCK();
+}
+
+#ifdef __GNUC__
+/* Frees the cached entries when the library is unloaded, after the last DROP FUNCTION. No
+   statement is running then, so none of them has references. */
+__attribute__((destructor))
+static void pattern_cache_shutdown(void)
+{
+	while (cache_lru_last != NULL)
+		pattern_cache_evict(cache_lru_last);
+}
+#endif
@@ -0,0 +1,71 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	A process-wide cache of the state that functions compile from their constant arguments, such
+	as translation tables and deserialized filters, so that statements that repeat the same
+	constant arguments do not compile them again in their _init function.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_PATTERN_CACHE_H
+#define LIB_MYSQLUDF_STR_PATTERN_CACHE_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The largest number of entries of the cache, and their largest total size in bytes. When a
+ * new entry would exceed either, the least recently used entries are evicted. */
+#define PATTERN_CACHE_MAX_ENTRIES 1024
+#define PATTERN_CACHE_MAX_BYTES (16 * 1024 * 1024)
+
+/** Entries larger than this are compiled for their statement only, not cached. */
+#define PATTERN_CACHE_MAX_ENTRY_BYTES (PATTERN_CACHE_MAX_BYTES / 16)
+
+typedef struct st_pattern_cache_entry st_pattern_cache_entry;
+
+/** Compiles the @p key_length bytes at @p key into an immutable value.
+ *
+ * @returns the value, or NULL if memory could not be allocated. The size of its memory is stored
+ *		in @p *size. */
+typedef void *(*pattern_cache_compile_fn)(const char *key, size_t key_length, size_t *size);
+
+/** Frees a value returned by a pattern_cache_compile_fn. */
+typedef void (*pattern_cache_destroy_fn)(void *value);
+
+typedef struct st_pattern_cache_stats
+{
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t entries;
+	size_t bytes; /* the sizes of the keys and values of the entries */
+} st_pattern_cache_stats;
+
+/** Looks up the value that @p compile returns for the @p key_length bytes at @p key, for the
+ * function named @p func. If it is not cached, it is compiled without holding the cache lock and
+ * added to the cache. The entry cannot be evicted until it is released.
+ *
+ * @returns a reference to the entry, which must be released with pattern_cache_release(), or
+ *		NULL if memory could not be allocated. */
+st_pattern_cache_entry *pattern_cache_acquire(const char *func, const char *key, size_t key_length,
+		pattern_cache_compile_fn compile, pattern_cache_destroy_fn destroy);
+
+/** @returns the value of @p entry, which must not be modified. */
+const void *pattern_cache_value(const st_pattern_cache_entry *entry);
+
+/** Releases a reference returned by pattern_cache_acquire(). */
+void pattern_cache_release(st_pattern_cache_entry *entry);
+
+/** Stores the counters of the cache in @p stats. */
+void pattern_cache_get_stats(st_pattern_cache_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,675 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipeline.h"
+#include "str_alloc.h"
+#include "string_utils.h"
+
+/* The largest number of arguments of a transform, plus its name */
+#define PIPELINE_MAX_FIELDS 3
+
+typedef enum pipeline_stage_kind
+{
+	PIPELINE_TABLE,   /* maps each byte with a table */
+	PIPELINE_XOR,
+	PIPELINE_UCWORDS,
+	PIPELINE_TRIM,
+	PIPELINE_SQUEEZE
+} pipeline_stage_kind;
+
+/* A kernel of string_utils.h that maps each byte to a byte */
+typedef void (*pipeline_map_fn)(char *__restrict dest, const char *__restrict src, size_t length);
+
+/* A transform, together with the byte maps before and after it that are folded into it: the maps
+   of translate, rot13, upper and lower cost a pass of their own only if nothing is next to them. */
+typedef struct st_pipeline_stage
+{
+	pipeline_stage_kind kind;
+	unsigned char pre[256];  /* maps the input of the stage; the identity for PIPELINE_TRIM */
+	unsigned char post[256]; /* maps the output of the stage; the identity for PIPELINE_XOR and
+	                            PIPELINE_TRIM */
+
+	/* Built from pre and post once the spec is compiled:
+	   PIPELINE_TABLE, PIPELINE_XOR: map[0] maps each byte.
+	   PIPELINE_UCWORDS: map[0] maps the bytes that follow a non-letter, map[1] those that follow a
+	   letter, and is_class[c] is 1 if c is mapped to a letter by pre.
+	   PIPELINE_SQUEEZE: map[0] maps each byte, and is_class[c] is 1 if c is mapped to a space by
+	   pre. */
+	unsigned char map[2][256];
+	unsigned char is_class[256];
+
+	/* PIPELINE_TABLE: a kernel that maps the bytes as map[0] does, or NULL for byte_map() */
+	pipeline_map_fn map_fn;
+
+	char *key;               /* PIPELINE_XOR */
+	size_t key_length;
+} st_pipeline_stage;
+
+struct st_str_pipeline
+{
+	st_str_pipeline_ctype ctype;
+	unsigned num_stages;
+	st_pipeline_stage stages[STR_PIPELINE_MAX_OPS];
+};
+
+/* The state of a stage between blocks */
+typedef struct st_pipeline_stage_state
+{
+	size_t pos;     /* PIPELINE_XOR: the next byte of the key */
+	size_t pending; /* PIPELINE_TRIM: the spaces that are kept back until a non-space follows */
+	int flag;       /* PIPELINE_UCWORDS: in a word; PIPELINE_TRIM: past the leading spaces;
+	                   PIPELINE_SQUEEZE: after a space */
+} st_pipeline_stage_state;
+
+typedef struct st_pipeline_run_state
+{
+	const st_str_pipeline *p;
+	st_pipeline_stage_state states[STR_PIPELINE_MAX_OPS];
+	unsigned char *scratch; /* a block for the output of each stage but the last one */
+	unsigned char *dest;
+	size_t dest_length;
+} st_pipeline_run_state;
+
+/* Returns the value of the hexadecimal digit c, or -1. */
+static int pipeline_hex_digit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+/* Splits the transform that starts at *spec into its name and arguments, which are unescaped into
+   buf, and moves *spec past it and the following '|', if any, in which case *more is set. Returns
+   the number of fields, or 0 with *error set. */
+static unsigned pipeline_parse_op(const char **spec, const char *spec_end, char *buf,
+		const char **fields, size_t *field_lengths, int *more, const char **error)
+{
+	const char *s = *spec;
+	unsigned n = 0;
+	char *d = buf;
+
+	fields[0] = d;
+
+	for (; s != spec_end && *s != '|'; ++s)
+	{
+		char c = *s;
+
+		if (c == ':')
+		{
+			field_lengths[n] = (size_t) (d - fields[n]);
+			if (++n == PIPELINE_MAX_FIELDS)
+			{
+				*error = "too many arguments";
+				return 0;
+			}
+			fields[n] = d;
+			continue;
+		}
+
+		if (c == '\\')
+		{
+			if (++s == spec_end)
+			{
+				*error = "incomplete escape sequence";
+				return 0;
+			}
+			c = *s;
+			if (c == 'x')
+			{
+				int hi, lo;
+
+				if (spec_end - s < 3 || (hi = pipeline_hex_digit(s[1])) < 0 || (lo = pipeline_hex_digit(s[2])) < 0)
+				{
+					*error = "\\x must be followed by two hexadecimal digits";
+					return 0;
+				}
+				c = (char) (hi * 16 + lo);
+				s += 2;
+			}
+			else if (c != '\\' && c != '|' && c != ':')
+			{
+				*error = "unknown escape sequence";
+				return 0;
+			}
+		}
+
+		*d++ = c;
+	}
+
+	field_lengths[n] = (size_t) (d - fields[n]);
+	*more = (s != spec_end);
+	*spec = (*more ? s + 1 : s);
+	return n + 1;
+}
+
+/* Trims the spaces around the name of a transform. */
+static void pipeline_trim_name(const char **name, size_t *length)
+{
+	while (*length != 0 && **name == ' ')
+	{
+		++*name;
+		--*length;
+	}
+	while (*length != 0 && (*name)[*length - 1] == ' ')
+		--*length;
+}
+
+static int pipeline_name_is(const char *name, size_t length, const char *s)
+{
+	return length == strlen(s) && memcmp(name, s, length) == 0;
+}
+
+static void pipeline_identity(unsigned char *table)
+{
+	unsigned i;
+
+	for (i = 0; i < 256; ++i)
+		table[i] = (unsigned char) i;
+}
+
+/* Returns non-zero if table maps spaces, and only spaces, to spaces. */
+static int pipeline_keeps_spaces(const unsigned char *table)
+{
+	unsigned i;
+
+	for (i = 0; i < 256; ++i)
+	{
+		if ((table[i] == ' ') != (i == ' '))
+			return 0;
+	}
+	return 1;
+}
+
+/* Appends a stage of the given kind whose maps are the identity. */
+static st_pipeline_stage *pipeline_append(st_str_pipeline *p, pipeline_stage_kind kind)
+{
+	st_pipeline_stage *st = &p->stages[p->num_stages++];
+
+	st->kind = kind;
+	pipeline_identity(st->pre);
+	pipeline_identity(st->post);
+	return st;
+}
+
+/* Appends a table stage, or folds table into the output of the last stage if that can be done. */
+static void pipeline_add_table(st_str_pipeline *p, const unsigned char *table)
+{
+	st_pipeline_stage *st;
+	unsigned i;
+
+	if (p->num_stages != 0)
+	{
+		st = &p->stages[p->num_stages - 1];
+		if (st->kind == PIPELINE_TABLE || st->kind == PIPELINE_UCWORDS || st->kind == PIPELINE_SQUEEZE)
+		{
+			for (i = 0; i < 256; ++i)
+				st->post[i] = table[st->post[i]];
+			return;
+		}
+	}
+
+	st = pipeline_append(p, PIPELINE_TABLE);
+	memcpy(st->post, table, 256);
+}
+
+/* Appends a stage of the given kind, which is not PIPELINE_TRIM. If the last stage is a table
+   stage, it becomes the new stage, with its table as the map of the input. */
+static st_pipeline_stage *pipeline_add_stage(st_str_pipeline *p, pipeline_stage_kind kind)
+{
+	st_pipeline_stage *st;
+
+	if (p->num_stages != 0 && p->stages[p->num_stages - 1].kind == PIPELINE_TABLE)
+	{
+		st = &p->stages[p->num_stages - 1];
+		st->kind = kind;
+		memcpy(st->pre, st->post, 256);
+		pipeline_identity(st->post);
+		return st;
+	}
+
+	return pipeline_append(p, kind);
+}
+
+/* Appends a trim stage. A table stage before it that maps spaces, and only spaces, to spaces gives
+   the same result after it, and goes after it so that it can be folded into the next stage. */
+static void pipeline_add_trim(st_str_pipeline *p)
+{
+	st_pipeline_stage *last;
+
+	if (p->num_stages != 0)
+	{
+		last = &p->stages[p->num_stages - 1];
+		if (last->kind == PIPELINE_TABLE && pipeline_keeps_spaces(last->post))
+		{
+			p->stages[p->num_stages] = *last;
+			last->kind = PIPELINE_TRIM;
+			pipeline_identity(last->pre);
+			pipeline_identity(last->post);
+			++p->num_stages;
+			return;
+		}
+	}
+
+	pipeline_append(p, PIPELINE_TRIM);
+}
+
+static void pipeline_rot13_table(unsigned char *table)
+{
+	unsigned i;
+
+	pipeline_identity(table);
+	for (i = 0; i < 26; ++i)
+	{
+		table['a' + i] = (unsigned char) ('a' + (i + 13) % 26);
+		table['A' + i] = (unsigned char) ('A' + (i + 13) % 26);
+	}
+}
+
+/* Returns the kernel that maps each byte as `table` does, if there is one: those of rot13 and of
+   the case of latin1 compute vectors of bytes rather than look each one up. */
+static pipeline_map_fn pipeline_table_kernel(const unsigned char *table)
+{
+	st_str_pipeline_ctype latin1;
+	unsigned char rot13_table[256];
+
+	str_pipeline_latin1_ctype(&latin1);
+	pipeline_rot13_table(rot13_table);
+
+	if (memcmp(table, latin1.upper, 256) == 0)
+		return latin1_upper;
+	if (memcmp(table, latin1.lower, 256) == 0)
+		return latin1_lower;
+	if (memcmp(table, rot13_table, 256) == 0)
+		return rot13;
+	return NULL;
+}
+
+/* Builds the tables that the stage is run with from its maps. */
+static void pipeline_build_stage(st_pipeline_stage *st, const st_str_pipeline_ctype *ctype)
+{
+	unsigned i;
+
+	for (i = 0; i < 256; ++i)
+	{
+		const unsigned char c = st->pre[i];
+
+		switch (st->kind)
+		{
+		case PIPELINE_TABLE:
+		case PIPELINE_XOR:
+			st->map[0][i] = st->post[c];
+			break;
+
+		case PIPELINE_TRIM:
+			break;
+
+		case PIPELINE_UCWORDS:
+			st->is_class[i] = (ctype->alpha[c] ? 1 : 0);
+			st->map[0][i] = st->post[st->is_class[i] ? ctype->upper[c] : c];
+			st->map[1][i] = st->post[c];
+			break;
+
+		case PIPELINE_SQUEEZE:
+			st->is_class[i] = (c == ' ');
+			st->map[0][i] = st->post[c];
+			break;
+		}
+	}
+
+	if (st->kind == PIPELINE_TABLE)
+		st->map_fn = pipeline_table_kernel(st->map[0]);
+}
+
+/* Compiles one transform into p. Returns 0, or a non-zero value with *error set. */
+static int pipeline_add_op(st_str_pipeline *p, const char **fields, const size_t *field_lengths, unsigned num_fields,
+		const char **error)
+{
+	const char *name = fields[0];
+	size_t name_length = field_lengths[0];
+	st_pipeline_stage *st;
+	unsigned char table[256];
+	unsigned num_args = num_fields - 1;
+
+	pipeline_trim_name(&name, &name_length);
+
+	if (name_length == 0)
+	{
+		*error = "empty transform";
+		return 1;
+	}
+
+	if (pipeline_name_is(name, name_length, "translate"))
+	{
+		if (num_args != 2 || field_lengths[1] != field_lengths[2])
+		{
+			*error = "translate needs two arguments of the same length";
+			return 1;
+		}
+		byte_map_fill(table, fields[1], fields[2], field_lengths[1]);
+		pipeline_add_table(p, table);
+		return 0;
+	}
+
+	if (pipeline_name_is(name, name_length, "xor"))
+	{
+		char *key;
+
+		if (num_args != 1 || field_lengths[1] == 0)
+		{
+			*error = "xor needs a non-empty key";
+			return 1;
+		}
+		key = (char *) str_malloc(field_lengths[1]);
+		if (key == NULL)
+		{
+			*error = "out of memory";
+			return 1;
+		}
+		memcpy(key, fields[1], field_lengths[1]);
+		st = pipeline_add_stage(p, PIPELINE_XOR);
+		st->key = key;
+		st->key_length = field_lengths[1];
+		return 0;
+	}
+
+	if (num_args != 0)
+	{
+		*error = "too many arguments";
+		return 1;
+	}
+
+	if (pipeline_name_is(name, name_length, "rot13"))
+	{
+		pipeline_rot13_table(table);
+		pipeline_add_table(p, table);
+	}
+	else if (pipeline_name_is(name, name_length, "upper"))
+		pipeline_add_table(p, p->ctype.upper);
+	else if (pipeline_name_is(name, name_length, "lower"))
+		pipeline_add_table(p, p->ctype.lower);
+	else if (pipeline_name_is(name, name_length, "ucwords"))
+		pipeline_add_stage(p, PIPELINE_UCWORDS);
+	else if (pipeline_name_is(name, name_length, "trim"))
+		pipeline_add_trim(p);
+	else if (pipeline_name_is(name, name_length, "squeeze"))
+		pipeline_add_stage(p, PIPELINE_SQUEEZE);
+	else
+	{
+		*error = "unknown transform";
+		return 1;
+	}
+
+	return 0;
+}
+
+void str_pipeline_latin1_ctype(st_str_pipeline_ctype *ctype)
+{
+	unsigned i;
+
+	for (i = 0; i < 256; ++i)
+	{
+		const int upper = ((i >= 'A' && i <= 'Z') || (i >= 0xC0 && i <= 0xDE && i != 0xD7));
+		const int lower = ((i >= 'a' && i <= 'z') || (i >= 0xE0 && i <= 0xFE && i != 0xF7));
+
+		ctype->alpha[i] = (unsigned char) (upper || lower || i == 0xDF || i == 0xFF);
+		ctype->upper[i] = (unsigned char) (lower ? i - 0x20 : i);
+		ctype->lower[i] = (unsigned char) (upper ? i + 0x20 : i);
+	}
+}
+
+st_str_pipeline *str_pipeline_compile(const char *spec, size_t spec_length, const st_str_pipeline_ctype *ctype,
+		const char **error, unsigned *error_op)
+{
+	const char *const spec_end = spec + spec_length;
+	st_str_pipeline *p;
+	char *buf;
+	unsigned op = 0;
+	int more;
+
+	*error_op = 0;
+
+	p = (st_str_pipeline *) str_calloc(1, sizeof (st_str_pipeline));
+	buf = (char *) str_malloc(spec_length + 1);
+	if (p == NULL || buf == NULL)
+	{
+		str_free(buf);
+		str_free(p);
+		*error = "out of memory";
+		return NULL;
+	}
+	p->ctype = *ctype;
+
+	do
+	{
+		const char *fields[PIPELINE_MAX_FIELDS];
+		size_t field_lengths[PIPELINE_MAX_FIELDS];
+		unsigned num_fields;
+
+		*error_op = ++op;
+		if (op > STR_PIPELINE_MAX_OPS)
+		{
+			*error = "too many transforms";
+			goto fail;
+		}
+
+		num_fields = pipeline_parse_op(&spec, spec_end, buf, fields, field_lengths, &more, error);
+		if (num_fields == 0 || pipeline_add_op(p, fields, field_lengths, num_fields, error))
+			goto fail;
+	} while (more);
+
+	for (op = 0; op < p->num_stages; ++op)
+		pipeline_build_stage(&p->stages[op], &p->ctype);
+
+	str_free(buf);
+	return p;
+
+fail:
+	str_free(buf);
+	str_pipeline_free(p);
+	return NULL;
+}
+
+void str_pipeline_free(st_str_pipeline *p)
+{
+	unsigned i;
+
+	if (p == NULL)
+		return;
+
+	for (i = 0; i < p->num_stages; ++i)
+	{
+		if (p->stages[i].kind == PIPELINE_XOR)
+			str_free(p->stages[i].key);
+	}
+	str_free(p);
+}
+
+size_t str_pipeline_scratch_size(const st_str_pipeline *p)
+{
+	return (p->num_stages > 1 ? (size_t) (p->num_stages - 1) * STR_PIPELINE_BLOCK_SIZE : 1);
+}
+
+static void pipeline_feed(st_pipeline_run_state *r, unsigned i, const unsigned char *in, size_t n);
+
+/* Returns where stage i writes its output: the end of the result for the last stage. */
+static unsigned char *pipeline_stage_output(st_pipeline_run_state *r, unsigned i)
+{
+	if (i + 1 == r->p->num_stages)
+		return r->dest + r->dest_length;
+	return r->scratch + (size_t) i * STR_PIPELINE_BLOCK_SIZE;
+}
+
+/* Passes the n bytes that stage i wrote to its output on. */
+static void pipeline_emit(st_pipeline_run_state *r, unsigned i, const unsigned char *out, size_t n)
+{
+	if (i + 1 == r->p->num_stages)
+		r->dest_length += n;
+	else
+		pipeline_feed(r, i + 1, out, n);
+}
+
+/* Passes n spaces from stage i on, at most a block at a time, once the output of stage i so far
+   has been passed on. */
+static void pipeline_emit_spaces(st_pipeline_run_state *r, unsigned i, size_t n)
+{
+	unsigned char *out = pipeline_stage_output(r, i);
+
+	if (i + 1 == r->p->num_stages)
+	{
+		memset(out, ' ', n);
+		r->dest_length += n;
+		return;
+	}
+
+	memset(out, ' ', (n < STR_PIPELINE_BLOCK_SIZE ? n : STR_PIPELINE_BLOCK_SIZE));
+	while (n != 0)
+	{
+		const size_t k = (n < STR_PIPELINE_BLOCK_SIZE ? n : STR_PIPELINE_BLOCK_SIZE);
+		pipeline_feed(r, i + 1, out, k);
+		n -= k;
+	}
+}
+
+/* Runs stage i on the n bytes at in, which are at most a block, and passes its output on. */
+static void pipeline_feed(st_pipeline_run_state *r, unsigned i, const unsigned char *in, size_t n)
+{
+	const st_pipeline_stage *st = &r->p->stages[i];
+	st_pipeline_stage_state *state = &r->states[i];
+	unsigned char *out = pipeline_stage_output(r, i);
+	size_t j, k = 0;
+
+	switch (st->kind)
+	{
+	case PIPELINE_TABLE:
+		if (st->map_fn != NULL)
+			st->map_fn((char *) out, (const char *) in, n);
+		else
+			byte_map((char *) out, st->map[0], (const char *) in, n);
+		k = n;
+		break;
+
+	case PIPELINE_XOR:
+		{
+			const unsigned char *key = (const unsigned char *) st->key;
+			size_t pos = state->pos;
+
+			for (j = 0; j < n; ++j)
+			{
+				out[j] = st->map[0][in[j]] ^ key[pos];
+				if (++pos == st->key_length)
+					pos = 0;
+			}
+			state->pos = pos;
+			k = n;
+		}
+		break;
+
+	case PIPELINE_UCWORDS:
+		{
+			unsigned in_word = (unsigned) state->flag;
+
+			for (j = 0; j < n; ++j)
+			{
+				out[j] = st->map[in_word][in[j]];
+				in_word = st->is_class[in[j]];
+			}
+			state->flag = (int) in_word;
+			k = n;
+		}
+		break;
+
+	case PIPELINE_SQUEEZE:
+		{
+			unsigned after_space = (unsigned) state->flag;
+
+			// Each byte is written, and kept unless it is a space after a space.
+			for (j = 0; j < n; ++j)
+			{
+				const unsigned space = st->is_class[in[j]];
+
+				out[k] = st->map[0][in[j]];
+				k += !(space & after_space);
+				after_space = space;
+			}
+			state->flag = (int) after_space;
+		}
+		break;
+
+	case PIPELINE_TRIM:
+		{
+			size_t end = n;
+
+			// Skip the leading spaces, and keep the spaces at the end of the block back until a
+			// non-space follows them.
+			j = 0;
+			if (!state->flag)
+			{
+				while (j < n && in[j] == ' ')
+					++j;
+				if (j == n)
+					return;
+				state->flag = 1;
+			}
+			while (end > j && in[end - 1] == ' ')
+				--end;
+			if (end == j)
+			{
+				state->pending += n - j;
+				return;
+			}
+
+			if (state->pending != 0)
+			{
+				pipeline_emit_spaces(r, i, state->pending);
+				out = pipeline_stage_output(r, i);
+			}
+			state->pending = n - end;
+
+			// The rest of the block goes on as it is.
+			if (i + 1 != r->p->num_stages)
+			{
+				pipeline_feed(r, i + 1, in + j, end - j);
+				return;
+			}
+			memcpy(out, in + j, end - j);
+			k = end - j;
+		}
+		break;
+	}
+
+	pipeline_emit(r, i, out, k);
+}
+
+size_t str_pipeline_run(const st_str_pipeline *p, const char *src, size_t length, char *dest, char *scratch)
+{
+	st_pipeline_run_state r;
+	const unsigned char *s = (const unsigned char *) src;
+	size_t i;
+
+	// A pipeline of byte maps only is a single byte map.
+	if (p->num_stages == 1 && p->stages[0].kind == PIPELINE_TABLE)
+	{
+		byte_map(dest, p->stages[0].map[0], src, length);
+		return length;
+	}
+
+	memset(&r, 0, sizeof r);
+	r.p = p;
+	r.scratch = (unsigned char *) scratch;
+	r.dest = (unsigned char *) dest;
+
+	for (i = 0; i < length; i += STR_PIPELINE_BLOCK_SIZE)
+		pipeline_feed(&r, 0, s + i, (length - i < STR_PIPELINE_BLOCK_SIZE ? length - i : STR_PIPELINE_BLOCK_SIZE));
+
+	return r.dest_length;
+}
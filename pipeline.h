@@ -0,0 +1,79 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	A sequence of byte-local transforms, such as "lower|trim|squeeze|ucwords", compiled so that a
+	string is transformed in a single pass. Consecutive transforms that map each byte to a byte
+	are composed into one 256-byte table. The other ones keep their state from one block to the
+	next, so that the data is transformed block by block while it is in cache.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_PIPELINE_H
+#define LIB_MYSQLUDF_STR_PIPELINE_H 1
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The largest number of transforms of a pipeline. */
+#define STR_PIPELINE_MAX_OPS 32
+
+/** The number of bytes that go through all transforms before the next ones are read. */
+#define STR_PIPELINE_BLOCK_SIZE 4096
+
+/** The character set of the transforms that depend on it. */
+typedef struct st_str_pipeline_ctype
+{
+	unsigned char upper[256];
+	unsigned char lower[256];
+	unsigned char alpha[256]; /* non-zero for letters */
+} st_str_pipeline_ctype;
+
+/** Fills @p ctype with the case and letters of latin1, the character set of the server that the
+ * functions use. */
+void str_pipeline_latin1_ctype(st_str_pipeline_ctype *ctype);
+
+typedef struct st_str_pipeline st_str_pipeline;
+
+/** Compiles the @p spec_length bytes of @p spec: transforms separated by <code>|</code>, each
+ * being the name of the transform followed by its arguments, each preceded by <code>:</code>.
+ * <code>\\|</code>, <code>\\:</code> and <code>\\\\</code> stand for these characters in an
+ * argument, and <code>\\x</code> followed by two hexadecimal digits for any byte.
+ *
+ *  - @c rot13: shifts each ASCII letter by 13 places in the alphabet;
+ *  - <code>translate:SRC:DST</code>: replaces each byte of @c SRC with the byte of @c DST at the
+ *    same position, like str_translate();
+ *  - <code>xor:KEY</code>: XORs the bytes with those of @c KEY, repeated as needed;
+ *  - @c upper, @c lower: changes the case of letters;
+ *  - @c ucwords: capitalizes the first letter of each word, like str_ucwords();
+ *  - @c trim: removes leading and trailing spaces;
+ *  - @c squeeze: replaces each run of spaces with one space.
+ *
+ * @returns the pipeline, or NULL if @p spec is not valid or memory could not be allocated, in
+ *		which case @p *error is set to a description of the error, and @p *error_op to the position
+ *		of the transform it is about, from 1. The pipeline must be freed with str_pipeline_free(). */
+st_str_pipeline *str_pipeline_compile(const char *spec, size_t spec_length, const st_str_pipeline_ctype *ctype,
+		const char **error, unsigned *error_op);
+
+/** Frees @p p, unless it is NULL. */
+void str_pipeline_free(st_str_pipeline *p);
+
+/** @returns the number of bytes of scratch memory that str_pipeline_run() needs for @p p. */
+size_t str_pipeline_scratch_size(const st_str_pipeline *p);
+
+/** Transforms the @p length bytes at @p src with @p p, and writes the result to @p dest, which has
+ * space for @p length bytes: no transform makes a string longer. @p scratch has
+ * <code>str_pipeline_scratch_size(p)</code> bytes. A pipeline can be used by several threads at the
+ * same time with different scratch memory.
+ *
+ * @returns the length of the result. */
+size_t str_pipeline_run(const st_str_pipeline *p, const char *src, size_t length, char *dest, char *scratch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,574 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#define read _read
+#define write _write
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "record_stream.h"
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#define RECORD_STREAM_THREADS 1
+#include <pthread.h>
+#endif
+
+#ifndef SIZE_MAX
+#define SIZE_MAX ((size_t) -1)
+#endif
+
+/* The states of a batch, which go round in this order */
+enum
+{
+	RECORD_BATCH_FREE,   /* the reader can fill it */
+	RECORD_BATCH_FILLED, /* a worker can process it */
+	RECORD_BATCH_DONE    /* the writer can write it */
+};
+
+typedef struct st_record_batch
+{
+	int state;
+	char *buf;          /* the input read for the batch, of buf_capacity bytes */
+	size_t buf_capacity;
+	const char *data;   /* the records of the batch, in buf or in the mapping of the input */
+	size_t length;
+	st_record_output out;
+	int status;         /* what the function returned */
+} st_record_batch;
+
+typedef struct st_record_stream
+{
+	int in_fd;
+	int out_fd;
+	int delim;
+	size_t batch_size;
+	record_stream_fn fn;
+	void *ctx;
+	st_record_stream_stats *stats;
+
+	/* The input if it is mapped, and the offset of the next batch in it */
+	const char *map;
+	size_t map_length;
+	size_t map_pos;
+
+	/* The start of a record that was read with the previous batch, which did not hold it */
+	char *carry;
+	size_t carry_length;
+	size_t carry_capacity;
+	uint64_t in_offset;
+	int in_done;
+
+	/* Batch n is batches[n % depth]. The batches from next_write to next_fill are in flight. */
+	st_record_batch *batches;
+	unsigned depth;
+	uint64_t next_fill;
+	uint64_t next_process;
+	uint64_t next_write;
+	int eof;            /* no batch follows next_fill */
+	int error;
+	const char *where;
+
+#ifdef RECORD_STREAM_THREADS
+	pthread_mutex_t lock;
+	pthread_cond_t filled; /* a batch was filled, or eof or error was set */
+	pthread_cond_t done;   /* a batch was processed, or eof or error was set */
+	pthread_cond_t freed;  /* a batch was written, or error was set */
+#endif
+} st_record_stream;
+
+char *record_output_reserve(st_record_output *out, size_t n)
+{
+	// The buffer is allocated even for n == 0, so that an empty record, such as a blank line,
+	// is not taken for a failed allocation.
+	if (out->capacity - out->length < n || out->data == NULL)
+	{
+		size_t capacity = (out->capacity != 0 ? out->capacity : 4096);
+		char *data;
+
+		if (n > SIZE_MAX / 2 - out->length)
+			return NULL;
+		while (capacity - out->length < n)
+			capacity *= 2;
+
+		data = (char *) realloc(out->data, capacity);
+		if (data == NULL)
+			return NULL;
+		out->data = data;
+		out->capacity = capacity;
+	}
+
+	return out->data + out->length;
+}
+
+/* Makes *buf, of *capacity bytes, hold at least `size` bytes; its contents are not kept. Returns
+   0 on success. Input buffers are page aligned, so that the kernel can copy whole pages. */
+static int record_stream_reserve(char **buf, size_t *capacity, size_t size)
+{
+	void *p;
+
+	if (size <= *capacity)
+		return 0;
+
+#ifdef _WIN32
+	p = malloc(size);
+	if (p == NULL)
+		return ENOMEM;
+#else
+	if (posix_memalign(&p, 4096, size) != 0)
+		return ENOMEM;
+#endif
+
+	free(*buf);
+	*buf = (char *) p;
+	*capacity = size;
+	return 0;
+}
+
+/* Returns the offset of the last delimiter of the bytes [begin, end) of s, or end if there is none. */
+static size_t record_stream_last_delim(const char *s, size_t begin, size_t end, int delim)
+{
+	size_t i = end;
+
+	while (i > begin)
+	{
+		if (s[--i] == (char) delim)
+			return i;
+	}
+	return end;
+}
+
+/* Reads the next batch into b. Sets *got to 0 at the end of the input. Returns 0, or an errno
+   value with *where set to what failed. */
+static int record_stream_fill(st_record_stream *s, st_record_batch *b, int *got, const char **where)
+{
+	size_t filled, searched, end;
+
+	*got = 0;
+
+	if (s->map != NULL)
+	{
+		const char *p = s->map + s->map_pos;
+		const size_t left = s->map_length - s->map_pos;
+		size_t n = left;
+
+		if (left == 0)
+			return 0;
+
+		if (left > s->batch_size)
+		{
+			const char *d = (const char *) memchr(p + s->batch_size - 1, s->delim, left - (s->batch_size - 1));
+			if (d != NULL)
+				n = (size_t) (d - p) + 1;
+		}
+
+		b->data = p;
+		b->length = n;
+		s->map_pos += n;
+		*got = 1;
+		return 0;
+	}
+
+	if (s->in_done && s->carry_length == 0)
+		return 0;
+
+	if (record_stream_reserve(&b->buf, &b->buf_capacity, s->carry_length + s->batch_size))
+	{
+		*where = "memory";
+		return ENOMEM;
+	}
+	if (s->carry_length != 0)
+		memcpy(b->buf, s->carry, s->carry_length);
+	filled = searched = s->carry_length;
+	s->carry_length = 0;
+
+	for (;;)
+	{
+		const size_t target = filled + s->batch_size;
+
+		// Read a batch, with reads that end at aligned offsets of the input.
+		while (!s->in_done && filled < target)
+		{
+			const uint64_t read_end = (s->in_offset + (target - filled) + RECORD_STREAM_READ_ALIGN - 1)
+					/ RECORD_STREAM_READ_ALIGN * RECORD_STREAM_READ_ALIGN;
+			const size_t want = (size_t) (read_end - s->in_offset);
+			long n;
+
+			if (b->buf_capacity - filled < want)
+			{
+				char *buf = NULL;
+				size_t capacity = 0;
+
+				if (record_stream_reserve(&buf, &capacity, 2 * b->buf_capacity + want))
+				{
+					*where = "memory";
+					return ENOMEM;
+				}
+				memcpy(buf, b->buf, filled);
+				free(b->buf);
+				b->buf = buf;
+				b->buf_capacity = capacity;
+			}
+
+			n = (long) read(s->in_fd, b->buf + filled, (unsigned) (want < 0x40000000 ? want : 0x40000000));
+			if (n < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				*where = "read";
+				return errno;
+			}
+			if (n == 0)
+				s->in_done = 1;
+			filled += (size_t) n;
+			s->in_offset += (uint64_t) n;
+		}
+
+		if (filled == 0)
+			return 0;
+
+		// The batch ends after its last delimiter, unless a record is longer than what was read.
+		end = record_stream_last_delim(b->buf, searched, filled, s->delim);
+		if (end != filled)
+		{
+			++end;
+			break;
+		}
+		if (s->in_done)
+			break;
+		searched = filled;
+	}
+
+	if (end < filled)
+	{
+		if (record_stream_reserve(&s->carry, &s->carry_capacity, filled - end))
+		{
+			*where = "memory";
+			return ENOMEM;
+		}
+		s->carry_length = filled - end;
+		memcpy(s->carry, b->buf + end, s->carry_length);
+	}
+
+	b->data = b->buf;
+	b->length = end;
+	*got = 1;
+	return 0;
+}
+
+static void record_stream_process(st_record_stream *s, st_record_batch *b)
+{
+	b->out.length = 0;
+	b->status = s->fn(s->ctx, b->data, b->length, &b->out);
+}
+
+/* Writes the result of b. Returns 0, or an errno value. */
+static int record_stream_write(st_record_stream *s, st_record_batch *b)
+{
+	const char *p = b->out.data;
+	size_t left = b->out.length;
+
+	while (left != 0)
+	{
+		const long n = (long) write(s->out_fd, p, (unsigned) (left < 0x40000000 ? left : 0x40000000));
+
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		p += n;
+		left -= (size_t) n;
+	}
+
+	s->stats->bytes_out += b->out.length;
+	++s->stats->batches;
+	return 0;
+}
+
+/* Fills, processes and writes the batches one after the other. */
+static void record_stream_run_serial(st_record_stream *s)
+{
+	st_record_batch *b = &s->batches[0];
+
+	for (;;)
+	{
+		int got;
+
+		s->error = record_stream_fill(s, b, &got, &s->where);
+		if (s->error != 0 || !got)
+			return;
+		s->stats->bytes_in += b->length;
+
+		record_stream_process(s, b);
+		if (b->status != 0)
+		{
+			s->error = b->status;
+			s->where = "process";
+			return;
+		}
+
+		s->error = record_stream_write(s, b);
+		if (s->error != 0)
+		{
+			s->where = "write";
+			return;
+		}
+	}
+}
+
+#ifdef RECORD_STREAM_THREADS
+
+/* Records the first error, and wakes all threads up so that they stop. Called with the lock held. */
+static void record_stream_fail(st_record_stream *s, int error, const char *where)
+{
+	if (s->error == 0)
+	{
+		s->error = error;
+		s->where = where;
+	}
+	pthread_cond_broadcast(&s->filled);
+	pthread_cond_broadcast(&s->done);
+	pthread_cond_broadcast(&s->freed);
+}
+
+static void *record_stream_worker(void *arg)
+{
+	st_record_stream *s = (st_record_stream *) arg;
+
+	pthread_mutex_lock(&s->lock);
+	for (;;)
+	{
+		st_record_batch *b;
+
+		while (s->error == 0 && s->next_process == s->next_fill && !s->eof)
+			pthread_cond_wait(&s->filled, &s->lock);
+		if (s->error != 0 || s->next_process == s->next_fill)
+			break;
+
+		b = &s->batches[s->next_process++ % s->depth];
+		pthread_mutex_unlock(&s->lock);
+		record_stream_process(s, b);
+		pthread_mutex_lock(&s->lock);
+
+		if (b->status != 0)
+			record_stream_fail(s, b->status, "process");
+		b->state = RECORD_BATCH_DONE;
+		pthread_cond_broadcast(&s->done);
+	}
+	pthread_mutex_unlock(&s->lock);
+
+	return NULL;
+}
+
+static void *record_stream_writer(void *arg)
+{
+	st_record_stream *s = (st_record_stream *) arg;
+
+	pthread_mutex_lock(&s->lock);
+	for (;;)
+	{
+		st_record_batch *b = &s->batches[s->next_write % s->depth];
+		int error;
+
+		// The batches are written in the order in which they were read.
+		while (s->error == 0 && b->state != RECORD_BATCH_DONE && !(s->eof && s->next_write == s->next_fill))
+			pthread_cond_wait(&s->done, &s->lock);
+		if (s->error != 0 || b->state != RECORD_BATCH_DONE)
+			break;
+
+		pthread_mutex_unlock(&s->lock);
+		error = record_stream_write(s, b);
+		pthread_mutex_lock(&s->lock);
+
+		if (error != 0)
+		{
+			record_stream_fail(s, error, "write");
+			break;
+		}
+		b->state = RECORD_BATCH_FREE;
+		++s->next_write;
+		pthread_cond_signal(&s->freed);
+	}
+	pthread_mutex_unlock(&s->lock);
+
+	return NULL;
+}
+
+/* Reads the batches in the calling thread while the workers process them and the writer writes
+   them. Returns 0 if the threads could not be started. */
+static int record_stream_run_threads(st_record_stream *s, unsigned threads)
+{
+	pthread_t workers[RECORD_STREAM_MAX_THREADS];
+	pthread_t writer;
+	unsigned num_workers, i;
+
+	pthread_mutex_init(&s->lock, NULL);
+	pthread_cond_init(&s->filled, NULL);
+	pthread_cond_init(&s->done, NULL);
+	pthread_cond_init(&s->freed, NULL);
+
+	for (num_workers = 0; num_workers < threads; ++num_workers)
+	{
+		if (pthread_create(&workers[num_workers], NULL, record_stream_worker, s) != 0)
+			break;
+	}
+
+	if (num_workers == 0 || pthread_create(&writer, NULL, record_stream_writer, s) != 0)
+	{
+		// Let the workers that were started see that there is nothing to do.
+		pthread_mutex_lock(&s->lock);
+		s->eof = 1;
+		pthread_cond_broadcast(&s->filled);
+		pthread_mutex_unlock(&s->lock);
+		for (i = 0; i < num_workers; ++i)
+			pthread_join(workers[i], NULL);
+		s->eof = 0;
+		return 0;
+	}
+	s->stats->threads = num_workers;
+
+	pthread_mutex_lock(&s->lock);
+	while (s->error == 0)
+	{
+		st_record_batch *b = &s->batches[s->next_fill % s->depth];
+		const char *where = NULL;
+		int error, got;
+
+		while (s->error == 0 && b->state != RECORD_BATCH_FREE)
+			pthread_cond_wait(&s->freed, &s->lock);
+		if (s->error != 0)
+			break;
+
+		pthread_mutex_unlock(&s->lock);
+		error = record_stream_fill(s, b, &got, &where);
+		pthread_mutex_lock(&s->lock);
+
+		if (error != 0)
+		{
+			record_stream_fail(s, error, where);
+			break;
+		}
+		if (!got)
+			break;
+
+		s->stats->bytes_in += b->length;
+		b->state = RECORD_BATCH_FILLED;
+		++s->next_fill;
+		pthread_cond_signal(&s->filled);
+	}
+	s->eof = 1;
+	pthread_cond_broadcast(&s->filled);
+	pthread_cond_broadcast(&s->done);
+	pthread_mutex_unlock(&s->lock);
+
+	for (i = 0; i < num_workers; ++i)
+		pthread_join(workers[i], NULL);
+	pthread_join(writer, NULL);
+
+	pthread_cond_destroy(&s->freed);
+	pthread_cond_destroy(&s->done);
+	pthread_cond_destroy(&s->filled);
+	pthread_mutex_destroy(&s->lock);
+	return 1;
+}
+
+#endif
+
+/* Maps the input if it is a regular file that is not empty. */
+static void record_stream_map(st_record_stream *s)
+{
+#ifndef _WIN32
+	struct stat st;
+	void *p;
+
+	if (fstat(s->in_fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0
+			|| (uint64_t) st.st_size > (uint64_t) SIZE_MAX)
+		return;
+
+	p = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, s->in_fd, 0);
+	if (p == MAP_FAILED)
+		return;
+#ifdef MADV_SEQUENTIAL
+	madvise(p, (size_t) st.st_size, MADV_SEQUENTIAL);
+#endif
+
+	s->map = (const char *) p;
+	s->map_length = (size_t) st.st_size;
+	s->stats->mapped = 1;
+#else
+	(void) s;
+#endif
+}
+
+int record_stream_run(int in_fd, int out_fd, const st_record_stream_options *options,
+		record_stream_fn fn, void *ctx, st_record_stream_stats *stats, const char **error)
+{
+	st_record_stream s;
+	unsigned threads = (options->threads < RECORD_STREAM_MAX_THREADS ? options->threads : RECORD_STREAM_MAX_THREADS);
+	unsigned i;
+	int ran = 0;
+
+	memset(stats, 0, sizeof *stats);
+	memset(&s, 0, sizeof s);
+	s.in_fd = in_fd;
+	s.out_fd = out_fd;
+	s.delim = options->delim;
+	s.fn = fn;
+	s.ctx = ctx;
+	s.stats = stats;
+
+	s.batch_size = (options->batch_size != 0 ? options->batch_size : RECORD_STREAM_BATCH_SIZE);
+	s.batch_size = (s.batch_size + RECORD_STREAM_READ_ALIGN - 1) / RECORD_STREAM_READ_ALIGN * RECORD_STREAM_READ_ALIGN;
+
+#ifndef RECORD_STREAM_THREADS
+	threads = 0;
+#endif
+	s.depth = (options->depth != 0 ? options->depth : 2 * threads + 2);
+	if (s.depth < 2)
+		s.depth = 2;
+
+	s.batches = (st_record_batch *) calloc(s.depth, sizeof (st_record_batch));
+	if (s.batches == NULL)
+	{
+		*error = "memory";
+		return ENOMEM;
+	}
+
+	if (!options->no_mmap)
+		record_stream_map(&s);
+
+#ifdef RECORD_STREAM_THREADS
+	if (threads != 0)
+		ran = record_stream_run_threads(&s, threads);
+#endif
+	if (!ran)
+		record_stream_run_serial(&s);
+
+#ifndef _WIN32
+	if (s.map != NULL)
+		munmap((void *) s.map, s.map_length);
+#endif
+	for (i = 0; i < s.depth; ++i)
+	{
+		free(s.batches[i].buf);
+		free(s.batches[i].out.data);
+	}
+	free(s.batches);
+	free(s.carry);
+
+	*error = s.where;
+	return s.error;
+}
@@ -0,0 +1,85 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	Runs a function over the delimited records of a file, such as the lines of a dump, with
+	several threads. The calling thread reads the input in batches of whole records, which are
+	memory mapped when the input is a regular file; worker threads process the batches, and a
+	writer thread writes their results in the order of the input. The number of batches in flight
+	is bounded, and so is the memory used however large the input is.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_RECORD_STREAM_H
+#define LIB_MYSQLUDF_STR_RECORD_STREAM_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The default number of bytes of input of a batch. Batches end after the first delimiter that
+ * follows, so that they hold whole records. */
+#define RECORD_STREAM_BATCH_SIZE (1024 * 1024)
+
+/** The input is read in multiples of this size, at offsets of the file that are multiples of it
+ * too. */
+#define RECORD_STREAM_READ_ALIGN (64 * 1024)
+
+/** The largest number of worker threads. */
+#define RECORD_STREAM_MAX_THREADS 64
+
+/** The result of a batch, to which the function appends. */
+typedef struct st_record_output
+{
+	char *data;
+	size_t length;
+	size_t capacity;
+} st_record_output;
+
+/** @returns a pointer to space for @p n bytes at the end of @p out, which are appended by adding
+ *		the number of bytes written to @p out->length, or NULL if memory could not be allocated. */
+char *record_output_reserve(st_record_output *out, size_t n);
+
+/** Processes the @p length bytes of records at @p data, each of which is followed by the
+ * delimiter except maybe the last record of the input, and appends the result to @p out. Several
+ * threads call it at the same time.
+ *
+ * @returns 0, or an @c errno value to stop the stream. */
+typedef int (*record_stream_fn)(void *ctx, const char *data, size_t length, st_record_output *out);
+
+typedef struct st_record_stream_options
+{
+	int delim;          /* the byte that ends records */
+	size_t batch_size;  /* the number of bytes of input of a batch, or 0 for the default */
+	unsigned threads;   /* the number of worker threads, up to RECORD_STREAM_MAX_THREADS; 0
+	                       processes the batches in the calling thread */
+	unsigned depth;     /* the number of batches in flight, or 0 for twice the number of threads,
+	                       plus 2 */
+	int no_mmap;        /* non-zero to read the input even if it could be mapped */
+} st_record_stream_options;
+
+typedef struct st_record_stream_stats
+{
+	uint64_t bytes_in;
+	uint64_t bytes_out;
+	uint64_t batches;
+	unsigned threads; /* the number of worker threads that were started */
+	int mapped;       /* non-zero if the input was memory mapped */
+} st_record_stream_stats;
+
+/** Runs @p fn with @p ctx over the records read from the file descriptor @p in_fd until its end,
+ * and writes the results to @p out_fd.
+ *
+ * @returns 0, or an @c errno value with @p *error set to what failed: "read", "write", "memory"
+ *		or "process" if @p fn returned it. @p stats is filled in either way. */
+int record_stream_run(int in_fd, int out_fd, const st_record_stream_options *options,
+		record_stream_fn fn, void *ctx, st_record_stream_stats *stats, const char **error);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
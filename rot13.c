@@ -0,0 +1,56 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include "kernel_isa.h"
+#include "kernel_tuning.h"
+#include "string_utils.h"
+
+#define ROT_OFFSET 13
+
+void rot13_scalar(char *__restrict dest, const char *__restrict src, size_t length)
+{
+	size_t i;
+	int cod_ascii;
+
+	for (i = 0; i < length; i++)
+	{
+		// cod_ascii is an integer containing the ascii code of a single character
+		cod_ascii = src[i];
+
+		if(cod_ascii >= 97 && cod_ascii <= 122)	// lower case character
+		{
+			cod_ascii += ROT_OFFSET;
+
+			if(cod_ascii>122)
+				cod_ascii = 96 + (cod_ascii-122);
+		}
+		else if(cod_ascii >= 65 && cod_ascii <= 90)	// upper case character
+		{
+			cod_ascii += ROT_OFFSET;
+
+			if(cod_ascii>90)
+				cod_ascii = 64 + (cod_ascii-90);
+		}
+
+		dest[i] = cod_ascii;
+	}
+}
+
+void rot13_vector(char *__restrict dest, const char *__restrict src, size_t length)
+{
+	kernel_isa()->transforms[KERNEL_TRANSFORM_rot13]((unsigned char *) dest, (const unsigned char *) src, NULL, length);
+}
+
+void rot13(char *__restrict dest, const char *__restrict src, size_t length)
+{
+	const st_kernel_isa *isa = kernel_isa();
+
+	// the calibrated length, but not below that of the narrowest vectors of the instruction set
+	if (length >= STR_TUNING_ROT13_MIN_LENGTH && length >= isa->min_width)
+		isa->transforms[KERNEL_TRANSFORM_rot13]((unsigned char *) dest, (const unsigned char *) src, NULL, length);
+	else
+		rot13_scalar(dest, src, length);
+}
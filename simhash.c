@@ -0,0 +1,215 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bit_utils.h"
+#include "simhash.h"
+#include "str_hash.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && ((defined(__GNUC__) && __GNUC__ >= 8) || (defined(__clang__) && __clang_major__ >= 7))
+#define SIMHASH_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+#define SWAR_ONES UINT64_C(0x0101010101010101)
+
+/* Spreads the 8 bits of x over the 8 bytes of the result: byte i is bit i of x. */
+STR_INLINE uint64_t simhash_spread_bits(uint64_t x)
+{
+	return ((((x * SWAR_ONES) & UINT64_C(0x8040201008040201)) + UINT64_C(0x00406070787C7E7F)) >> 7) & SWAR_ONES;
+}
+
+uint64_t simhash64(const char *s, size_t length, size_t shingle_size)
+{
+	uint32_t counts[64];
+	uint64_t acc[8]; /* byte i of acc[j] counts bit 8*j + i of the hashes since the last flush */
+	size_t shingles, i, pending = 0;
+	uint64_t fingerprint = 0;
+	int j, b;
+
+	if (length == 0)
+		return 0;
+
+	if (shingle_size > length)
+		shingle_size = length;
+	shingles = length - shingle_size + 1;
+
+	memset(counts, 0, sizeof counts);
+	memset(acc, 0, sizeof acc);
+
+	for (i = 0; i < shingles; ++i)
+	{
+		const uint64_t h = str_hash64(s + i, shingle_size, 0);
+
+		// Eight byte-wide adds per hash, which the compiler can also turn into vector adds.
+		for (j = 0; j < 8; ++j)
+			acc[j] += simhash_spread_bits((h >> (8 * j)) & 0xFF);
+
+		if (++pending == 255 || i + 1 == shingles)
+		{
+			for (j = 0; j < 8; ++j)
+			{
+				for (b = 0; b < 8; ++b)
+					counts[8 * j + b] += (uint32_t) ((acc[j] >> (8 * b)) & 0xFF);
+				acc[j] = 0;
+			}
+			pending = 0;
+		}
+	}
+
+	for (b = 0; b < 64; ++b)
+	{
+		if (2 * (uint64_t) counts[b] > (uint64_t) shingles)
+			fingerprint |= UINT64_C(1) << b;
+	}
+
+	return fingerprint;
+}
+
+STR_INLINE uint64_t hamming_load64(const unsigned char *p)
+{
+	uint64_t v;
+	memcpy(&v, p, sizeof v);
+	return v;
+}
+
+typedef uint64_t (*hamming_xor_fn)(const unsigned char *a, const unsigned char *b, size_t length);
+
+/* Counts the bits that differ between the length bytes at a and b, 8 bytes at a time. */
+static uint64_t hamming_xor_generic(const unsigned char *a, const unsigned char *b, size_t length)
+{
+	uint64_t total = 0;
+	size_t i = 0;
+
+	for (; i + 8 <= length; i += 8)
+		total += bit_popcount64(hamming_load64(a + i) ^ hamming_load64(b + i));
+	for (; i < length; ++i)
+		total += bit_popcount64((uint64_t) (a[i] ^ b[i]));
+
+	return total;
+}
+
+#ifdef SIMHASH_X86_DISPATCH
+__attribute__((target("popcnt")))
+static uint64_t hamming_xor_popcnt(const unsigned char *a, const unsigned char *b, size_t length)
+{
+	uint64_t total = 0;
+	size_t i = 0;
+
+	for (; i + 8 <= length; i += 8)
+		total += (uint64_t) __builtin_popcountll(hamming_load64(a + i) ^ hamming_load64(b + i));
+	for (; i < length; ++i)
+		total += (uint64_t) __builtin_popcount((unsigned) (a[i] ^ b[i]));
+
+	return total;
+}
+
+__attribute__((target("popcnt,avx512f,avx512vpopcntdq")))
+static uint64_t hamming_xor_avx512(const unsigned char *a, const unsigned char *b, size_t length)
+{
+	__m512i sums = _mm512_setzero_si512();
+	uint64_t total = 0;
+	size_t i = 0;
+
+	for (; i + 64 <= length; i += 64)
+	{
+		const __m512i x = _mm512_xor_si512(_mm512_loadu_si512((const void *) (a + i)), _mm512_loadu_si512((const void *) (b + i)));
+		sums = _mm512_add_epi64(sums, _mm512_popcnt_epi64(x));
+	}
+	total = (uint64_t) _mm512_reduce_add_epi64(sums);
+
+	for (; i + 8 <= length; i += 8)
+		total += (uint64_t) __builtin_popcountll(hamming_load64(a + i) ^ hamming_load64(b + i));
+	for (; i < length; ++i)
+		total += (uint64_t) __builtin_popcount((unsigned) (a[i] ^ b[i]));
+
+	return total;
+}
+#endif
+
+typedef struct st_hamming_impl
+{
+	hamming_xor_fn fn;
+	const char *name;
+} st_hamming_impl;
+
+static const st_hamming_impl hamming_impl_generic = { hamming_xor_generic, "generic" };
+#ifdef SIMHASH_X86_DISPATCH
+static const st_hamming_impl hamming_impl_popcnt = { hamming_xor_popcnt, "popcnt" };
+static const st_hamming_impl hamming_impl_avx512 = { hamming_xor_avx512, "avx512vpopcntdq" };
+#endif
+
+/* Chooses the implementation for this CPU. */
+static const st_hamming_impl *hamming_select(void)
+{
+#ifdef SIMHASH_X86_DISPATCH
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512vpopcntdq"))
+		return &hamming_impl_avx512;
+	if (__builtin_cpu_supports("popcnt"))
+		return &hamming_impl_popcnt;
+#endif
+	return &hamming_impl_generic;
+}
+
+/* The choice is made by the first call; threads that make it at the same time make the same one. */
+static const st_hamming_impl *hamming_impl_chosen;
+
+static const st_hamming_impl *hamming_impl(void)
+{
+	const st_hamming_impl *impl;
+
+#ifdef _MSC_VER
+	// aligned pointers are read and written atomically, and volatile ones are not reordered on x86
+	impl = *(const st_hamming_impl *volatile *) &hamming_impl_chosen;
+	if (impl == NULL)
+	{
+		impl = hamming_select();
+		*(const st_hamming_impl *volatile *) &hamming_impl_chosen = impl;
+	}
+#else
+	impl = __atomic_load_n(&hamming_impl_chosen, __ATOMIC_ACQUIRE);
+	if (impl == NULL)
+	{
+		impl = hamming_select();
+		__atomic_store_n(&hamming_impl_chosen, impl, __ATOMIC_RELEASE);
+	}
+#endif
+
+	return impl;
+}
+
+uint64_t hamming_distance(const char *a, size_t a_length, const char *b, size_t b_length)
+{
+	static const unsigned char zeros[64] = { 0 };
+	const hamming_xor_fn fn = hamming_impl()->fn;
+	const unsigned char *longer;
+	size_t common, rest;
+	uint64_t total;
+
+	common = (a_length < b_length ? a_length : b_length);
+	total = fn((const unsigned char *) a, (const unsigned char *) b, common);
+
+	// The tail of the longer string is compared against NUL bytes.
+	longer = (const unsigned char *) (a_length < b_length ? b : a) + common;
+	rest = (a_length < b_length ? b_length : a_length) - common;
+	while (rest > 0)
+	{
+		const size_t n = (rest < sizeof zeros ? rest : sizeof zeros);
+		total += fn(longer, zeros, n);
+		longer += n;
+		rest -= n;
+	}
+
+	return total;
+}
+
+const char *hamming_distance_impl_name(void)
+{
+	return hamming_impl()->name;
+}
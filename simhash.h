@@ -0,0 +1,45 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_SIMHASH_H
+#define LIB_MYSQLUDF_STR_SIMHASH_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The largest shingle size accepted by simhash64(). */
+#define SIMHASH_MAX_SHINGLE_SIZE 64
+
+/** Computes the 64-bit SimHash fingerprint of the @p length bytes at @p s.
+ *
+ * Every run of @p shingle_size consecutive bytes (or the whole string, if it is shorter) is
+ * hashed with str_hash64(). Bit @c i of the fingerprint is set if bit @c i is set in more than
+ * half of the shingle hashes. Similar strings have fingerprints with a small Hamming distance.
+ *
+ * @p shingle_size must be in <code>[1, SIMHASH_MAX_SHINGLE_SIZE]</code>.
+ *
+ * @returns the fingerprint; 0 if @p length is 0. */
+uint64_t simhash64(const char *s, size_t length, size_t shingle_size);
+
+/** Computes the number of bits that differ between the @p a_length bytes at @p a and the
+ * @p b_length bytes at @p b, the shorter string being padded with NUL bytes.
+ *
+ * On x86 the implementation is chosen once at run time, using AVX-512 VPOPCNTQ or POPCNT when
+ * the CPU supports them. */
+uint64_t hamming_distance(const char *a, size_t a_length, const char *b, size_t b_length);
+
+/** @returns the name of the implementation that hamming_distance() uses on this CPU. */
+const char *hamming_distance_impl_name(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
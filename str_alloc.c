@@ -0,0 +1,307 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "str_alloc.h"
+
+#ifndef SIZE_MAX
+#define SIZE_MAX ((size_t) -1)
+#endif
+
+/* Counters that are updated by all threads without a lock, since they are updated by every
+   allocation */
+#ifdef _MSC_VER
+#include <windows.h>
+#define STR_THREAD_LOCAL __declspec(thread)
+typedef volatile LONG64 str_counter;
+
+static uint64_t str_counter_load(str_counter *c)
+{
+	return (uint64_t) InterlockedCompareExchange64(c, 0, 0);
+}
+
+static uint64_t str_counter_add(str_counter *c, uint64_t n)
+{
+	return (uint64_t) InterlockedExchangeAdd64(c, (LONG64) n) + n;
+}
+
+static int str_counter_cas(str_counter *c, uint64_t expected, uint64_t desired)
+{
+	return InterlockedCompareExchange64(c, (LONG64) desired, (LONG64) expected) == (LONG64) expected;
+}
+#else
+#define STR_THREAD_LOCAL __thread
+typedef uint64_t str_counter;
+
+static uint64_t str_counter_load(str_counter *c)
+{
+	return __atomic_load_n(c, __ATOMIC_RELAXED);
+}
+
+static uint64_t str_counter_add(str_counter *c, uint64_t n)
+{
+	return __atomic_add_fetch(c, n, __ATOMIC_RELAXED);
+}
+
+static int str_counter_cas(str_counter *c, uint64_t expected, uint64_t desired)
+{
+	return __atomic_compare_exchange_n(c, &expected, desired, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+#endif
+
+/* The header in front of each allocation. Its size keeps the memory after it aligned like that of
+   malloc(). */
+#define STR_ALLOC_HEADER_SIZE 16
+
+typedef struct st_str_alloc_header
+{
+	size_t size;
+	uint64_t scope; /* the id of the statement that it is charged to, or 0 */
+} st_str_alloc_header;
+
+static str_counter str_memory_current;
+static str_counter str_memory_peak;
+static str_counter str_memory_refused;
+static str_counter str_memory_statement_peak;
+static str_counter str_memory_next_scope;
+
+/* The limit plus 1, or 0 until it is read from the environment */
+static str_counter str_memory_limit_plus_1;
+
+static STR_THREAD_LOCAL st_str_memory_scope *str_memory_scope;
+static STR_THREAD_LOCAL int str_memory_refused_here;
+
+static void str_counter_raise(str_counter *c, uint64_t value)
+{
+	uint64_t old = str_counter_load(c);
+
+	while (value > old && !str_counter_cas(c, old, value))
+		old = str_counter_load(c);
+}
+
+static size_t str_memory_env_limit(void)
+{
+	const char *s = getenv("LIB_MYSQLUDF_STR_MEMORY_LIMIT");
+	char *end;
+	unsigned long long n;
+
+	if (s == NULL || *s == '\0')
+		return 0;
+
+	n = strtoull(s, &end, 10);
+	if (*end != '\0' || n >= SIZE_MAX)
+		return 0;
+
+	return (size_t) n;
+}
+
+size_t str_memory_limit(void)
+{
+	uint64_t limit_plus_1 = str_counter_load(&str_memory_limit_plus_1);
+
+	if (limit_plus_1 == 0)
+	{
+		str_counter_cas(&str_memory_limit_plus_1, 0, (uint64_t) str_memory_env_limit() + 1);
+		limit_plus_1 = str_counter_load(&str_memory_limit_plus_1);
+	}
+
+	return (size_t) (limit_plus_1 - 1);
+}
+
+void str_memory_set_limit(size_t limit)
+{
+	uint64_t old = str_counter_load(&str_memory_limit_plus_1);
+
+	if (limit == SIZE_MAX)
+		limit = 0;
+	while (!str_counter_cas(&str_memory_limit_plus_1, old, (uint64_t) limit + 1))
+		old = str_counter_load(&str_memory_limit_plus_1);
+}
+
+int str_memory_charge(size_t size)
+{
+	const uint64_t limit = str_memory_limit();
+	const uint64_t current = str_counter_add(&str_memory_current, size);
+
+	// Charged first, so that threads allocating at the same time cannot all pass the limit.
+	if (limit != 0 && current > limit)
+	{
+		str_counter_add(&str_memory_current, (uint64_t) 0 - size);
+		str_counter_add(&str_memory_refused, 1);
+		str_memory_refused_here = 1;
+		return 1;
+	}
+
+	str_counter_raise(&str_memory_peak, current);
+	str_memory_refused_here = 0;
+	return 0;
+}
+
+void str_memory_discharge(size_t size)
+{
+	str_counter_add(&str_memory_current, (uint64_t) 0 - size);
+}
+
+int str_memory_over_limit(void)
+{
+	return str_memory_refused_here;
+}
+
+/* Charges `size` more bytes to the statement of h, if it is the one of the calling thread. */
+static void str_scope_grow(const st_str_alloc_header *h, size_t size)
+{
+	st_str_memory_scope *scope = str_memory_scope;
+
+	if (scope != NULL && scope->id == h->scope)
+	{
+		scope->current += size;
+		if (scope->current > scope->peak)
+			scope->peak = scope->current;
+	}
+}
+
+static void str_scope_shrink(const st_str_alloc_header *h, size_t size)
+{
+	st_str_memory_scope *scope = str_memory_scope;
+
+	if (scope != NULL && scope->id == h->scope)
+		scope->current -= (size < scope->current ? size : scope->current);
+}
+
+/* Returns the memory after the header h of a new allocation of `size` bytes. */
+static void *str_alloc_finish(st_str_alloc_header *h, size_t size)
+{
+	h->size = size;
+	h->scope = (str_memory_scope != NULL ? str_memory_scope->id : 0);
+	str_scope_grow(h, size);
+	return (char *) h + STR_ALLOC_HEADER_SIZE;
+}
+
+void *str_malloc(size_t size)
+{
+	st_str_alloc_header *h;
+
+	// A failure of this allocation is then not taken for a refusal of an earlier one.
+	str_memory_refused_here = 0;
+	if (size > SIZE_MAX - STR_ALLOC_HEADER_SIZE || str_memory_charge(size) != 0)
+		return NULL;
+
+	h = (st_str_alloc_header *) malloc(STR_ALLOC_HEADER_SIZE + size);
+	if (h == NULL)
+	{
+		str_memory_discharge(size);
+		return NULL;
+	}
+
+	return str_alloc_finish(h, size);
+}
+
+void *str_calloc(size_t count, size_t size)
+{
+	st_str_alloc_header *h;
+
+	str_memory_refused_here = 0;
+	if (size != 0 && count > (SIZE_MAX - STR_ALLOC_HEADER_SIZE) / size)
+		return NULL;
+	size *= count;
+	if (str_memory_charge(size) != 0)
+		return NULL;
+
+	// calloc() rather than memset(), so that large blocks are fresh pages that are already zero.
+	h = (st_str_alloc_header *) calloc(1, STR_ALLOC_HEADER_SIZE + size);
+	if (h == NULL)
+	{
+		str_memory_discharge(size);
+		return NULL;
+	}
+
+	return str_alloc_finish(h, size);
+}
+
+void *str_realloc(void *p, size_t size)
+{
+	st_str_alloc_header *h, *moved;
+	size_t old_size;
+
+	if (p == NULL)
+		return str_malloc(size);
+
+	str_memory_refused_here = 0;
+	h = (st_str_alloc_header *) ((char *) p - STR_ALLOC_HEADER_SIZE);
+	old_size = h->size;
+	if (size > SIZE_MAX - STR_ALLOC_HEADER_SIZE)
+		return NULL;
+	if (size > old_size && str_memory_charge(size - old_size) != 0)
+		return NULL;
+
+	moved = (st_str_alloc_header *) realloc(h, STR_ALLOC_HEADER_SIZE + size);
+	if (moved == NULL)
+	{
+		if (size > old_size)
+			str_memory_discharge(size - old_size);
+		return NULL;
+	}
+
+	moved->size = size;
+	if (size > old_size)
+		str_scope_grow(moved, size - old_size);
+	else
+	{
+		str_memory_discharge(old_size - size);
+		str_scope_shrink(moved, old_size - size);
+	}
+
+	return (char *) moved + STR_ALLOC_HEADER_SIZE;
+}
+
+void str_free(void *p)
+{
+	st_str_alloc_header *h;
+
+	if (p == NULL)
+		return;
+
+	h = (st_str_alloc_header *) ((char *) p - STR_ALLOC_HEADER_SIZE);
+	str_memory_discharge(h->size);
+	str_scope_shrink(h, h->size);
+	free(h);
+}
+
+void str_memory_scope_init(st_str_memory_scope *scope)
+{
+	scope->id = str_counter_add(&str_memory_next_scope, 1);
+	scope->current = 0;
+	scope->peak = 0;
+}
+
+void str_memory_scope_end(st_str_memory_scope *scope)
+{
+	str_counter_raise(&str_memory_statement_peak, scope->peak);
+}
+
+st_str_memory_scope *str_memory_enter(st_str_memory_scope *scope)
+{
+	st_str_memory_scope *previous = str_memory_scope;
+
+	str_memory_scope = scope;
+	return previous;
+}
+
+void str_memory_leave(st_str_memory_scope *previous)
+{
+	str_memory_scope = previous;
+}
+
+void str_memory_get_stats(st_str_memory_stats *stats)
+{
+	stats->current = str_counter_load(&str_memory_current);
+	stats->peak = str_counter_load(&str_memory_peak);
+	stats->limit = str_memory_limit();
+	stats->refused = str_counter_load(&str_memory_refused);
+	stats->statement_peak = str_counter_load(&str_memory_statement_peak);
+}
@@ -0,0 +1,96 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The allocator of the library, which counts the bytes that it holds, in the whole process and in
+	each statement, and refuses allocations that would take the process over a limit, so that
+	statements over large values fail with an error instead of taking the server out of memory.
+
+	Memory is charged to the statement whose scope is entered in the calling thread, if any. Memory
+	that outlives the statement, such as the entries of process-wide caches, is allocated outside of
+	any scope, with str_memory_enter(NULL).
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_STR_ALLOC_H
+#define LIB_MYSQLUDF_STR_STR_ALLOC_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Like malloc(), calloc() and realloc(), but the memory is counted, and NULL is also returned if
+ * it would take the process over the limit. The memory must be freed with str_free(). */
+void *str_malloc(size_t size);
+void *str_calloc(size_t count, size_t size);
+void *str_realloc(void *p, size_t size);
+
+/** Frees @p p, which was allocated by str_malloc(), str_calloc() or str_realloc(), unless it is
+ * NULL. */
+void str_free(void *p);
+
+/** Counts @p size bytes that were obtained otherwise, such as a memory mapping.
+ *
+ * @returns 0, or non-zero if they would take the process over the limit, in which case they are
+ *		not counted and must not be obtained. */
+int str_memory_charge(size_t size);
+
+/** Stops counting @p size bytes counted by str_memory_charge(). */
+void str_memory_discharge(size_t size);
+
+/** @returns non-zero if the last allocation that failed in the calling thread was refused because
+ *		of the limit, rather than by the system. */
+int str_memory_over_limit(void);
+
+/** @returns the largest number of bytes that the process may hold, or 0 for no limit. It is read
+ *		from the environment variable @c LIB_MYSQLUDF_STR_MEMORY_LIMIT of the server the first time,
+ *		until it is changed by str_memory_set_limit(). */
+size_t str_memory_limit(void);
+
+/** Sets the limit to @p limit bytes, or removes it if @p limit is 0. Memory that is already held
+ * is kept, even if it is over the new limit. */
+void str_memory_set_limit(size_t limit);
+
+/** The memory of a statement. */
+typedef struct st_str_memory_scope
+{
+	uint64_t id;
+	size_t current;
+	size_t peak;
+} st_str_memory_scope;
+
+/** Initializes @p scope for a new statement. */
+void str_memory_scope_init(st_str_memory_scope *scope);
+
+/** Ends @p scope, whose peak is then taken into the statement peak of str_memory_get_stats(). */
+void str_memory_scope_end(st_str_memory_scope *scope);
+
+/** Charges the memory that the calling thread allocates to @p scope, or to no statement if it is
+ * NULL, until str_memory_leave().
+ *
+ * @returns the scope that was entered before, to be passed to str_memory_leave(). */
+st_str_memory_scope *str_memory_enter(st_str_memory_scope *scope);
+
+/** Enters @p previous again. */
+void str_memory_leave(st_str_memory_scope *previous);
+
+typedef struct st_str_memory_stats
+{
+	uint64_t current;        /* the bytes held by the process */
+	uint64_t peak;           /* the most bytes held at once */
+	uint64_t limit;          /* see str_memory_limit() */
+	uint64_t refused;        /* the allocations refused because of the limit */
+	uint64_t statement_peak; /* the most bytes held at once by an ended statement */
+} st_str_memory_stats;
+
+/** Stores the process-wide counters in @p stats. */
+void str_memory_get_stats(st_str_memory_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
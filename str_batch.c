@@ -0,0 +1,371 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simhash.h"
+#include "str_batch.h"
+#include "string_utils.h"
+
+#if STR_BATCH_NUMTOWORDS_MAX_LENGTH != NUMTOWORDS_MAX_LENGTH
+#error "STR_BATCH_NUMTOWORDS_MAX_LENGTH must be NUMTOWORDS_MAX_LENGTH"
+#endif
+
+unsigned str_batch_abi_version(void)
+{
+	return STR_BATCH_ABI_VERSION;
+}
+
+void str_column_buffer_init(st_str_column_buffer *out)
+{
+	memset(out, 0, sizeof *out);
+}
+
+void str_column_buffer_free(st_str_column_buffer *out)
+{
+	if (out->allocated)
+	{
+		free(out->offsets);
+		free(out->data);
+		free(out->validity);
+	}
+	str_column_buffer_init(out);
+}
+
+/* Whether the buffers of out are the library's to allocate. */
+static int str_batch_owns(const st_str_column_buffer *out)
+{
+	return out->offsets == NULL || out->allocated;
+}
+
+static int str_batch_is_valid(const uint8_t *validity, size_t j)
+{
+	return validity == NULL || ((validity[j >> 3] >> (j & 7)) & 1);
+}
+
+/* Copies the `length` bits of src from bit `offset` to dest from bit 0, or sets them if src is
+   NULL. */
+static void str_batch_copy_validity(uint8_t *dest, const uint8_t *src, size_t offset, size_t length)
+{
+	const size_t n = (length + 7) / 8;
+	unsigned shift;
+	size_t last, i;
+
+	if (dest == NULL || length == 0)
+		return;
+
+	if (src == NULL)
+	{
+		memset(dest, 0xFF, n);
+		return;
+	}
+
+	src += offset / 8;
+	shift = (unsigned) (offset % 8);
+	if (shift == 0)
+	{
+		memcpy(dest, src, n);
+		return;
+	}
+
+	/* the last byte of src that holds bits of the column */
+	last = (shift + length - 1) / 8;
+	for (i = 0; i < n; ++i)
+	{
+		dest[i] = (uint8_t) (src[i] >> shift);
+		if (i + 1 <= last)
+			dest[i] |= (uint8_t) (src[i + 1] << (8 - shift));
+	}
+}
+
+/* Grows the data of out, which the library owns, to at least `size` bytes. */
+static int str_batch_reserve(st_str_column_buffer *out, size_t size)
+{
+	size_t capacity = (out->capacity != 0 ? out->capacity : 64);
+	char *data;
+
+	if (size <= out->capacity)
+		return 0;
+
+	while (capacity < size)
+		capacity *= 2;
+	data = (char *) realloc(out->data, capacity);
+	if (data == NULL)
+		return ENOMEM;
+	out->data = data;
+	out->capacity = capacity;
+	return 0;
+}
+
+/* Prepares out for `length` values that are NULL where those of the column with the validity
+   `validity` from `offset` are, and whose results take `size` bytes of data. */
+static int str_batch_begin(st_str_column_buffer *out, size_t length, const uint8_t *validity, size_t offset,
+		size_t size)
+{
+	if (size > INT32_MAX)
+		return EOVERFLOW;
+
+	if (str_batch_owns(out))
+	{
+		int32_t *offsets;
+
+		if (length >= ((size_t) -1) / sizeof (int32_t))
+			return ENOMEM;
+		offsets = (int32_t *) realloc(out->offsets, (length + 1) * sizeof (int32_t));
+		if (offsets == NULL)
+			return ENOMEM;
+		out->offsets = offsets;
+		out->allocated = 1;
+
+		if (str_batch_reserve(out, size != 0 ? size : 1) != 0)
+			return ENOMEM;
+
+		if (validity != NULL && length != 0)
+		{
+			uint8_t *bits = (uint8_t *) realloc(out->validity, (length + 7) / 8);
+
+			if (bits == NULL)
+				return ENOMEM;
+			out->validity = bits;
+		}
+		else
+		{
+			free(out->validity);
+			out->validity = NULL;
+		}
+	}
+	else if (validity != NULL && length != 0 && out->validity == NULL)
+		return EINVAL;
+	else if (out->capacity < size)
+	{
+		out->size = size;
+		return ENOBUFS;
+	}
+
+	str_batch_copy_validity(out->validity, validity, offset, length);
+	return 0;
+}
+
+/* Maps the `length` bytes at src to dest, with the table at arg if there is one. */
+typedef void (*str_batch_map_fn)(char *dest, const char *src, size_t length, const unsigned char *arg);
+
+static void str_batch_rot13_bytes(char *dest, const char *src, size_t length, const unsigned char *arg)
+{
+	(void) arg;
+	rot13(dest, src, length);
+}
+
+static void str_batch_byte_map_bytes(char *dest, const char *src, size_t length, const unsigned char *arg)
+{
+	byte_map(dest, arg, src, length);
+}
+
+/* Applies a function that maps each byte to a byte to the values of in. The data of each run of
+   values that are not NULL is mapped at once, so that of a column without NULL values is mapped
+   in a single call, whatever the lengths of the values; NULL values are empty. */
+static int str_batch_map(const st_str_column *in, st_str_column_buffer *out, str_batch_map_fn fn,
+		const unsigned char *arg)
+{
+	const int32_t *offsets = in->offsets + in->offset;
+	size_t size = (size_t) (offsets[in->length] - offsets[0]), i, run;
+	int error;
+
+	if (in->validity == NULL)
+	{
+		error = str_batch_begin(out, in->length, NULL, in->offset, size);
+		if (error != 0)
+			return error;
+
+		for (i = 0; i <= in->length; ++i)
+			out->offsets[i] = offsets[i] - offsets[0];
+		fn(out->data, in->data + offsets[0], size, arg);
+		out->size = size;
+		return 0;
+	}
+
+	for (i = 0; i < in->length; ++i)
+	{
+		if (!str_batch_is_valid(in->validity, in->offset + i))
+			size -= (size_t) (offsets[i + 1] - offsets[i]);
+	}
+
+	error = str_batch_begin(out, in->length, in->validity, in->offset, size);
+	if (error != 0)
+		return error;
+
+	size = 0;
+	for (i = 0; i < in->length; i = run)
+	{
+		out->offsets[i] = (int32_t) size;
+		if (!str_batch_is_valid(in->validity, in->offset + i))
+		{
+			run = i + 1;
+			continue;
+		}
+
+		for (run = i + 1; run < in->length && str_batch_is_valid(in->validity, in->offset + run); ++run)
+			out->offsets[run] = (int32_t) (size + (size_t) (offsets[run] - offsets[i]));
+		fn(out->data + size, in->data + offsets[i], (size_t) (offsets[run] - offsets[i]), arg);
+		size += (size_t) (offsets[run] - offsets[i]);
+	}
+	out->offsets[in->length] = (int32_t) size;
+	out->size = size;
+	return 0;
+}
+
+int str_batch_rot13(const st_str_column *in, st_str_column_buffer *out)
+{
+	return str_batch_map(in, out, str_batch_rot13_bytes, NULL);
+}
+
+int str_batch_translate(const st_str_column *in, const char *src, const char *dst, size_t length,
+		st_str_column_buffer *out)
+{
+	unsigned char table[256];
+
+	byte_map_fill(table, src, dst, length);
+	return str_batch_map(in, out, str_batch_byte_map_bytes, table);
+}
+
+int str_batch_xor(const st_str_column *in, const char *key, size_t key_length, st_str_column_buffer *out)
+{
+	const int32_t *offsets = in->offsets + in->offset;
+	size_t size = 0, i;
+	int error;
+
+	for (i = 0; i < in->length; ++i)
+	{
+		if (str_batch_is_valid(in->validity, in->offset + i))
+		{
+			const size_t length = (size_t) (offsets[i + 1] - offsets[i]);
+
+			size += (length > key_length ? length : key_length);
+			if (size > INT32_MAX)
+				return EOVERFLOW;
+		}
+	}
+
+	error = str_batch_begin(out, in->length, in->validity, in->offset, size);
+	if (error != 0)
+		return error;
+
+	size = 0;
+	for (i = 0; i < in->length; ++i)
+	{
+		out->offsets[i] = (int32_t) size;
+		if (str_batch_is_valid(in->validity, in->offset + i))
+		{
+			const char *value = in->data + offsets[i];
+			const size_t length = (size_t) (offsets[i + 1] - offsets[i]);
+
+			if (length >= key_length)
+			{
+				xor_bytes(out->data + size, value, length, key, key_length);
+				size += length;
+			}
+			else
+			{
+				xor_bytes(out->data + size, key, key_length, value, length);
+				size += key_length;
+			}
+		}
+	}
+	out->offsets[in->length] = (int32_t) size;
+	out->size = size;
+	return 0;
+}
+
+int str_batch_numtowords(const st_int64_column *in, st_str_column_buffer *out)
+{
+	char words[STR_BATCH_NUMTOWORDS_MAX_LENGTH];
+	const int owns = str_batch_owns(out);
+	size_t size = 0, i;
+	int error;
+
+	/* the results are mostly much shorter than STR_BATCH_NUMTOWORDS_MAX_LENGTH; the library's
+	   buffers grow as needed, and the caller's are checked as they are filled */
+	error = str_batch_begin(out, in->length, in->validity, in->offset,
+			(owns ? (in->length < 65536 ? in->length : 65536) * 32 : 0));
+	if (error != 0)
+		return error;
+
+	for (i = 0; i < in->length; ++i)
+	{
+		if (size <= INT32_MAX)
+			out->offsets[i] = (int32_t) size;
+		if (!str_batch_is_valid(in->validity, in->offset + i))
+			continue;
+
+		if (owns && str_batch_reserve(out, size + STR_BATCH_NUMTOWORDS_MAX_LENGTH) != 0)
+			return ENOMEM;
+
+		if (size <= out->capacity && out->capacity - size >= STR_BATCH_NUMTOWORDS_MAX_LENGTH)
+			size += numtowords(out->data + size, (long long) in->values[in->offset + i]);
+		else
+		{
+			const size_t length = numtowords(words, (long long) in->values[in->offset + i]);
+
+			if (size <= out->capacity && out->capacity - size >= length)
+				memcpy(out->data + size, words, length);
+			size += length;
+		}
+	}
+
+	if (size > INT32_MAX)
+		return EOVERFLOW;
+	out->offsets[in->length] = (int32_t) size;
+	out->size = size;
+	return (size > out->capacity ? ENOBUFS : 0);
+}
+
+int str_batch_pipeline(const st_str_pipeline *p, const st_str_column *in, st_str_column_buffer *out)
+{
+	const int32_t *offsets = in->offsets + in->offset;
+	const size_t scratch_size = str_pipeline_scratch_size(p);
+	char *scratch;
+	size_t size = 0, i;
+	int error;
+
+	error = str_batch_begin(out, in->length, in->validity, in->offset, (size_t) (offsets[in->length] - offsets[0]));
+	if (error != 0)
+		return error;
+
+	scratch = (char *) malloc(scratch_size != 0 ? scratch_size : 1);
+	if (scratch == NULL)
+		return ENOMEM;
+
+	for (i = 0; i < in->length; ++i)
+	{
+		out->offsets[i] = (int32_t) size;
+		if (str_batch_is_valid(in->validity, in->offset + i))
+			size += str_pipeline_run(p, in->data + offsets[i], (size_t) (offsets[i + 1] - offsets[i]), out->data + size, scratch);
+	}
+	out->offsets[in->length] = (int32_t) size;
+	out->size = size;
+
+	free(scratch);
+	return 0;
+}
+
+int str_batch_simhash(const st_str_column *in, size_t shingle_size, uint64_t *fingerprints)
+{
+	const int32_t *offsets = in->offsets + in->offset;
+	size_t i;
+
+	if (shingle_size < 1 || shingle_size > SIMHASH_MAX_SHINGLE_SIZE)
+		return EINVAL;
+
+	for (i = 0; i < in->length; ++i)
+	{
+		if (str_batch_is_valid(in->validity, in->offset + i))
+			fingerprints[i] = simhash64(in->data + offsets[i], (size_t) (offsets[i + 1] - offsets[i]), shingle_size);
+		else
+			fingerprints[i] = 0;
+	}
+	return 0;
+}
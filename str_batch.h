@@ -0,0 +1,126 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	The functions of lib_mysqludf_str over whole columns of values, for engines other than MySQL.
+	Columns have the layout of Apache Arrow arrays: the bytes of all of the values follow each
+	other in a data buffer, an array of offsets gives where each value starts, and an optional
+	bitmap tells which values are NULL. A call processes all of the values of a column, so that
+	its cost is spread over them, and the functions that map each byte to a byte go over the data
+	buffer in a single loop, whatever the lengths of the values.
+
+	This header and libmysqludf_str_batch are installed. Structures are only ever extended at
+	their end, and STR_BATCH_ABI_VERSION is increased when they are.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_STR_BATCH_H
+#define LIB_MYSQLUDF_STR_STR_BATCH_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pipeline.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The version of the interface declared by this header. */
+#define STR_BATCH_ABI_VERSION 1
+
+/** @returns the STR_BATCH_ABI_VERSION of the library, which may be newer than the header. */
+unsigned str_batch_abi_version(void);
+
+/** The largest number of bytes of a result of str_batch_numtowords(). */
+#define STR_BATCH_NUMTOWORDS_MAX_LENGTH 288
+
+/** A column of strings, laid out like an Arrow binary or utf8 array.
+ *
+ * Value @c i is NULL if @c validity is not NULL and bit <code>offset + i</code> of it is clear,
+ * bit @c j being bit <code>j % 8</code>, from the least significant, of byte <code>j / 8</code>.
+ * Otherwise it is the bytes of @c data from <code>offsets[offset + i]</code> up to
+ * <code>offsets[offset + i + 1]</code>, which do not decrease. */
+typedef struct st_str_column
+{
+	size_t length;           /* the number of values */
+	size_t offset;           /* the position of the first value in offsets and validity, as in a
+	                            slice of an Arrow array */
+	const int32_t *offsets;  /* offset + length + 1 offsets into data */
+	const char *data;
+	const uint8_t *validity; /* the validity bitmap, or NULL if no value is NULL */
+} st_str_column;
+
+/** A column of integers, laid out like an Arrow int64 array. */
+typedef struct st_int64_column
+{
+	size_t length;
+	size_t offset;
+	const int64_t *values;   /* offset + length values */
+	const uint8_t *validity;
+} st_int64_column;
+
+/** The buffers that a function writes a column of strings to, from offset 0.
+ *
+ * To have the function allocate them with malloc(), clear the structure with
+ * str_column_buffer_init(); it reallocates them when it is passed the same structure again, and
+ * they are freed with str_column_buffer_free(). Otherwise, set @c offsets to space for
+ * <code>length + 1</code> offsets, @c data to @c capacity bytes and @c validity to
+ * <code>(length + 7) / 8</code> bytes, which may be NULL only if the input has no validity bitmap.
+ * The function sets all of the bits of @c validity if the input has none. NULL values are empty. */
+typedef struct st_str_column_buffer
+{
+	int32_t *offsets;
+	char *data;
+	size_t capacity;    /* the number of bytes at data */
+	uint8_t *validity;
+	size_t size;        /* set to the number of bytes of data of the result */
+	int allocated;      /* non-zero if the buffers were allocated by the library */
+} st_str_column_buffer;
+
+/** Clears @p out, so that the next function it is passed to allocates its buffers. */
+void str_column_buffer_init(st_str_column_buffer *out);
+
+/** Frees the buffers of @p out if they were allocated by the library, and clears it. */
+void str_column_buffer_free(st_str_column_buffer *out);
+
+/* The functions below return 0, or:
+ *  - ENOBUFS if the caller's buffers are too small, in which case out->size is set to the number
+ *    of bytes of data that they need;
+ *  - EOVERFLOW if the result has more than INT32_MAX bytes of data, the largest that offsets of
+ *    32 bits can address;
+ *  - ENOMEM if memory could not be allocated;
+ *  - EINVAL if an argument is not valid.
+ *
+ * The result of each value is that of the SQL function for it. */
+
+/** Applies str_rot13() to the values of @p in. The result has as many bytes as @p in. */
+int str_batch_rot13(const st_str_column *in, st_str_column_buffer *out);
+
+/** Applies str_translate() with the @p length bytes of @p src and @p dst to the values of @p in.
+ * The result has as many bytes as @p in. */
+int str_batch_translate(const st_str_column *in, const char *src, const char *dst, size_t length,
+		st_str_column_buffer *out);
+
+/** Applies str_xor() with the @p key_length bytes of @p key to the values of @p in: each result is
+ * as long as the longer of the value and the key. */
+int str_batch_xor(const st_str_column *in, const char *key, size_t key_length, st_str_column_buffer *out);
+
+/** Applies str_numtowords() to the values of @p in. Each result has at most
+ * @c STR_BATCH_NUMTOWORDS_MAX_LENGTH bytes. */
+int str_batch_numtowords(const st_int64_column *in, st_str_column_buffer *out);
+
+/** Applies str_pipeline() with @p p to the values of @p in. The result has at most as many bytes as
+ * @p in, and caller's buffers must have space for that many. */
+int str_batch_pipeline(const st_str_pipeline *p, const st_str_column *in, st_str_column_buffer *out);
+
+/** Writes str_simhash() with @p shingle_size of the values of @p in to @p fingerprints, which has
+ * space for <code>in->length</code> of them, as integers: 0 for NULL values. The validity of the
+ * result is that of @p in. */
+int str_batch_simhash(const st_str_column *in, size_t shingle_size, uint64_t *fingerprints);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
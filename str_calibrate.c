@@ -0,0 +1,185 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	str_calibrate, which times the scalar and the vector variants of the kernels of string_utils.h
+	on the CPU that it runs on, and writes to its standard output a str_tuning.h with the lengths
+	from which the vector variants are faster (see kernel_tuning.h). It is run by `make calibrate`.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "string_utils.h"
+
+/* The longest length that is timed; the vector variants of longer strings are taken to be faster
+   if they are at this length */
+#define CALIBRATE_MAX_LENGTH 256
+
+/* The bytes processed by each timing, and the number of timings of which the fastest is kept */
+#define CALIBRATE_BYTES (1 << 20)
+#define CALIBRATE_RUNS 7
+
+/* A variant of a kernel, with the arguments of the three kernels */
+typedef void (*calibrate_fn)(char *dest, const unsigned char *table, const char *src, const char *key, size_t length);
+
+typedef struct st_calibrate_kernel
+{
+	const char *name;
+	const char *macro;
+	calibrate_fn variants[2]; /* the scalar and the vector variant */
+} st_calibrate_kernel;
+
+static void calibrate_rot13_scalar(char *dest, const unsigned char *table, const char *src, const char *key, size_t length)
+{
+	(void) table;
+	(void) key;
+	rot13_scalar(dest, src, length);
+}
+
+static void calibrate_rot13_vector(char *dest, const unsigned char *table, const char *src, const char *key, size_t length)
+{
+	(void) table;
+	(void) key;
+	rot13_vector(dest, src, length);
+}
+
+static void calibrate_byte_map_scalar(char *dest, const unsigned char *table, const char *src, const char *key, size_t length)
+{
+	(void) key;
+	byte_map_scalar(dest, table, src, length);
+}
+
+static void calibrate_byte_map_vector(char *dest, const unsigned char *table, const char *src, const char *key, size_t length)
+{
+	(void) key;
+	byte_map_vector(dest, table, src, length);
+}
+
+/* str_xor() is mostly called with a key that is shorter than the values */
+static void calibrate_xor_bytes_scalar(char *dest, const unsigned char *table, const char *src, const char *key, size_t length)
+{
+	(void) table;
+	xor_bytes_scalar(dest, src, length, key, length / 2);
+}
+
+static void calibrate_xor_bytes_vector(char *dest, const unsigned char *table, const char *src, const char *key, size_t length)
+{
+	(void) table;
+	xor_bytes_vector(dest, src, length, key, length / 2);
+}
+
+static const st_calibrate_kernel calibrate_kernels[] = {
+	{ "rot13", "STR_TUNING_ROT13_MIN_LENGTH", { calibrate_rot13_scalar, calibrate_rot13_vector } },
+	{ "translate", "STR_TUNING_TRANSLATE_MIN_LENGTH", { calibrate_byte_map_scalar, calibrate_byte_map_vector } },
+	{ "xor", "STR_TUNING_XOR_MIN_LENGTH", { calibrate_xor_bytes_scalar, calibrate_xor_bytes_vector } }
+};
+
+static double calibrate_now(void)
+{
+#if defined(CLOCK_MONOTONIC) && !defined(_WIN32)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+#else
+	return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Returns the fastest time of fn over CALIBRATE_BYTES bytes in strings of `length` bytes. */
+static double calibrate_time(calibrate_fn fn, char *dest, const unsigned char *table, const char *src, const char *key, size_t length)
+{
+	const size_t calls = CALIBRATE_BYTES / length;
+	double best = 0;
+	unsigned run;
+	size_t i;
+
+	for (run = 0; run < CALIBRATE_RUNS; run++)
+	{
+		const double start = calibrate_now();
+		double t;
+
+		// the strings follow each other in the buffer, as the values of a column would
+		for (i = 0; i < calls; i++)
+		{
+			const size_t offset = (i * length) % (CALIBRATE_MAX_LENGTH * 16);
+
+			fn(dest + offset, table, src + offset, key, length);
+		}
+
+		t = calibrate_now() - start;
+		if (run == 0 || t < best)
+			best = t;
+	}
+
+	return best;
+}
+
+int main(void)
+{
+	const size_t buffer_size = CALIBRATE_MAX_LENGTH * 17;
+	char *src = (char *) malloc(buffer_size);
+	char *dest = (char *) malloc(buffer_size);
+	char *key = (char *) malloc(buffer_size);
+	unsigned char table[256];
+	size_t i, k, length;
+
+	if (src == NULL || dest == NULL || key == NULL)
+	{
+		fprintf(stderr, "str_calibrate: out of memory\n");
+		return 1;
+	}
+
+	// printable ASCII, of which about half are letters, like most of the values of text columns
+	srand(1);
+	for (i = 0; i < buffer_size; i++)
+	{
+		src[i] = (char) (' ' + rand() % 95);
+		key[i] = (char) rand();
+	}
+	for (i = 0; i < sizeof (table); i++)
+		table[i] = (unsigned char) (i >= 'a' && i <= 'z' ? i - 'a' + 'A' : i);
+
+	printf("/* Generated by str_calibrate, which `make calibrate` runs; see kernel_tuning.h. */\n");
+
+	for (k = 0; k < sizeof (calibrate_kernels) / sizeof (calibrate_kernels[0]); k++)
+	{
+		const st_calibrate_kernel *kernel = &calibrate_kernels[k];
+		size_t min_length = 0;
+
+		// the shortest length from which the vector variant is faster at every length timed
+		for (length = 1; length <= CALIBRATE_MAX_LENGTH; length++)
+		{
+			const double scalar = calibrate_time(kernel->variants[0], dest, table, src, key, length);
+			const double vector = calibrate_time(kernel->variants[1], dest, table, src, key, length);
+
+			if (vector < scalar)
+			{
+				if (min_length == 0)
+					min_length = length;
+			}
+			else
+				min_length = 0;
+		}
+
+		if (min_length == 0)
+		{
+			fprintf(stderr, "str_calibrate: the vector variant of %s is never faster\n", kernel->name);
+			printf("#define %s ((size_t) -1)\n", kernel->macro);
+		}
+		else
+		{
+			fprintf(stderr, "str_calibrate: the vector variant of %s is faster from %lu bytes\n", kernel->name, (unsigned long) min_length);
+			printf("#define %s %lu\n", kernel->macro, (unsigned long) min_length);
+		}
+	}
+
+	free(src);
+	free(dest);
+	free(key);
+	return 0;
+}
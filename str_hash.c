@@ -0,0 +1,63 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+
+#include "str_hash.h"
+
+#define PRIME64_1 UINT64_C(0x9E3779B185EBCA87)
+#define PRIME64_2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define PRIME64_3 UINT64_C(0x165667B19E3779F9)
+#define PRIME64_4 UINT64_C(0x85EBCA77C2B2AE63)
+#define PRIME64_5 UINT64_C(0x27D4EB2F165667C5)
+
+#define ROTL64(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint64_t read64le(const unsigned char *p)
+{
+	return (uint64_t) p[0] | ((uint64_t) p[1] << 8) | ((uint64_t) p[2] << 16) | ((uint64_t) p[3] << 24)
+			| ((uint64_t) p[4] << 32) | ((uint64_t) p[5] << 40) | ((uint64_t) p[6] << 48) | ((uint64_t) p[7] << 56);
+}
+
+static uint32_t read32le(const unsigned char *p)
+{
+	return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+uint64_t str_hash64(const void *data, size_t length, uint64_t seed)
+{
+	const unsigned char *p = (const unsigned char *) data;
+	uint64_t h = seed + PRIME64_5 + (uint64_t) length;
+
+	for (; length >= 8; length -= 8, p += 8)
+	{
+		uint64_t k = read64le(p) * PRIME64_2;
+		k = ROTL64(k, 31) * PRIME64_1;
+		h ^= k;
+		h = ROTL64(h, 27) * PRIME64_1 + PRIME64_4;
+	}
+
+	if (length >= 4)
+	{
+		h ^= (uint64_t) read32le(p) * PRIME64_1;
+		h = ROTL64(h, 23) * PRIME64_2 + PRIME64_3;
+		length -= 4;
+		p += 4;
+	}
+
+	for (; length > 0; --length, ++p)
+	{
+		h ^= (uint64_t) *p * PRIME64_5;
+		h = ROTL64(h, 11) * PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
@@ -0,0 +1,28 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_STR_HASH_H
+#define LIB_MYSQLUDF_STR_STR_HASH_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Computes a 64-bit hash of the @p length bytes at @p data.
+ *
+ * The function follows the structure of XXH64 for short inputs (8-byte lanes, then a 4-byte
+ * lane, then single bytes, then an avalanche step). It reads its input as little-endian words,
+ * so the result is the same on every platform and may be stored, e.g. in serialized filters. */
+uint64_t str_hash64(const void *data, size_t length, uint64_t seed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,85 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	Static tracepoints (USDT probes) of the provider lib_mysqludf_str, which bpftrace, perf and
+	SystemTap attach to in a running server. They are compiled in where <sys/sdt.h> is available
+	(systemtap-sdt-dev or systemtap-sdt-devel), unless configure is run with --disable-probes, and
+	are a single nop each until a tracer attaches. Arguments that take work to compute are only
+	computed while STR_PROBE_ENABLED() is true, which is set by the tracer through a semaphore.
+
+	The probes, whose first argument is the name of the SQL function:
+
+	  init__entry(name)
+	  init__return(name, failed, message)
+	  row__entry(name, input_length)
+	  row__return(name, input_length, output_length, is_null, error)
+	  add__entry(name, input_length)
+	  add__return(name, input_length, error)
+	  deinit__entry(name)
+	  deinit__return(name)
+
+	The row probes fire around the main function of each SQL function, and the add probes around
+	the _add function of aggregate functions. input_length is the total length of the arguments
+	that are not NULL, and output_length that of the result, 0 for integer results.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_STR_PROBES_H
+#define LIB_MYSQLUDF_STR_STR_PROBES_H 1
+
+#if defined(HAVE_SYS_SDT_H) && defined(__GNUC__)
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define STR_PROBE_SEMAPHORE(probe) lib_mysqludf_str_ ## probe ## _semaphore
+
+/* Defines the semaphores of the probes; used once in the library. */
+#define STR_PROBE_DEFINE_SEMAPHORES \
+	STR_PROBE_DEFINE_SEMAPHORE(init__entry); \
+	STR_PROBE_DEFINE_SEMAPHORE(init__return); \
+	STR_PROBE_DEFINE_SEMAPHORE(row__entry); \
+	STR_PROBE_DEFINE_SEMAPHORE(row__return); \
+	STR_PROBE_DEFINE_SEMAPHORE(add__entry); \
+	STR_PROBE_DEFINE_SEMAPHORE(add__return); \
+	STR_PROBE_DEFINE_SEMAPHORE(deinit__entry); \
+	STR_PROBE_DEFINE_SEMAPHORE(deinit__return)
+
+#define STR_PROBE_DEFINE_SEMAPHORE(probe) \
+	__extension__ unsigned short STR_PROBE_SEMAPHORE(probe) __attribute__ ((unused)) __attribute__ ((section (".probes")))
+
+#define STR_PROBE_DECLARE_SEMAPHORE(probe) \
+	__extension__ extern unsigned short STR_PROBE_SEMAPHORE(probe)
+
+STR_PROBE_DECLARE_SEMAPHORE(init__entry);
+STR_PROBE_DECLARE_SEMAPHORE(init__return);
+STR_PROBE_DECLARE_SEMAPHORE(row__entry);
+STR_PROBE_DECLARE_SEMAPHORE(row__return);
+STR_PROBE_DECLARE_SEMAPHORE(add__entry);
+STR_PROBE_DECLARE_SEMAPHORE(add__return);
+STR_PROBE_DECLARE_SEMAPHORE(deinit__entry);
+STR_PROBE_DECLARE_SEMAPHORE(deinit__return);
+
+/* Non-zero while a tracer is attached to the probe. */
+#define STR_PROBE_ENABLED(probe) __builtin_expect(STR_PROBE_SEMAPHORE(probe) != 0, 0)
+
+#define STR_PROBE1(probe, a1) STAP_PROBE1(lib_mysqludf_str, probe, a1)
+#define STR_PROBE2(probe, a1, a2) STAP_PROBE2(lib_mysqludf_str, probe, a1, a2)
+#define STR_PROBE3(probe, a1, a2, a3) STAP_PROBE3(lib_mysqludf_str, probe, a1, a2, a3)
+#define STR_PROBE5(probe, a1, a2, a3, a4, a5) STAP_PROBE5(lib_mysqludf_str, probe, a1, a2, a3, a4, a5)
+
+#else
+
+#define STR_PROBE_DEFINE_SEMAPHORES typedef int str_probe_semaphores_unused
+#define STR_PROBE_ENABLED(probe) 0
+#define STR_PROBE1(probe, a1) ((void) 0)
+/* input_length is computed by the callers of the entry probes, and is not then an unused variable */
+#define STR_PROBE2(probe, a1, a2) ((void) (a2))
+#define STR_PROBE3(probe, a1, a2, a3) ((void) 0)
+#define STR_PROBE5(probe, a1, a2, a3, a4, a5) ((void) 0)
+
+#endif
+
+#endif
@@ -0,0 +1,26 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_STR_SYNC_H
+#define LIB_MYSQLUDF_STR_STR_SYNC_H 1
+
+/* A mutex that can be initialized statically, for the process-wide state of the library */
+#ifdef _WIN32
+#include <windows.h>
+typedef SRWLOCK str_mutex;
+#define STR_MUTEX_INITIALIZER SRWLOCK_INIT
+#define str_mutex_lock(m) AcquireSRWLockExclusive(m)
+#define str_mutex_unlock(m) ReleaseSRWLockExclusive(m)
+#else
+#include <pthread.h>
+typedef pthread_mutex_t str_mutex;
+#define STR_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define str_mutex_lock(m) pthread_mutex_lock(m)
+#define str_mutex_unlock(m) pthread_mutex_unlock(m)
+#endif
+
+#endif
@@ -0,0 +1,228 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "str_alloc.h"
+#include "str_hash.h"
+#include "string_list.h"
+
+#ifndef SIZE_MAX
+#define SIZE_MAX ((size_t) -1)
+#endif
+
+#define STRING_LIST_SEED UINT64_C(0x5354524C49535431)
+
+/* Size of the arena chunks that hold the strings */
+#define STRING_LIST_ARENA_CHUNK_SIZE (64 * 1024)
+
+/* Size of the hash table of a distinct list when the first string is added */
+#define STRING_LIST_MIN_TABLE_SIZE 64
+
+/* Each string is stored in the arena as its length followed by its bytes, without padding. */
+typedef uint32_t string_list_length_t;
+
+typedef struct st_string_list_slot
+{
+	const char *record; /* the length of a string in the arena, or NULL if the slot is empty */
+	uint64_t hash;
+} st_string_list_slot;
+
+struct st_string_list
+{
+	st_arena arena;
+	size_t count;
+	size_t total_length; /* the sum of the lengths of the strings */
+
+	/* Open addressing hash table with linear probing of the strings of a distinct list */
+	int distinct;
+	st_string_list_slot *table;
+	size_t table_mask;
+};
+
+st_string_list *string_list_alloc(int distinct)
+{
+	st_string_list *list = (st_string_list *) str_calloc(1, sizeof (st_string_list));
+
+	if (list == NULL)
+		return NULL;
+
+	arena_init(&list->arena, STRING_LIST_ARENA_CHUNK_SIZE);
+	list->distinct = distinct;
+
+	return list;
+}
+
+void string_list_free(st_string_list *list)
+{
+	arena_free(&list->arena);
+	str_free(list->table);
+	str_free(list);
+}
+
+void string_list_clear(st_string_list *list)
+{
+	if (list->count == 0)
+		return;
+
+	if (list->table != NULL)
+		memset(list->table, 0, (list->table_mask + 1) * sizeof (st_string_list_slot));
+	arena_reset(&list->arena);
+	list->count = 0;
+	list->total_length = 0;
+}
+
+static string_list_length_t string_list_record_length(const char *record)
+{
+	string_list_length_t length;
+
+	memcpy(&length, record, sizeof length);
+	return length;
+}
+
+/* Returns the slot of the string, or the empty slot where it would be inserted. */
+static st_string_list_slot *string_list_find_slot(const st_string_list *list, uint64_t hash, const char *str, size_t length)
+{
+	size_t i = (size_t) hash & list->table_mask;
+
+	while (list->table[i].record != NULL)
+	{
+		const char *record = list->table[i].record;
+
+		if (list->table[i].hash == hash && string_list_record_length(record) == length
+				&& memcmp(record + sizeof (string_list_length_t), str, length) == 0)
+			break;
+		i = (i + 1) & list->table_mask;
+	}
+
+	return list->table + i;
+}
+
+/* Makes sure that at most half of the slots are used once another string is added. */
+static int string_list_reserve_slot(st_string_list *list)
+{
+	st_string_list_slot *old_table = list->table;
+	const size_t old_size = (old_table != NULL ? list->table_mask + 1 : 0);
+	size_t new_size, i;
+
+	if (2 * (list->count + 1) <= old_size)
+		return 0;
+
+	new_size = (old_size != 0 ? 2 * old_size : STRING_LIST_MIN_TABLE_SIZE);
+	if (new_size > SIZE_MAX / sizeof (st_string_list_slot))
+		return E2BIG;
+
+	list->table = (st_string_list_slot *) str_calloc(new_size, sizeof (st_string_list_slot));
+	if (list->table == NULL)
+	{
+		list->table = old_table;
+		return ENOMEM;
+	}
+	list->table_mask = new_size - 1;
+
+	for (i = 0; i < old_size; ++i)
+	{
+		size_t j;
+
+		if (old_table[i].record == NULL)
+			continue;
+
+		j = (size_t) old_table[i].hash & list->table_mask;
+		while (list->table[j].record != NULL)
+			j = (j + 1) & list->table_mask;
+		list->table[j] = old_table[i];
+	}
+
+	str_free(old_table);
+	return 0;
+}
+
+int string_list_add(st_string_list *list, const char *str, size_t length)
+{
+	const string_list_length_t record_length = (string_list_length_t) length;
+	st_string_list_slot *slot = NULL;
+	uint64_t hash = 0;
+	char *record;
+
+	if (length > STRING_LIST_MAX_LENGTH || list->total_length > SIZE_MAX - length)
+		return E2BIG;
+
+	if (list->distinct)
+	{
+		int err = string_list_reserve_slot(list);
+		if (err != 0)
+			return err;
+
+		hash = str_hash64(str, length, STRING_LIST_SEED);
+		slot = string_list_find_slot(list, hash, str, length);
+		if (slot->record != NULL)
+			return 0;
+	}
+
+	record = (char *) arena_alloc_unaligned(&list->arena, sizeof record_length + length);
+	if (record == NULL)
+		return ENOMEM;
+	memcpy(record, &record_length, sizeof record_length);
+	memcpy(record + sizeof record_length, str, length);
+
+	if (slot != NULL)
+	{
+		slot->record = record;
+		slot->hash = hash;
+	}
+
+	++list->count;
+	list->total_length += length;
+	return 0;
+}
+
+size_t string_list_count(const st_string_list *list)
+{
+	return list->count;
+}
+
+int string_list_join(const st_string_list *list, st_char_vector *vec, const char *sep, size_t sep_length)
+{
+	const st_arena_chunk *c = NULL;
+	const char *data;
+	size_t used, length = list->total_length;
+	int err, first = 1;
+
+	char_vector_clear(vec);
+	if (list->count == 0)
+		return 0;
+
+	if (sep_length != 0 && (list->count - 1) > (SIZE_MAX - length) / sep_length)
+		return E2BIG;
+	length += (list->count - 1) * sep_length;
+
+	err = char_vector_reserve(vec, length);
+	if (err != 0)
+		return err;
+
+	// The strings were allocated back to back, so the chunks are read like one stream of records.
+	while ((c = arena_next_chunk(&list->arena, c, &data, &used)) != NULL)
+	{
+		const char *const end = data + used;
+
+		while (data < end)
+		{
+			const string_list_length_t record_length = string_list_record_length(data);
+
+			if (!first)
+				char_vector_append(vec, sep, sep_length);
+			first = 0;
+			char_vector_append(vec, data + sizeof record_length, record_length);
+			data += sizeof record_length + record_length;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_STRING_LIST_H
+#define LIB_MYSQLUDF_STR_STRING_LIST_H 1
+#include <stddef.h>
+
+#include "char_vector.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The longest string that can be added to a list. */
+#define STRING_LIST_MAX_LENGTH 0xFFFFFFFFUL
+
+typedef struct st_string_list st_string_list;
+
+/** Allocates an empty list of strings. The strings are copied back to back into the chunks of an
+ * arena, so adding one never moves the others. If @p distinct is non-zero, a string that is
+ * already in the list is not added again.
+ *
+ * @returns a pointer to the list, or NULL if memory could not be allocated. It must be freed with
+ *		string_list_free(). */
+st_string_list *string_list_alloc(int distinct);
+
+/** Frees @p list and all of its memory. */
+void string_list_free(st_string_list *list);
+
+/** Empties @p list, keeping its memory for reuse. */
+void string_list_clear(st_string_list *list);
+
+/** Adds a copy of the @p length bytes at @p str to the end of @p list, unless the list is distinct
+ * and already has them.
+ *
+ * @returns 0 if successful, or a non-zero value if @p length is larger than
+ *		@c STRING_LIST_MAX_LENGTH or memory could not be allocated. */
+int string_list_add(st_string_list *list, const char *str, size_t length);
+
+/** @returns the number of strings in @p list. */
+size_t string_list_count(const st_string_list *list);
+
+/** Replaces the contents of @p vec with the strings of @p list in order, separated by the
+ * @p sep_length bytes at @p sep. The memory of @p vec is allocated once, to the exact length.
+ *
+ * @returns 0 if successful, or a non-zero error code if memory could not be allocated, in which
+ *		case @p vec is empty. */
+int string_list_join(const st_string_list *list, st_char_vector *vec, const char *sep, size_t sep_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,6 +22,103 @@ extern "C" {
  */
 size_t x_strlcpy(char *__restrict dest, const char *__restrict src, size_t dest_len);
 
+/**
+ * \returns the number of bytes that json_escape() writes for the \p length bytes at \p src.
+ */
+size_t json_escaped_length(const char *src, size_t length);
+
+/**
+ * Writes the \p length bytes at \p src to \p dest as the contents of a JSON string literal,
+ * without the surrounding quotes: quotes, backslashes and control characters are escaped, and all
+ * other bytes are copied as is. \p dest must have space for
+ * <code>json_escaped_length(src, length)</code> bytes.
+ *
+ * \returns a pointer past the last byte written.
+ */
+char *json_escape(char *dest, const char *src, size_t length);
+
+/**
+ * Fills the 256-byte \p table with the byte that each byte is replaced with by str_translate():
+ * the corresponding byte of \p dst for the bytes of \p src (the last one if a byte occurs several
+ * times in \p src), itself otherwise. \p src and \p dst have \p length bytes each.
+ */
+void byte_map_fill(unsigned char *table, const char *src, const char *dst, size_t length);
+
+/**
+ * \returns the length of the longest prefix of the \p length bytes at \p src that the 256-byte
+ *		\p table maps to itself, i.e. the offset of the first byte that byte_map() would change, or
+ *		\p length if there is none.
+ */
+size_t byte_map_unchanged_length(const unsigned char *table, const char *src, size_t length);
+
+/**
+ * Writes <code>table[src[i]]</code> to <code>dest[i]</code> for each of the \p length bytes at
+ * \p src, which must not overlap \p dest.
+ */
+void byte_map(char *__restrict dest, const unsigned char *table, const char *__restrict src, size_t length);
+
+/**
+ * The variants of byte_map(), which uses byte_map_vector() for strings of at least
+ * \c STR_TUNING_TRANSLATE_MIN_LENGTH bytes (see kernel_tuning.h): byte_map_scalar() maps a
+ * byte at a time, and byte_map_vector() stores the bytes of eight lookups at once.
+ *
+ * The vector variants of the kernels below use the widest instruction set of the CPU (see
+ * kernel_isa.h). The scalar variants are their reference implementations, which the
+ * differential tests of tests/kernel_fuzz compare the other variants with: they are kept as
+ * plain loops rather than optimized.
+ */
+void byte_map_scalar(char *__restrict dest, const unsigned char *table, const char *__restrict src, size_t length);
+void byte_map_vector(char *__restrict dest, const unsigned char *table, const char *__restrict src, size_t length);
+
+/**
+ * Writes the rot13 transform of the \p length bytes at \p src, which must not overlap \p dest,
+ * to \p dest: each ASCII letter is shifted by 13 places in the alphabet, and the other bytes are
+ * copied as is.
+ */
+void rot13(char *__restrict dest, const char *__restrict src, size_t length);
+
+/**
+ * The variants of rot13(), which uses rot13_vector() for strings of at least
+ * \c STR_TUNING_ROT13_MIN_LENGTH bytes, and of at least the narrowest vector of its instruction
+ * set (see kernel_isa.h): rot13_scalar() transforms a byte at a time, and
+ * rot13_vector() a vector at a time.
+ */
+void rot13_scalar(char *__restrict dest, const char *__restrict src, size_t length);
+void rot13_vector(char *__restrict dest, const char *__restrict src, size_t length);
+
+/**
+ * Writes the bytewise XOR of the \p length bytes at \p longer and the \p shorter_length bytes at
+ * \p shorter, padded with NUL bytes to \p length bytes, to \p dest, which must not overlap them.
+ */
+void xor_bytes(char *__restrict dest, const char *longer, size_t length, const char *shorter, size_t shorter_length);
+
+/**
+ * The variants of xor_bytes(), which uses xor_bytes_vector() for strings of at least
+ * \c STR_TUNING_XOR_MIN_LENGTH bytes, and of at least a vector as rot13():
+ * xor_bytes_scalar() combines a byte at a time, and xor_bytes_vector() a vector at a time.
+ */
+void xor_bytes_scalar(char *__restrict dest, const char *longer, size_t length, const char *shorter, size_t shorter_length);
+void xor_bytes_vector(char *__restrict dest, const char *longer, size_t length, const char *shorter, size_t shorter_length);
+
+/**
+ * Writes the \p length bytes at \p src, which must not overlap \p dest, to \p dest with the
+ * letters of latin1 in upper case, or in lower case, as the tables of str_pipeline_latin1_ctype()
+ * map them. They use the instruction set of the vector variants of the kernels above.
+ */
+void latin1_upper(char *__restrict dest, const char *__restrict src, size_t length);
+void latin1_lower(char *__restrict dest, const char *__restrict src, size_t length);
+
+/** The largest number of bytes that numtowords() writes. */
+#define NUMTOWORDS_MAX_LENGTH 288
+
+/**
+ * Writes \p value spelled in English, such as "negative one hundred twenty-three", to \p dest,
+ * which has space for \c NUMTOWORDS_MAX_LENGTH bytes. The result is not NUL-terminated.
+ *
+ * \returns the length of the result.
+ */
+size_t numtowords(char *dest, long long value);
+
 #ifdef __cplusplus
 }
 #endif
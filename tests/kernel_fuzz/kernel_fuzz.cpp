@@ -0,0 +1,887 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+// Differential tests of the optimized kernels of lib_mysqludf_str against their reference
+// implementations. No MySQL server is needed.
+//
+// The references are the scalar variants of string_utils.h, which are the loops that the
+// functions have always used, the tables of str_pipeline_latin1_ctype() for the case of latin1, and,
+// for ucwords and numtowords, the straightforward
+// implementations below, which follow str_ucwords() and the spelling of str_numtowords(). Each
+// input is given to every other implementation: the transforms of kernel_isa.h of each
+// instruction set that the CPU supports, the vector variants and the dispatchers that choose
+// between the variants, the compiled transforms of pipeline.h and the column functions of
+// str_batch.h. Their results must be byte-identical to that of the reference, and they must not
+// write outside of their destination.
+//
+// Usage: kernel_fuzz [--seed N] [--iterations N] [--no-sweep]
+//
+//   --seed N           the seed of the random inputs [1]
+//   --iterations N     the number of random inputs [10000]
+//   --no-sweep         only run the random inputs
+//
+// The sweep gives the kernels all lengths from 0 to KERNEL_FUZZ_MAX_LENGTH bytes, with every pair
+// of alignments of the source and of the destination up to KERNEL_FUZZ_ALL_ALIGNMENTS bytes and
+// every alignment of the source above, and sources in which each byte value occurs at each
+// position modulo 16; the transforms, which are not vectorized, get one pair of alignments per
+// length. The random inputs then draw their lengths, alignments, translation tables
+// and keys, and their bytes from all 256 values or from those around the letters.
+//
+// Built with -DKERNEL_FUZZ_LIBFUZZER and -fsanitize=fuzzer (`make kernel_fuzz_libfuzzer`), the
+// program is a libFuzzer target instead: LLVMFuzzerTestOneInput() decodes the same inputs from
+// the fuzzer's bytes. A mismatch prints the input and aborts in both modes.
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../../kernel_isa.h"
+#include "../../kernel_select.h"
+#include "../../pipeline.h"
+#include "../../str_batch.h"
+#include "../../string_utils.h"
+
+#define KERNEL_FUZZ_MAX_LENGTH 4096
+
+// The lengths up to which all pairs of alignments are swept
+#define KERNEL_FUZZ_ALL_ALIGNMENTS 64
+
+// The bytes after the destination that must not be written
+#define KERNEL_FUZZ_GUARD 16
+
+#define KERNEL_FUZZ_CANARY 0xA5
+
+namespace {
+
+// An input of the kernels: the bytes to transform, the alignments, and the arguments of
+// str_translate() and str_xor().
+struct fuzz_input
+{
+	const char *src;
+	size_t length;
+	unsigned src_align;
+	unsigned dest_align;
+	const char *from;
+	const char *to;
+	size_t map_length;
+	const char *key;
+	size_t key_length;
+};
+
+// Where the input comes from, for the message of a mismatch
+std::string g_origin;
+
+[[noreturn]] void fuzz_fail(const fuzz_input &in, const char *kernel, const char *what)
+{
+	size_t i;
+
+	std::fprintf(stderr, "kernel_fuzz: %s: %s\n", kernel, what);
+	std::fprintf(stderr, "  input: %s, length %lu, source alignment %u, destination alignment %u\n",
+			g_origin.c_str(), (unsigned long) in.length, in.src_align, in.dest_align);
+	std::fprintf(stderr, "  translate %lu bytes, key of %lu bytes\n", (unsigned long) in.map_length,
+			(unsigned long) in.key_length);
+	std::fprintf(stderr, "  bytes:");
+	for (i = 0; i < in.length && i < 64; ++i)
+		std::fprintf(stderr, " %02x", (unsigned char) in.src[i]);
+	std::fprintf(stderr, "%s\n", in.length > 64 ? " ..." : "");
+	std::abort();
+}
+
+// Compares the `length` bytes of `actual` with `expected`.
+void fuzz_compare(const fuzz_input &in, const char *kernel, const char *expected, const char *actual, size_t length)
+{
+	size_t i;
+	char what[128];
+
+	for (i = 0; i < length; ++i)
+	{
+		if (expected[i] != actual[i])
+		{
+			std::snprintf(what, sizeof (what), "byte %lu is 0x%02x instead of 0x%02x", (unsigned long) i,
+					(unsigned char) actual[i], (unsigned char) expected[i]);
+			fuzz_fail(in, kernel, what);
+		}
+	}
+}
+
+// A destination of `length` bytes at the alignment of the input, followed by guard bytes.
+class fuzz_dest
+{
+public:
+	fuzz_dest(const fuzz_input &in, size_t length)
+		: buf_(in.dest_align + length + KERNEL_FUZZ_GUARD, (char) KERNEL_FUZZ_CANARY),
+			in_(in),
+			length_(length)
+	{
+	}
+
+	char *data() { return &buf_[in_.dest_align]; }
+
+	// Checks that the bytes around the destination were left alone, and the result.
+	void check(const char *kernel, const char *expected)
+	{
+		size_t i;
+
+		for (i = 0; i < buf_.size(); ++i)
+		{
+			if ((i < in_.dest_align || i >= in_.dest_align + length_) && buf_[i] != (char) KERNEL_FUZZ_CANARY)
+				fuzz_fail(in_, kernel, "wrote outside of the destination");
+		}
+		fuzz_compare(in_, kernel, expected, data(), length_);
+
+		std::fill(buf_.begin(), buf_.end(), (char) KERNEL_FUZZ_CANARY);
+	}
+
+private:
+	std::vector<char> buf_;
+	const fuzz_input &in_;
+	size_t length_;
+};
+
+/* references */
+
+// str_ucwords(), with the letters and the case of latin1
+void ucwords_reference(char *dest, const char *src, size_t length, const st_str_pipeline_ctype &ctype)
+{
+	int new_word = 0;
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		const unsigned char c = (unsigned char) src[i];
+
+		dest[i] = src[i];
+		if (ctype.alpha[c])
+		{
+			if (!new_word)
+			{
+				new_word = 1;
+				dest[i] = (char) ctype.upper[c];
+			}
+		}
+		else
+		{
+			new_word = 0;
+		}
+	}
+}
+
+// The XOR of the bytes with those of the key, repeated as needed, as str_pipeline() does
+void xor_repeat_reference(char *dest, const char *src, size_t length, const char *key, size_t key_length)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++)
+		dest[i] = (char) (src[i] ^ key[i % key_length]);
+}
+
+// str_xor(): the longer of the two strings, XORed with the other one padded with NUL bytes
+std::string xor_reference(const char *a, size_t a_length, const char *b, size_t b_length)
+{
+	std::string result(a_length > b_length ? a : b, a_length > b_length ? a_length : b_length);
+	const char *shorter = (a_length > b_length ? b : a);
+	size_t i;
+
+	for (i = 0; i < (a_length > b_length ? b_length : a_length); i++)
+		result[i] = (char) (result[i] ^ shorter[i]);
+	return result;
+}
+
+std::string numtowords_below_thousand(unsigned n)
+{
+	static const char *const small[] = {"", "one", "two", "three", "four", "five", "six", "seven",
+			"eight", "nine", "ten", "eleven", "twelve", "thirteen", "fourteen", "fifteen", "sixteen",
+			"seventeen", "eighteen", "nineteen"};
+	static const char *const tens[] = {"", "", "twenty", "thirty", "forty", "fifty", "sixty", "seventy",
+			"eighty", "ninety"};
+	std::string words;
+
+	if (n >= 100)
+	{
+		words += small[n / 100];
+		words += " hundred";
+		n %= 100;
+	}
+	if (n != 0 && !words.empty())
+		words += " ";
+	if (n >= 20)
+	{
+		words += tens[n / 10];
+		if (n % 10 != 0)
+		{
+			words += "-";
+			words += small[n % 10];
+		}
+	}
+	else
+		words += small[n];
+	return words;
+}
+
+// str_numtowords(): groups of three digits, each followed by its power of a thousand
+std::string numtowords_reference(long long value)
+{
+	static const char *const powers[] = {"", "thousand", "million", "billion", "trillion", "quadrillion",
+			"quintillion"};
+	unsigned long long magnitude = (value < 0 ? 0ULL - (unsigned long long) value : (unsigned long long) value);
+	std::vector<unsigned> groups;
+	std::string words;
+	size_t g;
+
+	if (value == 0)
+		return "zero";
+
+	for (; magnitude != 0; magnitude /= 1000)
+		groups.push_back((unsigned) (magnitude % 1000));
+
+	for (g = groups.size(); g-- > 0;)
+	{
+		if (groups[g] == 0)
+			continue;
+		if (!words.empty())
+			words += " ";
+		words += numtowords_below_thousand(groups[g]);
+		if (g != 0)
+		{
+			words += " ";
+			words += powers[g];
+		}
+	}
+
+	return (value < 0 ? "negative " + words : words);
+}
+
+/* the kernels of string_utils.h */
+
+// Checks the transform `t` of kernel_isa.h of each instruction set that the CPU supports, on the
+// first `length` bytes of the input.
+void check_transform(const fuzz_input &in, kernel_transform t, const char *name, const unsigned char *arg,
+		size_t length, const char *expected)
+{
+	fuzz_dest dest(in, length);
+	char kernel[64];
+	unsigned i;
+
+	for (i = 0; i < kernel_isa_count(); ++i)
+	{
+		const st_kernel_isa *isa = kernel_isa_at(i);
+
+		if (!kernel_isa_supported(isa))
+			continue;
+		isa->transforms[t]((unsigned char *) dest.data(), (const unsigned char *) in.src, arg, length);
+		std::snprintf(kernel, sizeof (kernel), "%s of %s", name, isa->name);
+		dest.check(kernel, expected);
+	}
+}
+
+void check_rot13(const fuzz_input &in)
+{
+	std::vector<char> expected(in.length + 1);
+	fuzz_dest dest(in, in.length);
+
+	rot13_scalar(&expected[0], in.src, in.length);
+
+	check_transform(in, KERNEL_TRANSFORM_rot13, "rot13", NULL, in.length, &expected[0]);
+	rot13_vector(dest.data(), in.src, in.length);
+	dest.check("rot13_vector", &expected[0]);
+	rot13(dest.data(), in.src, in.length);
+	dest.check("rot13", &expected[0]);
+}
+
+// latin1_upper() and latin1_lower(), against the tables of str_pipeline_latin1_ctype()
+void check_latin1_case(const fuzz_input &in)
+{
+	st_str_pipeline_ctype ctype;
+	std::vector<char> expected(in.length + 1);
+	fuzz_dest dest(in, in.length);
+
+	str_pipeline_latin1_ctype(&ctype);
+
+	byte_map_scalar(&expected[0], ctype.upper, in.src, in.length);
+	check_transform(in, KERNEL_TRANSFORM_latin1_upper, "latin1_upper", NULL, in.length, &expected[0]);
+	latin1_upper(dest.data(), in.src, in.length);
+	dest.check("latin1_upper", &expected[0]);
+
+	byte_map_scalar(&expected[0], ctype.lower, in.src, in.length);
+	check_transform(in, KERNEL_TRANSFORM_latin1_lower, "latin1_lower", NULL, in.length, &expected[0]);
+	latin1_lower(dest.data(), in.src, in.length);
+	dest.check("latin1_lower", &expected[0]);
+}
+
+void check_byte_map(const fuzz_input &in)
+{
+	unsigned char table[256];
+	std::vector<char> expected(in.length + 1);
+	fuzz_dest dest(in, in.length);
+	size_t unchanged = 0;
+
+	byte_map_fill(table, in.from, in.to, in.map_length);
+	byte_map_scalar(&expected[0], table, in.src, in.length);
+
+	check_transform(in, KERNEL_TRANSFORM_translate, "translate", table, in.length, &expected[0]);
+	byte_map_vector(dest.data(), table, in.src, in.length);
+	dest.check("byte_map_vector", &expected[0]);
+	byte_map(dest.data(), table, in.src, in.length);
+	dest.check("byte_map", &expected[0]);
+
+	while (unchanged < in.length && expected[unchanged] == in.src[unchanged])
+		unchanged++;
+	if (byte_map_unchanged_length(table, in.src, in.length) != unchanged)
+		fuzz_fail(in, "byte_map_unchanged_length", "wrong length");
+}
+
+void check_xor_bytes(const fuzz_input &in)
+{
+	const size_t shorter_length = (in.key_length < in.length ? in.key_length : in.length);
+	std::vector<char> expected(in.length + 1);
+	fuzz_dest dest(in, in.length);
+
+	xor_bytes_scalar(&expected[0], in.src, in.length, in.key, shorter_length);
+
+	check_transform(in, KERNEL_TRANSFORM_xor, "xor", (const unsigned char *) in.key, shorter_length, &expected[0]);
+
+	xor_bytes_vector(dest.data(), in.src, in.length, in.key, shorter_length);
+	dest.check("xor_bytes_vector", &expected[0]);
+	xor_bytes(dest.data(), in.src, in.length, in.key, shorter_length);
+	dest.check("xor_bytes", &expected[0]);
+}
+
+/* the transforms of pipeline.h */
+
+// Appends the bytes of an argument of a transform, escaped.
+void pipeline_append_arg(std::string &spec, const char *arg, size_t length)
+{
+	char escaped[5];
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		std::snprintf(escaped, sizeof (escaped), "\\x%02x", (unsigned char) arg[i]);
+		spec += escaped;
+	}
+}
+
+void check_pipeline(const fuzz_input &in, const char *kernel, const std::string &spec, const char *expected)
+{
+	st_str_pipeline_ctype ctype;
+	const char *error = NULL;
+	unsigned error_op;
+	st_str_pipeline *p;
+	fuzz_dest dest(in, in.length);
+	std::vector<char> scratch;
+
+	str_pipeline_latin1_ctype(&ctype);
+	p = str_pipeline_compile(spec.data(), spec.size(), &ctype, &error, &error_op);
+	if (p == NULL)
+		fuzz_fail(in, kernel, error);
+	scratch.resize(str_pipeline_scratch_size(p) + 1);
+
+	if (str_pipeline_run(p, in.src, in.length, dest.data(), &scratch[0]) != in.length)
+		fuzz_fail(in, kernel, "changed the length");
+	dest.check(kernel, expected);
+
+	str_pipeline_free(p);
+}
+
+void check_pipelines(const fuzz_input &in)
+{
+	st_str_pipeline_ctype ctype;
+	unsigned char table[256];
+	std::vector<char> expected(in.length + 1), tmp(in.length + 1);
+	std::string spec;
+
+	str_pipeline_latin1_ctype(&ctype);
+	byte_map_fill(table, in.from, in.to, in.map_length);
+
+	rot13_scalar(&expected[0], in.src, in.length);
+	check_pipeline(in, "pipeline rot13", "rot13", &expected[0]);
+
+	ucwords_reference(&expected[0], in.src, in.length, ctype);
+	check_pipeline(in, "pipeline ucwords", "ucwords", &expected[0]);
+
+	byte_map_scalar(&expected[0], ctype.upper, in.src, in.length);
+	check_pipeline(in, "pipeline upper", "upper", &expected[0]);
+
+	byte_map_scalar(&expected[0], ctype.lower, in.src, in.length);
+	check_pipeline(in, "pipeline lower", "lower", &expected[0]);
+
+	if (in.map_length != 0)
+	{
+		byte_map_scalar(&expected[0], table, in.src, in.length);
+		spec = "translate:";
+		pipeline_append_arg(spec, in.from, in.map_length);
+		spec += ":";
+		pipeline_append_arg(spec, in.to, in.map_length);
+		check_pipeline(in, "pipeline translate", spec, &expected[0]);
+	}
+
+	if (in.key_length != 0)
+	{
+		xor_repeat_reference(&expected[0], in.src, in.length, in.key, in.key_length);
+		spec = "xor:";
+		pipeline_append_arg(spec, in.key, in.key_length);
+		check_pipeline(in, "pipeline xor", spec, &expected[0]);
+
+		// the tables that are composed, and the stage between them
+		byte_map_scalar(&expected[0], ctype.lower, in.src, in.length);
+		rot13_scalar(&tmp[0], &expected[0], in.length);
+		ucwords_reference(&expected[0], &tmp[0], in.length, ctype);
+		xor_repeat_reference(&tmp[0], &expected[0], in.length, in.key, in.key_length);
+		byte_map_scalar(&expected[0], ctype.upper, &tmp[0], in.length);
+		spec = "lower|rot13|ucwords|xor:";
+		pipeline_append_arg(spec, in.key, in.key_length);
+		spec += "|upper";
+		check_pipeline(in, "pipeline lower|rot13|ucwords|xor|upper", spec, &expected[0]);
+	}
+}
+
+/* the column functions of str_batch.h */
+
+// A column of the values that the input is cut into, of which some are NULL, sliced from the
+// second value if the destination is odd.
+struct fuzz_column
+{
+	std::vector<int32_t> offsets;
+	std::vector<uint8_t> validity;
+	st_str_column column;
+
+	explicit fuzz_column(const fuzz_input &in)
+	{
+		const size_t first = in.dest_align % 2;
+		size_t start = 0, i;
+
+		offsets.push_back(0);
+		for (i = 0; start < in.length || i <= first; ++i)
+		{
+			const size_t length = (i * 37 + in.dest_align) % 67;
+
+			start = (start + length < in.length ? start + length : in.length);
+			offsets.push_back((int32_t) start);
+		}
+		validity.resize((offsets.size() + 7) / 8, 0xFF);
+		for (i = 0; i + 1 < offsets.size(); ++i)
+		{
+			if ((i + in.src_align) % 5 == 0)
+				validity[i / 8] &= (uint8_t) ~(1u << (i % 8));
+		}
+
+		column.length = offsets.size() - 1 - first;
+		column.offset = first;
+		column.offsets = &offsets[0];
+		column.data = in.src;
+		column.validity = (in.src_align % 3 == 0 ? NULL : &validity[0]);
+	}
+
+	bool is_valid(size_t i) const
+	{
+		const size_t j = column.offset + i;
+
+		return column.validity == NULL || ((column.validity[j / 8] >> (j % 8)) & 1);
+	}
+
+	const char *value(size_t i) const { return column.data + offsets[column.offset + i]; }
+
+	size_t value_length(size_t i) const
+	{
+		return (size_t) (offsets[column.offset + i + 1] - offsets[column.offset + i]);
+	}
+};
+
+bool fuzz_result_is_valid(const st_str_column_buffer &out, size_t i)
+{
+	return out.validity == NULL || ((out.validity[i / 8] >> (i % 8)) & 1);
+}
+
+// Checks the results of a column function, given the reference of each value.
+template <typename Reference>
+void check_batch_result(const fuzz_input &in, const char *kernel, const fuzz_column &c, int error,
+		const st_str_column_buffer &out, Reference reference)
+{
+	size_t i;
+
+	if (error != 0)
+		fuzz_fail(in, kernel, std::strerror(error));
+
+	for (i = 0; i < c.column.length; ++i)
+	{
+		if (fuzz_result_is_valid(out, i) != c.is_valid(i))
+			fuzz_fail(in, kernel, "wrong NULL value");
+		if (c.is_valid(i))
+		{
+			const std::string expected = reference(c.value(i), c.value_length(i));
+
+			if ((size_t) (out.offsets[i + 1] - out.offsets[i]) != expected.size())
+				fuzz_fail(in, kernel, "wrong length of a value");
+			fuzz_compare(in, kernel, expected.data(), out.data + out.offsets[i], expected.size());
+		}
+		else if (out.offsets[i + 1] != out.offsets[i])
+			fuzz_fail(in, kernel, "NULL value not empty");
+	}
+}
+
+void check_batch(const fuzz_input &in)
+{
+	unsigned char table[256];
+	fuzz_column c(in);
+	st_str_column_buffer out;
+
+	byte_map_fill(table, in.from, in.to, in.map_length);
+	str_column_buffer_init(&out);
+
+	check_batch_result(in, "str_batch_rot13", c, str_batch_rot13(&c.column, &out), out,
+			[](const char *value, size_t length) {
+				std::string s(length, '\0');
+				rot13_scalar(&s[0], value, length);
+				return s;
+			});
+
+	check_batch_result(in, "str_batch_translate", c,
+			str_batch_translate(&c.column, in.from, in.to, in.map_length, &out), out,
+			[&table](const char *value, size_t length) {
+				std::string s(length, '\0');
+				byte_map_scalar(&s[0], table, value, length);
+				return s;
+			});
+
+	check_batch_result(in, "str_batch_xor", c, str_batch_xor(&c.column, in.key, in.key_length, &out), out,
+			[&in](const char *value, size_t length) {
+				return xor_reference(value, length, in.key, in.key_length);
+			});
+
+	str_column_buffer_free(&out);
+
+	// The caller's buffers must have a validity bitmap if the input has one.
+	if (c.column.validity != NULL && c.column.length != 0)
+	{
+		std::vector<int32_t> offsets(c.column.length + 1);
+		std::vector<char> data(in.length + 1);
+
+		out.offsets = &offsets[0];
+		out.data = &data[0];
+		out.capacity = data.size();
+		if (str_batch_rot13(&c.column, &out) != EINVAL)
+			fuzz_fail(in, "str_batch_rot13", "no EINVAL without a validity bitmap");
+		str_column_buffer_init(&out);
+	}
+}
+
+/* numtowords */
+
+void check_numtowords_value(const fuzz_input &in, long long value)
+{
+	char words[NUMTOWORDS_MAX_LENGTH];
+	const std::string expected = numtowords_reference(value);
+	const size_t length = numtowords(words, value);
+	char what[64];
+
+	if (length != expected.size())
+	{
+		std::snprintf(what, sizeof (what), "wrong length for %lld", value);
+		fuzz_fail(in, "numtowords", what);
+	}
+	fuzz_compare(in, "numtowords", expected.data(), words, length);
+}
+
+// numtowords() and str_batch_numtowords() of the values that the bytes of the input make.
+void check_numtowords(const fuzz_input &in)
+{
+	const size_t count = in.length / sizeof (int64_t);
+	std::vector<int64_t> values(count + 1);
+	std::vector<uint8_t> validity(count / 8 + 1, 0xFF);
+	st_int64_column column;
+	st_str_column_buffer out;
+	size_t i;
+
+	if (count != 0)
+		std::memcpy(&values[0], in.src, count * sizeof (int64_t));
+	for (i = 0; i < count; ++i)
+	{
+		check_numtowords_value(in, (long long) values[i]);
+		if ((i + in.src_align) % 7 == 0)
+			validity[i / 8] &= (uint8_t) ~(1u << (i % 8));
+	}
+
+	column.length = count;
+	column.offset = 0;
+	column.values = &values[0];
+	column.validity = (in.src_align % 2 == 0 ? NULL : &validity[0]);
+	str_column_buffer_init(&out);
+	if (str_batch_numtowords(&column, &out) != 0)
+		fuzz_fail(in, "str_batch_numtowords", "failed");
+	for (i = 0; i < count; ++i)
+	{
+		const bool valid = (column.validity == NULL || ((validity[i / 8] >> (i % 8)) & 1));
+
+		if (fuzz_result_is_valid(out, i) != valid)
+			fuzz_fail(in, "str_batch_numtowords", "wrong NULL value");
+		if (valid)
+		{
+			const std::string expected = numtowords_reference((long long) values[i]);
+
+			if ((size_t) (out.offsets[i + 1] - out.offsets[i]) != expected.size())
+				fuzz_fail(in, "str_batch_numtowords", "wrong length of a value");
+			fuzz_compare(in, "str_batch_numtowords", expected.data(), out.data + out.offsets[i], expected.size());
+		}
+	}
+	str_column_buffer_free(&out);
+}
+
+// What check_input() checks
+enum
+{
+	CHECK_KERNELS = 1,    // the variants of the kernels of string_utils.h
+	CHECK_TRANSFORMS = 2, // pipeline.h, str_batch.h and numtowords(), which depend less on alignment
+	CHECK_ALL = 3
+};
+
+// Runs the checks `what` on `in`, whose source is copied to a buffer that ends with it, so that
+// reading past it is caught by AddressSanitizer.
+void check_input(fuzz_input in, unsigned what)
+{
+	std::vector<char> src_buf(in.src_align + in.length);
+
+	if (in.length != 0)
+		std::memcpy(&src_buf[in.src_align], in.src, in.length);
+	in.src = (src_buf.empty() ? "" : &src_buf[0] + in.src_align);
+
+	if (what & CHECK_KERNELS)
+	{
+		check_rot13(in);
+		check_latin1_case(in);
+		check_byte_map(in);
+		check_xor_bytes(in);
+	}
+	if (what & CHECK_TRANSFORMS)
+	{
+		check_pipelines(in);
+		check_batch(in);
+		check_numtowords(in);
+	}
+}
+
+} // namespace
+
+#ifdef KERNEL_FUZZ_LIBFUZZER
+
+// The bytes of the fuzzer are: the alignments of the source (low 4 bits) and of the destination,
+// the length of the translation and that of the key, the bytes replaced, those that replace
+// them, the key, and the source, of up to KERNEL_FUZZ_MAX_LENGTH bytes.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	const char *p = (const char *) data;
+	fuzz_input in;
+
+	if (size < 3)
+		return 0;
+
+	in.src_align = data[0] & 15;
+	in.dest_align = data[0] >> 4;
+	in.map_length = data[1];
+	in.key_length = data[2];
+	p += 3;
+	size -= 3;
+
+	if (size < 2 * in.map_length + in.key_length)
+		return 0;
+	in.from = p;
+	in.to = p + in.map_length;
+	in.key = p + 2 * in.map_length;
+	p += 2 * in.map_length + in.key_length;
+	size -= 2 * in.map_length + in.key_length;
+
+	in.src = p;
+	in.length = (size < KERNEL_FUZZ_MAX_LENGTH ? size : KERNEL_FUZZ_MAX_LENGTH);
+
+	g_origin = "libFuzzer";
+	check_input(in, CHECK_ALL);
+	return 0;
+}
+
+#else
+
+namespace {
+
+// splitmix64, so that the inputs of a seed are the same on all platforms
+struct fuzz_random
+{
+	uint64_t state;
+
+	explicit fuzz_random(uint64_t seed) : state(seed) {}
+
+	uint64_t next()
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	size_t below(size_t n) { return (size_t) (next() % n); }
+};
+
+// The bytes around the letters, where rot13, the case and the words change
+const char fuzz_letter_bytes[] = " @AMNZ[`amnz{\xbf\xc0\xd7\xdf\xe0\xf7\xfe\xff\x00\t-";
+
+void fill_random(fuzz_random &rng, char *dest, size_t length)
+{
+	const int letters = (rng.below(2) == 0);
+	size_t i;
+
+	for (i = 0; i < length; ++i)
+		dest[i] = (char) (letters ? fuzz_letter_bytes[rng.below(sizeof (fuzz_letter_bytes) - 1)] : rng.next());
+}
+
+// A translation of random bytes, and a key of up to twice `length` bytes.
+void fill_arguments(fuzz_random &rng, fuzz_input &in, std::vector<char> &args, size_t length)
+{
+	size_t i;
+
+	in.map_length = rng.below(257);
+	in.key_length = rng.below(2 * length + 2);
+	args.resize(2 * in.map_length + in.key_length + 1);
+	for (i = 0; i < args.size(); ++i)
+		args[i] = (char) rng.next();
+	in.from = &args[0];
+	in.to = &args[in.map_length];
+	in.key = &args[2 * in.map_length];
+}
+
+void run_sweep(uint64_t seed)
+{
+	fuzz_random rng(seed);
+	std::vector<char> src(KERNEL_FUZZ_MAX_LENGTH + 1), args;
+	fuzz_input in;
+	size_t length, i;
+	unsigned src_align, dest_align;
+	char origin[64];
+	long long v;
+
+	for (length = 0; length <= KERNEL_FUZZ_MAX_LENGTH; ++length)
+	{
+		// 167 is odd, so that each byte value is at each position modulo 16 in 4096 bytes
+		for (i = 0; i < length; ++i)
+			src[i] = (char) (i * 167 + length);
+		in.src = &src[0];
+		in.length = length;
+		fill_arguments(rng, in, args, length);
+
+		for (src_align = 0; src_align < 16; ++src_align)
+		{
+			for (dest_align = 0; dest_align < 16; ++dest_align)
+			{
+				if (length > KERNEL_FUZZ_ALL_ALIGNMENTS && dest_align != (src_align + length) % 16)
+					continue;
+				std::snprintf(origin, sizeof (origin), "sweep of seed %llu", (unsigned long long) seed);
+				g_origin = origin;
+				in.src_align = src_align;
+				in.dest_align = dest_align;
+				check_input(in, (src_align == length % 16 && dest_align == (src_align + length) % 16 ? CHECK_ALL : CHECK_KERNELS));
+			}
+		}
+	}
+
+	// numtowords() of the values around the powers of ten
+	in.src = "";
+	in.length = 0;
+	for (v = -100000; v <= 100000; ++v)
+		check_numtowords_value(in, v);
+	for (v = 1000000; v < LLONG_MAX / 10; v *= 10)
+	{
+		check_numtowords_value(in, v - 1);
+		check_numtowords_value(in, v);
+		check_numtowords_value(in, v + 1);
+		check_numtowords_value(in, -v);
+	}
+	check_numtowords_value(in, LLONG_MAX);
+	check_numtowords_value(in, LLONG_MIN);
+	check_numtowords_value(in, LLONG_MIN + 1);
+}
+
+void run_random(uint64_t seed, unsigned long iterations)
+{
+	fuzz_random rng(seed);
+	std::vector<char> src, args;
+	fuzz_input in;
+	unsigned long n;
+	char origin[64];
+
+	for (n = 0; n < iterations; ++n)
+	{
+		// mostly short strings, as in most columns
+		const size_t length = rng.below(rng.below(4) == 0 ? KERNEL_FUZZ_MAX_LENGTH + 1 : 65);
+
+		src.resize(length + 1);
+		fill_random(rng, &src[0], length);
+		in.src = &src[0];
+		in.length = length;
+		in.src_align = (unsigned) rng.below(16);
+		in.dest_align = (unsigned) rng.below(16);
+		fill_arguments(rng, in, args, length);
+
+		std::snprintf(origin, sizeof (origin), "iteration %lu of seed %llu", n, (unsigned long long) seed);
+		g_origin = origin;
+		check_input(in, CHECK_ALL);
+	}
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	uint64_t seed = 1;
+	unsigned long iterations = 10000;
+	bool sweep = true;
+	int i, k;
+
+	for (i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+			seed = std::strtoull(argv[++i], NULL, 10);
+		else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+			iterations = std::strtoul(argv[++i], NULL, 10);
+		else if (std::strcmp(argv[i], "--no-sweep") == 0)
+			sweep = false;
+		else
+		{
+			std::fprintf(stderr, "usage: %s [--seed N] [--iterations N] [--no-sweep]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	std::printf("instruction sets:");
+	for (k = 0; k < (int) kernel_isa_count(); ++k)
+	{
+		const st_kernel_isa *isa = kernel_isa_at((unsigned) k);
+
+		std::printf(" %s%s", isa->name, kernel_isa_supported(isa) ? "" : " (not supported by this CPU)");
+	}
+	std::printf("\n");
+
+	for (k = 0; k < KERNEL_COUNT; ++k)
+	{
+		std::printf("%s: %s against %s\n", kernel_name((kernel_id) k),
+				kernel_variant_name((kernel_id) k, KERNEL_VECTOR), kernel_variant_name((kernel_id) k, KERNEL_SCALAR));
+	}
+
+	if (sweep)
+	{
+		run_sweep(seed);
+		std::printf("sweep of lengths 0 to %d: ok\n", KERNEL_FUZZ_MAX_LENGTH);
+	}
+	run_random(seed, iterations);
+	std::printf("%lu random inputs of seed %llu: ok\n", iterations, (unsigned long long) seed);
+	return 0;
+}
+
+#endif
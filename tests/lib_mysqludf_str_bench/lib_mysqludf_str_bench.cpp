@@ -0,0 +1,981 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+// In-process micro-benchmarks of the lib_mysqludf_str kernels. No MySQL server is needed.
+//
+// Usage: lib_mysqludf_str_bench [OPTIONS] [FILTER]
+//
+//   --repeat N         measure each benchmark N times, and report the mean and its 95% confidence
+//                      interval [1]
+//   --cpu N            run on CPU N only; the threads of the worker pool then share it, so that the
+//                      worker_pool benchmarks measure its overhead rather than its speedup
+//   --json FILE        write the results to FILE, as a baseline for --check
+//   --check FILE       compare the results with the baseline FILE, and fail if a benchmark is slower
+//                      by more than the tolerance beyond the confidence intervals of both
+//   --tolerance PCT    the tolerance of --check [10]
+//   --compare FILE     print the speedup of each benchmark over the results in FILE, and of each
+//                      group of benchmarks, without failing
+//   --min-time SECONDS run each benchmark for at least SECONDS [0.5]
+//
+// Only the benchmarks whose name contains FILTER are run. The inputs are generated
+// deterministically, so that the results of two runs can be compared. `make perfcheck` and
+// `make perfcheck-baseline` run --check and --json with the baseline.json of this directory.
+// With --enable-pgo, the build of the library runs these benchmarks as the training workload of
+// profile-guided optimization, and `make pgo-report` runs --compare between a plain build and the
+// optimized one.
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "../../big_buffer.h"
+#include "../../bloom.h"
+#include "../../csv_field.h"
+#include "../../hll.h"
+#include "../../lz4_block.h"
+#include "../../memo.h"
+#include "../../pattern_cache.h"
+#include "../../pipeline.h"
+#include "../../simhash.h"
+#include "../../str_batch.h"
+#include "../../str_probes.h"
+#include "../../string_list.h"
+#include "../../string_utils.h"
+#include "../../topk.h"
+#include "../../worker_pool.h"
+
+static const char *g_filter = NULL;
+static unsigned g_repeat = 1;
+static double g_min_seconds = 0.5;
+
+// Keeps the optimizer from discarding results.
+static volatile std::size_t g_sink;
+
+// The time of an iteration of a benchmark, and the half-width of its 95% confidence interval.
+struct bench_result
+{
+	double ns_per_iter;
+	double ci;
+	double mb_per_s;
+};
+
+static std::map<std::string, bench_result> g_results;
+
+// Returns the critical value of Student's t distribution for a two-sided 95% confidence interval
+// of the mean of `n` samples.
+static double student_t95(unsigned n)
+{
+	static const double t[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228 };
+	if (n < 2) {
+		return 0.0;
+	}
+	return (n - 2 < sizeof t / sizeof t[0] ? t[n - 2] : (n <= 30 ? 2.1 : 1.96));
+}
+
+// Runs `f` repeatedly for at least `min_seconds`, g_repeat times, and reports the throughput,
+// given that each run processes `bytes_per_iter` bytes. Returns the number of runs, including the
+// warm-up run, or 0 if the benchmark was filtered out.
+template <typename F>
+static std::size_t run_bench(const std::string& name, std::size_t bytes_per_iter, F f, double min_seconds = g_min_seconds)
+{
+	if (g_filter != NULL && name.find(g_filter) == std::string::npos) {
+		return 0;
+	}
+
+	typedef std::chrono::steady_clock clock_type;
+	std::vector<double> samples;
+	std::size_t runs = 1;
+
+	f(); // warm up
+
+	for (unsigned r = 0; r < g_repeat; ++r) {
+		std::size_t iterations = 0, batch = 1;
+		double elapsed = 0.0;
+
+		const clock_type::time_point start = clock_type::now();
+		do {
+			for (std::size_t i = 0; i < batch; ++i) {
+				f();
+			}
+			iterations += batch;
+			batch *= 2;
+			elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+		} while (elapsed < min_seconds);
+
+		samples.push_back(elapsed * 1e9 / iterations);
+		runs += iterations;
+	}
+
+	double mean = 0.0, variance = 0.0;
+	for (std::size_t i = 0; i < samples.size(); ++i) {
+		mean += samples[i];
+	}
+	mean /= samples.size();
+	for (std::size_t i = 0; i < samples.size(); ++i) {
+		variance += (samples[i] - mean) * (samples[i] - mean);
+	}
+	if (samples.size() > 1) {
+		variance /= samples.size() - 1;
+	}
+
+	const bench_result result = { mean, student_t95(g_repeat) * std::sqrt(variance / samples.size()), bytes_per_iter * 1e3 / mean };
+	g_results[name] = result;
+	if (g_repeat > 1) {
+		std::printf("%-40s %12.1f MB/s %12.1f ns/iter +- %.1f%%\n", name.c_str(), result.mb_per_s, mean, 100.0 * result.ci / mean);
+	} else {
+		std::printf("%-40s %12.1f MB/s %12.1f ns/iter\n", name.c_str(), result.mb_per_s, mean);
+	}
+	return runs;
+}
+
+#ifndef _WIN32
+static long minor_faults()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_minflt;
+}
+
+// Like run_bench, and also reports the page faults taken per run.
+template <typename F>
+static void run_bench_faults(const std::string& name, std::size_t bytes_per_iter, F f, double min_seconds = g_min_seconds)
+{
+	const long before = minor_faults();
+	const std::size_t runs = run_bench(name, bytes_per_iter, f, min_seconds);
+	if (runs != 0) {
+		std::printf("%-40s %12.1f faults/iter\n", name.c_str(), static_cast<double>(minor_faults() - before) / runs);
+	}
+}
+#endif
+
+// Builds a CSV record of about `length` bytes whose fields are a mix of plain words, quoted
+// fields containing delimiters, and quoted fields containing doubled quotes.
+static std::string make_csv_line(std::size_t length)
+{
+	static const char *const fields[] = {
+		"12345", "plain word", "\"quoted, with comma\"", "\"say \"\"hi\"\"\"", "3.1415", "\"\"", "x"
+	};
+	std::string line;
+	for (std::size_t i = 0; line.size() < length; ++i) {
+		if (i != 0) {
+			line += ',';
+		}
+		line += fields[i % (sizeof fields / sizeof fields[0])];
+	}
+	return line;
+}
+
+static std::size_t count_csv_fields(const std::string& line)
+{
+	std::size_t n = 1, b, e;
+	while (csv_field_locate_scalar(line.data(), line.size(), n + 1, ',', '"', &b, &e)) {
+		++n;
+	}
+	return n;
+}
+
+static void bench_csv_field()
+{
+	static const std::size_t lengths[] = { 1024, 64 * 1024 };
+
+	for (std::size_t i = 0; i < sizeof lengths / sizeof lengths[0]; ++i) {
+		const std::string line = make_csv_line(lengths[i]);
+		const std::size_t last = count_csv_fields(line);
+		const std::string suffix = "/" + std::to_string(lengths[i] / 1024) + "KB";
+
+		// Selecting the last field is the worst case: the whole record has to be scanned.
+		run_bench("csv_field/scalar" + suffix, line.size(), [&]() {
+			std::size_t b, e;
+			csv_field_locate_scalar(line.data(), line.size(), last, ',', '"', &b, &e);
+			g_sink = e - b;
+		});
+		run_bench("csv_field/bitmask" + suffix, line.size(), [&]() {
+			std::size_t b, e;
+			csv_field_locate(line.data(), line.size(), last, ',', '"', &b, &e);
+			g_sink = e - b;
+		});
+	}
+}
+
+// Builds about `length` bytes of JSON documents like the ones that are archived row by row.
+static std::string make_json_payload(std::size_t length)
+{
+	std::string payload;
+	for (unsigned i = 0; payload.size() < length; ++i) {
+		payload += "{\"id\":" + std::to_string(100000 + i * 7919 % 100000)
+				+ ",\"status\":\"" + (i % 3 == 0 ? "shipped" : "pending")
+				+ "\",\"customer\":{\"name\":\"customer " + std::to_string(i % 977)
+				+ "\",\"country\":\"" + (i % 5 == 0 ? "DE" : "US")
+				+ "\"},\"total\":" + std::to_string(i * 37 % 10000) + "." + std::to_string(i % 100) + "}\n";
+	}
+	payload.resize(length);
+	return payload;
+}
+
+static void bench_lz4()
+{
+	static const std::size_t lengths[] = { 4 * 1024, 256 * 1024 };
+	std::vector<uint32_t> hash_table(LZ4_BLOCK_HASH_SIZE);
+
+	for (std::size_t i = 0; i < sizeof lengths / sizeof lengths[0]; ++i) {
+		const std::string payload = make_json_payload(lengths[i]);
+		const std::string suffix = "/" + std::to_string(lengths[i] / 1024) + "KB";
+		std::vector<char> compressed(lz4_block_compress_bound(payload.size()));
+		std::vector<char> decompressed(payload.size());
+		std::size_t compressed_length = 0;
+
+		run_bench("lz4/compress" + suffix, payload.size(), [&]() {
+			compressed_length = lz4_block_compress(payload.data(), payload.size(), &compressed[0], &hash_table[0], 1);
+		});
+		run_bench("lz4/compress_accel8" + suffix, payload.size(), [&]() {
+			g_sink = lz4_block_compress(payload.data(), payload.size(), &compressed[0], &hash_table[0], 8);
+		});
+		compressed_length = lz4_block_compress(payload.data(), payload.size(), &compressed[0], &hash_table[0], 1);
+		run_bench("lz4/decompress" + suffix, payload.size(), [&]() {
+			g_sink = lz4_block_decompress(&compressed[0], compressed_length, &decompressed[0], decompressed.size());
+		});
+		std::printf("%-40s %12.3f\n", ("lz4/ratio" + suffix).c_str(), static_cast<double>(payload.size()) / compressed_length);
+	}
+}
+
+static void bench_simhash()
+{
+	const std::string description = make_json_payload(1024);
+	run_bench("simhash/1KB", description.size(), [&]() {
+		g_sink = static_cast<std::size_t>(simhash64(description.data(), description.size(), 4));
+	});
+
+	static const std::size_t lengths[] = { 8, 1024, 64 * 1024 };
+	for (std::size_t i = 0; i < sizeof lengths / sizeof lengths[0]; ++i) {
+		const std::string a = make_json_payload(lengths[i]), b = make_json_payload(lengths[i] + 1).substr(1);
+		run_bench(std::string("hamming/") + hamming_distance_impl_name() + "/" + std::to_string(lengths[i]) + "B", lengths[i], [&]() {
+			g_sink = static_cast<std::size_t>(hamming_distance(a.data(), a.size(), b.data(), b.size()));
+		});
+	}
+}
+
+static void bench_bloom()
+{
+	// 4M keys at 1% make a filter of about 5 MB, larger than most L2 caches.
+	const std::size_t num_keys = 4 * 1024 * 1024, num_probes = 64 * 1024;
+	st_bloom_filter bf;
+	if (bloom_filter_init(&bf, bloom_blocks_for(num_keys, 0.01)) != 0) {
+		std::fprintf(stderr, "bloom_filter_init() failed\n");
+		return;
+	}
+
+	char key[32];
+	for (std::size_t i = 0; i < num_keys; ++i) {
+		const int key_length = std::sprintf(key, "customer-%zu", i);
+		bloom_filter_add(&bf, bloom_hash(key, static_cast<std::size_t>(key_length)));
+	}
+
+	std::vector<std::string> probes;
+	for (std::size_t i = 0; i < num_probes; ++i) {
+		std::sprintf(key, "customer-%zu", (i * 2654435761u) % (2 * num_keys));
+		probes.push_back(key);
+	}
+
+	std::size_t next = 0;
+	run_bench("bloom/contains/4M", probes[0].size(), [&]() {
+		const std::string& probe = probes[next++ % num_probes];
+		g_sink = static_cast<std::size_t>(bloom_filter_contains(&bf, bloom_hash(probe.data(), probe.size())));
+	});
+
+	std::vector<char> serialized(bloom_filter_serialized_size(&bf));
+	bloom_filter_serialize(&bf, &serialized[0]);
+	run_bench("bloom/contains_serialized/4M", probes[0].size(), [&]() {
+		const std::string& probe = probes[next++ % num_probes];
+		g_sink = static_cast<std::size_t>(bloom_serialized_contains(&serialized[0], bf.num_blocks, bloom_hash(probe.data(), probe.size())));
+	});
+
+	bloom_filter_free(&bf);
+}
+
+static void bench_hll()
+{
+	const std::size_t num_urls = 64 * 1024;
+	std::vector<std::string> urls;
+	char url[64];
+	for (std::size_t i = 0; i < num_urls; ++i) {
+		std::sprintf(url, "/products/%zu?ref=home", i);
+		urls.push_back(url);
+	}
+
+	st_hll hll;
+	hll_init(&hll, HLL_DEFAULT_PRECISION);
+	std::size_t next = 0;
+	run_bench("hll/add", urls[0].size(), [&]() {
+		const std::string& u = urls[next++ % num_urls];
+		hll_add(&hll, hll_hash(u.data(), u.size()));
+	});
+
+	// Rolling up daily dense sketches: one vector max per 16 registers.
+	std::vector<char> day(hll_serialized_size(&hll));
+	hll_serialize(&hll, &day[0]);
+	run_bench("hll/merge_dense/p14", day.size(), [&]() {
+		g_sink = static_cast<std::size_t>(hll_merge_serialized(&hll, &day[0], day.size()));
+	});
+
+	run_bench("hll/count/p14", day.size(), [&]() {
+		g_sink = static_cast<std::size_t>(hll_serialized_estimate(&day[0], day.size()));
+	});
+
+	hll_free(&hll);
+}
+
+static void bench_topk()
+{
+	// Search terms with a skewed distribution over many more distinct terms than counters
+	const std::size_t num_terms = 256 * 1024;
+	std::vector<std::string> terms;
+	char term[64];
+	unsigned long long x = 88172645463325252ULL;
+	for (std::size_t i = 0; i < num_terms; ++i) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		const unsigned long long r = x % 1000000, rank = (r * r / 1000000) * (r % 1000) / 1000;
+		std::sprintf(term, "query %llu", rank);
+		terms.push_back(term);
+	}
+
+	static const std::size_t capacities[] = { 100, 10000 };
+	for (std::size_t c = 0; c < sizeof capacities / sizeof capacities[0]; ++c) {
+		st_topk *tk = topk_alloc(capacities[c]);
+		std::size_t next = 0;
+		run_bench("topk/add/capacity=" + std::to_string(capacities[c]), terms[0].size(), [&]() {
+			const std::string& t = terms[next++ % num_terms];
+			g_sink = static_cast<std::size_t>(topk_add(tk, t.data(), t.size()));
+		});
+		topk_free(tk);
+	}
+}
+
+static void bench_agg()
+{
+	// A group of short values, half of which are repeated
+	const std::size_t num_values = 100000;
+	std::vector<std::string> values;
+	std::size_t bytes = 0;
+	char value[32];
+	for (std::size_t i = 0; i < num_values; ++i) {
+		std::sprintf(value, "customer-%zu", i % (num_values / 2));
+		values.push_back(value);
+		bytes += values.back().size();
+	}
+
+	st_char_vector *vec = char_vector_alloc();
+	for (int distinct = 0; distinct <= 1; ++distinct) {
+		st_string_list *list = string_list_alloc(distinct);
+		run_bench(std::string("agg/100K") + (distinct ? "/distinct" : ""), bytes, [&]() {
+			string_list_clear(list);
+			for (std::size_t i = 0; i < num_values; ++i) {
+				string_list_add(list, values[i].data(), values[i].size());
+			}
+			string_list_join(list, vec, ",", 1);
+			g_sink = char_vector_length(vec);
+		});
+		string_list_free(list);
+	}
+	char_vector_free(vec);
+}
+
+static void *bench_compile_table(const char *key, std::size_t key_length, std::size_t *size)
+{
+	unsigned char *table = static_cast<unsigned char *>(std::malloc(256));
+	if (table != NULL) {
+		for (int i = 0; i < 256; ++i) {
+			table[i] = static_cast<unsigned char>(i);
+		}
+		for (std::size_t i = 0; i < key_length / 2; ++i) {
+			table[static_cast<unsigned char>(key[i])] = static_cast<unsigned char>(key[key_length / 2 + i]);
+		}
+	}
+	*size = 256;
+	return table;
+}
+
+static void bench_pattern_cache()
+{
+	// What the _init and _deinit functions of a statement with constant arguments pay
+	static const char key[] = "aeiouAEIOU";
+	st_pattern_cache_entry *warm = pattern_cache_acquire("bench", key, sizeof key - 1, bench_compile_table, std::free);
+	run_bench("pattern_cache/acquire_release", sizeof key - 1, [&]() {
+		st_pattern_cache_entry *e = pattern_cache_acquire("bench", key, sizeof key - 1, bench_compile_table, std::free);
+		g_sink = *static_cast<const unsigned char *>(pattern_cache_value(e));
+		pattern_cache_release(e);
+	});
+	pattern_cache_release(warm);
+}
+
+static void bench_memo()
+{
+	// Lookups of country names, which all hit after the first round
+	static const char *const countries[] = { "Argentina", "Brazil", "Canada", "Denmark", "Egypt", "France", "Germany", "Hungary" };
+	const std::size_t num_countries = sizeof countries / sizeof countries[0];
+	st_memo *m = memo_alloc();
+	std::size_t next = 0;
+	run_bench("memo/lookup_hit", std::strlen(countries[0]), [&]() {
+		const char *country = countries[next++ % num_countries];
+		const std::size_t length = std::strlen(country);
+		const char *value;
+		std::size_t value_length;
+		char is_null;
+		if (!memo_lookup(m, country, length, &value, &value_length, &is_null)) {
+			memo_store(m, country, length, country, length, 0);
+			value_length = 0;
+		}
+		g_sink = value_length;
+	});
+	memo_free(m);
+}
+
+static void bench_translate()
+{
+	// str_translate(col, 'ABCDEFGHIJKLMNOPQRSTUVWXYZ', 'abcdefghijklmnopqrstuvwxyz') over a column
+	// that was lowercased on the way in, which is what most rows of a normalizing UPDATE look like
+	static const char key[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+	std::size_t table_size;
+	unsigned char *table = static_cast<unsigned char *>(bench_compile_table(key, sizeof key - 1, &table_size));
+	const std::string payload = make_json_payload(4096);
+	std::vector<char> result(payload.size());
+	byte_map(&result[0], table, payload.data(), payload.size());
+	const std::string normalized(result.begin(), result.end());
+	std::string changed = normalized;
+	changed[changed.size() / 2] = 'X';
+
+	// What every row paid before: the whole subject is mapped into the result buffer.
+	run_bench("translate/copy/normalized", normalized.size(), [&]() {
+		byte_map(&result[0], table, normalized.data(), normalized.size());
+		g_sink = result[0];
+	});
+	// The subject is returned as is once the scan finds nothing to change.
+	run_bench("translate/cow/normalized", normalized.size(), [&]() {
+		g_sink = byte_map_unchanged_length(table, normalized.data(), normalized.size());
+	});
+	// Only the half before the first change is copied without being mapped.
+	run_bench("translate/cow/changed_half", changed.size(), [&]() {
+		const std::size_t i = byte_map_unchanged_length(table, changed.data(), changed.size());
+		std::memcpy(&result[0], changed.data(), i);
+		byte_map(&result[i], table, changed.data() + i, changed.size() - i);
+		g_sink = result[0];
+	});
+	std::free(table);
+}
+
+static void bench_kernels()
+{
+	// The scalar and the vector variants of the kernels of str_rot13, str_translate and str_xor over
+	// short and long values, which are what kernel_select.h chooses between
+	static const std::size_t lengths[] = { 8, 32, 4096 };
+	static const char key[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	std::size_t table_size;
+	unsigned char *table = static_cast<unsigned char *>(bench_compile_table(key, sizeof key - 1, &table_size));
+	const std::string payload = make_json_payload(4096);
+	const std::string xor_key(payload.rbegin(), payload.rend());
+	std::vector<char> result(payload.size());
+
+	for (std::size_t k = 0; k < sizeof lengths / sizeof lengths[0]; ++k) {
+		const std::size_t n = lengths[k];
+		const std::string suffix = "/" + std::to_string(n);
+		run_bench("kernels/rot13/scalar" + suffix, n, [&]() {
+			rot13_scalar(&result[0], payload.data(), n);
+			g_sink = result[0];
+		});
+		run_bench("kernels/rot13/vector" + suffix, n, [&]() {
+			rot13_vector(&result[0], payload.data(), n);
+			g_sink = result[0];
+		});
+		run_bench("kernels/translate/scalar" + suffix, n, [&]() {
+			byte_map_scalar(&result[0], table, payload.data(), n);
+			g_sink = result[0];
+		});
+		run_bench("kernels/translate/vector" + suffix, n, [&]() {
+			byte_map_vector(&result[0], table, payload.data(), n);
+			g_sink = result[0];
+		});
+		run_bench("kernels/xor/scalar" + suffix, n, [&]() {
+			xor_bytes_scalar(&result[0], payload.data(), n, xor_key.data(), n / 2);
+			g_sink = result[0];
+		});
+		run_bench("kernels/xor/vector" + suffix, n, [&]() {
+			xor_bytes_vector(&result[0], payload.data(), n, xor_key.data(), n / 2);
+			g_sink = result[0];
+		});
+	}
+	std::free(table);
+}
+
+#ifndef _WIN32
+// str_xor(col, key) over LONGBLOB values: each statement needs a result buffer as large as the
+// value, and each row writes all of it.
+static void bench_big_buffer()
+{
+	const std::size_t length = 64 * 1024 * 1024;
+	std::vector<char> value(length, 'v');
+	const char key = 'k';
+
+	// What each statement paid before: a fresh heap block, which the allocator maps and unmaps.
+	run_bench_faults("big_buffer/malloc_per_statement/64MB", length, [&]() {
+		char *buf = static_cast<char *>(std::malloc(length));
+		for (std::size_t i = 0; i < length; ++i) {
+			buf[i] = value[i] ^ key;
+		}
+		g_sink = buf[length - 1];
+		std::free(buf);
+	}, 2.0);
+	// A mapping per statement, with huge pages if transparent huge pages are enabled for madvise
+	run_bench_faults("big_buffer/map_per_statement/64MB", length, [&]() {
+		st_big_buffer b;
+		big_buffer_init(&b);
+		b.threshold = BIG_BUFFER_DEFAULT_THRESHOLD;
+		big_buffer_reserve(&b, length);
+		for (std::size_t i = 0; i < length; ++i) {
+			b.data[i] = value[i] ^ key;
+		}
+		g_sink = b.data[length - 1];
+		big_buffer_free(&b);
+	}, 2.0);
+	// The following rows of a statement reuse the mapping.
+	st_big_buffer reused;
+	big_buffer_init(&reused);
+	reused.threshold = BIG_BUFFER_DEFAULT_THRESHOLD;
+	run_bench_faults("big_buffer/map_reused_per_row/64MB", length, [&]() {
+		big_buffer_reserve(&reused, length);
+		for (std::size_t i = 0; i < length; ++i) {
+			reused.data[i] = value[i] ^ key;
+		}
+		g_sink = reused.data[length - 1];
+	}, 2.0);
+	big_buffer_free(&reused);
+}
+#endif
+
+struct bench_map_job {
+	const unsigned char *table;
+	const char *src;
+	char *dest;
+};
+
+static void bench_map_range(void *ctx, std::size_t begin, std::size_t end)
+{
+	const bench_map_job *job = static_cast<const bench_map_job *>(ctx);
+	byte_map(job->dest + begin, job->table, job->src + begin, end - begin);
+}
+
+static void bench_worker_pool()
+{
+	// str_translate over a 64 MB value. The pool has LIB_MYSQLUDF_STR_THREADS threads, or one less
+	// than there are processors.
+	static const char key[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+	const std::size_t length = 64 * 1024 * 1024;
+	std::size_t table_size;
+	unsigned char *table = static_cast<unsigned char *>(bench_compile_table(key, sizeof key - 1, &table_size));
+	std::vector<char> src(length, 'V'), dest(length);
+	bench_map_job job = { table, &src[0], &dest[0] };
+
+	run_bench("worker_pool/translate/64MB/serial", length, [&]() {
+		bench_map_range(&job, 0, length);
+		g_sink = dest[length - 1];
+	});
+	run_bench("worker_pool/translate/64MB/pool", length, [&]() {
+		worker_pool_run(length, bench_map_range, &job);
+		g_sink = dest[length - 1];
+	});
+
+	st_worker_pool_stats stats;
+	worker_pool_get_stats(&stats);
+	if (stats.jobs != 0) {
+		std::printf("%-40s %12llu threads\n", "worker_pool/translate/64MB/pool", static_cast<unsigned long long>(stats.threads));
+	}
+	std::free(table);
+}
+
+static st_str_pipeline *bench_compile_pipeline(const char *spec, const st_str_pipeline_ctype& ctype)
+{
+	const char *error;
+	unsigned error_op;
+	st_str_pipeline *p = str_pipeline_compile(spec, std::strlen(spec), &ctype, &error, &error_op);
+
+	if (p == NULL) {
+		std::fprintf(stderr, "%s: %s in transform %u\n", spec, error, error_op);
+		std::exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+static void bench_pipeline(std::size_t length, const char *size_name)
+{
+	// str_pipeline('lower|trim|squeeze|ucwords', col) against the nested calls that it replaces,
+	// each of which makes a pass over a whole intermediate result
+	static const char *const ops[] = { "lower", "trim", "squeeze", "ucwords" };
+	static const std::size_t num_ops = sizeof ops / sizeof ops[0];
+	st_str_pipeline_ctype ctype;
+	for (unsigned i = 0; i < 256; ++i) {
+		ctype.upper[i] = static_cast<unsigned char>(std::toupper(static_cast<int>(i)));
+		ctype.lower[i] = static_cast<unsigned char>(std::tolower(static_cast<int>(i)));
+		ctype.alpha[i] = (std::isalpha(static_cast<int>(i)) ? 1 : 0);
+	}
+	const std::string payload = "   " + make_json_payload(length) + "   ";
+
+	st_str_pipeline *fused = bench_compile_pipeline("lower|trim|squeeze|ucwords", ctype);
+	std::vector<char> scratch(str_pipeline_scratch_size(fused));
+	std::vector<char> result(payload.size());
+	run_bench(std::string("pipeline/fused/") + size_name, payload.size(), [&]() {
+		g_sink = str_pipeline_run(fused, payload.data(), payload.size(), &result[0], &scratch[0]);
+	});
+	str_pipeline_free(fused);
+
+	st_str_pipeline *chained[num_ops];
+	for (std::size_t k = 0; k < num_ops; ++k) {
+		chained[k] = bench_compile_pipeline(ops[k], ctype);
+	}
+	std::vector<char> intermediate(payload.size());
+	run_bench(std::string("pipeline/chained/") + size_name, payload.size(), [&]() {
+		const char *src = payload.data();
+		std::size_t n = payload.size();
+		for (std::size_t k = 0; k < num_ops; ++k) {
+			char *dest = (k % 2 == 0 ? &intermediate[0] : &result[0]);
+			n = str_pipeline_run(chained[k], src, n, dest, &scratch[0]);
+			src = dest;
+		}
+		g_sink = n;
+	});
+	for (std::size_t k = 0; k < num_ops; ++k) {
+		str_pipeline_free(chained[k]);
+	}
+}
+
+static void bench_batch()
+{
+	// str_rot13(col) over a column of 64K short values, such as names, one call per value like the
+	// UDF is called, against a single call over the whole column
+	static const std::size_t num_values = 64 * 1024;
+	std::vector<std::int32_t> offsets(num_values + 1);
+	std::string data;
+	for (std::size_t i = 0; i < num_values; ++i) {
+		offsets[i] = static_cast<std::int32_t>(data.size());
+		data.append(make_json_payload(4 + i % 17), 0, 4 + i % 17);
+	}
+	offsets[num_values] = static_cast<std::int32_t>(data.size());
+	const st_str_column column = { num_values, 0, &offsets[0], data.data(), NULL };
+
+	std::vector<std::int32_t> result_offsets(num_values + 1);
+	std::vector<char> result(data.size());
+	run_bench("batch/rot13/per_value", data.size(), [&]() {
+		std::size_t size = 0;
+		for (std::size_t i = 0; i < num_values; ++i) {
+			const std::size_t n = static_cast<std::size_t>(offsets[i + 1] - offsets[i]);
+			result_offsets[i] = static_cast<std::int32_t>(size);
+			rot13(&result[size], data.data() + offsets[i], n);
+			size += n;
+		}
+		result_offsets[num_values] = static_cast<std::int32_t>(size);
+		g_sink = size;
+	});
+
+	st_str_column_buffer out;
+	str_column_buffer_init(&out);
+	run_bench("batch/rot13/column", data.size(), [&]() {
+		g_sink = (str_batch_rot13(&column, &out) == 0 ? out.size : 0);
+	});
+	run_bench("batch/xor/column", data.size(), [&]() {
+		g_sink = (str_batch_xor(&column, "k3y", 3, &out) == 0 ? out.size : 0);
+	});
+	str_column_buffer_free(&out);
+}
+
+STR_PROBE_DEFINE_SEMAPHORES;
+
+typedef void (*bench_row_fn)(char *, const char *, std::size_t, std::size_t *);
+
+static void bench_bare_row(char *dest, const char *src, std::size_t n, std::size_t *res_length)
+{
+	rot13(dest, src, n);
+	*res_length = n;
+}
+
+static void bench_traced_row(char *dest, const char *src, std::size_t n, std::size_t *res_length)
+{
+	const unsigned long input_length = ((STR_PROBE_ENABLED(row__entry) || STR_PROBE_ENABLED(row__return)) ? static_cast<unsigned long>(n) : 0);
+	STR_PROBE2(row__entry, "bench", input_length);
+	rot13(dest, src, n);
+	*res_length = n;
+	if (STR_PROBE_ENABLED(row__return))
+		STR_PROBE5(row__return, "bench", input_length, *res_length, 0, 0);
+}
+
+static void bench_probes()
+{
+	// The probes that the exported functions fire around each row (see str_probes.h), around
+	// str_rot13() of a 16-byte value, against the bare call. Built with <sys/sdt.h> and run without
+	// a tracer attached, the two should not differ measurably.
+#ifdef HAVE_SYS_SDT_H
+	static const char *const variant = "sdt";
+#else
+	static const char *const variant = "compiled_out";
+#endif
+	static const std::size_t num_rows = 1024;
+	const std::string value = make_json_payload(16).substr(0, 16);
+	char result[16];
+	bench_row_fn volatile bare = bench_bare_row;
+	bench_row_fn volatile traced = bench_traced_row;
+
+	run_bench(std::string("probes/bare_row/") + variant, value.size() * num_rows, [&]() {
+		std::size_t length = 0;
+		for (std::size_t i = 0; i < num_rows; ++i) {
+			bare(result, value.data(), value.size(), &length);
+		}
+		g_sink = length;
+	});
+	run_bench(std::string("probes/traced_row/") + variant, value.size() * num_rows, [&]() {
+		std::size_t length = 0;
+		for (std::size_t i = 0; i < num_rows; ++i) {
+			traced(result, value.data(), value.size(), &length);
+		}
+		g_sink = length;
+	});
+}
+
+// Writes the results to `path`, one benchmark per line.
+static bool write_baseline(const char *path)
+{
+	std::FILE *out = std::fopen(path, "w");
+	if (out == NULL) {
+		return false;
+	}
+	std::fprintf(out, "{\n");
+	for (std::map<std::string, bench_result>::const_iterator it = g_results.begin(); it != g_results.end(); ++it) {
+		std::fprintf(out, "\"%s\": {\"ns_per_iter\": %.2f, \"ci\": %.2f, \"mb_per_s\": %.1f}%s\n", it->first.c_str(),
+				it->second.ns_per_iter, it->second.ci, it->second.mb_per_s, (std::next(it) == g_results.end() ? "" : ","));
+	}
+	std::fprintf(out, "}\n");
+	return std::fclose(out) == 0;
+}
+
+// Reads a baseline written by write_baseline().
+static bool read_baseline(const char *path, std::map<std::string, bench_result>& baseline)
+{
+	std::ifstream in(path);
+	std::string line;
+
+	if (!in) {
+		return false;
+	}
+	while (std::getline(in, line)) {
+		const std::string::size_type end_of_name = line.find("\": {");
+		bench_result result;
+		if (line.empty() || line[0] != '"' || end_of_name == std::string::npos
+				|| std::sscanf(line.c_str() + end_of_name, "\": {\"ns_per_iter\": %lf, \"ci\": %lf, \"mb_per_s\": %lf",
+						&result.ns_per_iter, &result.ci, &result.mb_per_s) != 3) {
+			continue;
+		}
+		baseline[line.substr(1, end_of_name - 1)] = result;
+	}
+	return true;
+}
+
+// Compares the results with the baseline at `path`, and prints the differences. A benchmark
+// regressed if it is slower than the baseline by more than `tolerance` even when both are taken at
+// the ends of their confidence intervals that are the most favorable to it. Returns the number of
+// regressions, or -1 if the baseline cannot be read.
+static int check_baseline(const char *path, double tolerance)
+{
+	std::map<std::string, bench_result> baseline;
+	int regressions = 0;
+
+	if (!read_baseline(path, baseline)) {
+		return -1;
+	}
+
+	std::printf("\n%-40s %12s %12s %8s\n", "benchmark", "baseline ns", "ns", "change");
+	for (std::map<std::string, bench_result>::const_iterator it = g_results.begin(); it != g_results.end(); ++it) {
+		const std::map<std::string, bench_result>::const_iterator base = baseline.find(it->first);
+		if (base == baseline.end()) {
+			std::printf("%-40s %12s %12.1f %8s  new\n", it->first.c_str(), "-", it->second.ns_per_iter, "");
+			continue;
+		}
+
+		const bench_result& b = base->second;
+		const bench_result& r = it->second;
+		const double change = 100.0 * (r.ns_per_iter / b.ns_per_iter - 1.0);
+		const char *verdict = "";
+		if (r.ns_per_iter - r.ci > (b.ns_per_iter + b.ci) * (1.0 + tolerance / 100.0)) {
+			verdict = "  REGRESSION";
+			++regressions;
+		} else if (r.ns_per_iter + r.ci < (b.ns_per_iter - b.ci) / (1.0 + tolerance / 100.0)) {
+			verdict = "  faster";
+		}
+		std::printf("%-40s %12.1f %12.1f %+7.1f%%%s\n", it->first.c_str(), b.ns_per_iter, r.ns_per_iter, change, verdict);
+	}
+	for (std::map<std::string, bench_result>::const_iterator it = baseline.begin(); it != baseline.end(); ++it) {
+		if (g_results.find(it->first) == g_results.end() && (g_filter == NULL || it->first.find(g_filter) != std::string::npos)) {
+			std::printf("%-40s %12.1f %12s %8s  missing\n", it->first.c_str(), it->second.ns_per_iter, "-", "");
+		}
+	}
+
+	if (regressions != 0) {
+		std::printf("\n%d benchmark%s slower than %s by more than %.0f%% beyond the noise\n",
+				regressions, (regressions == 1 ? " is" : "s are"), path, tolerance);
+	}
+	return regressions;
+}
+
+// Prints the speedup of each benchmark over the baseline at `path`, and the geometric mean of the
+// speedups of each group of benchmarks, which is the first part of their names, such as "kernels"
+// or "lz4". Returns false if the baseline cannot be read.
+static bool compare_baseline(const char *path)
+{
+	std::map<std::string, bench_result> baseline;
+	std::map<std::string, std::pair<double, unsigned> > groups;
+	double log_sum = 0.0;
+	unsigned count = 0;
+
+	if (!read_baseline(path, baseline)) {
+		return false;
+	}
+
+	std::printf("\n%-40s %12s %12s %8s\n", "benchmark", "baseline ns", "ns", "speedup");
+	for (std::map<std::string, bench_result>::const_iterator it = g_results.begin(); it != g_results.end(); ++it) {
+		const std::map<std::string, bench_result>::const_iterator base = baseline.find(it->first);
+		if (base == baseline.end() || it->second.ns_per_iter <= 0.0) {
+			continue;
+		}
+
+		const double speedup = base->second.ns_per_iter / it->second.ns_per_iter;
+		std::pair<double, unsigned>& group = groups[it->first.substr(0, it->first.find('/'))];
+		group.first += std::log(speedup);
+		++group.second;
+		log_sum += std::log(speedup);
+		++count;
+		std::printf("%-40s %12.1f %12.1f %7.2fx\n", it->first.c_str(), base->second.ns_per_iter, it->second.ns_per_iter, speedup);
+	}
+
+	std::printf("\n%-40s %12s %8s\n", "group", "benchmarks", "speedup");
+	for (std::map<std::string, std::pair<double, unsigned> >::const_iterator it = groups.begin(); it != groups.end(); ++it) {
+		std::printf("%-40s %12u %7.2fx\n", it->first.c_str(), it->second.second, std::exp(it->second.first / it->second.second));
+	}
+	if (count != 0) {
+		std::printf("%-40s %12u %7.2fx\n", "all", count, std::exp(log_sum / count));
+	}
+	return true;
+}
+
+static void usage()
+{
+	std::fprintf(stderr, "usage: lib_mysqludf_str_bench [--repeat N] [--cpu N] [--json FILE] [--check FILE] [--tolerance PCT] [--compare FILE] [--min-time SECONDS] [FILTER]\n");
+	std::exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+	const char *json_path = NULL;
+	const char *check_path = NULL;
+	const char *compare_path = NULL;
+	double tolerance = 10.0;
+	int cpu = -1;
+
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool has_value = (i + 1 < argc);
+		if (arg == "--repeat" && has_value) {
+			g_repeat = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+		} else if (arg == "--cpu" && has_value) {
+			cpu = std::atoi(argv[++i]);
+		} else if (arg == "--json" && has_value) {
+			json_path = argv[++i];
+		} else if (arg == "--check" && has_value) {
+			check_path = argv[++i];
+		} else if (arg == "--tolerance" && has_value) {
+			tolerance = std::strtod(argv[++i], NULL);
+		} else if (arg == "--compare" && has_value) {
+			compare_path = argv[++i];
+		} else if (arg == "--min-time" && has_value) {
+			g_min_seconds = std::strtod(argv[++i], NULL);
+		} else if (arg[0] != '-' && g_filter == NULL) {
+			g_filter = argv[i];
+		} else {
+			usage();
+		}
+	}
+	if (g_repeat == 0 || tolerance < 0 || g_min_seconds < 0) {
+		usage();
+	}
+
+	if (cpu >= 0) {
+#ifdef __linux__
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+		if (sched_setaffinity(0, sizeof set, &set) != 0) {
+			std::perror("sched_setaffinity");
+			return EXIT_FAILURE;
+		}
+#else
+		std::fprintf(stderr, "--cpu is only supported on Linux\n");
+		return EXIT_FAILURE;
+#endif
+	}
+
+	bench_csv_field();
+	bench_lz4();
+	bench_simhash();
+	bench_bloom();
+	bench_hll();
+	bench_topk();
+	bench_agg();
+	bench_pattern_cache();
+	bench_memo();
+	bench_translate();
+	bench_kernels();
+	bench_worker_pool();
+	bench_pipeline(4096, "4KB");
+	bench_pipeline(16 << 20, "16MB");
+	bench_batch();
+	bench_probes();
+#ifndef _WIN32
+	bench_big_buffer();
+#endif
+
+	if (json_path != NULL && !write_baseline(json_path)) {
+		std::perror(json_path);
+		return EXIT_FAILURE;
+	}
+	if (compare_path != NULL && !compare_baseline(compare_path)) {
+		std::perror(compare_path);
+		return EXIT_FAILURE;
+	}
+	if (check_path != NULL) {
+		const int regressions = check_baseline(check_path, tolerance);
+		if (regressions < 0) {
+			std::perror(check_path);
+		}
+		if (regressions != 0) {
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
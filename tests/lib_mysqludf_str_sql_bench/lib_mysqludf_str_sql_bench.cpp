@@ -0,0 +1,569 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+// End-to-end benchmarks of the functions in SQL statements, against built-in SQL that does the
+// same or comparable work, over tables of synthetic values.
+//
+// Usage: lib_mysqludf_str_sql_bench [OPTIONS] [FILTER]
+//
+//   --socket PATH      use the server listening on PATH, to which the functions are installed
+//                      with --install or already; without it, a throwaway server is started
+//   --user NAME        the user of --socket [root]
+//   --password PASS    the password of --user [none]
+//   --install          source installdb.sql into the server of --socket
+//   --mysqld PATH      the mysqld of the throwaway server [mysqld]
+//   --plugin-dir DIR   the directory of lib_mysqludf_str.so for the throwaway server [../../.libs]
+//   --rows N           the rows of the table of short values; the table of long values has N / 100
+//                      [100000]
+//   --connections N    run each statement over 1, 2, 4, ... up to N concurrent connections [4]
+//   --seconds S        run each statement for S seconds per number of connections [3]
+//
+// Only the benchmarks whose name contains FILTER are run. Each statement is a scan that sums the
+// lengths of the results, so that it measures the server rather than the transfer of the results.
+// The report is written to the standard output, one JSON object per line: first the versions and
+// the tables, then one line per benchmark and number of connections, with the rows scanned per
+// second, the 50th and 99th percentiles of the time of a statement in milliseconds, and the CPU
+// time of the server per row in nanoseconds (null if the server is not on this host). Reports of
+// two releases can be compared with diff, or loaded with jq.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pwd.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <mysql.h>
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+const char *g_socket = NULL;
+const char *g_user = "root";
+const char *g_password = NULL;
+bool g_install = false;
+const char *g_mysqld = "mysqld";
+std::string g_plugin_dir = "../../.libs";
+std::size_t g_rows = 100000;
+unsigned g_connections = 4;
+double g_seconds = 3.0;
+const char *g_filter = NULL;
+
+const char g_database[] = "lib_mysqludf_str_sql_bench";
+
+// A statement of the benchmarks: `udf` is computed over each row of `table` with the function,
+// and `builtin` with the built-in SQL that is compared with it, or NULL if there is none.
+struct sql_bench_case
+{
+	const char *name;
+	const char *table;
+	const char *udf;
+	const char *builtin;
+};
+
+const sql_bench_case g_cases[] = {
+	{ "rot13", "short_values", "str_rot13(s)", "UPPER(s)" },
+	{ "translate", "short_values", "str_translate(s, 'abc', 'xyz')", "REPLACE(REPLACE(REPLACE(s, 'a', 'x'), 'b', 'y'), 'c', 'z')" },
+	{ "ucfirst", "short_values", "str_ucfirst(s)", "CONCAT(UPPER(LEFT(s, 1)), SUBSTRING(s, 2))" },
+	{ "ucwords", "short_values", "str_ucwords(s)", NULL },
+	{ "xor", "short_values", "str_xor(s, 'k3y')", "HEX(s)" },
+	{ "numtowords", "short_values", "str_numtowords(n)", "FORMAT(n, 0)" },
+	{ "srand", "short_values", "str_srand(16)", "RAND()" },
+	{ "kv_get", "short_values", "str_kv_get(q, 'b')", "SUBSTRING_INDEX(SUBSTRING_INDEX(q, 'b=', -1), '&', 1)" },
+	{ "csv_field", "short_values", "str_csv_field(line, 2, ',', '\"')", "SUBSTRING_INDEX(SUBSTRING_INDEX(line, ',', 2), ',', -1)" },
+	{ "rot13/long", "long_values", "str_rot13(s)", "UPPER(s)" },
+	{ "xor/long", "long_values", "str_xor(s, 'k3y')", "HEX(s)" }
+};
+
+// A connection that is closed when it goes out of scope.
+class connection
+{
+public:
+	connection() : m_conn(mysql_init(NULL))
+	{
+		if (m_conn == NULL) {
+			throw std::runtime_error("mysql_init failed");
+		}
+	}
+
+	~connection()
+	{
+		mysql_close(m_conn);
+	}
+
+	bool connect(const char *database)
+	{
+		return mysql_real_connect(m_conn, NULL, g_user, g_password, database, 0, g_socket, 0) != NULL;
+	}
+
+	void query(const std::string& sql)
+	{
+		if (mysql_real_query(m_conn, sql.data(), sql.size()) != 0) {
+			throw std::runtime_error(sql.substr(0, 80) + ": " + mysql_error(m_conn));
+		}
+		MYSQL_RES *res = mysql_store_result(m_conn);
+		if (res != NULL) {
+			mysql_free_result(res);
+		} else if (mysql_field_count(m_conn) != 0) {
+			throw std::runtime_error(sql.substr(0, 80) + ": " + mysql_error(m_conn));
+		}
+	}
+
+	// Returns the first column of the first row of the result of `sql`, or "" if it is NULL.
+	std::string value(const std::string& sql)
+	{
+		std::string v;
+
+		if (mysql_real_query(m_conn, sql.data(), sql.size()) != 0) {
+			throw std::runtime_error(sql.substr(0, 80) + ": " + mysql_error(m_conn));
+		}
+		MYSQL_RES *res = mysql_store_result(m_conn);
+		if (res == NULL) {
+			throw std::runtime_error(sql.substr(0, 80) + ": " + mysql_error(m_conn));
+		}
+		MYSQL_ROW row = mysql_fetch_row(res);
+		if (row != NULL && row[0] != NULL) {
+			v = row[0];
+		}
+		mysql_free_result(res);
+		return v;
+	}
+
+	std::string escape(const std::string& s)
+	{
+		std::vector<char> buf(2 * s.size() + 1);
+		return std::string(&buf[0], mysql_real_escape_string(m_conn, &buf[0], s.data(), s.size()));
+	}
+
+private:
+	connection(const connection&);
+	connection& operator=(const connection&);
+
+	MYSQL *m_conn;
+};
+
+// The throwaway server: a data directory initialized in a temporary directory, and a mysqld that
+// only listens on a socket in it.
+class throwaway_server
+{
+public:
+	throwaway_server() : m_pid(-1)
+	{
+		char dir[] = "/tmp/lib_mysqludf_str_sql_bench.XXXXXX";
+		if (mkdtemp(dir) == NULL) {
+			throw std::runtime_error("failed to create a temporary directory");
+		}
+		m_dir = dir;
+		m_socket = m_dir + "/mysqld.sock";
+
+		// mysqld refuses to run as root unless it is told to
+		const struct passwd *pw = getpwuid(getuid());
+		const std::string user = std::string("--user=") + (pw != NULL ? pw->pw_name : "root");
+		const std::string datadir = "--datadir=" + m_dir + "/data";
+		const std::string log_error = "--log-error=" + m_dir + "/error.log";
+		const char *initialize[] = { g_mysqld, "--no-defaults", "--initialize-insecure", user.c_str(), datadir.c_str(), log_error.c_str(), NULL };
+		if (run(initialize) != 0) {
+			throw std::runtime_error(std::string(g_mysqld) + " --initialize-insecure failed in " + m_dir);
+		}
+
+		const std::string socket = "--socket=" + m_socket;
+		const std::string pid_file = "--pid-file=" + m_dir + "/mysqld.pid";
+		const std::string plugin_dir = "--plugin-dir=" + g_plugin_dir;
+		const char *start[] = { g_mysqld, "--no-defaults", user.c_str(), datadir.c_str(), log_error.c_str(), socket.c_str(),
+				pid_file.c_str(), plugin_dir.c_str(), "--skip-networking", NULL };
+		m_pid = spawn(start);
+
+		// wait until it accepts connections
+		g_socket = m_socket.c_str();
+		for (int i = 0; ; ++i) {
+			connection conn;
+			if (conn.connect(NULL)) {
+				break;
+			}
+			if (i == 600 || waitpid(m_pid, NULL, WNOHANG) != 0) {
+				// the directory is kept for its log
+				kill(m_pid, SIGTERM);
+				waitpid(m_pid, NULL, 0);
+				throw std::runtime_error("the throwaway mysqld did not start; see " + m_dir + "/error.log");
+			}
+			usleep(100 * 1000);
+		}
+	}
+
+	~throwaway_server()
+	{
+		stop();
+	}
+
+	pid_t pid() const
+	{
+		return m_pid;
+	}
+
+private:
+	throwaway_server(const throwaway_server&);
+	throwaway_server& operator=(const throwaway_server&);
+
+	static pid_t spawn(const char *const *argv)
+	{
+		const pid_t pid = fork();
+		if (pid == 0) {
+			execvp(argv[0], const_cast<char *const *>(argv));
+			_exit(127);
+		}
+		if (pid < 0) {
+			throw std::runtime_error("fork failed");
+		}
+		return pid;
+	}
+
+	static int run(const char *const *argv)
+	{
+		int status;
+		if (waitpid(spawn(argv), &status, 0) < 0 || !WIFEXITED(status)) {
+			return -1;
+		}
+		return WEXITSTATUS(status);
+	}
+
+	// Stops the server, and removes its directory.
+	void stop()
+	{
+		if (m_pid > 0) {
+			kill(m_pid, SIGTERM);
+			waitpid(m_pid, NULL, 0);
+			m_pid = -1;
+		}
+		const char *rm[] = { "rm", "-rf", m_dir.c_str(), NULL };
+		run(rm);
+	}
+
+	std::string m_dir;
+	std::string m_socket;
+	pid_t m_pid;
+};
+
+// Returns the CPU time of the process `pid` in seconds, or a negative value if it is unknown.
+double process_cpu_seconds(pid_t pid)
+{
+	if (pid <= 0) {
+		return -1.0;
+	}
+
+	std::ostringstream path;
+	path << "/proc/" << pid << "/stat";
+	std::ifstream in(path.str().c_str());
+	std::string stat;
+	std::getline(in, stat);
+
+	// utime and stime are the 12th and 13th fields after the name, which is in parentheses
+	const std::string::size_type end_of_name = stat.rfind(')');
+	if (end_of_name == std::string::npos) {
+		return -1.0;
+	}
+	std::istringstream fields(stat.substr(end_of_name + 1));
+	std::string field;
+	unsigned long long utime = 0, stime = 0;
+	for (int i = 0; i < 11; ++i) {
+		fields >> field;
+	}
+	if (!(fields >> utime >> stime)) {
+		return -1.0;
+	}
+	return static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+}
+
+// Returns the process of the server, if it is on this host.
+pid_t server_pid(connection& conn)
+{
+	std::ifstream in(conn.value("SELECT @@pid_file").c_str());
+	long pid = -1;
+	if (!(in >> pid)) {
+		return -1;
+	}
+	return static_cast<pid_t>(pid);
+}
+
+// Sources installdb.sql, whose statements each end with a semicolon at the end of a line.
+void install(connection& conn)
+{
+	std::ifstream in("../../installdb.sql");
+	std::string line, statement;
+
+	if (!in) {
+		throw std::runtime_error("cannot read ../../installdb.sql");
+	}
+	while (std::getline(in, line)) {
+		if (statement.empty() && line.empty()) {
+			continue;
+		}
+		statement += line + "\n";
+		if (!line.empty() && line[line.size() - 1] == ';') {
+			conn.query(statement);
+			statement.clear();
+		}
+	}
+	conn.query(std::string("USE ") + g_database);
+}
+
+// The words of the values, from which the names, queries and records of the tables are made.
+const char *const g_words[] = {
+	"alice", "bob", "carol", "dave", "eve", "mallory", "trent", "peggy", "victor", "walter",
+	"zürich", "new york", "são paulo", "o'brien", "jean-luc", "acme corp", "shipped", "pending"
+};
+
+std::string random_text(std::uint64_t& state, std::size_t length)
+{
+	std::string s;
+	while (s.size() < length) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		if (!s.empty()) {
+			s += ' ';
+		}
+		s += g_words[(state >> 33) % (sizeof g_words / sizeof g_words[0])];
+	}
+	s.resize(length);
+	return s;
+}
+
+// Creates the tables. short_values has the lengths of names and labels, most of 4 to 24 bytes and
+// a few NULLs; long_values has documents of 1 KiB to 64 KiB, most of them short.
+void populate(connection& conn)
+{
+	static const std::size_t rows_per_insert = 500;
+	std::uint64_t state = 1;
+
+	conn.query("DROP TABLE IF EXISTS short_values, long_values");
+	conn.query("CREATE TABLE short_values (id INT NOT NULL PRIMARY KEY, s VARCHAR(64), n BIGINT, q VARCHAR(255), line VARCHAR(255)) CHARACTER SET utf8mb4");
+	conn.query("CREATE TABLE long_values (id INT NOT NULL PRIMARY KEY, s MEDIUMTEXT) CHARACTER SET utf8mb4");
+
+	for (std::size_t i = 0; i < g_rows; ) {
+		std::string sql = "INSERT INTO short_values (id, s, n, q, line) VALUES ";
+		for (std::size_t k = 0; k < rows_per_insert && i < g_rows; ++k, ++i) {
+			state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+			const std::size_t length = 4 + (state >> 40) % 21;
+			const long long n = static_cast<long long>((state >> 20) % 2000000000ULL) - 1000000000LL;
+			const std::string s = random_text(state, length);
+			sql += (k == 0 ? "(" : ",(") + std::to_string(i) + ",";
+			sql += (i % 100 == 99 ? std::string("NULL") : "'" + conn.escape(s) + "'");
+			sql += "," + std::to_string(n);
+			sql += ",'a=" + std::to_string(i) + "&b=" + conn.escape(s.substr(0, length / 2)) + "&c=1'";
+			sql += ",'" + std::to_string(i) + ",\"" + conn.escape(s) + ", jr\"," + std::to_string(n) + "')";
+		}
+		conn.query(sql);
+	}
+
+	for (std::size_t i = 0; i < g_rows / 100; ++i) {
+		state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+		const std::size_t length = static_cast<std::size_t>(1024) << std::min((state >> 40) % 7, (state >> 50) % 7);
+		conn.query("INSERT INTO long_values (id, s) VALUES (" + std::to_string(i) + ",'" + conn.escape(random_text(state, length)) + "')");
+	}
+}
+
+std::string json_string(const std::string& s)
+{
+	std::string j = "\"";
+	for (std::size_t i = 0; i < s.size(); ++i) {
+		if (s[i] == '"' || s[i] == '\\') {
+			j += '\\';
+		}
+		j += s[i];
+	}
+	return j + "\"";
+}
+
+std::string json_number(double v, int precision)
+{
+	if (v < 0) {
+		return "null";
+	}
+	char buf[64];
+	std::snprintf(buf, sizeof buf, "%.*f", precision, v);
+	return buf;
+}
+
+// Runs `sql` over `connections` connections for g_seconds, and reports it as `name`.
+void run_sql_bench(const std::string& name, const std::string& expr, const std::string& sql,
+		std::size_t rows_per_statement, unsigned connections, pid_t pid)
+{
+	std::vector<std::vector<double> > latencies(connections);
+	std::vector<std::string> errors(connections);
+	std::vector<std::thread> threads;
+
+	const double cpu_before = process_cpu_seconds(pid);
+	const clock_type::time_point start = clock_type::now();
+	const clock_type::time_point deadline = start + std::chrono::duration_cast<clock_type::duration>(std::chrono::duration<double>(g_seconds));
+
+	for (unsigned t = 0; t < connections; ++t) {
+		threads.push_back(std::thread([&, t]() {
+			try {
+				connection conn;
+				if (!conn.connect(g_database)) {
+					throw std::runtime_error("failed to connect");
+				}
+				do {
+					const clock_type::time_point before = clock_type::now();
+					conn.value(sql);
+					latencies[t].push_back(std::chrono::duration<double, std::milli>(clock_type::now() - before).count());
+				} while (clock_type::now() < deadline);
+			} catch (const std::exception& e) {
+				errors[t] = e.what();
+			}
+			mysql_thread_end();
+		}));
+	}
+	for (unsigned t = 0; t < connections; ++t) {
+		threads[t].join();
+	}
+
+	const double elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+	const double cpu_after = process_cpu_seconds(pid);
+	std::vector<double> all;
+	for (unsigned t = 0; t < connections; ++t) {
+		if (!errors[t].empty()) {
+			throw std::runtime_error(name + ": " + errors[t]);
+		}
+		all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+	}
+	std::sort(all.begin(), all.end());
+
+	const double rows = static_cast<double>(all.size()) * rows_per_statement;
+	const double cpu_ns_per_row = (cpu_before < 0 || cpu_after < 0 || rows == 0 ? -1.0 : (cpu_after - cpu_before) * 1e9 / rows);
+	std::printf("{\"bench\":%s,\"expr\":%s,\"connections\":%u,\"statements\":%lu,\"rows_per_s\":%s,\"p50_ms\":%s,\"p99_ms\":%s,\"cpu_ns_per_row\":%s}\n",
+			json_string(name).c_str(), json_string(expr).c_str(), connections, static_cast<unsigned long>(all.size()),
+			json_number(rows / elapsed, 0).c_str(), json_number(all[all.size() / 2], 3).c_str(),
+			json_number(all[all.size() * 99 / 100], 3).c_str(), json_number(cpu_ns_per_row, 1).c_str());
+	std::fflush(stdout);
+}
+
+void usage()
+{
+	std::fprintf(stderr, "usage: lib_mysqludf_str_sql_bench [--socket PATH [--user NAME] [--password PASS] [--install]]\n"
+			"    [--mysqld PATH] [--plugin-dir DIR] [--rows N] [--connections N] [--seconds S] [FILTER]\n");
+	std::exit(EXIT_FAILURE);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		const bool has_value = (i + 1 < argc);
+		if (arg == "--socket" && has_value) {
+			g_socket = argv[++i];
+		} else if (arg == "--user" && has_value) {
+			g_user = argv[++i];
+		} else if (arg == "--password" && has_value) {
+			g_password = argv[++i];
+		} else if (arg == "--install") {
+			g_install = true;
+		} else if (arg == "--mysqld" && has_value) {
+			g_mysqld = argv[++i];
+		} else if (arg == "--plugin-dir" && has_value) {
+			g_plugin_dir = argv[++i];
+		} else if (arg == "--rows" && has_value) {
+			g_rows = std::strtoul(argv[++i], NULL, 10);
+		} else if (arg == "--connections" && has_value) {
+			g_connections = static_cast<unsigned>(std::strtoul(argv[++i], NULL, 10));
+		} else if (arg == "--seconds" && has_value) {
+			g_seconds = std::strtod(argv[++i], NULL);
+		} else if (arg[0] != '-' && g_filter == NULL) {
+			g_filter = argv[i];
+		} else {
+			usage();
+		}
+	}
+	if (g_rows < 100 || g_connections == 0 || g_seconds <= 0) {
+		usage();
+	}
+
+	if (mysql_library_init(0, NULL, NULL) != 0) {
+		std::fprintf(stderr, "failed to initialize the MySQL client library\n");
+		return EXIT_FAILURE;
+	}
+
+	int status = EXIT_SUCCESS;
+	try {
+		throwaway_server *server = NULL;
+		if (g_socket == NULL) {
+			if (g_plugin_dir[0] != '/') {
+				char cwd[4096];
+				if (getcwd(cwd, sizeof cwd) != NULL) {
+					g_plugin_dir = std::string(cwd) + "/" + g_plugin_dir;
+				}
+			}
+			std::fprintf(stderr, "starting a throwaway %s\n", g_mysqld);
+			server = new throwaway_server();
+		}
+
+		try {
+			connection conn;
+			if (!conn.connect(NULL)) {
+				throw std::runtime_error(std::string("failed to connect to ") + g_socket);
+			}
+			conn.query(std::string("CREATE DATABASE IF NOT EXISTS ") + g_database);
+			conn.query(std::string("USE ") + g_database);
+			if (server != NULL || g_install) {
+				install(conn);
+			}
+
+			std::fprintf(stderr, "populating %s with %lu rows\n", g_database, static_cast<unsigned long>(g_rows));
+			populate(conn);
+			const pid_t pid = (server != NULL ? server->pid() : server_pid(conn));
+
+			std::printf("{\"server\":%s,\"lib_mysqludf_str\":%s,\"short_values\":%lu,\"long_values\":%lu,\"seconds\":%g}\n",
+					json_string(conn.value("SELECT VERSION()")).c_str(), json_string(conn.value("SELECT lib_mysqludf_str_info()")).c_str(),
+					static_cast<unsigned long>(g_rows), static_cast<unsigned long>(g_rows / 100), g_seconds);
+
+			for (std::size_t i = 0; i < sizeof g_cases / sizeof g_cases[0]; ++i) {
+				const sql_bench_case& c = g_cases[i];
+				const std::size_t rows = (std::strcmp(c.table, "long_values") == 0 ? g_rows / 100 : g_rows);
+				for (int builtin = 0; builtin < 2; ++builtin) {
+					const char *expr = (builtin ? c.builtin : c.udf);
+					const std::string name = std::string(c.name) + (builtin ? "/builtin" : "/udf");
+					if (expr == NULL || (g_filter != NULL && name.find(g_filter) == std::string::npos)) {
+						continue;
+					}
+					const std::string sql = std::string("SELECT SUM(LENGTH(") + expr + ")) FROM " + c.table;
+					conn.value(sql); // warm up the buffer pool and the caches of the library
+					for (unsigned connections = 1; ; connections *= 2) {
+						run_sql_bench(name, expr, sql, rows, std::min(connections, g_connections), pid);
+						if (connections >= g_connections) {
+							break;
+						}
+					}
+				}
+			}
+
+			conn.query(std::string("DROP DATABASE ") + g_database);
+		} catch (...) {
+			delete server;
+			throw;
+		}
+		delete server;
+	} catch (const std::exception& e) {
+		std::fprintf(stderr, "lib_mysqludf_str_sql_bench: %s\n", e.what());
+		status = EXIT_FAILURE;
+	}
+
+	mysql_library_end();
+	return status;
+}
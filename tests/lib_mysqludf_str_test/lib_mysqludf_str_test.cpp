@@ -21,6 +21,7 @@
 
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <mysql.h>
 #include <mysqld_error.h>
 #include <set>
@@ -60,6 +61,7 @@ static char * getpass(const char *prompt) throw()
 	return pass_buf;
 }
 #else
+#include <dlfcn.h>
 #include <unistd.h>
 #endif
 
@@ -73,6 +75,9 @@ static const char *g_mysql_host = "localhost";
 static const char *g_mysql_user = "test";
 static const char *g_mysql_password = NULL;
 static const char *g_mysql_dbname = "test";
+#ifndef _WIN32
+static const char *g_plugin_path = "../../.libs/lib_mysqludf_str.so";
+#endif
 
 class init_mysqlclient_lib
 {
@@ -346,7 +351,7 @@ BOOST_AUTO_TEST_CASE(test_str_translate)
 		BOOST_ERROR(mysql_error(pconn));
 	}
 
-	if (mysql_query(pconn, "INSERT INTO strings(id, str) VALUES (1, 'a big string'), (2, NULL)") != 0) {
+	if (mysql_query(pconn, "INSERT INTO strings(id, str) VALUES (1, 'a big string'), (2, NULL), (3, 'xyz string')") != 0) {
 		BOOST_ERROR(mysql_error(pconn));
 	}
 
@@ -371,6 +376,11 @@ BOOST_AUTO_TEST_CASE(test_str_translate)
 			prow = mysql_fetch_row(pres);
 			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
 			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), static_cast<const char *>(NULL));
+
+			// a value that the function leaves unchanged
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "xyz string");
 		}
 	}
 }
@@ -411,7 +421,7 @@ BOOST_AUTO_TEST_CASE(test_str_ucfirst)
 		BOOST_ERROR(mysql_error(pconn));
 	}
 
-	if (mysql_query(pconn, "INSERT INTO strings(id, str) VALUES (1, 'sAmple strinG'), (2, NULL)") != 0) {
+	if (mysql_query(pconn, "INSERT INTO strings(id, str) VALUES (1, 'sAmple strinG'), (2, NULL), (3, 'Sample string')") != 0) {
 		BOOST_ERROR(mysql_error(pconn));
 	}
 
@@ -436,6 +446,11 @@ BOOST_AUTO_TEST_CASE(test_str_ucfirst)
 			prow = mysql_fetch_row(pres);
 			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
 			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), static_cast<const char *>(NULL));
+
+			// a value that the function leaves unchanged
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "Sample string");
 		}
 	}
 }
@@ -476,7 +491,7 @@ BOOST_AUTO_TEST_CASE(test_str_ucwords)
 		BOOST_ERROR(mysql_error(pconn));
 	}
 
-	if (mysql_query(pconn, "INSERT INTO strings(id, str) VALUES (1, 'sAmple strinG'), (2, NULL)") != 0) {
+	if (mysql_query(pconn, "INSERT INTO strings(id, str) VALUES (1, 'sAmple strinG'), (2, NULL), (3, 'Sample String 2')") != 0) {
 		BOOST_ERROR(mysql_error(pconn));
 	}
 
@@ -501,6 +516,11 @@ BOOST_AUTO_TEST_CASE(test_str_ucwords)
 			prow = mysql_fetch_row(pres);
 			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
 			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), static_cast<const char *>(NULL));
+
+			// a value that the function leaves unchanged
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "Sample String 2");
 		}
 	}
 }
@@ -620,7 +640,7 @@ BOOST_AUTO_TEST_CASE(test_str_srand)
 	BOOST_CHECK_EQUAL(mysql_errno(pconn), ER_CANT_INITIALIZE_UDF);
 }
 
-BOOST_AUTO_TEST_CASE(test_lib_mysqludf_str_info)
+BOOST_AUTO_TEST_CASE(test_str_csv_field)
 {
 	MYSQL *pconn = mysql_init(NULL);
 	BOOST_SCOPE_EXIT( (pconn) ) {
@@ -631,7 +651,7 @@ BOOST_AUTO_TEST_CASE(test_lib_mysqludf_str_info)
 		BOOST_FAIL("failed to connect");
 	}
 
-	if (mysql_query(pconn, "SELECT lib_mysqludf_str_info() AS info") != 0) {
+	if (mysql_query(pconn, "SELECT str_csv_field('42,\"Smith, John\",\"say \"\"hi\"\"\"', 2) AS name, str_csv_field('42,\"Smith, John\",\"say \"\"hi\"\"\"', 3), str_csv_field('a;b', 2, ';'), str_csv_field('a,b', 3)") != 0) {
 		BOOST_ERROR(mysql_error(pconn));
 	} else {
 		MYSQL_RES *pres = mysql_store_result(pconn);
@@ -642,13 +662,1001 @@ BOOST_AUTO_TEST_CASE(test_lib_mysqludf_str_info)
 				mysql_free_result(pres);
 			} BOOST_SCOPE_EXIT_END
 
-			MYSQL_FIELD *pinfo_field = mysql_fetch_field(pres);
-			BOOST_CHECK_EQUAL(pinfo_field->name, "info");
-			BOOST_CHECK_EQUAL(pinfo_field->type, MYSQL_TYPE_VAR_STRING);
+			MYSQL_FIELD *pname_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(pname_field->name, "name");
+			BOOST_CHECK_EQUAL(pname_field->type, MYSQL_TYPE_VAR_STRING);
 
 			MYSQL_ROW prow = mysql_fetch_row(pres);
 			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
-			BOOST_CHECK_EQUAL(prow[0], "lib_mysqludf_str version 0.5");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "Smith, John");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "say \"hi\"");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[2]), "b");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[3]), static_cast<const char *>(NULL));
+		}
+	}
+
+	BOOST_CHECK_NE(mysql_query(pconn, "SELECT str_csv_field('a,b', 1, ',', ',')"), 0);
+	BOOST_CHECK_EQUAL(mysql_errno(pconn), ER_CANT_INITIALIZE_UDF);
+
+	if (mysql_query(pconn, "CREATE TEMPORARY TABLE records (id INT NOT NULL AUTO_INCREMENT, line VARCHAR(255), PRIMARY KEY (id))") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "INSERT INTO records(id, line) VALUES (1, 'x,\"1,2\",y'), (2, NULL)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "SELECT str_csv_field(line, 2) FROM records ORDER BY id") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "1,2");
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), static_cast<const char *>(NULL));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_str_kv_get)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT str_kv_get('q=mysql+udf%21&page=2', 'q') AS q, str_kv_get('q=mysql+udf%21&page=2', 'page'), str_kv_get('q=1&page=2', 'age'), str_kv_get('Host:example.org;Accept:text/html', 'Accept', ';', ':', 0)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *pq_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(pq_field->name, "q");
+			BOOST_CHECK_EQUAL(pq_field->type, MYSQL_TYPE_VAR_STRING);
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "mysql udf!");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "2");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[2]), static_cast<const char *>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[3]), "text/html");
+		}
+	}
+
+	if (mysql_query(pconn, "CREATE TEMPORARY TABLE access_log (id INT NOT NULL AUTO_INCREMENT, query_string VARCHAR(255), param VARCHAR(16), PRIMARY KEY (id))") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "INSERT INTO access_log(id, query_string, param) VALUES (1, 'a=1&b=x%20y', 'b'), (2, 'a=1&b=2', 'a'), (3, NULL, 'a')") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "SELECT str_kv_get(query_string, param) FROM access_log ORDER BY id") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "x y");
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "1");
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), static_cast<const char *>(NULL));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_str_lz4_compress)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT str_lz4_decompress(str_lz4_compress('hello, hello, hello')) AS original, LENGTH(str_lz4_compress(REPEAT('abc', 1000))) < 100, str_lz4_decompress(str_lz4_compress(REPEAT('abc', 1000), 8)) = REPEAT('abc', 1000), str_lz4_decompress('not compressed')") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *poriginal_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(poriginal_field->name, "original");
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "hello, hello, hello");
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 1);
+			BOOST_CHECK_EQUAL(std::atoi(prow[2]), 1);
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[3]), static_cast<const char *>(NULL));
+		}
+	}
+
+	if (mysql_query(pconn, "CREATE TEMPORARY TABLE payloads (id INT NOT NULL AUTO_INCREMENT, payload TEXT, PRIMARY KEY (id))") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "INSERT INTO payloads(id, payload) VALUES (1, REPEAT('{\"status\":\"shipped\"}', 200)), (2, ''), (3, NULL)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "SELECT str_lz4_decompress(str_lz4_compress(payload)) <=> payload, LENGTH(str_lz4_compress(payload)) FROM payloads ORDER BY id") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[0]), 1);
+			BOOST_CHECK_LT(std::atoi(prow[1]), 200);
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[0]), 1);
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 0);
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[0]), 1);
+			BOOST_CHECK_EQUAL(prow[1], static_cast<const char *>(NULL));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_str_simhash)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT HEX(str_simhash('The quick brown fox jumps over the lazy dog')) AS fingerprint, str_hamming(str_simhash('The quick brown fox jumps over the lazy dog'), str_simhash('The quick brown fox jumped over the lazy dog')), str_hamming(str_simhash('The quick brown fox jumps over the lazy dog'), str_simhash('Lorem ipsum dolor sit amet, consectetur')), str_hamming(X'0F', X'F001'), LENGTH(str_simhash('')), str_simhash('abc', NULL)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *pfingerprint_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(pfingerprint_field->name, "fingerprint");
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "05CF0A8086726DB2");
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 8);
+			BOOST_CHECK_EQUAL(std::atoi(prow[2]), 25);
+			BOOST_CHECK_EQUAL(std::atoi(prow[3]), 9);
+			BOOST_CHECK_EQUAL(std::atoi(prow[4]), 8);
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[5]), static_cast<const char *>(NULL));
+		}
+	}
+
+	if (mysql_query(pconn, "CREATE TEMPORARY TABLE descriptions (id INT NOT NULL AUTO_INCREMENT, description TEXT, PRIMARY KEY (id))") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "INSERT INTO descriptions(id, description) VALUES (1, 'The quick brown fox jumps over the lazy dog'), (2, 'The quick brown fox jumped over the lazy dog'), (3, NULL)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "SELECT str_hamming(str_simhash(description, 4), str_simhash('The quick brown fox jumps over the lazy dog')) FROM descriptions ORDER BY id") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[0]), 0);
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[0]), 8);
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(prow[0], static_cast<const char *>(NULL));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_str_bloom_build)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT str_bloom_contains(f, 'apple') AS apple, str_bloom_contains(f, 'cherry'), LENGTH(f), str_bloom_contains(f, NULL) FROM (SELECT str_bloom_build(fruit) AS f FROM (SELECT 'apple' AS fruit UNION ALL SELECT 'banana') AS fruits) AS filters") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *papple_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(papple_field->name, "apple");
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[0]), 1);
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 0);
+			BOOST_CHECK_EQUAL(std::atoi(prow[2]), 80);
+			BOOST_CHECK_EQUAL(prow[3], static_cast<const char *>(NULL));
+		}
+	}
+
+	if (mysql_query(pconn, "CREATE TEMPORARY TABLE unsubscribed (id INT NOT NULL AUTO_INCREMENT, email VARCHAR(64), PRIMARY KEY (id))") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "INSERT INTO unsubscribed(id, email) VALUES (1, 'a@example.com'), (2, 'c@example.com'), (3, NULL)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "SET @excluded = (SELECT str_bloom_build(email, 1000, 0.001) FROM unsubscribed)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "SELECT email, str_bloom_contains(@excluded, email) FROM (SELECT 'a@example.com' AS email UNION ALL SELECT 'b@example.com' UNION ALL SELECT 'c@example.com' UNION ALL SELECT NULL) AS customers") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 1);
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 0);
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 1);
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(prow[1], static_cast<const char *>(NULL));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_str_hll_build)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT str_hll_count(str_hll_build(fruit)) AS distinct_fruits, str_hll_count(str_hll_build(fruit, 4)), str_hll_count('not a sketch') FROM (SELECT 'apple' AS fruit UNION ALL SELECT 'banana' UNION ALL SELECT 'apple' UNION ALL SELECT 'cherry' UNION ALL SELECT NULL) AS fruits") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *pdistinct_fruits_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(pdistinct_fruits_field->name, "distinct_fruits");
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[0]), 3);
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 3);
+			BOOST_CHECK_EQUAL(prow[2], static_cast<const char *>(NULL));
+		}
+	}
+
+	if (mysql_query(pconn, "CREATE TEMPORARY TABLE visits (id INT NOT NULL AUTO_INCREMENT, day INT NOT NULL, visitor VARCHAR(16), PRIMARY KEY (id))") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "INSERT INTO visits(day, visitor) VALUES (1, 'ann'), (1, 'bob'), (1, 'ann'), (2, 'bob'), (2, 'cid'), (2, NULL), (3, NULL)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "SELECT str_hll_count(str_hll_merge(sketch)), str_hll_count(str_hll_merge(IF(precision_used = 12, NULL, sketch))) FROM (SELECT 12 AS precision_used, str_hll_build(visitor, 12) AS sketch FROM visits WHERE day = 1 UNION ALL SELECT 14, str_hll_build(visitor) FROM visits WHERE day = 2) AS daily") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[0]), 3);
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 2);
+		}
+	}
+
+	if (mysql_query(pconn, "SELECT day, str_hll_count(str_hll_build(visitor)) FROM visits GROUP BY day ORDER BY day") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 2);
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 2);
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::atoi(prow[1]), 0);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_str_topk)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT str_topk(fruit, 2) AS top_fruits, str_topk(fruit, 1, 1) FROM (SELECT 'apple' AS fruit UNION ALL SELECT 'banana' UNION ALL SELECT 'apple' UNION ALL SELECT 'cherry' UNION ALL SELECT 'banana' UNION ALL SELECT 'apple' UNION ALL SELECT NULL) AS fruits") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *ptop_fruits_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(ptop_fruits_field->name, "top_fruits");
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "[{\"term\":\"apple\",\"count\":3,\"error\":0},{\"term\":\"banana\",\"count\":2,\"error\":0}]");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "[{\"term\":\"apple\",\"count\":6,\"error\":5}]");
+		}
+	}
+
+	if (mysql_query(pconn, "CREATE TEMPORARY TABLE searches (id INT NOT NULL AUTO_INCREMENT, customer INT NOT NULL, term VARCHAR(32), PRIMARY KEY (id))") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "INSERT INTO searches(customer, term) VALUES (1, 'shoes'), (1, 'say \"hi\"'), (1, 'say \"hi\"'), (2, NULL)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "SELECT customer, str_topk(term, 1) FROM searches GROUP BY customer ORDER BY customer") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "[{\"term\":\"say \\\"hi\\\"\",\"count\":2,\"error\":0}]");
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "[]");
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_str_agg)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT str_agg(fruit, ', ') AS fruits, str_agg(fruit, ', ', 'DISTINCT'), str_agg(fruit, '') FROM (SELECT 'apple' AS fruit UNION ALL SELECT 'banana' UNION ALL SELECT NULL UNION ALL SELECT 'apple' UNION ALL SELECT 'cherry') AS fruits") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *pfruits_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(pfruits_field->name, "fruits");
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "apple, banana, apple, cherry");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "apple, banana, cherry");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[2]), "applebananaapplecherry");
+		}
+	}
+
+	// Longer than the default group_concat_max_len of 1024
+	if (mysql_query(pconn, "SELECT LENGTH(str_agg(REPEAT('x', 1000), ',')), LENGTH(str_agg(REPEAT('x', 1000), ',', 'distinct')), str_agg(NULL, ',') FROM (SELECT 1 AS n UNION ALL SELECT 2 UNION ALL SELECT 3) AS numbers") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "3002");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "1000");
+			BOOST_CHECK_EQUAL(prow[2], static_cast<const char *>(NULL));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_constant_arguments)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	// Results of constant arguments are computed once, and returned for every row.
+	if (mysql_query(pconn, "SELECT str_numtowords(123456), str_translate('a string', 'ag', 'AG'), str_csv_field('x,NULL', 3), LENGTH(str_shuffle('abc')) FROM (SELECT 1 AS n UNION ALL SELECT 2 UNION ALL SELECT 3) AS numbers") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			for (int i = 0; i < 3; ++i) {
+				MYSQL_ROW prow = mysql_fetch_row(pres);
+				BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+				BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "one hundred twenty-three thousand four hundred fifty-six");
+				BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "A strinG");
+				BOOST_CHECK_EQUAL(prow[2], static_cast<const char *>(NULL));
+				BOOST_CHECK_EQUAL(static_cast<const char *>(prow[3]), "3");
+			}
+			BOOST_CHECK_EQUAL(mysql_fetch_row(pres), static_cast<MYSQL_ROW>(NULL));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_str_pipeline)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT str_pipeline('lower|trim|squeeze|ucwords', '  JOHN   SMITH ') AS name, str_pipeline('rot13|translate:a\\\\|:b\\\\:', 'n|x'), str_pipeline('xor:\\\\x20', 'aBc'), str_pipeline('upper', NULL)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *pname_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(pname_field->name, "name");
+			BOOST_CHECK_EQUAL(pname_field->type, MYSQL_TYPE_VAR_STRING);
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "John Smith");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "b:k");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[2]), "AbC");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[3]), static_cast<const char *>(NULL));
+		}
+	}
+
+	BOOST_CHECK_NE(mysql_query(pconn, "SELECT str_pipeline('lower|nope', 'x')"), 0);
+
+	if (mysql_query(pconn, "CREATE TEMPORARY TABLE transforms (id INT NOT NULL AUTO_INCREMENT, spec VARCHAR(64), s VARCHAR(255), PRIMARY KEY (id))") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "INSERT INTO transforms(id, spec, s) VALUES (1, 'trim|upper', ' a b '), (2, 'squeeze', 'a   b'), (3, NULL, 'a')") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+
+	if (mysql_query(pconn, "SELECT str_pipeline(spec, s) FROM transforms ORDER BY id") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "A B");
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "a b");
+
+			prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), static_cast<const char *>(NULL));
+		}
+	}
+}
+
+#ifndef _WIN32
+typedef my_bool (*udf_init_fn)(UDF_INIT *, UDF_ARGS *, char *);
+typedef void (*udf_deinit_fn)(UDF_INIT *);
+typedef char *(*udf_string_fn)(UDF_INIT *, UDF_ARGS *, char *, unsigned long *, char *, char *);
+typedef long long (*udf_integer_fn)(UDF_INIT *, UDF_ARGS *, char *, char *);
+
+static void *plugin_symbol(void *plugin, const char *name)
+{
+	void *symbol = dlsym(plugin, name);
+	BOOST_REQUIRE_MESSAGE(symbol != NULL, name);
+	return symbol;
+}
+
+// Calls str_set_memory_limit(limit) of the plugin.
+static void plugin_set_memory_limit(void *plugin, long long limit)
+{
+	Item_result type = INT_RESULT;
+	char *value = reinterpret_cast<char *>(&limit);
+	unsigned long length = sizeof limit;
+	char maybe_null = 0, message[MYSQL_ERRMSG_SIZE], is_null = 0, error = 0;
+	UDF_INIT initid;
+	UDF_ARGS args;
+
+	std::memset(&initid, 0, sizeof initid);
+	std::memset(&args, 0, sizeof args);
+	args.arg_count = 1;
+	args.arg_type = &type;
+	args.args = &value;
+	args.lengths = &length;
+	args.maybe_null = &maybe_null;
+	BOOST_REQUIRE_EQUAL(reinterpret_cast<udf_init_fn>(plugin_symbol(plugin, "str_set_memory_limit_init"))(&initid, &args, message), 0);
+	reinterpret_cast<udf_integer_fn>(plugin_symbol(plugin, "str_set_memory_limit"))(&initid, &args, &is_null, &error);
+	reinterpret_cast<udf_deinit_fn>(plugin_symbol(plugin, "str_set_memory_limit_deinit"))(&initid);
+	BOOST_REQUIRE_EQUAL(error, 0);
+}
+
+// Returns the memory that the plugin holds, from lib_mysqludf_str_stats().
+static unsigned long long plugin_memory(void *plugin)
+{
+	char message[MYSQL_ERRMSG_SIZE], result[256], is_null = 0, error = 0;
+	unsigned long length = 0;
+	UDF_INIT initid;
+	UDF_ARGS args;
+
+	std::memset(&initid, 0, sizeof initid);
+	std::memset(&args, 0, sizeof args);
+	BOOST_REQUIRE_EQUAL(reinterpret_cast<udf_init_fn>(plugin_symbol(plugin, "lib_mysqludf_str_stats_init"))(&initid, &args, message), 0);
+	const char *stats = reinterpret_cast<udf_string_fn>(plugin_symbol(plugin, "lib_mysqludf_str_stats"))(&initid, &args, result, &length, &is_null, &error);
+	BOOST_REQUIRE(stats != NULL);
+	const std::string json(stats, length);
+	reinterpret_cast<udf_deinit_fn>(plugin_symbol(plugin, "lib_mysqludf_str_stats_deinit"))(&initid);
+
+	const std::string::size_type current = json.find("\"current\":");
+	BOOST_REQUIRE(current != std::string::npos);
+	return std::strtoull(json.c_str() + current + std::strlen("\"current\":"), NULL, 10);
+}
+
+// A row of str_pipeline() whose spec needs more scratch memory than the limit leaves fails, and so
+// does the next row with the same spec, rather than running it with the scratch memory of the
+// previous spec. The server stops calling a function after a row fails, so the functions of the
+// plugin are called directly, as the server would call them.
+BOOST_AUTO_TEST_CASE(regression_test_str_pipeline_scratch_refused)
+{
+	void *plugin = dlopen(g_plugin_path, RTLD_NOW);
+	BOOST_REQUIRE_MESSAGE(plugin != NULL, dlerror());
+	BOOST_SCOPE_EXIT( (plugin) ) {
+		dlclose(plugin);
+	} BOOST_SCOPE_EXIT_END
+
+	udf_string_fn str_pipeline = reinterpret_cast<udf_string_fn>(plugin_symbol(plugin, "str_pipeline"));
+	Item_result types[2] = { STRING_RESULT, STRING_RESULT };
+	char *values[2] = { NULL, NULL };
+	unsigned long lengths[2] = { 1024, 255 };
+	char maybe_null[2] = { 1, 1 }, message[MYSQL_ERRMSG_SIZE], result[255], is_null, error;
+	unsigned long length;
+	UDF_INIT initid;
+	UDF_ARGS args;
+
+	std::memset(&initid, 0, sizeof initid);
+	std::memset(&args, 0, sizeof args);
+	args.arg_count = 2;
+	args.arg_type = types;
+	args.args = values;
+	args.lengths = lengths;
+	args.maybe_null = maybe_null;
+	BOOST_REQUIRE_EQUAL(reinterpret_cast<udf_init_fn>(plugin_symbol(plugin, "str_pipeline_init"))(&initid, &args, message), 0);
+	BOOST_SCOPE_EXIT( (plugin)(&initid) ) {
+		reinterpret_cast<udf_deinit_fn>(plugin_symbol(plugin, "str_pipeline_deinit"))(&initid);
+	} BOOST_SCOPE_EXIT_END
+
+	// 20 stages, whose scratch memory is 19 blocks of 4 KiB
+	std::string spec;
+	for (int i = 0; i < 10; ++i) {
+		spec += (i == 0 ? "trim|ucwords" : "|trim|ucwords");
+	}
+	std::string value = " hello  world ";
+
+	values[0] = const_cast<char *>("upper");
+	lengths[0] = 5;
+	values[1] = &value[0];
+	lengths[1] = value.size();
+	is_null = error = 0;
+	char *row = str_pipeline(&initid, &args, result, &length, &is_null, &error);
+	BOOST_REQUIRE(row != NULL);
+	BOOST_CHECK_EQUAL(std::string(row, length), " HELLO  WORLD ");
+
+	// enough for the spec to be compiled, but not for its scratch memory
+	plugin_set_memory_limit(plugin, static_cast<long long>(plugin_memory(plugin)) + 65536);
+	BOOST_SCOPE_EXIT( (plugin) ) {
+		plugin_set_memory_limit(plugin, 0);
+	} BOOST_SCOPE_EXIT_END
+
+	values[0] = &spec[0];
+	lengths[0] = spec.size();
+	for (int i = 0; i < 2; ++i) {
+		is_null = error = 0;
+		row = str_pipeline(&initid, &args, result, &length, &is_null, &error);
+		BOOST_CHECK_EQUAL(error, 1);
+		BOOST_CHECK(row == NULL);
+	}
+
+	plugin_set_memory_limit(plugin, 0);
+	is_null = error = 0;
+	row = str_pipeline(&initid, &args, result, &length, &is_null, &error);
+	BOOST_REQUIRE(row != NULL);
+	BOOST_CHECK_EQUAL(std::string(row, length), "Hello  World");
+}
+
+// str_lz4_compress() gives the same result for a value whatever the rows before it, and its
+// output buffer is sized from each row rather than from the longest argument the server allows.
+BOOST_AUTO_TEST_CASE(regression_test_str_lz4_compress_rows)
+{
+	void *plugin = dlopen(g_plugin_path, RTLD_NOW);
+	BOOST_REQUIRE_MESSAGE(plugin != NULL, dlerror());
+	BOOST_SCOPE_EXIT( (plugin) ) {
+		dlclose(plugin);
+	} BOOST_SCOPE_EXIT_END
+
+	udf_string_fn str_lz4_compress = reinterpret_cast<udf_string_fn>(plugin_symbol(plugin, "str_lz4_compress"));
+	Item_result type = STRING_RESULT;
+	char *value = NULL;
+	unsigned long length = 0xFFFFFFFFUL; // a LONGBLOB
+	char maybe_null = 1, message[MYSQL_ERRMSG_SIZE], result[255], is_null, error;
+	unsigned long res_length;
+	UDF_INIT initid;
+	UDF_ARGS args;
+
+	const unsigned long long memory = plugin_memory(plugin);
+	std::memset(&initid, 0, sizeof initid);
+	std::memset(&args, 0, sizeof args);
+	args.arg_count = 1;
+	args.arg_type = &type;
+	args.args = &value;
+	args.lengths = &length;
+	args.maybe_null = &maybe_null;
+	BOOST_REQUIRE_EQUAL(reinterpret_cast<udf_init_fn>(plugin_symbol(plugin, "str_lz4_compress_init"))(&initid, &args, message), 0);
+	BOOST_SCOPE_EXIT( (plugin)(&initid) ) {
+		reinterpret_cast<udf_deinit_fn>(plugin_symbol(plugin, "str_lz4_compress_deinit"))(&initid);
+	} BOOST_SCOPE_EXIT_END
+	BOOST_CHECK_LT(plugin_memory(plugin) - memory, 1024 * 1024);
+
+	// Strings of two letters, in which the entries left over from the other strings are often
+	// taken for matches.
+	unsigned seed = 1;
+	std::string strings[101];
+	for (int i = 0; i < 101; ++i) {
+		for (int j = 0; j < 100; ++j) {
+			seed = seed * 1103515245 + 12345;
+			strings[i] += "ab"[(seed >> 16) & 1];
+		}
+	}
+
+	std::string first;
+	for (int i = 0; i < 100; ++i) {
+		for (int k = 0; k < 2; ++k) {
+			std::string &s = strings[k == 0 ? 100 : i];
+			value = &s[0];
+			length = s.size();
+			is_null = error = 0;
+			const char *row = str_lz4_compress(&initid, &args, result, &res_length, &is_null, &error);
+			BOOST_REQUIRE(row != NULL);
+			if (k != 0) {
+				continue;
+			}
+			if (i == 0) {
+				first.assign(row, res_length);
+			} else {
+				BOOST_CHECK(std::string(row, res_length) == first);
+			}
+		}
+	}
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(test_lib_mysqludf_str_info)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT lib_mysqludf_str_info() AS info") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *pinfo_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(pinfo_field->name, "info");
+			BOOST_CHECK_EQUAL(pinfo_field->type, MYSQL_TYPE_VAR_STRING);
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(prow[0], "lib_mysqludf_str version 0.5");
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_lib_mysqludf_str_stats)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	// The second statement finds the translation table of the first one in the pattern cache.
+	for (int i = 0; i < 2; ++i) {
+		if (mysql_query(pconn, "SELECT str_translate('a string', 'ag', 'AG')") != 0) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			MYSQL_RES *pres = mysql_store_result(pconn);
+			if (pres == NULL) {
+				BOOST_ERROR(mysql_error(pconn));
+			} else {
+				mysql_free_result(pres);
+			}
+		}
+	}
+
+	if (mysql_query(pconn, "SELECT lib_mysqludf_str_stats() AS stats") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *pstats_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(pstats_field->name, "stats");
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(std::strncmp(prow[0], "{\"pattern_cache\":{\"entries\":", 28), 0);
+			const char *ppattern_cache_hits = std::strstr(prow[0], "\"hits\":");
+			BOOST_REQUIRE(ppattern_cache_hits != NULL);
+			BOOST_CHECK_NE(std::strtoul(ppattern_cache_hits + 7, NULL, 10), 0UL);
+			BOOST_CHECK(std::strstr(prow[0], "\"memo\":{\"hits\":") != NULL);
+			BOOST_CHECK(std::strstr(prow[0], "\"worker_pool\":{\"threads\":") != NULL);
+			BOOST_CHECK(std::strstr(prow[0], "\"memory\":{\"current\":") != NULL);
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_str_set_memory_limit)
+{
+	MYSQL *pconn = mysql_init(NULL);
+	BOOST_SCOPE_EXIT( (pconn) ) {
+		mysql_close(pconn);
+	} BOOST_SCOPE_EXIT_END
+
+	if (! mysql_real_connect(pconn, g_mysql_host, g_mysql_user, g_mysql_password, g_mysql_dbname, 0, NULL, 0)) {
+		BOOST_FAIL("failed to connect");
+	}
+
+	if (mysql_query(pconn, "SELECT str_set_memory_limit(1048576) AS `limit`, str_set_memory_limit(NULL)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_FIELD *plimit_field = mysql_fetch_field(pres);
+			BOOST_CHECK_EQUAL(plimit_field->name, "limit");
+			BOOST_CHECK_EQUAL(plimit_field->type, MYSQL_TYPE_LONGLONG);
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "1048576");
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[1]), "1048576");
+		}
+	}
+
+	// The result buffer for a LONGTEXT column would take the library over the limit.
+	if (mysql_query(pconn, "CREATE TEMPORARY TABLE texts (t LONGTEXT)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+	if (mysql_query(pconn, "INSERT INTO texts(t) VALUES ('a string')") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	}
+	BOOST_CHECK_NE(mysql_query(pconn, "SELECT str_rot13(t) FROM texts"), 0);
+	BOOST_CHECK(std::strstr(mysql_error(pconn), "limit") != NULL);
+
+	BOOST_CHECK_NE(mysql_query(pconn, "SELECT str_set_memory_limit(-1)"), 0);
+
+	if (mysql_query(pconn, "SELECT str_set_memory_limit(0)") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "0");
+		}
+	}
+
+	if (mysql_query(pconn, "SELECT str_rot13(t) FROM texts") != 0) {
+		BOOST_ERROR(mysql_error(pconn));
+	} else {
+		MYSQL_RES *pres = mysql_store_result(pconn);
+		if (pres == NULL) {
+			BOOST_ERROR(mysql_error(pconn));
+		} else {
+			BOOST_SCOPE_EXIT( (pres) ) {
+				mysql_free_result(pres);
+			} BOOST_SCOPE_EXIT_END
+
+			MYSQL_ROW prow = mysql_fetch_row(pres);
+			BOOST_REQUIRE_NE(prow, static_cast<MYSQL_ROW>(NULL));
+			BOOST_CHECK_EQUAL(static_cast<const char *>(prow[0]), "n fgevat");
 		}
 	}
 }
@@ -0,0 +1,176 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define BOOST_TEST_DYN_LINK 1
+#define BOOST_TEST_MODULE "record_stream tests"
+#include <boost/test/unit_test.hpp>
+
+#include "../../record_stream.h"
+
+namespace {
+
+// Copies each record, reserving exactly its length, as the commands of mysqludf_str do.
+int copy_records(void *ctx, const char *data, size_t length, st_record_output *out)
+{
+	const char *const end = data + length;
+
+	(void) ctx;
+	while (data != end)
+	{
+		const char *d = (const char *) std::memchr(data, '\n', (size_t) (end - data));
+		const size_t n = (size_t) ((d != NULL ? d : end) - data) + (d != NULL ? 1 : 0);
+		char *p = record_output_reserve(out, n);
+
+		if (p == NULL)
+			return ENOMEM;
+		std::memcpy(p, data, n);
+		out->length += n;
+		data += n;
+	}
+	return 0;
+}
+
+// Runs copy_records over `input` through pipes, and returns what was written.
+std::string run_stream(const std::string& input, unsigned threads, size_t batch_size, int *error)
+{
+	int out[2];
+	st_record_stream_options options;
+	st_record_stream_stats stats;
+	const char *where = NULL;
+	std::string result;
+	char buf[4096];
+	ssize_t n;
+	FILE *tmp = std::tmpfile();
+
+	BOOST_REQUIRE(tmp != NULL);
+	BOOST_REQUIRE(std::fwrite(input.data(), 1, input.size(), tmp) == input.size());
+	BOOST_REQUIRE(std::fflush(tmp) == 0);
+	std::rewind(tmp);
+	BOOST_REQUIRE(pipe(out) == 0);
+
+	std::memset(&options, 0, sizeof options);
+	options.delim = '\n';
+	options.threads = threads;
+	options.batch_size = batch_size;
+
+	// The output is smaller than the capacity of a pipe, so it can be read after the run.
+	*error = record_stream_run(fileno(tmp), out[1], &options, copy_records, NULL, &stats, &where);
+	close(out[1]);
+	while ((n = read(out[0], buf, sizeof buf)) > 0)
+		result.append(buf, (size_t) n);
+	close(out[0]);
+	std::fclose(tmp);
+	return result;
+}
+
+// Runs `mysqludf_str ARGS` with `input` on its standard input, and returns its exit status.
+int run_cli(const std::string& args, const std::string& input, std::string *output)
+{
+	char in_name[] = "/tmp/record_stream_test.XXXXXX";
+	const int fd = mkstemp(in_name);
+	std::string command;
+	FILE *p;
+	char buf[4096];
+	size_t n;
+	int status;
+
+	BOOST_REQUIRE(fd >= 0);
+	BOOST_REQUIRE(write(fd, input.data(), input.size()) == (ssize_t) input.size());
+	close(fd);
+
+	command = "../../mysqludf_str " + args + " < " + in_name;
+	p = popen(command.c_str(), "r");
+	BOOST_REQUIRE(p != NULL);
+	output->clear();
+	while ((n = std::fread(buf, 1, sizeof buf, p)) > 0)
+		output->append(buf, n);
+	status = pclose(p);
+	unlink(in_name);
+	return (WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(test_record_output_reserve)
+{
+	st_record_output out = { NULL, 0, 0 };
+	char *p;
+
+	// An empty reservation on a new output is not a failure.
+	p = record_output_reserve(&out, 0);
+	BOOST_REQUIRE(p != NULL);
+	BOOST_CHECK_EQUAL(out.length, 0u);
+
+	p = record_output_reserve(&out, 3);
+	BOOST_REQUIRE(p != NULL);
+	std::memcpy(p, "abc", 3);
+	out.length += 3;
+
+	p = record_output_reserve(&out, 0);
+	BOOST_CHECK(p == out.data + 3);
+
+	// Growing keeps what was appended.
+	p = record_output_reserve(&out, 100000);
+	BOOST_REQUIRE(p != NULL);
+	BOOST_CHECK(out.capacity - out.length >= 100000);
+	BOOST_CHECK_EQUAL(std::string(out.data, out.length), "abc");
+
+	std::free(out.data);
+}
+
+BOOST_AUTO_TEST_CASE(test_record_stream_empty_records)
+{
+	static const unsigned thread_counts[] = { 0, 1, 8, 16 };
+	std::string input = "\nabc\n\n";
+	size_t i;
+	int error;
+
+	for (i = 0; i < 1000; ++i)
+		input += (i % 3 == 0 ? "\n" : "record\n");
+
+	for (i = 0; i < sizeof thread_counts / sizeof thread_counts[0]; ++i)
+	{
+		// Batches of one record, some of which are empty.
+		BOOST_CHECK_EQUAL(run_stream(input, thread_counts[i], 1, &error), input);
+		BOOST_CHECK_EQUAL(error, 0);
+		BOOST_CHECK_EQUAL(run_stream(input, thread_counts[i], 0, &error), input);
+		BOOST_CHECK_EQUAL(error, 0);
+	}
+
+	BOOST_CHECK_EQUAL(run_stream("", 4, 0, &error), "");
+	BOOST_CHECK_EQUAL(error, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_cli)
+{
+	static const char *const threads[] = { "-t 0", "-t 8", "-t 16" };
+	std::string output;
+	size_t i;
+
+	for (i = 0; i < sizeof threads / sizeof threads[0]; ++i)
+	{
+		const std::string t = threads[i];
+
+		// Empty records, such as blank lines, give empty records.
+		BOOST_CHECK_EQUAL(run_cli(t + " -b 1 rot13", "\nabc\n\n", &output), 0);
+		BOOST_CHECK_EQUAL(output, "\nnop\n\n");
+		BOOST_CHECK_EQUAL(run_cli(t + " -b 1 translate ab xy", "\nabc\n", &output), 0);
+		BOOST_CHECK_EQUAL(output, "\nxyc\n");
+		BOOST_CHECK_EQUAL(run_cli(t + " -b 1 pipeline upper", "\nabc\n", &output), 0);
+		BOOST_CHECK_EQUAL(output, "\nABC\n");
+		BOOST_CHECK_EQUAL(run_cli(t + " -b 1 xor ''", "\n\n", &output), 0);
+		BOOST_CHECK_EQUAL(output, "\n\n");
+	}
+
+	BOOST_CHECK_EQUAL(run_cli("rot13", "abc\n\\N\nxyz", &output), 0);
+	BOOST_CHECK_EQUAL(output, "nop\n\\N\nklm");
+	BOOST_CHECK_EQUAL(run_cli("numtowords", "12\nx\n", &output), 0);
+	BOOST_CHECK_EQUAL(output, "twelve\n\\N\n");
+}
@@ -3,6 +3,8 @@
 // This code and all comments, written by Daniel Trebbien, are hereby entered into the Public Domain by their author.
 
 #include <algorithm>
+#include <climits>
+#include <string>
 
 #define BOOST_TEST_DYN_LINK 1
 #define BOOST_TEST_MODULE "string_utils tests"
@@ -73,3 +75,121 @@ BOOST_AUTO_TEST_CASE(test_x_strlcpy)
 	BOOST_CHECK_EQUAL(buf[4], '\0');
 	BOOST_CHECK_EQUAL(buf[5], 'a');
 }
+
+BOOST_AUTO_TEST_CASE(test_byte_map)
+{
+	unsigned char table[256];
+	char buf[10];
+
+	for (int i = 0; i < 256; ++i) {
+		table[i] = static_cast<unsigned char>(i);
+	}
+	table['a'] = 'x';
+	table[0xE9] = 'e';
+
+	// No byte is changed by the table.
+	BOOST_CHECK_EQUAL(byte_map_unchanged_length(table, "", 0), 0);
+	BOOST_CHECK_EQUAL(byte_map_unchanged_length(table, "bcd", 3), 3);
+	BOOST_CHECK_EQUAL(byte_map_unchanged_length(table, "bcdefghij", 9), 9);
+
+	// The first changed byte is in the unrolled part, or in the tail.
+	BOOST_CHECK_EQUAL(byte_map_unchanged_length(table, "bcadefghi", 9), 2);
+	BOOST_CHECK_EQUAL(byte_map_unchanged_length(table, "bcdefghia", 9), 8);
+	BOOST_CHECK_EQUAL(byte_map_unchanged_length(table, "bcdefgh\xE9", 8), 7);
+
+	// Only the length given is scanned.
+	BOOST_CHECK_EQUAL(byte_map_unchanged_length(table, "bcda", 3), 3);
+
+	std::fill(buf, buf + (sizeof buf), 'z');
+	byte_map(buf, table, "ab\xE9" "a", 4);
+	BOOST_CHECK_EQUAL(buf[0], 'x');
+	BOOST_CHECK_EQUAL(buf[1], 'b');
+	BOOST_CHECK_EQUAL(buf[2], 'e');
+	BOOST_CHECK_EQUAL(buf[3], 'x');
+	BOOST_CHECK_EQUAL(buf[4], 'z');
+}
+
+BOOST_AUTO_TEST_CASE(test_rot13)
+{
+	char buf[10];
+
+	std::fill(buf, buf + (sizeof buf), 'z');
+	rot13(buf, "Hello, Zz", 9);
+	BOOST_CHECK_EQUAL(std::string(buf, 9), "Uryyb, Mm");
+	BOOST_CHECK_EQUAL(buf[9], 'z');
+
+	// Bytes that are not ASCII letters are copied.
+	rot13(buf, "@[`{\xE9", 5);
+	BOOST_CHECK_EQUAL(std::string(buf, 5), "@[`{\xE9");
+}
+
+BOOST_AUTO_TEST_CASE(test_xor_bytes)
+{
+	char buf[10];
+
+	std::fill(buf, buf + (sizeof buf), 'z');
+	xor_bytes(buf, "abcdef", 6, "\x01\x02", 2);
+	BOOST_CHECK_EQUAL(std::string(buf, 6), "``cdef");
+	BOOST_CHECK_EQUAL(buf[6], 'z');
+
+	// With no shorter bytes, the longer ones are copied.
+	xor_bytes(buf, "abc", 3, "", 0);
+	BOOST_CHECK_EQUAL(std::string(buf, 3), "abc");
+}
+
+BOOST_AUTO_TEST_CASE(test_kernel_variants)
+{
+	unsigned char table[256];
+	char src[300], key[300], scalar[300], vector[300];
+
+	for (int i = 0; i < 256; ++i) {
+		table[i] = static_cast<unsigned char>(255 - i);
+	}
+	for (int i = 0; i < 300; ++i) {
+		src[i] = static_cast<char>(i * 7);
+		key[i] = static_cast<char>(i * 13 + 1);
+	}
+
+	// The variants agree at every length and offset, over all byte values, including those around
+	// the letters, and neither writes past the length.
+	for (size_t offset = 0; offset < 16; ++offset) {
+		for (size_t length = 0; length <= 256; ++length) {
+			std::fill(scalar, scalar + (sizeof scalar), 'z');
+			std::fill(vector, vector + (sizeof vector), 'z');
+			rot13_scalar(scalar + offset, src + offset, length);
+			rot13_vector(vector + offset, src + offset, length);
+			BOOST_REQUIRE(std::equal(scalar, scalar + (sizeof scalar), vector));
+
+			byte_map_scalar(scalar + offset, table, src + offset, length);
+			byte_map_vector(vector + offset, table, src + offset, length);
+			BOOST_REQUIRE(std::equal(scalar, scalar + (sizeof scalar), vector));
+
+			xor_bytes_scalar(scalar + offset, src + offset, length, key, length / 3);
+			xor_bytes_vector(vector + offset, src + offset, length, key, length / 3);
+			BOOST_REQUIRE(std::equal(scalar, scalar + (sizeof scalar), vector));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(test_numtowords)
+{
+	char buf[NUMTOWORDS_MAX_LENGTH];
+	size_t length;
+
+	length = numtowords(buf, 0);
+	BOOST_CHECK_EQUAL(std::string(buf, length), "zero");
+
+	length = numtowords(buf, -1042);
+	BOOST_CHECK_EQUAL(std::string(buf, length), "negative one thousand forty-two");
+
+	length = numtowords(buf, 1000000);
+	BOOST_CHECK_EQUAL(std::string(buf, length), "one million");
+
+	length = numtowords(buf, 120);
+	BOOST_CHECK_EQUAL(std::string(buf, length), "one hundred twenty");
+
+	// The longest result, whose magnitude does not fit in a long long.
+	length = numtowords(buf, LLONG_MIN);
+	BOOST_CHECK(length <= NUMTOWORDS_MAX_LENGTH);
+	BOOST_CHECK_EQUAL(std::string(buf, length), "negative nine quintillion two hundred twenty-three quadrillion three hundred seventy-two trillion thirty-six billion eight hundred fifty-four million seven hundred seventy-five thousand eight hundred eight");
+}
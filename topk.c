@@ -0,0 +1,301 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "str_alloc.h"
+#include "str_hash.h"
+#include "topk.h"
+
+#define TOPK_SEED UINT64_C(0x544F504B544F504B)
+
+/* Size of the arena chunks that hold the terms and the buckets */
+#define TOPK_ARENA_CHUNK_SIZE (64 * 1024)
+
+typedef struct st_topk_bucket st_topk_bucket;
+
+typedef struct st_topk_counter
+{
+	st_topk_bucket *bucket; /* the bucket of the count of the counter */
+	struct st_topk_counter *prev, *next; /* the other counters of the bucket */
+	char *term; /* a block from arena_alloc_block() */
+	size_t term_length;
+	uint64_t hash;
+	uint64_t error;
+} st_topk_counter;
+
+/* The counters that have the same count. Buckets form a list by increasing count, so that the
+   counters with the smallest count are found in constant time, and incrementing a counter moves
+   it to the next bucket. */
+struct st_topk_bucket
+{
+	uint64_t count;
+	st_topk_bucket *prev, *next;
+	st_topk_counter *counters;
+};
+
+struct st_topk
+{
+	size_t capacity;
+	size_t used; /* counters[0, used) are in use */
+	st_topk_counter *counters;
+
+	/* Open addressing hash table with linear probing: 1 + the index of a counter, or 0 */
+	uint32_t *table;
+	size_t table_mask;
+
+	st_topk_bucket *min_bucket;
+	st_topk_bucket *max_bucket;
+
+	st_arena arena;
+};
+
+st_topk *topk_alloc(size_t capacity)
+{
+	st_topk *tk;
+	size_t table_size = 16;
+
+	if (capacity == 0 || capacity > TOPK_MAX_CAPACITY)
+		return NULL;
+
+	// At most half of the slots are used.
+	while (table_size < 2 * capacity)
+		table_size *= 2;
+
+	tk = (st_topk *) str_calloc(1, sizeof (st_topk));
+	if (tk == NULL)
+		return NULL;
+
+	tk->capacity = capacity;
+	tk->table_mask = table_size - 1;
+	tk->counters = (st_topk_counter *) str_malloc(capacity * sizeof (st_topk_counter));
+	tk->table = (uint32_t *) str_calloc(table_size, sizeof (uint32_t));
+	arena_init(&tk->arena, TOPK_ARENA_CHUNK_SIZE);
+
+	if (tk->counters == NULL || tk->table == NULL)
+	{
+		topk_free(tk);
+		return NULL;
+	}
+
+	return tk;
+}
+
+void topk_free(st_topk *tk)
+{
+	arena_free(&tk->arena);
+	str_free(tk->table);
+	str_free(tk->counters);
+	str_free(tk);
+}
+
+void topk_clear(st_topk *tk)
+{
+	if (tk->used == 0)
+		return;
+
+	memset(tk->table, 0, (tk->table_mask + 1) * sizeof (uint32_t));
+	arena_reset(&tk->arena);
+	tk->used = 0;
+	tk->min_bucket = tk->max_bucket = NULL;
+}
+
+/* Returns a new bucket of `count` inserted after `after`, or at the front if that is NULL. */
+static st_topk_bucket *topk_bucket_insert(st_topk *tk, st_topk_bucket *after, uint64_t count)
+{
+	st_topk_bucket *b = (st_topk_bucket *) arena_alloc_block(&tk->arena, sizeof (st_topk_bucket));
+
+	if (b == NULL)
+		return NULL;
+
+	b->count = count;
+	b->counters = NULL;
+	b->prev = after;
+	b->next = (after != NULL ? after->next : tk->min_bucket);
+
+	if (b->next != NULL)
+		b->next->prev = b;
+	else
+		tk->max_bucket = b;
+
+	if (after != NULL)
+		after->next = b;
+	else
+		tk->min_bucket = b;
+
+	return b;
+}
+
+static void topk_bucket_attach(st_topk_bucket *b, st_topk_counter *c)
+{
+	c->bucket = b;
+	c->prev = NULL;
+	c->next = b->counters;
+	if (b->counters != NULL)
+		b->counters->prev = c;
+	b->counters = c;
+}
+
+/* Removes c from its bucket, and the bucket from the list if it becomes empty. */
+static void topk_bucket_detach(st_topk *tk, st_topk_counter *c)
+{
+	st_topk_bucket *b = c->bucket;
+
+	if (c->prev != NULL)
+		c->prev->next = c->next;
+	else
+		b->counters = c->next;
+	if (c->next != NULL)
+		c->next->prev = c->prev;
+
+	if (b->counters != NULL)
+		return;
+
+	if (b->prev != NULL)
+		b->prev->next = b->next;
+	else
+		tk->min_bucket = b->next;
+	if (b->next != NULL)
+		b->next->prev = b->prev;
+	else
+		tk->max_bucket = b->prev;
+
+	arena_free_block(&tk->arena, b, sizeof (st_topk_bucket));
+}
+
+static int topk_increment(st_topk *tk, st_topk_counter *c)
+{
+	st_topk_bucket *b = c->bucket;
+	st_topk_bucket *next = b->next;
+
+	if (next == NULL || next->count != b->count + 1)
+	{
+		next = topk_bucket_insert(tk, b, b->count + 1);
+		if (next == NULL)
+			return 1;
+	}
+
+	topk_bucket_detach(tk, c);
+	topk_bucket_attach(next, c);
+	return 0;
+}
+
+/* Returns the slot of the term, or the empty slot where it would be inserted. */
+static size_t topk_find_slot(const st_topk *tk, uint64_t hash, const char *term, size_t term_length)
+{
+	size_t i = (size_t) hash & tk->table_mask;
+
+	while (tk->table[i] != 0)
+	{
+		const st_topk_counter *c = tk->counters + tk->table[i] - 1;
+		if (c->hash == hash && c->term_length == term_length && memcmp(c->term, term, term_length) == 0)
+			break;
+		i = (i + 1) & tk->table_mask;
+	}
+
+	return i;
+}
+
+/* Empties slot i, moving later entries of its cluster back so that lookups still find them. */
+static void topk_table_remove(st_topk *tk, size_t i)
+{
+	size_t j = i;
+
+	for (;;)
+	{
+		size_t home;
+
+		j = (j + 1) & tk->table_mask;
+		if (tk->table[j] == 0)
+			break;
+
+		home = (size_t) tk->counters[tk->table[j] - 1].hash & tk->table_mask;
+		if (((j - home) & tk->table_mask) >= ((j - i) & tk->table_mask))
+		{
+			tk->table[i] = tk->table[j];
+			i = j;
+		}
+	}
+
+	tk->table[i] = 0;
+}
+
+int topk_add(st_topk *tk, const char *term, size_t term_length)
+{
+	const uint64_t hash = str_hash64(term, term_length, TOPK_SEED);
+	size_t slot = topk_find_slot(tk, hash, term, term_length);
+	st_topk_counter *c;
+	char *copy;
+
+	if (tk->table[slot] != 0)
+		return topk_increment(tk, tk->counters + tk->table[slot] - 1);
+
+	copy = (char *) arena_alloc_block(&tk->arena, term_length);
+	if (copy == NULL)
+		return 1;
+	memcpy(copy, term, term_length);
+
+	if (tk->used < tk->capacity)
+	{
+		st_topk_bucket *ones = tk->min_bucket;
+
+		if (ones == NULL || ones->count != 1)
+		{
+			ones = topk_bucket_insert(tk, NULL, 1);
+			if (ones == NULL)
+			{
+				arena_free_block(&tk->arena, copy, term_length);
+				return 1;
+			}
+		}
+
+		c = tk->counters + tk->used++;
+		c->term = copy;
+		c->term_length = term_length;
+		c->hash = hash;
+		c->error = 0;
+		topk_bucket_attach(ones, c);
+		tk->table[slot] = (uint32_t) tk->used;
+		return 0;
+	}
+
+	// Take over a counter with the smallest count. Its count becomes the error of the new term.
+	c = tk->min_bucket->counters;
+	topk_table_remove(tk, topk_find_slot(tk, c->hash, c->term, c->term_length));
+	arena_free_block(&tk->arena, c->term, c->term_length);
+
+	c->term = copy;
+	c->term_length = term_length;
+	c->hash = hash;
+	c->error = c->bucket->count;
+	tk->table[topk_find_slot(tk, hash, term, term_length)] = (uint32_t) (c - tk->counters) + 1;
+
+	return topk_increment(tk, c);
+}
+
+size_t topk_top(const st_topk *tk, st_topk_entry *entries, size_t k)
+{
+	const st_topk_bucket *b;
+	size_t n = 0;
+
+	for (b = tk->max_bucket; b != NULL && n < k; b = b->prev)
+	{
+		const st_topk_counter *c;
+
+		for (c = b->counters; c != NULL && n < k; c = c->next, ++n)
+		{
+			entries[n].term = c->term;
+			entries[n].term_length = c->term_length;
+			entries[n].count = b->count;
+			entries[n].error = c->error;
+		}
+	}
+
+	return n;
+}
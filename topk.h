@@ -0,0 +1,67 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	Heavy hitters with the Space-Saving algorithm and its Stream-Summary structure (Metwally,
+	Agrawal and El Abbadi, "Efficient Computation of Frequent and Top-k Elements in Data Streams",
+	2005).
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_TOPK_H
+#define LIB_MYSQLUDF_STR_TOPK_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The largest number of counters of a summary. */
+#define TOPK_MAX_CAPACITY (1 << 20)
+
+typedef struct st_topk st_topk;
+
+/** One of the most frequent terms of a summary. */
+typedef struct st_topk_entry
+{
+	const char *term;
+	size_t term_length;
+	uint64_t count; /* an upper bound of the number of occurrences of the term */
+	uint64_t error; /* count - error is a lower bound of the number of occurrences */
+} st_topk_entry;
+
+/** Allocates an empty summary of @p capacity counters, which must be in
+ * <code>[1, TOPK_MAX_CAPACITY]</code>. Its memory does not depend on the number of distinct terms
+ * that are added, only on @p capacity and on the lengths of the terms.
+ *
+ * @returns a pointer to the summary, or NULL if memory could not be allocated. It must be freed
+ *		with topk_free(). */
+st_topk *topk_alloc(size_t capacity);
+
+/** Frees @p tk and all of its memory. */
+void topk_free(st_topk *tk);
+
+/** Empties @p tk, keeping its memory for reuse. */
+void topk_clear(st_topk *tk);
+
+/** Counts one occurrence of the @p term_length bytes at @p term.
+ *
+ * If the term has a counter, it is incremented. Otherwise, the term gets a free counter, or
+ * takes over a counter with the smallest count, inheriting that count as its error.
+ *
+ * @returns 0 if successful, or a non-zero value if memory could not be allocated. */
+int topk_add(st_topk *tk, const char *term, size_t term_length);
+
+/** Stores the at most @p k terms of @p tk with the largest counts in @p entries, by decreasing
+ * count. The terms point into @p tk and are valid until it is next modified.
+ *
+ * @returns the number of entries stored. */
+size_t topk_top(const st_topk *tk, st_topk_entry *entries, size_t k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
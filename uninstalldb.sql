@@ -1,6 +1,7 @@
 use mysql;
 
 drop function if exists lib_mysqludf_str_info;
+drop function if exists lib_mysqludf_str_stats;
 drop function if exists str_numtowords;
 drop function if exists str_rot13;
 drop function if exists str_shuffle;
@@ -9,3 +10,18 @@ drop function if exists str_ucfirst;
 drop function if exists str_ucwords;
 drop function if exists str_xor;
 drop function if exists str_srand;
+drop function if exists str_csv_field;
+drop function if exists str_kv_get;
+drop function if exists str_lz4_compress;
+drop function if exists str_lz4_decompress;
+drop function if exists str_simhash;
+drop function if exists str_hamming;
+drop function if exists str_bloom_build;
+drop function if exists str_bloom_contains;
+drop function if exists str_hll_build;
+drop function if exists str_hll_merge;
+drop function if exists str_hll_count;
+drop function if exists str_topk;
+drop function if exists str_agg;
+drop function if exists str_pipeline;
+drop function if exists str_set_memory_limit;
@@ -0,0 +1,247 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "worker_pool.h"
+
+/* The threads must be stopped before the library is unloaded, which needs a destructor. Elsewhere
+   the work is done by the calling thread. */
+#if defined(__GNUC__) && !defined(_WIN32)
+#define WORKER_POOL_THREADS 1
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef WORKER_POOL_THREADS
+
+/* The work on one value. It lives on the stack of the calling thread, which does not return before
+   the threads of the pool that took part are done with it. */
+typedef struct st_worker_pool_job
+{
+	worker_pool_fn fn;
+	void *ctx;
+	size_t length;
+	size_t next;       /* the start of the first range that no thread has taken yet */
+	unsigned wanted;   /* the number of threads of the pool that can still join */
+	unsigned helpers;  /* the number of threads of the pool working on the job */
+	struct st_worker_pool_job *next_job;
+} st_worker_pool_job;
+
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_work = PTHREAD_COND_INITIALIZER; /* a job was queued, or shutdown */
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER; /* a thread left a job */
+
+static int pool_started;
+static int pool_shutdown;
+static unsigned pool_num_threads;
+static pthread_t pool_threads[WORKER_POOL_MAX_THREADS];
+
+/* The jobs that threads can join, oldest first */
+static st_worker_pool_job *pool_jobs;
+
+static st_worker_pool_stats pool_stats;
+
+/* Returns the number of threads to start. */
+static unsigned worker_pool_size(void)
+{
+	const char *s = getenv("LIB_MYSQLUDF_STR_THREADS");
+	long n;
+
+	if (s != NULL && *s != '\0')
+	{
+		char *end;
+		n = strtol(s, &end, 10);
+		if (*end != '\0' || n < 0)
+			n = 0;
+	}
+	else
+	{
+		n = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+	}
+
+	if (n <= 0)
+		return 0;
+	return (n > WORKER_POOL_MAX_THREADS ? WORKER_POOL_MAX_THREADS : (unsigned) n);
+}
+
+/* Removes job from the queue if it is in it. Called with the lock held. */
+static void worker_pool_dequeue(st_worker_pool_job *job)
+{
+	st_worker_pool_job **p;
+
+	for (p = &pool_jobs; *p != NULL; p = &(*p)->next_job)
+	{
+		if (*p == job)
+		{
+			*p = job->next_job;
+			return;
+		}
+	}
+}
+
+/* Processes the ranges of job that are left, and returns the number of them. Called with the lock
+   held, which is released while fn runs. */
+static uint64_t worker_pool_work(st_worker_pool_job *job)
+{
+	uint64_t chunks = 0;
+
+	while (job->next < job->length)
+	{
+		const size_t begin = job->next;
+		const size_t end = (job->length - begin > WORKER_POOL_CHUNK_SIZE ? begin + WORKER_POOL_CHUNK_SIZE : job->length);
+
+		job->next = end;
+		if (end == job->length)
+			worker_pool_dequeue(job);
+
+		pthread_mutex_unlock(&pool_lock);
+		job->fn(job->ctx, begin, end);
+		pthread_mutex_lock(&pool_lock);
+		++chunks;
+	}
+
+	return chunks;
+}
+
+static void *worker_pool_thread(void *arg)
+{
+	(void) arg;
+
+	pthread_mutex_lock(&pool_lock);
+	for (;;)
+	{
+		st_worker_pool_job *job = pool_jobs;
+
+		while (job != NULL && job->wanted == 0)
+			job = job->next_job;
+
+		if (job == NULL)
+		{
+			if (pool_shutdown)
+				break;
+			pthread_cond_wait(&pool_work, &pool_lock);
+			continue;
+		}
+
+		--job->wanted;
+		++job->helpers;
+		pool_stats.chunks += worker_pool_work(job);
+		if (--job->helpers == 0)
+			pthread_cond_broadcast(&pool_done);
+	}
+	pthread_mutex_unlock(&pool_lock);
+
+	return NULL;
+}
+
+/* Starts the threads. Called with the lock held. */
+static void worker_pool_start(void)
+{
+	const unsigned n = worker_pool_size();
+	unsigned i;
+
+	pool_started = 1;
+
+	for (i = 0; i < n; ++i)
+	{
+		if (pthread_create(&pool_threads[i], NULL, worker_pool_thread, NULL) != 0)
+			break;
+	}
+
+	pool_num_threads = i;
+	pool_stats.threads = i;
+}
+
+void worker_pool_run(size_t length, worker_pool_fn fn, void *ctx)
+{
+	st_worker_pool_job job;
+	size_t num_chunks;
+
+	if (length < WORKER_POOL_MIN_LENGTH)
+	{
+		fn(ctx, 0, length);
+		return;
+	}
+
+	pthread_mutex_lock(&pool_lock);
+
+	if (!pool_started)
+		worker_pool_start();
+
+	if (pool_num_threads == 0 || pool_shutdown)
+	{
+		pthread_mutex_unlock(&pool_lock);
+		fn(ctx, 0, length);
+		return;
+	}
+
+	num_chunks = (length + WORKER_POOL_CHUNK_SIZE - 1) / WORKER_POOL_CHUNK_SIZE;
+
+	memset(&job, 0, sizeof job);
+	job.fn = fn;
+	job.ctx = ctx;
+	job.length = length;
+	job.wanted = (num_chunks - 1 < pool_num_threads ? (unsigned) (num_chunks - 1) : pool_num_threads);
+	job.next_job = NULL;
+
+	// Queue the job after the others, so that threads that are busy with other values finish them
+	// first, and work on this one too.
+	{
+		st_worker_pool_job **p = &pool_jobs;
+		while (*p != NULL)
+			p = &(*p)->next_job;
+		*p = &job;
+	}
+	++pool_stats.jobs;
+	pthread_cond_broadcast(&pool_work);
+
+	worker_pool_work(&job);
+
+	// The ranges are all taken; wait for the threads that are still working on theirs.
+	while (job.helpers != 0)
+		pthread_cond_wait(&pool_done, &pool_lock);
+
+	pthread_mutex_unlock(&pool_lock);
+}
+
+void worker_pool_get_stats(st_worker_pool_stats *stats)
+{
+	pthread_mutex_lock(&pool_lock);
+	*stats = pool_stats;
+	pthread_mutex_unlock(&pool_lock);
+}
+
+/* Stops the threads when the library is unloaded, after the last DROP FUNCTION. No statement is
+   running then, so the threads are all waiting for work. */
+__attribute__((destructor))
+static void worker_pool_shutdown(void)
+{
+	unsigned i;
+
+	pthread_mutex_lock(&pool_lock);
+	pool_shutdown = 1;
+	pthread_cond_broadcast(&pool_work);
+	pthread_mutex_unlock(&pool_lock);
+
+	for (i = 0; i < pool_num_threads; ++i)
+		pthread_join(pool_threads[i], NULL);
+}
+
+#else
+
+void worker_pool_run(size_t length, worker_pool_fn fn, void *ctx)
+{
+	fn(ctx, 0, length);
+}
+
+void worker_pool_get_stats(st_worker_pool_stats *stats)
+{
+	memset(stats, 0, sizeof *stats);
+}
+
+#endif
@@ -0,0 +1,57 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+
+	A process-wide pool of threads that split the work of functions on very large values by byte
+	range. The threads are started by the first value that is large enough, and wait for work
+	while there is none. All statements share them, so that the number of threads the library
+	adds to the server is bounded however many statements run.
+*/
+
+#pragma once
+#ifndef LIB_MYSQLUDF_STR_WORKER_POOL_H
+#define LIB_MYSQLUDF_STR_WORKER_POOL_H 1
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Work on fewer bytes is done by the calling thread alone. */
+#define WORKER_POOL_MIN_LENGTH (4 * 1024 * 1024)
+
+/** The size of the ranges that threads take one at a time. */
+#define WORKER_POOL_CHUNK_SIZE (1024 * 1024)
+
+/** The largest number of threads of the pool. By default, it has one thread less than there are
+ * processors, up to this number. It can be changed with the environment variable
+ * @c LIB_MYSQLUDF_STR_THREADS of the server; 0 disables the pool. */
+#define WORKER_POOL_MAX_THREADS 64
+
+/** Processes the bytes <code>[begin, end)</code> of the work described by @p ctx. */
+typedef void (*worker_pool_fn)(void *ctx, size_t begin, size_t end);
+
+typedef struct st_worker_pool_stats
+{
+	uint64_t threads; /* the number of threads of the pool, 0 until it is started */
+	uint64_t jobs;    /* the number of values that were split */
+	uint64_t chunks;  /* the number of ranges processed by threads of the pool */
+} st_worker_pool_stats;
+
+/** Calls @p fn on ranges that cover <code>[0, length)</code> exactly once, and returns once all of
+ * them are processed. If @p length is at least @c WORKER_POOL_MIN_LENGTH, ranges are processed
+ * concurrently by the calling thread and idle threads of the pool, so @p fn must only write to the
+ * range it is given. Otherwise, or if the pool cannot be used, @p fn is called once for the whole
+ * range by the calling thread. */
+void worker_pool_run(size_t length, worker_pool_fn fn, void *ctx);
+
+/** Stores the statistics of the pool since the library was loaded in @p stats. */
+void worker_pool_get_stats(st_worker_pool_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
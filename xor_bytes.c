@@ -0,0 +1,52 @@
+/* -*- coding: utf-8; tab-width: 2; c-basic-offset: 2; indent-tabs-mode: t -*- */
+/*
+	This file is part of lib_mysqludf_str and is distributed under the terms of
+	the GNU Lesser General Public License, version 2.1 or later. See COPYING.
+*/
+
+#include <string.h>
+
+#include "kernel_isa.h"
+#include "kernel_tuning.h"
+#include "string_utils.h"
+
+void xor_bytes_scalar(char *__restrict dest, const char *longer, size_t length, const char *shorter, size_t shorter_length)
+{
+	const size_t xor_end = (length < shorter_length ? length : shorter_length);
+	size_t i;
+
+	for (i = 0; i < xor_end; ++i)
+		dest[i] = longer[i] ^ shorter[i];
+
+	// '\x00' ^ (*longer) == *longer
+	if (i < length)
+		memcpy(dest + i, longer + i, length - i);
+}
+
+/* xor_bytes_vector() with the transform of an instruction set */
+static void xor_bytes_isa(const st_kernel_isa *isa, char *__restrict dest, const char *longer, size_t length, const char *shorter, size_t shorter_length)
+{
+	const size_t xor_end = (length < shorter_length ? length : shorter_length);
+
+	isa->transforms[KERNEL_TRANSFORM_xor]((unsigned char *) dest, (const unsigned char *) longer,
+			(const unsigned char *) shorter, xor_end);
+
+	if (xor_end < length)
+		memcpy(dest + xor_end, longer + xor_end, length - xor_end);
+}
+
+void xor_bytes_vector(char *__restrict dest, const char *longer, size_t length, const char *shorter, size_t shorter_length)
+{
+	xor_bytes_isa(kernel_isa(), dest, longer, length, shorter, shorter_length);
+}
+
+void xor_bytes(char *__restrict dest, const char *longer, size_t length, const char *shorter, size_t shorter_length)
+{
+	const st_kernel_isa *isa = kernel_isa();
+
+	// the calibrated length, but not below that of the narrowest vectors of the instruction set
+	if (length >= STR_TUNING_XOR_MIN_LENGTH && length >= isa->min_width)
+		xor_bytes_isa(isa, dest, longer, length, shorter, shorter_length);
+	else
+		xor_bytes_scalar(dest, longer, length, shorter, shorter_length);
+}